@@ -2,7 +2,12 @@
 #include <comdef.h>
 #include <wrl.h>
 #include <wincodec.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
 #include "Engine.h"
+#include "ObjParser.h"
+#include "TangentGenerator.h"
 
 
 void Actor::UpdateTransformationMat()
@@ -14,87 +19,103 @@ void Actor::UpdateTransformationMat()
 
 void Actor::CalculateTangents()
 {
-	typedef WaveFrontReader<DWORD>::Vertex ReaderVertex;
+	TangentGenerator::Generate(m_verticesWithTangents, m_objIndices, TangentGenerator::SelectKernel(),
+		ThreadPool::GetShared());
+}
 
-	vector<DWORD>& indices = waveFrontReader.indices;
-	vector<ReaderVertex>& vertices = waveFrontReader.vertices;
+void Actor::WeldVertices()
+{
+	VertexWelder::Weld(m_verticesWithTangents, m_objIndices, VertexWelder::GetDefaultEpsilons(), m_weldStats);
+
+	char message[128];
+	sprintf_s(message, "vertices welded: %u -> %u (%.1f%% fewer)\n",
+		m_weldStats.verticesBefore, m_weldStats.verticesAfter,
+		m_weldStats.verticesBefore > 0 ?
+		100.0f * (m_weldStats.verticesBefore - m_weldStats.verticesAfter) / m_weldStats.verticesBefore : 0.0f);
+	OutputDebugStringA(message);
+}
 
-	for (DWORD indexOfIndex = 0; indexOfIndex < indices.size(); indexOfIndex += 3)
+void Actor::OptimizeMesh()
+{
+	if (!MeshOptimizer::Optimize(m_verticesWithTangents, m_objIndices, m_optimizerStats))
 	{
-		DWORD vertexIndex0 = indices[indexOfIndex];
-		ReaderVertex& readerVertex0 = vertices[vertexIndex0];
-		XMVECTOR vertexPos0 = XMLoadFloat3(&readerVertex0.position);
-		XMVECTOR texCoord0 = XMLoadFloat2(&readerVertex0.textureCoordinate);
-
-		DWORD vertexIndex1 = indices[indexOfIndex + 1];
-		ReaderVertex& readerVertex1 = vertices[vertexIndex1];
-		XMVECTOR vertexPos1 = XMLoadFloat3(&readerVertex1.position);
-		XMVECTOR texCoord1 = XMLoadFloat2(&readerVertex1.textureCoordinate);
-
-		DWORD vertexIndex2 = indices[indexOfIndex + 2];
-		ReaderVertex& readerVertex2 = vertices[vertexIndex2];
-		XMVECTOR vertexPos2 = XMLoadFloat3(&readerVertex2.position);
-		XMVECTOR texCoord2 = XMLoadFloat2(&readerVertex2.textureCoordinate);
-
-		XMVECTOR deltaPos0Vec = vertexPos0 - vertexPos2;
-		deltaPos0Vec = XMVector3Normalize(deltaPos0Vec);
-		XMFLOAT3 deltaPos0;
-		XMStoreFloat3(&deltaPos0, deltaPos0Vec);
-
-		XMVECTOR deltaPos1Vec = vertexPos2 - vertexPos1;
-		deltaPos1Vec = XMVector3Normalize(deltaPos1Vec);
-		XMFLOAT3 deltaPos1;
-		XMStoreFloat3(&deltaPos1, deltaPos1Vec);
-
-		XMVECTOR deltaTexCoordVec0 = texCoord1 - texCoord0;
-		deltaTexCoordVec0 = XMVector2Normalize(deltaTexCoordVec0);
-		XMFLOAT2 deltaTexCoord0;
-		XMStoreFloat2(&deltaTexCoord0, deltaTexCoordVec0);
-
-		XMVECTOR deltaTexCoord1Vec = texCoord2 - texCoord0;
-		deltaTexCoord1Vec = XMVector2Normalize(deltaTexCoord1Vec);
-		XMFLOAT2 deltaTexCoord1;
-		XMStoreFloat2(&deltaTexCoord1, deltaTexCoord1Vec);
-
-		float det = (deltaTexCoord0.x * deltaTexCoord1.y - deltaTexCoord0.y * deltaTexCoord1.x);
-
-		XMVECTOR tangent = (deltaPos0Vec * deltaTexCoord0.y - deltaPos1Vec * deltaTexCoord1.y) / det;
-		tangent = XMVector3Normalize(tangent);
-
-		XMVECTOR tangentSum0 = XMLoadFloat3(&m_verticesWithTangents[vertexIndex0].tangent) + tangent;
-		XMVECTOR tangentSum1 = XMLoadFloat3(&m_verticesWithTangents[vertexIndex1].tangent) + tangent;
-		XMVECTOR tangentSum2 = XMLoadFloat3(&m_verticesWithTangents[vertexIndex2].tangent) + tangent;
-
-		XMStoreFloat3(&m_verticesWithTangents[vertexIndex0].tangent, tangentSum0);
-		XMStoreFloat3(&m_verticesWithTangents[vertexIndex1].tangent, tangentSum1);
-		XMStoreFloat3(&m_verticesWithTangents[vertexIndex2].tangent, tangentSum2);
+		exit(-1);
 	}
 
-	vector<UINT> verticesRepeatings(vertices.size());
-	
-	for (int i = 0; i < vertices.size(); ++i)
+	char message[128];
+	sprintf_s(message, "mesh optimized: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		m_optimizerStats.acmrBefore, m_optimizerStats.acmrAfter,
+		m_optimizerStats.atvrBefore, m_optimizerStats.atvrAfter);
+	OutputDebugStringA(message);
+}
+
+void Actor::BuildLods()
+{
+	MeshSimplifier::BuildLods(m_verticesWithTangents, m_objIndices, m_objLods);
+
+	for (size_t i = 0; i < m_objLods.size(); ++i)
 	{
-		verticesRepeatings[i] = 0;
+		char message[128];
+		sprintf_s(message, "LOD %zu: %u triangles, error %g\n", i, m_objLods[i].indexCount / 3, m_objLods[i].error);
+		OutputDebugStringA(message);
 	}
+}
+
+void Actor::CalculateBounds()
+{
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
 
-	for (DWORD index : indices)
+	for (const Vertex& vertex : m_verticesWithTangents)
 	{
-		++verticesRepeatings[index];
+		XMVECTOR position = XMLoadFloat3(&vertex.position);
+		boundsMin = XMVectorMin(boundsMin, position);
+		boundsMax = XMVectorMax(boundsMax, position);
 	}
 
-	for (int i = 0; i < vertices.size(); ++i)
+	XMStoreFloat3(&m_boundsMin, boundsMin);
+	XMStoreFloat3(&m_boundsMax, boundsMax);
+}
+
+void Actor::CalculateUvDensity()
+{
+	// from the texture coordinate area and the surface area of LOD 0
+	const MeshLod& lod = GetLod(0);
+	double surfaceArea = 0.0;
+	double uvArea = 0.0;
+
+	for (UINT i = lod.indexOffset; i + 2 < lod.indexOffset + lod.indexCount; i += 3)
 	{
-		XMVECTOR vertexTangentAvg = XMLoadFloat3(&m_verticesWithTangents[i].tangent);
-		vertexTangentAvg /= verticesRepeatings[i];
-		XMStoreFloat3(&m_verticesWithTangents[i].tangent, vertexTangentAvg);
+		const Vertex& vertex0 = m_vertices[m_indices[i]];
+		const Vertex& vertex1 = m_vertices[m_indices[i + 1]];
+		const Vertex& vertex2 = m_vertices[m_indices[i + 2]];
+
+		XMVECTOR position0 = XMLoadFloat3(&vertex0.position);
+		XMVECTOR edgeCross = XMVector3Cross(XMLoadFloat3(&vertex1.position) - position0, XMLoadFloat3(&vertex2.position) - position0);
+		surfaceArea += 0.5 * XMVectorGetX(XMVector3Length(edgeCross));
+
+		float deltaU1 = vertex1.textureCoordinate.x - vertex0.textureCoordinate.x;
+		float deltaV1 = vertex1.textureCoordinate.y - vertex0.textureCoordinate.y;
+		float deltaU2 = vertex2.textureCoordinate.x - vertex0.textureCoordinate.x;
+		float deltaV2 = vertex2.textureCoordinate.y - vertex0.textureCoordinate.y;
+		uvArea += 0.5 * fabs(deltaU1 * deltaV2 - deltaU2 * deltaV1);
 	}
+
+	m_uvDensity = surfaceArea > 0.0 ? static_cast<float>(sqrt(uvArea / surfaceArea)) : 0.0f;
 }
 
 Actor::Actor(Engine* const engine)
-	: m_albedoTex(engine),
-	m_normalTex(engine),
-	m_occlusionTex(engine),
-	m_roughnessTex(engine)
+	: m_vertices(nullptr),
+	m_vertexCount(0),
+	m_indices(nullptr),
+	m_indexCount(0),
+	m_lods(nullptr),
+	m_lodCount(0),
+	m_boundsMin(0.0f, 0.0f, 0.0f),
+	m_boundsMax(0.0f, 0.0f, 0.0f),
+	m_uvDensity(0.0f),
+	m_weldStats(),
+	m_optimizerStats()
 {
 	m_engine = engine;
 
@@ -149,103 +170,213 @@ XMMATRIX Actor::GetWorldMat() const
 
 void Actor::LoadObjFromFile(const wchar_t* const fileName)
 {
-	typedef WaveFrontReader<DWORD>::Vertex ReaderVertex;
+	ObjParser objParser(ThreadPool::GetShared());
 
-	HRESULT hr = waveFrontReader.Load(fileName);
-	if (FAILED(hr))
+	if (!objParser.Load(fileName, m_verticesWithTangents, m_objIndices))
 	{
 		exit(-1);
 	}
 
-	for (const ReaderVertex& readerVertex : waveFrontReader.vertices)
+	CalculateTangents();
+	WeldVertices();
+	OptimizeMesh();
+	BuildLods();
+	CalculateBounds();
+
+	m_cookedMesh.Close();
+	m_vertices = m_verticesWithTangents.data();
+	m_vertexCount = static_cast<UINT>(m_verticesWithTangents.size());
+	m_indices = m_objIndices.data();
+	m_indexCount = static_cast<UINT>(m_objIndices.size());
+	m_lods = m_objLods.data();
+	m_lodCount = static_cast<UINT>(m_objLods.size());
+	CalculateUvDensity();
+}
+
+bool Actor::LoadCookedMeshFromFile(const wchar_t* const fileName)
+{
+	if (!m_cookedMesh.Open(fileName))
 	{
-		Vertex vertex;
-		vertex.position = readerVertex.position;
-		vertex.normal = readerVertex.normal;
-		vertex.tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
-		vertex.textureCoordinate = readerVertex.textureCoordinate;
+		return false;
+	}
 
-		m_verticesWithTangents.push_back(vertex);
+	// no parsing, the buffers point straight into the mapped file
+	const CookedMeshHeader* header = m_cookedMesh.GetHeader();
+	m_vertices = m_cookedMesh.GetVertices();
+	m_vertexCount = header->vertexCount;
+	m_indices = m_cookedMesh.GetIndices();
+	m_indexCount = header->indexCount;
+	m_lods = m_cookedMesh.GetLods();
+	m_lodCount = header->lodCount;
+	m_boundsMin = header->boundsMin;
+	m_boundsMax = header->boundsMax;
+	CalculateUvDensity();
+
+	return true;
+}
+
+bool Actor::SaveCookedMeshToFile(const wchar_t* const fileName) const
+{
+	if (m_vertices == nullptr || m_indices == nullptr || m_lods == nullptr)
+	{
+		return false;
 	}
-	
-	CalculateTangents();
+
+	return CookedMesh::Write(fileName, m_vertices, m_vertexCount,
+		m_indices, m_indexCount, m_lods, m_lodCount, m_boundsMin, m_boundsMax);
 }
 
 void Actor::ReleaseObj()
 {
-	waveFrontReader.Clear();
+	m_verticesWithTangents.clear();
+	m_verticesWithTangents.shrink_to_fit();
+	m_objIndices.clear();
+	m_objIndices.shrink_to_fit();
+	m_objLods.clear();
+	m_objLods.shrink_to_fit();
+	m_cookedMesh.Close();
+	m_vertices = nullptr;
+	m_indices = nullptr;
+	m_lods = nullptr;
+	m_lodCount = 0;
+	m_meshlets.clear();
+	m_meshlets.shrink_to_fit();
+}
+
+const Vertex* Actor::GetVertices() const
+{
+	return m_vertices;
+}
+
+UINT Actor::GetVertexCount() const
+{
+	return m_vertexCount;
 }
 
-vector<Vertex>& Actor::GetVertices()
+const DWORD* Actor::GetIndices() const
 {
-	return m_verticesWithTangents;
+	return m_indices;
 }
 
-std::vector<DWORD>& Actor::GetIndices()
+UINT Actor::GetIndexCount() const
 {
-	return waveFrontReader.indices;
+	return m_indexCount;
+}
+
+UINT Actor::GetLodCount() const
+{
+	return m_lodCount;
+}
+
+const MeshLod& Actor::GetLod(UINT lod) const
+{
+	return m_lods[lod < m_lodCount ? lod : m_lodCount - 1];
+}
+
+void Actor::BuildMeshlets()
+{
+	// works for both the OBJ and the cooked mesh, the index buffer is already cache optimized
+	const MeshLod& lod = GetLod(0);
+	MeshletBuilder::Build(m_vertices, m_vertexCount, reinterpret_cast<const uint32_t*>(m_indices),
+		lod.indexOffset, lod.indexCount, m_meshlets);
+
+	char message[128];
+	sprintf_s(message, "meshlets: %zu for %u triangles\n", m_meshlets.size(), lod.indexCount / 3);
+	OutputDebugStringA(message);
+}
+
+const vector<Meshlet>& Actor::GetMeshlets() const
+{
+	return m_meshlets;
+}
+
+XMFLOAT3 Actor::GetBoundsMin() const
+{
+	return m_boundsMin;
+}
+
+XMFLOAT3 Actor::GetBoundsMax() const
+{
+	return m_boundsMax;
+}
+
+float Actor::GetUvDensity() const
+{
+	return m_uvDensity;
+}
+
+const VertexWeldStats& Actor::GetWeldStats() const
+{
+	return m_weldStats;
+}
+
+const MeshOptimizerStats& Actor::GetOptimizerStats() const
+{
+	return m_optimizerStats;
 }
 
 void Actor::LoadAlbedoFromFile(const wchar_t* const fileName)
 {
-	m_albedoTex.LoadFromFile(fileName);
+	m_albedoTex = m_engine->GetTextureCache().Load(fileName, MipContent::Srgb);
 }
 
 void Actor::LoadNormalFromFile(const wchar_t* const fileName)
 {
-	m_normalTex.LoadFromFile(fileName);
+	m_normalTex = m_engine->GetTextureCache().Load(fileName, MipContent::Normal);
 }
 
-void Actor::LoadRoughnessFromFile(const wchar_t * const fileName)
+void Actor::LoadOrmFromFile(const wchar_t* const fileName)
 {
-	m_roughnessTex.LoadFromFile(fileName);
+	m_ormTex = m_engine->GetTextureCache().Load(fileName, MipContent::Linear);
 }
 
-void Actor::LoadOcclusionFromFile(const wchar_t* const fileName)
+void Actor::LoadOrmFromFiles(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName)
 {
-	m_occlusionTex.LoadFromFile(fileName);
+	// there is no specular map, the channel is left full
+	m_ormTex = m_engine->GetTextureCache().LoadOrm(occlusionFileName, roughnessFileName, nullptr);
 }
 
-void Actor::UploadAlbedoResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle)
+const TextureHandle& Actor::GetAlbedo() const
 {
-	m_albedoTex.CreateResource(L"Albedo", cpuDescriptorHandle);
-	m_albedoTex.UploadToResource();
+	return m_albedoTex;
 }
 
-void Actor::UploadNormalResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle)
+const TextureHandle& Actor::GetNormal() const
 {
-	m_normalTex.CreateResource(L"Normal", cpuDescriptorHandle);
-	m_normalTex.UploadToResource();
+	return m_normalTex;
 }
 
-void Actor::UploadOclussionResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle)
+const TextureHandle& Actor::GetOrm() const
 {
-	m_occlusionTex.CreateResource(L"Oclussion", cpuDescriptorHandle);
-	m_occlusionTex.UploadToResource();
+	return m_ormTex;
 }
 
-void Actor::UploadRoughnessResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle)
+const TextureLoadTimes& Actor::GetAlbedoLoadTimes() const
 {
-	m_roughnessTex.CreateResource(L"Roughness", cpuDescriptorHandle);
-	m_roughnessTex.UploadToResource();
+	return m_albedoTex->GetLoadTimes();
 }
 
-void Actor::ReleaseAlbedo()
+const TextureLoadTimes& Actor::GetNormalLoadTimes() const
 {
-	m_albedoTex.Release();
+	return m_normalTex->GetLoadTimes();
 }
 
-void Actor::ReleaseNormal()
+const TextureLoadTimes& Actor::GetOrmLoadTimes() const
+{
+	return m_ormTex->GetLoadTimes();
+}
+
+void Actor::ReleaseAlbedo()
 {
-	m_normalTex.Release();
+	m_albedoTex = TextureHandle();
 }
 
-void Actor::ReleaseOclussion()
+void Actor::ReleaseNormal()
 {
-	m_occlusionTex.Release();
+	m_normalTex = TextureHandle();
 }
 
-void Actor::ReleaseRoughness()
+void Actor::ReleaseOrm()
 {
-	m_roughnessTex.Release();
+	m_ormTex = TextureHandle();
 }
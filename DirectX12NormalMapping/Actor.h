@@ -5,21 +5,18 @@
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include <DirectXMesh.h>
-#include <WaveFrontReader.h>
 #include <vector>
-#include "Texture.h"
+#include "TextureCache.h"
+#include "Vertex.h"
+#include "CookedMesh.h"
+#include "MeshOptimizer.h"
+#include "VertexWelder.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
 
 using namespace DirectX;
 using namespace std;
 
-struct Vertex
-{
-	XMFLOAT3 position;
-	XMFLOAT3 normal;
-	XMFLOAT3 tangent;
-	XMFLOAT2 textureCoordinate;
-};
-
 class Actor
 {
 private:
@@ -28,17 +25,38 @@ private:
 	XMVECTOR m_translationVec;
 	XMMATRIX m_worldMat;
 
-	WaveFrontReader<DWORD> waveFrontReader;
-	Texture m_albedoTex;
-	Texture m_normalTex;
-	Texture m_occlusionTex;
-	Texture m_roughnessTex;
+	// shared through the engine's texture cache
+	TextureHandle m_albedoTex;
+	TextureHandle m_normalTex;
+	TextureHandle m_ormTex;	// occlusion, roughness and specular packed by OrmPacker
 	std::vector<Vertex> m_verticesWithTangents;
+	std::vector<DWORD> m_objIndices;	// all LODs back to back
+	std::vector<MeshLod> m_objLods;
+	CookedMesh m_cookedMesh;
+
+	// either the loaded OBJ data or a view into the cooked mesh mapping
+	const Vertex* m_vertices;
+	UINT m_vertexCount;
+	const DWORD* m_indices;
+	UINT m_indexCount;
+	const MeshLod* m_lods;
+	UINT m_lodCount;
+	std::vector<Meshlet> m_meshlets;	// of LOD 0, empty unless built
+	XMFLOAT3 m_boundsMin;
+	XMFLOAT3 m_boundsMax;
+	float m_uvDensity;	// texture coordinate units per model space unit
+	VertexWeldStats m_weldStats;
+	MeshOptimizerStats m_optimizerStats;
 
 	class Engine* m_engine;
 
 	void UpdateTransformationMat();
 	void CalculateTangents();
+	void WeldVertices();
+	void OptimizeMesh();
+	void BuildLods();
+	void CalculateBounds();
+	void CalculateUvDensity();
 
 public:
 	Actor(class Engine* const engine);
@@ -49,20 +67,34 @@ public:
 	void SetTranslation(const XMFLOAT3* const translationVec);
 	XMMATRIX GetWorldMat() const;
 	void LoadObjFromFile(const wchar_t* const fileName);
+	bool LoadCookedMeshFromFile(const wchar_t* const fileName);
+	bool SaveCookedMeshToFile(const wchar_t* const fileName) const;
 	void ReleaseObj();
-	vector<Vertex>& GetVertices();
-	vector<DWORD>& GetIndices();
+	const Vertex* GetVertices() const;
+	UINT GetVertexCount() const;
+	const DWORD* GetIndices() const;
+	UINT GetIndexCount() const;
+	UINT GetLodCount() const;
+	const MeshLod& GetLod(UINT lod) const;
+	void BuildMeshlets();
+	const std::vector<Meshlet>& GetMeshlets() const;
+	XMFLOAT3 GetBoundsMin() const;
+	XMFLOAT3 GetBoundsMax() const;
+	float GetUvDensity() const;
+	const VertexWeldStats& GetWeldStats() const;
+	const MeshOptimizerStats& GetOptimizerStats() const;
 	void LoadAlbedoFromFile(const wchar_t* const fileName);
 	void LoadNormalFromFile(const wchar_t* const fileName);
-	void LoadRoughnessFromFile(const wchar_t* const fileName);
-	void LoadOcclusionFromFile(const wchar_t* const fileName);
-	void UploadAlbedoResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle);
-	void UploadNormalResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle);
-	void UploadOclussionResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle);
-	void UploadRoughnessResource(D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle);
+	void LoadOrmFromFile(const wchar_t* const fileName);
+	void LoadOrmFromFiles(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName);
+	const TextureHandle& GetAlbedo() const;
+	const TextureHandle& GetNormal() const;
+	const TextureHandle& GetOrm() const;
+	const TextureLoadTimes& GetAlbedoLoadTimes() const;
+	const TextureLoadTimes& GetNormalLoadTimes() const;
+	const TextureLoadTimes& GetOrmLoadTimes() const;
 	void ReleaseAlbedo();
 	void ReleaseNormal();
-	void ReleaseOclussion();
-	void ReleaseRoughness();
+	void ReleaseOrm();
 };
 
@@ -0,0 +1,89 @@
+#include "AssetLoader.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+
+AssetLoader::AssetLoader(ThreadPool& threadPool)
+	: m_threadPool(threadPool), m_loading(0), m_firstLoadTime(high_resolution_clock::now())
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	// the jobs reference their owners, which are about to go away
+	WaitForLoads();
+}
+
+void AssetLoader::Load(const char* const name, function<void()> load, function<void()> upload)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_loading == 0 && m_loaded.empty() && m_timings.empty())
+		{
+			m_firstLoadTime = high_resolution_clock::now();
+		}
+		++m_loading;
+	}
+
+	string assetName(name);
+	m_threadPool.Enqueue([this, assetName, load, upload]()
+	{
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		load();
+		double loadMs = duration<double, milli>(high_resolution_clock::now() - start).count();
+
+		// notify under the lock, a waiting destructor must not return before
+		lock_guard<mutex> lock(m_mutex);
+		LoadedAsset asset = { { assetName, duration<double, milli>(start - m_firstLoadTime).count(), loadMs, 0.0 }, upload };
+		m_loaded.push_back(asset);
+		--m_loading;
+		m_loadFinished.notify_all();
+	});
+}
+
+UINT AssetLoader::UploadLoaded()
+{
+	vector<LoadedAsset> loaded;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		loaded.swap(m_loaded);
+	}
+
+	for (LoadedAsset& asset : loaded)
+	{
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		asset.upload();
+		asset.timing.uploadMs = duration<double, milli>(high_resolution_clock::now() - start).count();
+
+		char message[160];
+		sprintf_s(message, "%s loaded in %.2f ms, upload recorded in %.2f ms\n", asset.timing.name.c_str(),
+			asset.timing.loadMs, asset.timing.uploadMs);
+		OutputDebugStringA(message);
+
+		lock_guard<mutex> lock(m_mutex);
+		m_timings.push_back(asset.timing);
+	}
+
+	return static_cast<UINT>(loaded.size());
+}
+
+bool AssetLoader::IsIdle()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_loading == 0 && m_loaded.empty();
+}
+
+void AssetLoader::WaitForLoads()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_loadFinished.wait(lock, [this] { return m_loading == 0; });
+}
+
+vector<AssetTiming> AssetLoader::GetTimings()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_timings;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+// where an asset spent its time, offsets are from the first Load call
+struct AssetTiming
+{
+	std::string name;
+	double startMs;	// a worker picked the load step up
+	double loadMs;
+	double uploadMs;
+};
+
+// Loads assets in the background. The load step (file I/O, parsing,
+// decoding) runs on the thread pool, the upload step (creating resources and
+// recording the GPU copies) runs on the render thread when it polls.
+class AssetLoader
+{
+private:
+	struct LoadedAsset
+	{
+		AssetTiming timing;
+		std::function<void()> upload;
+	};
+
+	ThreadPool& m_threadPool;
+	std::mutex m_mutex;
+	std::condition_variable m_loadFinished;
+	std::vector<LoadedAsset> m_loaded;	// waiting for the render thread
+	UINT m_loading;	// still on the thread pool
+	std::chrono::high_resolution_clock::time_point m_firstLoadTime;
+	std::vector<AssetTiming> m_timings;	// uploaded assets, in upload order
+
+public:
+	explicit AssetLoader(ThreadPool& threadPool);
+	~AssetLoader();
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// load must not touch anything the render thread uses until upload runs
+	void Load(const char* const name, std::function<void()> load, std::function<void()> upload);
+
+	// runs the upload step of every asset that finished loading since the
+	// last call on the calling thread, returns how many ran
+	UINT UploadLoaded();
+
+	// nothing loading and nothing waiting for upload
+	bool IsIdle();
+
+	// blocks until every load step has returned, uploads are not run
+	void WaitForLoads();
+
+	std::vector<AssetTiming> GetTimings();
+};
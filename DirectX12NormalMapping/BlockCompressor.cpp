@@ -0,0 +1,659 @@
+#include "BlockCompressor.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const UINT BLOCK_TEXELS = 16;
+	const int REFINE_ITERATIONS = 1;
+	const int POWER_ITERATIONS = 8;
+
+	// BGRA byte order
+	const UINT BLUE = 0;
+	const UINT GREEN = 1;
+	const UINT RED = 2;
+	const UINT ALPHA = 3;
+
+	struct ColorBlock
+	{
+		alignas(16) int r[BLOCK_TEXELS];
+		alignas(16) int g[BLOCK_TEXELS];
+		alignas(16) int b[BLOCK_TEXELS];
+	};
+
+	// 4x4 texels starting at (x, y), coordinates past the edges are clamped
+	void LoadBlock(const BYTE* bgra, UINT width, UINT height, UINT x, UINT y, BYTE texels[BLOCK_TEXELS][4])
+	{
+		for (UINT row = 0; row < 4; ++row)
+		{
+			UINT texelY = y + row < height ? y + row : height - 1;
+			for (UINT column = 0; column < 4; ++column)
+			{
+				UINT texelX = x + column < width ? x + column : width - 1;
+				memcpy(texels[row * 4 + column], bgra + (static_cast<size_t>(texelY) * width + texelX) * 4, 4);
+			}
+		}
+	}
+
+	inline int Expand5(int value)
+	{
+		return (value << 3) | (value >> 2);
+	}
+
+	inline int Expand6(int value)
+	{
+		return (value << 2) | (value >> 4);
+	}
+
+	inline int ClampByte(float value)
+	{
+		return value < 0.0f ? 0 : (value > 255.0f ? 255 : static_cast<int>(value + 0.5f));
+	}
+
+	UINT16 QuantizeColor565(const float color[3])
+	{
+		int r = (ClampByte(color[0]) * 31 + 127) / 255;
+		int g = (ClampByte(color[1]) * 63 + 127) / 255;
+		int b = (ClampByte(color[2]) * 31 + 127) / 255;
+		return static_cast<UINT16>((r << 11) | (g << 5) | b);
+	}
+
+	// the four colors the decoder derives from the endpoints, RGB
+	void GetBc1Palette(UINT16 c0, UINT16 c1, int palette[4][3])
+	{
+		const UINT16 endpoints[2] = { c0, c1 };
+		for (int i = 0; i < 2; ++i)
+		{
+			palette[i][0] = Expand5((endpoints[i] >> 11) & 31);
+			palette[i][1] = Expand6((endpoints[i] >> 5) & 63);
+			palette[i][2] = Expand5(endpoints[i] & 31);
+		}
+
+		for (int c = 0; c < 3; ++c)
+		{
+			if (c0 > c1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				// three color mode with black
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	// nearest palette color for every texel, returns the summed squared error
+	UINT FindColorIndicesScalar(const ColorBlock& block, const int palette[4][3], int indices[BLOCK_TEXELS])
+	{
+		UINT error = 0;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			int bestDistance = 0;
+			for (int k = 0; k < 4; ++k)
+			{
+				int dr = block.r[i] - palette[k][0];
+				int dg = block.g[i] - palette[k][1];
+				int db = block.b[i] - palette[k][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (k == 0 || distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = k;
+				}
+			}
+			error += bestDistance;
+		}
+
+		return error;
+	}
+
+	// same search on 4 texels at once, the distances are exact in float
+	UINT FindColorIndicesSse(const ColorBlock& block, const int palette[4][3], int indices[BLOCK_TEXELS])
+	{
+		__m128 paletteR[4];
+		__m128 paletteG[4];
+		__m128 paletteB[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			paletteR[k] = _mm_set1_ps(static_cast<float>(palette[k][0]));
+			paletteG[k] = _mm_set1_ps(static_cast<float>(palette[k][1]));
+			paletteB[k] = _mm_set1_ps(static_cast<float>(palette[k][2]));
+		}
+
+		__m128i error = _mm_setzero_si128();
+		for (UINT i = 0; i < BLOCK_TEXELS; i += 4)
+		{
+			const __m128 r = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(block.r + i)));
+			const __m128 g = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(block.g + i)));
+			const __m128 b = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(block.b + i)));
+
+			__m128 bestDistance = _mm_setzero_ps();
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int k = 0; k < 4; ++k)
+			{
+				__m128 dr = _mm_sub_ps(r, paletteR[k]);
+				__m128 dg = _mm_sub_ps(g, paletteG[k]);
+				__m128 db = _mm_sub_ps(b, paletteB[k]);
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				if (k == 0)
+				{
+					bestDistance = distance;
+					continue;
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, bestDistance));
+				bestDistance = _mm_min_ps(distance, bestDistance);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), bestIndex);
+			error = _mm_add_epi32(error, _mm_cvtps_epi32(bestDistance));
+		}
+
+		alignas(16) int errors[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(errors), error);
+		return static_cast<UINT>(errors[0] + errors[1] + errors[2] + errors[3]);
+	}
+
+	UINT FindColorIndices(BlockKernel kernel, const ColorBlock& block, UINT16 c0, UINT16 c1, int indices[BLOCK_TEXELS])
+	{
+		int palette[4][3];
+		GetBc1Palette(c0, c1, palette);
+		return kernel == BlockKernel::Sse ? FindColorIndicesSse(block, palette, indices) :
+			FindColorIndicesScalar(block, palette, indices);
+	}
+
+	// endpoints at the extremes of the principal axis, inset by 1/16 of the range
+	void FitColorEndpoints(const ColorBlock& block, UINT16& c0, UINT16& c1)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		int minColor[3] = { 255, 255, 255 };
+		int maxColor[3] = { 0, 0, 0 };
+		const int* channels[3] = { block.r, block.g, block.b };
+
+		for (int c = 0; c < 3; ++c)
+		{
+			for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+			{
+				mean[c] += static_cast<float>(channels[c][i]);
+				minColor[c] = channels[c][i] < minColor[c] ? channels[c][i] : minColor[c];
+				maxColor[c] = channels[c][i] > maxColor[c] ? channels[c][i] : maxColor[c];
+			}
+			mean[c] /= BLOCK_TEXELS;
+		}
+
+		// covariance rr, rg, rb, gg, gb, bb
+		float covariance[6] = {};
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			float r = channels[0][i] - mean[0];
+			float g = channels[1][i] - mean[1];
+			float b = channels[2][i] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		float axis[3] =
+		{
+			static_cast<float>(maxColor[0] - minColor[0]),
+			static_cast<float>(maxColor[1] - minColor[1]),
+			static_cast<float>(maxColor[2] - minColor[2])
+		};
+
+		for (int iteration = 0; iteration < POWER_ITERATIONS; ++iteration)
+		{
+			float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+			float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+			float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+			float largest = fmaxf(fabsf(r), fmaxf(fabsf(g), fabsf(b)));
+			if (!(largest > 0.0f))
+			{
+				break;
+			}
+			axis[0] = r / largest;
+			axis[1] = g / largest;
+			axis[2] = b / largest;
+		}
+
+		float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		if (!(length > 0.0f))
+		{
+			// one color
+			c0 = QuantizeColor565(mean);
+			c1 = c0;
+			return;
+		}
+
+		axis[0] /= length;
+		axis[1] /= length;
+		axis[2] /= length;
+
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			float projection = (channels[0][i] - mean[0]) * axis[0] + (channels[1][i] - mean[1]) * axis[1] +
+				(channels[2][i] - mean[2]) * axis[2];
+			minProjection = fminf(minProjection, projection);
+			maxProjection = fmaxf(maxProjection, projection);
+		}
+
+		float inset = (maxProjection - minProjection) / 16.0f;
+		minProjection += inset;
+		maxProjection -= inset;
+
+		float endpoint0[3];
+		float endpoint1[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			endpoint0[c] = mean[c] + axis[c] * maxProjection;
+			endpoint1[c] = mean[c] + axis[c] * minProjection;
+		}
+
+		c0 = QuantizeColor565(endpoint0);
+		c1 = QuantizeColor565(endpoint1);
+	}
+
+	// least squares endpoints for the given four color mode indices, false when singular
+	bool RefineColorEndpoints(const ColorBlock& block, const int indices[BLOCK_TEXELS], UINT16& c0, UINT16& c1)
+	{
+		const float weights0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		const int* channels[3] = { block.r, block.g, block.b };
+
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			float a = weights0[indices[i]];
+			float b = 1.0f - a;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (int c = 0; c < 3; ++c)
+			{
+				ax[c] += a * channels[c][i];
+				bx[c] += b * channels[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		float endpoint0[3];
+		float endpoint1[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			endpoint0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			endpoint1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+
+		c0 = QuantizeColor565(endpoint0);
+		c1 = QuantizeColor565(endpoint1);
+		return true;
+	}
+
+	void CompressBc1Block(BlockKernel kernel, const BYTE texels[BLOCK_TEXELS][4], BYTE* block)
+	{
+		ColorBlock colors;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			colors.r[i] = texels[i][RED];
+			colors.g[i] = texels[i][GREEN];
+			colors.b[i] = texels[i][BLUE];
+		}
+
+		UINT16 c0;
+		UINT16 c1;
+		FitColorEndpoints(colors, c0, c1);
+
+		// four color mode needs c0 > c1
+		if (c0 < c1)
+		{
+			UINT16 swap = c0;
+			c0 = c1;
+			c1 = swap;
+		}
+
+		int indices[BLOCK_TEXELS];
+		UINT error = FindColorIndices(kernel, colors, c0, c1, indices);
+
+		for (int iteration = 0; iteration < REFINE_ITERATIONS && error > 0 && c0 > c1; ++iteration)
+		{
+			UINT16 refined0;
+			UINT16 refined1;
+			if (!RefineColorEndpoints(colors, indices, refined0, refined1))
+			{
+				break;
+			}
+
+			if (refined0 < refined1)
+			{
+				UINT16 swap = refined0;
+				refined0 = refined1;
+				refined1 = swap;
+			}
+
+			int refinedIndices[BLOCK_TEXELS];
+			UINT refinedError = FindColorIndices(kernel, colors, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+			{
+				break;
+			}
+
+			c0 = refined0;
+			c1 = refined1;
+			error = refinedError;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+
+		UINT32 packedIndices = 0;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			packedIndices |= static_cast<UINT32>(indices[i]) << (2 * i);
+		}
+
+		memcpy(block, &c0, 2);
+		memcpy(block + 2, &c1, 2);
+		memcpy(block + 4, &packedIndices, 4);
+	}
+
+	// the eight values the decoder derives from the endpoints
+	void GetBc4Palette(int a0, int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void FindValueIndicesScalar(const BYTE values[BLOCK_TEXELS], const int palette[8], int indices[BLOCK_TEXELS])
+	{
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			int bestDistance = 0;
+			for (int k = 0; k < 8; ++k)
+			{
+				int distance = abs(values[i] - palette[k]);
+				if (k == 0 || distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = k;
+				}
+			}
+		}
+	}
+
+	// all 16 values as two vectors of 16 bit lanes
+	void FindValueIndicesSse(const BYTE values[BLOCK_TEXELS], const int palette[8], int indices[BLOCK_TEXELS])
+	{
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+		const __m128i halves[2] =
+		{
+			_mm_unpacklo_epi8(bytes, _mm_setzero_si128()),
+			_mm_unpackhi_epi8(bytes, _mm_setzero_si128())
+		};
+
+		for (int h = 0; h < 2; ++h)
+		{
+			__m128i bestDistance = _mm_setzero_si128();
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int k = 0; k < 8; ++k)
+			{
+				__m128i entry = _mm_set1_epi16(static_cast<short>(palette[k]));
+				__m128i distance = _mm_max_epi16(_mm_sub_epi16(halves[h], entry), _mm_sub_epi16(entry, halves[h]));
+
+				if (k == 0)
+				{
+					bestDistance = distance;
+					continue;
+				}
+
+				__m128i closer = _mm_cmplt_epi16(distance, bestDistance);
+				bestDistance = _mm_min_epi16(distance, bestDistance);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi16(static_cast<short>(k))), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) short lanes[8];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+			for (int i = 0; i < 8; ++i)
+			{
+				indices[h * 8 + i] = lanes[i];
+			}
+		}
+	}
+
+	void CompressBc4Block(BlockKernel kernel, const BYTE texels[BLOCK_TEXELS][4], UINT channel, BYTE* block)
+	{
+		BYTE values[BLOCK_TEXELS];
+		int minValue = 255;
+		int maxValue = 0;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			values[i] = texels[i][channel];
+			minValue = values[i] < minValue ? values[i] : minValue;
+			maxValue = values[i] > maxValue ? values[i] : maxValue;
+		}
+
+		// eight value mode, one value blocks only ever use index 0
+		int palette[8];
+		GetBc4Palette(maxValue, minValue, palette);
+
+		int indices[BLOCK_TEXELS];
+		if (kernel == BlockKernel::Sse)
+		{
+			FindValueIndicesSse(values, palette, indices);
+		}
+		else
+		{
+			FindValueIndicesScalar(values, palette, indices);
+		}
+
+		UINT64 packedIndices = 0;
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			packedIndices |= static_cast<UINT64>(indices[i]) << (3 * i);
+		}
+
+		block[0] = static_cast<BYTE>(maxValue);
+		block[1] = static_cast<BYTE>(minValue);
+		for (int i = 0; i < 6; ++i)
+		{
+			block[2 + i] = static_cast<BYTE>(packedIndices >> (8 * i));
+		}
+	}
+
+	void CompressBlockRow(BlockFormat format, BlockKernel kernel, const BYTE* bgra, UINT width, UINT height,
+		UINT blockRow, BYTE* blocks)
+	{
+		const UINT blocksWide = (width + 3) / 4;
+		const UINT blockBytes = BlockCompressor::GetBlockBytes(format);
+		BYTE* block = blocks + static_cast<size_t>(blockRow) * blocksWide * blockBytes;
+
+		BYTE texels[BLOCK_TEXELS][4];
+		for (UINT blockColumn = 0; blockColumn < blocksWide; ++blockColumn, block += blockBytes)
+		{
+			LoadBlock(bgra, width, height, blockColumn * 4, blockRow * 4, texels);
+
+			switch (format)
+			{
+			case BlockFormat::Bc1:
+				CompressBc1Block(kernel, texels, block);
+				break;
+			case BlockFormat::Bc4:
+				CompressBc4Block(kernel, texels, RED, block);
+				break;
+			case BlockFormat::Bc5:
+				CompressBc4Block(kernel, texels, RED, block);
+				CompressBc4Block(kernel, texels, GREEN, block + 8);
+				break;
+			}
+		}
+	}
+
+	void DecodeBc4Block(const BYTE* block, BYTE values[BLOCK_TEXELS])
+	{
+		int palette[8];
+		GetBc4Palette(block[0], block[1], palette);
+
+		UINT64 packedIndices = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			packedIndices |= static_cast<UINT64>(block[2 + i]) << (8 * i);
+		}
+
+		for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			values[i] = static_cast<BYTE>(palette[(packedIndices >> (3 * i)) & 7]);
+		}
+	}
+}
+
+const wchar_t* BlockCompressor::GetKernelName(BlockKernel kernel)
+{
+	switch (kernel)
+	{
+	case BlockKernel::Scalar:
+		return L"scalar";
+	case BlockKernel::Sse:
+		return L"SSE";
+	}
+
+	return L"unknown";
+}
+
+const wchar_t* BlockCompressor::GetFormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::Bc1:
+		return L"BC1";
+	case BlockFormat::Bc4:
+		return L"BC4";
+	case BlockFormat::Bc5:
+		return L"BC5";
+	}
+
+	return L"unknown";
+}
+
+UINT BlockCompressor::GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::Bc5 ? 16 : 8;
+}
+
+UINT64 BlockCompressor::GetCompressedSize(BlockFormat format, UINT width, UINT height)
+{
+	return static_cast<UINT64>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+void BlockCompressor::Compress(BlockFormat format, BlockKernel kernel, const BYTE* bgra, UINT width, UINT height, BYTE* blocks)
+{
+	const UINT blocksHigh = (height + 3) / 4;
+	for (UINT blockRow = 0; blockRow < blocksHigh; ++blockRow)
+	{
+		CompressBlockRow(format, kernel, bgra, width, height, blockRow, blocks);
+	}
+}
+
+void BlockCompressor::Compress(BlockFormat format, BlockKernel kernel, const BYTE* bgra, UINT width, UINT height, BYTE* blocks,
+	ThreadPool& threadPool)
+{
+	threadPool.ParallelFor((height + 3) / 4, [&](UINT blockRow)
+	{
+		CompressBlockRow(format, kernel, bgra, width, height, blockRow, blocks);
+	});
+}
+
+void BlockCompressor::Decompress(BlockFormat format, const BYTE* blocks, UINT width, UINT height, BYTE* bgra)
+{
+	const UINT blocksWide = (width + 3) / 4;
+	const UINT blocksHigh = (height + 3) / 4;
+	const UINT blockBytes = GetBlockBytes(format);
+
+	for (UINT blockRow = 0; blockRow < blocksHigh; ++blockRow)
+	{
+		for (UINT blockColumn = 0; blockColumn < blocksWide; ++blockColumn)
+		{
+			const BYTE* block = blocks + (static_cast<size_t>(blockRow) * blocksWide + blockColumn) * blockBytes;
+
+			BYTE texels[BLOCK_TEXELS][4] = {};
+			if (format == BlockFormat::Bc1)
+			{
+				UINT16 c0;
+				UINT16 c1;
+				UINT32 packedIndices;
+				memcpy(&c0, block, 2);
+				memcpy(&c1, block + 2, 2);
+				memcpy(&packedIndices, block + 4, 4);
+
+				int palette[4][3];
+				GetBc1Palette(c0, c1, palette);
+				for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+				{
+					const int* color = palette[(packedIndices >> (2 * i)) & 3];
+					texels[i][RED] = static_cast<BYTE>(color[0]);
+					texels[i][GREEN] = static_cast<BYTE>(color[1]);
+					texels[i][BLUE] = static_cast<BYTE>(color[2]);
+				}
+			}
+			else
+			{
+				BYTE values[BLOCK_TEXELS];
+				DecodeBc4Block(block, values);
+				for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+				{
+					texels[i][RED] = values[i];
+				}
+
+				if (format == BlockFormat::Bc5)
+				{
+					DecodeBc4Block(block + 8, values);
+					for (UINT i = 0; i < BLOCK_TEXELS; ++i)
+					{
+						texels[i][GREEN] = values[i];
+					}
+				}
+			}
+
+			for (UINT row = 0; row < 4 && blockRow * 4 + row < height; ++row)
+			{
+				for (UINT column = 0; column < 4 && blockColumn * 4 + column < width; ++column)
+				{
+					BYTE* texel = bgra + (static_cast<size_t>(blockRow * 4 + row) * width + blockColumn * 4 + column) * 4;
+					memcpy(texel, texels[row * 4 + column], 4);
+					texel[ALPHA] = 255;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include "ThreadPool.h"
+
+enum class BlockFormat
+{
+	Bc1,	// color, 8 bytes per 4x4 block
+	Bc4,	// red channel, 8 bytes per block
+	Bc5	// red and green channels, 16 bytes per block
+};
+
+enum class BlockKernel
+{
+	Scalar,
+	Sse	// 4 texels (BC1) or 8 texels (BC4) per iteration
+};
+
+// Compresses BGRA8 images into BC1, BC4 or BC5 blocks. BC1 fits the endpoints
+// along the principal axis of the block colors and refines them once by least
+// squares, BC4 takes the channel range as endpoints. Blocks on the right and
+// bottom edges of sizes that are not a multiple of 4 repeat the last texel.
+// Both kernels give bit identical blocks, only the index search differs.
+// Decompress mirrors the hardware decoder and is used for quality checks.
+class BlockCompressor
+{
+public:
+	static const wchar_t* GetKernelName(BlockKernel kernel);
+	static const wchar_t* GetFormatName(BlockFormat format);
+	static UINT GetBlockBytes(BlockFormat format);
+	static UINT64 GetCompressedSize(BlockFormat format, UINT width, UINT height);
+
+	static void Compress(BlockFormat format, BlockKernel kernel, const BYTE* bgra, UINT width, UINT height, BYTE* blocks);
+	// block rows are spread over the thread pool
+	static void Compress(BlockFormat format, BlockKernel kernel, const BYTE* bgra, UINT width, UINT height, BYTE* blocks,
+		ThreadPool& threadPool);
+
+	// writes the decoded channels into BGRA8, channels the format lacks are 0, alpha is 255
+	static void Decompress(BlockFormat format, const BYTE* blocks, UINT width, UINT height, BYTE* bgra);
+};
@@ -127,6 +127,11 @@ XMVECTOR Camera::GetPosition() const
 	return m_translationVec;
 }
 
+float Camera::GetFov() const
+{
+	return m_fov;
+}
+
 Camera::Camera()
 	: m_translationVec(XMVectorZero()),
 	m_rotationVec(XMVectorZero()),
@@ -35,6 +35,7 @@ public:
 	void MoveRight(float units);
 	void MoveUp(float units);
 	XMVECTOR GetPosition() const;
+	float GetFov() const;
 
 	Camera();
 	XMMATRIX GetViewProjectionMat() const;
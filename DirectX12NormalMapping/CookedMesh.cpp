@@ -0,0 +1,154 @@
+#include "CookedMesh.h"
+
+bool CookedMesh::Open(const wchar_t* const fileName)
+{
+	if (!m_file.Open(fileName) || m_file.GetSize() < sizeof(CookedMeshHeader))
+	{
+		Close();
+		return false;
+	}
+
+	// validate header before anybody dereferences the arrays
+	const UINT64 fileSize = m_file.GetSize();
+	const CookedMeshHeader* header = GetHeader();
+	const UINT64 vertexBytes = static_cast<UINT64>(header->vertexCount) * sizeof(Vertex);
+	const UINT64 indexBytes = static_cast<UINT64>(header->indexCount) * sizeof(DWORD);
+	const UINT64 lodBytes = static_cast<UINT64>(header->lodCount) * sizeof(MeshLod);
+
+	if (header->magic != COOKED_MESH_MAGIC ||
+		header->version != COOKED_MESH_VERSION ||
+		header->vertexStride != sizeof(Vertex) ||
+		header->vertexCount == 0 ||
+		header->indexCount % 3 != 0 ||
+		header->vertexOffset % alignof(Vertex) != 0 ||
+		header->indexOffset % alignof(DWORD) != 0 ||
+		header->lodOffset % alignof(MeshLod) != 0 ||
+		header->lodCount == 0 ||
+		header->vertexOffset > fileSize || vertexBytes > fileSize - header->vertexOffset ||
+		header->indexOffset > fileSize || indexBytes > fileSize - header->indexOffset ||
+		header->lodOffset > fileSize || lodBytes > fileSize - header->lodOffset)
+	{
+		Close();
+		return false;
+	}
+
+	// every LOD has to be a whole number of triangles inside the index array
+	const MeshLod* lods = GetLods();
+	for (UINT32 i = 0; i < header->lodCount; ++i)
+	{
+		if (lods[i].indexCount % 3 != 0 ||
+			lods[i].indexOffset > header->indexCount ||
+			lods[i].indexCount > header->indexCount - lods[i].indexOffset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	// a stale or truncated file must not send the CPU or GPU past the vertex array
+	const DWORD* indices = GetIndices();
+	for (UINT32 i = 0; i < header->indexCount; ++i)
+	{
+		if (indices[i] >= header->vertexCount)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CookedMesh::Close()
+{
+	m_file.Close();
+}
+
+bool CookedMesh::IsOpen() const
+{
+	return m_file.IsOpen();
+}
+
+const CookedMeshHeader* CookedMesh::GetHeader() const
+{
+	return reinterpret_cast<const CookedMeshHeader*>(m_file.GetData());
+}
+
+const Vertex* CookedMesh::GetVertices() const
+{
+	return reinterpret_cast<const Vertex*>(m_file.GetData() + GetHeader()->vertexOffset);
+}
+
+const DWORD* CookedMesh::GetIndices() const
+{
+	return reinterpret_cast<const DWORD*>(m_file.GetData() + GetHeader()->indexOffset);
+}
+
+const MeshLod* CookedMesh::GetLods() const
+{
+	return reinterpret_cast<const MeshLod*>(m_file.GetData() + GetHeader()->lodOffset);
+}
+
+bool CookedMesh::Write(const wchar_t* const fileName,
+	const Vertex* vertices, UINT vertexCount,
+	const DWORD* indices, UINT indexCount,
+	const MeshLod* lods, UINT lodCount,
+	const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	CookedMeshHeader header = {};
+	header.magic = COOKED_MESH_MAGIC;
+	header.version = COOKED_MESH_VERSION;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.lodCount = lodCount;
+	header.boundsMin = boundsMin;
+	header.boundsMax = boundsMax;
+	header.vertexOffset = sizeof(CookedMeshHeader);
+	header.indexOffset = header.vertexOffset + static_cast<UINT64>(vertexCount) * sizeof(Vertex);
+	header.lodOffset = header.indexOffset + static_cast<UINT64>(indexCount) * sizeof(DWORD);
+
+	HANDLE file = CreateFileW(fileName, GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	const void* chunks[] = { &header, vertices, indices, lods };
+	const UINT64 chunkSizes[] = {
+		sizeof(CookedMeshHeader),
+		static_cast<UINT64>(vertexCount) * sizeof(Vertex),
+		static_cast<UINT64>(indexCount) * sizeof(DWORD),
+		static_cast<UINT64>(lodCount) * sizeof(MeshLod)
+	};
+
+	bool succeeded = true;
+	for (int i = 0; i < _countof(chunks) && succeeded; ++i)
+	{
+		const BYTE* data = reinterpret_cast<const BYTE*>(chunks[i]);
+		UINT64 remaining = chunkSizes[i];
+
+		while (remaining > 0)
+		{
+			DWORD toWrite = static_cast<DWORD>(remaining > MAXDWORD ? MAXDWORD : remaining);
+			DWORD written = 0;
+			if (!WriteFile(file, data, toWrite, &written, nullptr) || written != toWrite)
+			{
+				succeeded = false;
+				break;
+			}
+			data += written;
+			remaining -= written;
+		}
+	}
+
+	CloseHandle(file);
+
+	if (!succeeded)
+	{
+		DeleteFileW(fileName);
+	}
+
+	return succeeded;
+}
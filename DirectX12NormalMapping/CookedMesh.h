@@ -0,0 +1,53 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include "MeshLod.h"
+#include "MappedFile.h"
+
+using namespace DirectX;
+
+const UINT32 COOKED_MESH_MAGIC = 0x4D4E5844;	// "DXNM"
+const UINT32 COOKED_MESH_VERSION = 2;
+
+// binary layout: header, vertex array, index array (all LODs), LOD array
+struct CookedMeshHeader
+{
+	UINT32 magic;
+	UINT32 version;
+	UINT32 vertexStride;	// sizeof(Vertex) at cook time
+	UINT32 vertexCount;
+	UINT32 indexCount;
+	UINT32 lodCount;
+	XMFLOAT3 boundsMin;
+	XMFLOAT3 boundsMax;
+	UINT64 vertexOffset;	// from the beginning of the file
+	UINT64 indexOffset;
+	UINT64 lodOffset;
+};
+
+// read-only memory mapped view of a cooked mesh file
+class CookedMesh
+{
+private:
+	MappedFile m_file;
+
+public:
+	bool Open(const wchar_t* const fileName);
+	void Close();
+	bool IsOpen() const;
+
+	const CookedMeshHeader* GetHeader() const;
+	const Vertex* GetVertices() const;
+	const DWORD* GetIndices() const;
+	const MeshLod* GetLods() const;
+
+	static bool Write(const wchar_t* const fileName,
+		const Vertex* vertices, UINT vertexCount,
+		const DWORD* indices, UINT indexCount,
+		const MeshLod* lods, UINT lodCount,
+		const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax);
+};
@@ -0,0 +1,254 @@
+#include "DdsFile.h"
+#include <cstring>
+
+namespace
+{
+	const uint32_t DDS_MAGIC = 0x20534444;	// "DDS "
+	const uint32_t DX10_FOURCC = 0x30315844;	// "DX10"
+	const uint32_t MAX_DIMENSION = 16384;	// D3D12 texture size limit
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PITCH = 0x8;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+	const uint32_t DIMENSION_TEXTURE2D = 3;
+
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	const uint64_t DATA_OFFSET = sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+	static_assert(sizeof(DdsHeaderDx10) == 20, "DX10 header layout");
+	static_assert(DATA_OFFSET == DDS_HEADER_SIZE, "DDS data offset");
+}
+
+bool DdsFile::IsSupportedFormat(uint32_t format)
+{
+	return format == DDS_FORMAT_BC1_UNORM || format == DDS_FORMAT_BC1_UNORM_SRGB ||
+		format == DDS_FORMAT_BC4_UNORM || format == DDS_FORMAT_BC5_UNORM ||
+		format == DDS_FORMAT_B8G8R8A8_UNORM || format == DDS_FORMAT_B8G8R8A8_UNORM_SRGB;
+}
+
+bool DdsFile::IsBlockCompressed(uint32_t format)
+{
+	return format == DDS_FORMAT_BC1_UNORM || format == DDS_FORMAT_BC1_UNORM_SRGB ||
+		format == DDS_FORMAT_BC4_UNORM || format == DDS_FORMAT_BC5_UNORM;
+}
+
+uint64_t DdsFile::GetRowPitch(uint32_t format, uint32_t width)
+{
+	if (!IsBlockCompressed(format))
+	{
+		return static_cast<uint64_t>(width) * 4;
+	}
+
+	const uint64_t blockBytes = format == DDS_FORMAT_BC5_UNORM ? 16 : 8;
+	const uint64_t blocksWide = (width + 3) / 4;
+	return (blocksWide > 0 ? blocksWide : 1) * blockBytes;
+}
+
+uint32_t DdsFile::GetRowCount(uint32_t format, uint32_t height)
+{
+	if (!IsBlockCompressed(format))
+	{
+		return height;
+	}
+
+	const uint32_t blocksHigh = (height + 3) / 4;
+	return blocksHigh > 0 ? blocksHigh : 1;
+}
+
+uint64_t DdsFile::GetMipChainSize(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	uint64_t size = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		size += GetRowPitch(format, width) * GetRowCount(format, height);
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return size;
+}
+
+uint32_t DdsFile::GetMaxMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t mipCount = 1;
+	for (uint32_t size = width > height ? width : height; size > 1; size /= 2)
+	{
+		++mipCount;
+	}
+	return mipCount;
+}
+
+uint32_t DdsFile::GetCoarsestFirstMip(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	if (mipCount == 0)
+	{
+		return 0;
+	}
+	if (!IsBlockCompressed(format))
+	{
+		return mipCount - 1;
+	}
+
+	uint32_t firstMip = 0;
+	while (firstMip + 1 < mipCount)
+	{
+		const uint32_t mipWidth = width >> (firstMip + 1);
+		const uint32_t mipHeight = height >> (firstMip + 1);
+		if (mipWidth < 4 || mipHeight < 4 || mipWidth % 4 != 0 || mipHeight % 4 != 0)
+		{
+			break;
+		}
+		++firstMip;
+	}
+	return firstMip;
+}
+
+bool DdsFile::Parse(const uint8_t* data, uint64_t size, TextureFileInfo& info)
+{
+	if (data == nullptr || size < DATA_OFFSET)
+	{
+		return false;
+	}
+
+	uint32_t magic;
+	DdsHeader header;
+	DdsHeaderDx10 headerDx10;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	memcpy(&headerDx10, data + sizeof(magic) + sizeof(header), sizeof(headerDx10));
+
+	if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+	{
+		return false;
+	}
+
+	// legacy pixel formats are not written by the cooker
+	if ((header.pixelFormat.flags & DDPF_FOURCC) == 0 || header.pixelFormat.fourCC != DX10_FOURCC)
+	{
+		return false;
+	}
+
+	if (headerDx10.resourceDimension != DIMENSION_TEXTURE2D || headerDx10.arraySize != 1 ||
+		!IsSupportedFormat(headerDx10.dxgiFormat))
+	{
+		return false;
+	}
+
+	if (header.width == 0 || header.height == 0 || header.width > MAX_DIMENSION || header.height > MAX_DIMENSION)
+	{
+		return false;
+	}
+
+	// D3D12 only creates a block compressed resource whose top level is whole blocks
+	if (IsBlockCompressed(headerDx10.dxgiFormat) && (header.width % 4 != 0 || header.height % 4 != 0))
+	{
+		return false;
+	}
+
+	uint32_t mipCount = header.mipMapCount == 0 ? 1 : header.mipMapCount;
+	if (mipCount > GetMaxMipCount(header.width, header.height))
+	{
+		return false;
+	}
+
+	uint64_t dataSize = GetMipChainSize(headerDx10.dxgiFormat, header.width, header.height, mipCount);
+	if (dataSize > size - DATA_OFFSET)
+	{
+		return false;
+	}
+
+	info.width = header.width;
+	info.height = header.height;
+	info.mipCount = mipCount;
+	info.format = headerDx10.dxgiFormat;
+
+	// the levels follow each other from the largest
+	uint64_t mipOffset = DATA_OFFSET;
+	uint32_t mipWidth = header.width;
+	uint32_t mipHeight = header.height;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		info.mipOffsets[mip] = mipOffset;
+		info.mipSizes[mip] = GetMipChainSize(info.format, mipWidth, mipHeight, 1);
+		mipOffset += info.mipSizes[mip];
+		mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+		mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+	}
+
+	return true;
+}
+
+void DdsFile::WriteHeader(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint8_t* header)
+{
+	const uint32_t magic = DDS_MAGIC;
+
+	DdsHeader ddsHeader = {};
+	ddsHeader.size = sizeof(DdsHeader);
+	ddsHeader.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+		(IsBlockCompressed(format) ? DDSD_LINEARSIZE : DDSD_PITCH);
+	ddsHeader.height = height;
+	ddsHeader.width = width;
+	ddsHeader.pitchOrLinearSize = static_cast<uint32_t>(IsBlockCompressed(format) ?
+		GetRowPitch(format, width) * GetRowCount(format, height) : GetRowPitch(format, width));
+	ddsHeader.depth = 1;
+	ddsHeader.mipMapCount = mipCount;
+	ddsHeader.pixelFormat.size = sizeof(DdsPixelFormat);
+	ddsHeader.pixelFormat.flags = DDPF_FOURCC;
+	ddsHeader.pixelFormat.fourCC = DX10_FOURCC;
+	ddsHeader.caps = DDSCAPS_TEXTURE | (mipCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	DdsHeaderDx10 headerDx10 = {};
+	headerDx10.dxgiFormat = format;
+	headerDx10.resourceDimension = DIMENSION_TEXTURE2D;
+	headerDx10.arraySize = 1;
+
+	memcpy(header, &magic, sizeof(magic));
+	memcpy(header + sizeof(magic), &ddsHeader, sizeof(ddsHeader));
+	memcpy(header + sizeof(magic) + sizeof(ddsHeader), &headerDx10, sizeof(headerDx10));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// DXGI_FORMAT values, numeric so the container code does not need the D3D headers
+const uint32_t DDS_FORMAT_BC1_UNORM = 71;
+const uint32_t DDS_FORMAT_BC1_UNORM_SRGB = 72;
+const uint32_t DDS_FORMAT_BC4_UNORM = 80;
+const uint32_t DDS_FORMAT_BC5_UNORM = 83;
+const uint32_t DDS_FORMAT_B8G8R8A8_UNORM = 87;
+const uint32_t DDS_FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+
+const uint32_t TEXTURE_FILE_MAX_MIPS = 15;	// D3D12_REQ_MIP_LEVELS, 16384 texels
+const uint64_t DDS_HEADER_SIZE = 148;	// magic, header and DX10 header, the levels follow
+
+// what the DDS and KTX2 parsers found, offsets are from the beginning of the parsed memory
+struct TextureFileInfo
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	uint32_t format;	// one of DDS_FORMAT_*
+	uint64_t mipOffsets[TEXTURE_FILE_MAX_MIPS];	// from the largest level
+	uint64_t mipSizes[TEXTURE_FILE_MAX_MIPS];	// tightly packed rows, see GetRowPitch and GetRowCount
+};
+
+// .dds files with the DX10 extension header holding a single 2D texture in
+// one of the formats above. Parse only reads memory and checks every size
+// against the buffer before trusting it, so it works on a mapped file as
+// well as on a buffer. Writing the file is left to DdsWriter.
+class DdsFile
+{
+public:
+	static bool IsSupportedFormat(uint32_t format);
+	static bool IsBlockCompressed(uint32_t format);
+	// bytes per row of texels, or of 4x4 blocks
+	static uint64_t GetRowPitch(uint32_t format, uint32_t width);
+	// rows of texels, or of 4x4 blocks
+	static uint32_t GetRowCount(uint32_t format, uint32_t height);
+	static uint64_t GetMipChainSize(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount);
+	static uint32_t GetMaxMipCount(uint32_t width, uint32_t height);
+	// the coarsest level a resource can start at with this and every finer level
+	// also allowed to, block compressed ones need a multiple of 4 in both dimensions
+	static uint32_t GetCoarsestFirstMip(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount);
+
+	static bool Parse(const uint8_t* data, uint64_t size, TextureFileInfo& info);
+	// the DDS_HEADER_SIZE bytes in front of a level chain Parse reads back
+	static void WriteHeader(uint32_t format, uint32_t width, uint32_t height, uint32_t mipCount, uint8_t* header);
+};
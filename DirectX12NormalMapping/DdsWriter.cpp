@@ -0,0 +1,54 @@
+#include "DdsWriter.h"
+#include "DdsFile.h"
+
+bool DdsWriter::Write(const wchar_t* const fileName, UINT32 format, UINT32 width, UINT32 height, UINT32 mipCount,
+	const BYTE* data, UINT64 dataSize)
+{
+	if (!DdsFile::IsSupportedFormat(format) || mipCount == 0 ||
+		dataSize != DdsFile::GetMipChainSize(format, width, height, mipCount))
+	{
+		return false;
+	}
+
+	BYTE header[DDS_HEADER_SIZE];
+	DdsFile::WriteHeader(format, width, height, mipCount, header);
+
+	HANDLE file = CreateFileW(fileName, GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	const BYTE* chunks[] = { header, data };
+	const UINT64 chunkSizes[] = { sizeof(header), dataSize };
+
+	bool succeeded = true;
+	for (int i = 0; i < _countof(chunks) && succeeded; ++i)
+	{
+		const BYTE* chunk = chunks[i];
+		UINT64 remaining = chunkSizes[i];
+
+		while (remaining > 0)
+		{
+			DWORD toWrite = static_cast<DWORD>(remaining > MAXDWORD ? MAXDWORD : remaining);
+			DWORD written = 0;
+			if (!WriteFile(file, chunk, toWrite, &written, nullptr) || written != toWrite)
+			{
+				succeeded = false;
+				break;
+			}
+			chunk += written;
+			remaining -= written;
+		}
+	}
+
+	CloseHandle(file);
+
+	if (!succeeded)
+	{
+		DeleteFileW(fileName);
+	}
+
+	return succeeded;
+}
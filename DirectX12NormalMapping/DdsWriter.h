@@ -0,0 +1,14 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+
+// writes the .dds files DdsFile::Parse reads, kept apart so the parser stays portable
+class DdsWriter
+{
+public:
+	// data holds mipCount levels from the largest, tightly packed, false when the size does not match
+	static bool Write(const wchar_t* const fileName, UINT32 format, UINT32 width, UINT32 height, UINT32 mipCount,
+		const BYTE* data, UINT64 dataSize);
+};
@@ -0,0 +1,71 @@
+#include "DeferredReleaseQueue.h"
+#include <algorithm>
+#include <utility>
+
+DeferredReleaseQueue::DeferredReleaseQueue(std::function<uint64_t()> completedFenceValue)
+	: m_completedFenceValue(std::move(completedFenceValue)), m_stats()
+{
+}
+
+void DeferredReleaseQueue::Retire(uint64_t fenceValue, uint64_t bytes, std::function<void()> release)
+{
+	// one fence only moves forward, anything retired for an earlier value goes in before the later ones
+	Entry entry = { fenceValue, bytes, std::move(release) };
+	auto position = std::upper_bound(m_entries.begin(), m_entries.end(), fenceValue,
+		[](uint64_t value, const Entry& other) { return value < other.fenceValue; });
+	m_entries.insert(position, std::move(entry));
+
+	++m_stats.pendingCount;
+	m_stats.pendingBytes += bytes;
+	if (m_stats.pendingBytes > m_stats.peakPendingBytes)
+	{
+		m_stats.peakPendingBytes = m_stats.pendingBytes;
+	}
+}
+
+void DeferredReleaseQueue::ReleaseFront()
+{
+	// off the queue before it runs, a release may retire something else
+	Entry entry = std::move(m_entries.front());
+	m_entries.pop_front();
+	entry.release();
+
+	--m_stats.pendingCount;
+	m_stats.pendingBytes -= entry.bytes;
+	++m_stats.releasedCount;
+	m_stats.releasedBytes += entry.bytes;
+	++m_stats.lastReleasedCount;
+	m_stats.lastReleasedBytes += entry.bytes;
+}
+
+uint64_t DeferredReleaseQueue::Release()
+{
+	m_stats.lastReleasedCount = 0;
+	m_stats.lastReleasedBytes = 0;
+	if (m_entries.empty())
+	{
+		return 0;
+	}
+
+	const uint64_t completedFenceValue = m_completedFenceValue();
+	while (!m_entries.empty() && m_entries.front().fenceValue <= completedFenceValue)
+	{
+		ReleaseFront();
+	}
+	return m_stats.lastReleasedBytes;
+}
+
+void DeferredReleaseQueue::ReleaseAll()
+{
+	m_stats.lastReleasedCount = 0;
+	m_stats.lastReleasedBytes = 0;
+	while (!m_entries.empty())
+	{
+		ReleaseFront();
+	}
+}
+
+const DeferredReleaseStats& DeferredReleaseQueue::GetStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+struct DeferredReleaseStats
+{
+	uint32_t pendingCount;	// retired, waiting for the fence
+	uint64_t pendingBytes;
+	uint64_t peakPendingBytes;
+	uint32_t releasedCount;	// since the queue was created
+	uint64_t releasedBytes;
+	uint32_t lastReleasedCount;	// by the last Release call
+	uint64_t lastReleasedBytes;
+};
+
+// Resources the GPU may still be using once the CPU is done with them.
+// Retire takes the fence value the queue signals after the last commands
+// that use a resource, and how to release it; Release runs the releases the
+// fence has passed, in fence order. Nothing assumes the previous frame has
+// finished, so it holds with any number of frames in flight. The completed
+// fence value comes from the injected clock, and a resource is only a size
+// and a callback.
+class DeferredReleaseQueue
+{
+private:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		uint64_t bytes;
+		std::function<void()> release;
+	};
+
+	std::function<uint64_t()> m_completedFenceValue;
+	std::deque<Entry> m_entries;	// by fence value, in the order they were retired for the same one
+	DeferredReleaseStats m_stats;
+
+	void ReleaseFront();
+
+public:
+	explicit DeferredReleaseQueue(std::function<uint64_t()> completedFenceValue);
+
+	// release runs once the fence reaches fenceValue, bytes is what it gives back
+	void Retire(uint64_t fenceValue, uint64_t bytes, std::function<void()> release);
+	// runs the releases the fence has passed, returns the bytes they gave back
+	uint64_t Release();
+	// the queue is idle, runs every release
+	void ReleaseAll();
+
+	const DeferredReleaseStats& GetStats() const;
+};
@@ -0,0 +1,154 @@
+#include "DeferredReleaseQueueTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <vector>
+#include "DeferredReleaseQueue.h"
+
+using std::mt19937;
+using std::vector;
+
+namespace
+{
+	// released once the fence passes its value, in the order of the values
+	bool TestFenceOrder()
+	{
+		uint64_t completedFenceValue = 0;
+		DeferredReleaseQueue queue([&]() { return completedFenceValue; });
+		vector<int> released;
+
+		queue.Retire(2, 200, [&]() { released.push_back(2); });
+		queue.Retire(1, 100, [&]() { released.push_back(1); });
+		queue.Retire(3, 300, [&]() { released.push_back(3); });
+		queue.Retire(1, 10, [&]() { released.push_back(10); });
+		bool passed = queue.GetStats().pendingCount == 4 && queue.GetStats().pendingBytes == 610;
+
+		passed = passed && queue.Release() == 0 && released.empty();
+
+		completedFenceValue = 1;
+		passed = passed && queue.Release() == 110 && released.size() == 2 && released[0] == 1 && released[1] == 10;
+		passed = passed && queue.GetStats().lastReleasedCount == 2;
+
+		// a fence that skips values releases everything it passed
+		completedFenceValue = 5;
+		passed = passed && queue.Release() == 500 && released.size() == 4 && released[2] == 2 && released[3] == 3;
+		passed = passed && queue.Release() == 0 && queue.GetStats().lastReleasedCount == 0;
+
+		const DeferredReleaseStats& stats = queue.GetStats();
+		passed = passed && stats.pendingCount == 0 && stats.pendingBytes == 0 && stats.peakPendingBytes == 610 &&
+			stats.releasedCount == 4 && stats.releasedBytes == 610;
+
+		wprintf(L"  %-40s %s\n", L"fence order", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// shutdown, everything goes whatever the fence says, a release that retires again is run too
+	bool TestReleaseAll()
+	{
+		DeferredReleaseQueue queue([]() { return 0ull; });
+		uint32_t releases = 0;
+
+		queue.Retire(7, 64, [&]() { ++releases; });
+		queue.Retire(8, 64, [&]()
+		{
+			++releases;
+			queue.Retire(9, 32, [&]() { ++releases; });
+		});
+		queue.ReleaseAll();
+		const DeferredReleaseStats& stats = queue.GetStats();
+		bool passed = releases == 3 && stats.pendingCount == 0 && stats.releasedBytes == 160 && stats.lastReleasedBytes == 160;
+
+		wprintf(L"  %-40s %s\n", L"release all", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// every frame uses a few of the resources and replaces some, the fence lags framesInFlight frames behind
+	bool RunFrames(const wchar_t* name, uint32_t framesInFlight)
+	{
+		struct Resource
+		{
+			bool alive;
+			uint64_t lastUse;	// fence value of the last frame that used it
+		};
+
+		const uint32_t resourceCount = 32;
+		const uint64_t resourceBytes = 65536;
+		uint64_t completedFenceValue = 0;
+		DeferredReleaseQueue queue([&]() { return completedFenceValue; });
+		mt19937 random(1357);
+		vector<Resource> resources;
+		vector<uint32_t> live;	// indices into resources
+		bool passed = true;
+		uint64_t mostReclaimed = 0;
+
+		for (uint32_t i = 0; i < resourceCount; ++i)
+		{
+			resources.push_back({ true, 0 });
+			live.push_back(i);
+		}
+
+		for (uint32_t frame = 0; frame < 1000; ++frame)
+		{
+			// the frame being recorded signals fenceValue, the GPU has finished the ones before the frames in flight
+			const uint64_t fenceValue = frame + 1;
+			completedFenceValue = fenceValue > framesInFlight ? fenceValue - framesInFlight : 0;
+			const uint64_t reclaimed = queue.Release();
+			mostReclaimed = reclaimed > mostReclaimed ? reclaimed : mostReclaimed;
+			passed = passed && reclaimed == queue.GetStats().lastReleasedCount * resourceBytes;
+
+			for (uint32_t use = 0; use < 8; ++use)
+			{
+				Resource& resource = resources[live[random() % live.size()]];
+				resource.lastUse = fenceValue;
+			}
+
+			// replaced, the new one is used from this frame on
+			const uint32_t replacements = random() % 3;
+			for (uint32_t i = 0; i < replacements; ++i)
+			{
+				const size_t slot = random() % live.size();
+				const uint32_t index = live[slot];
+				queue.Retire(fenceValue, resourceBytes, [&, index]()
+				{
+					// no frame the GPU has not finished uses it
+					passed = passed && resources[index].alive && resources[index].lastUse <= completedFenceValue;
+					resources[index].alive = false;
+				});
+
+				live[slot] = static_cast<uint32_t>(resources.size());
+				resources.push_back({ true, fenceValue });
+			}
+		}
+
+		// the last frames finish
+		completedFenceValue = 1000;
+		queue.Release();
+		uint32_t aliveCount = 0;
+		for (const Resource& resource : resources)
+		{
+			aliveCount += resource.alive ? 1 : 0;
+		}
+		const DeferredReleaseStats& stats = queue.GetStats();
+		passed = passed && aliveCount == resourceCount && stats.pendingCount == 0 && stats.releasedCount == resources.size() - resourceCount;
+		// at most the replacements of the frames still in flight are waiting
+		passed = passed && stats.peakPendingBytes <= (framesInFlight + 1) * 2 * resourceBytes;
+
+		wprintf(L"  %-40s %s  %u released, %.0f KB peak pending, %.0f KB most reclaimed in a frame\n", name, passed ? L"ok" : L"FAILED",
+			stats.releasedCount, stats.peakPendingBytes / 1024.0, mostReclaimed / 1024.0);
+		return passed;
+	}
+}
+
+int RunDeferredReleaseQueueTests()
+{
+	int failures = 0;
+
+	failures += TestFenceOrder() ? 0 : 1;
+	failures += TestReleaseAll() ? 0 : 1;
+	failures += RunFrames(L"one frame in flight", 1) ? 0 : 1;
+	failures += RunFrames(L"two frames in flight", 2) ? 0 : 1;
+	failures += RunFrames(L"three frames in flight", 3) ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// DeferredReleaseQueue with a made up fence, checks that nothing is released
+// before the fence passes the value it was retired with, that releases run in
+// fence order and report the bytes they give back, and that frames rendered
+// with one to three frames in flight never release what a frame still on the
+// GPU uses, prints every case and returns 0 when all of them pass
+int RunDeferredReleaseQueueTests();
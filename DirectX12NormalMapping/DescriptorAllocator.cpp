@@ -0,0 +1,92 @@
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCount, uint32_t frameCount, uint32_t incrementSize, size_t cpuStart, uint64_t gpuStart,
+	std::function<uint64_t()> completedFenceValue)
+	: m_persistentCount(persistentCount), m_frameCount(frameCount), m_incrementSize(incrementSize), m_cpuStart(cpuStart),
+	m_gpuStart(gpuStart), m_persistent(persistentCount, 1), m_frame(frameCount, completedFenceValue), m_framePeak(0)
+{
+}
+
+DescriptorHandle DescriptorAllocator::GetHandle(uint32_t index, uint32_t count, uint32_t block) const
+{
+	DescriptorHandle handle = { index, count, m_cpuStart + static_cast<size_t>(index) * m_incrementSize, 0, block };
+	if (m_gpuStart != 0)
+	{
+		handle.gpu = m_gpuStart + static_cast<uint64_t>(index) * m_incrementSize;
+	}
+	return handle;
+}
+
+DescriptorHandle DescriptorAllocator::AllocatePersistent(uint32_t count)
+{
+	DescriptorHandle handle = { DESCRIPTOR_NONE, 0, 0, 0, HEAP_ALLOCATOR_NONE };
+	if (count == 0)
+	{
+		return handle;
+	}
+
+	const HeapAllocation allocation = m_persistent.Allocate(count, 1);
+	if (allocation.block == HEAP_ALLOCATOR_NONE)
+	{
+		return handle;
+	}
+	return GetHandle(static_cast<uint32_t>(allocation.offset), count, allocation.block);
+}
+
+void DescriptorAllocator::FreePersistent(DescriptorHandle& handle)
+{
+	if (handle.block == HEAP_ALLOCATOR_NONE)
+	{
+		return;
+	}
+
+	m_persistent.Free(handle.block);
+	handle.index = DESCRIPTOR_NONE;
+	handle.block = HEAP_ALLOCATOR_NONE;
+}
+
+DescriptorHandle DescriptorAllocator::AllocateFrame(uint32_t count)
+{
+	DescriptorHandle handle = { DESCRIPTOR_NONE, 0, 0, 0, HEAP_ALLOCATOR_NONE };
+	uint64_t offset;
+	if (count == 0 || m_frameCount == 0 || !m_frame.Allocate(count, 1, offset))
+	{
+		return handle;
+	}
+
+	const uint32_t used = static_cast<uint32_t>(m_frame.GetUsedBytes());
+	m_framePeak = used > m_framePeak ? used : m_framePeak;
+	return GetHandle(m_persistentCount + static_cast<uint32_t>(offset), count, HEAP_ALLOCATOR_NONE);
+}
+
+void DescriptorAllocator::Submit(uint64_t fenceValue)
+{
+	m_frame.Submit(fenceValue);
+}
+
+size_t DescriptorAllocator::GetCpu(const DescriptorHandle& handle, uint32_t offset) const
+{
+	return handle.cpu + static_cast<size_t>(offset) * m_incrementSize;
+}
+
+uint32_t DescriptorAllocator::GetPersistentCount() const
+{
+	return m_persistentCount;
+}
+
+uint32_t DescriptorAllocator::GetFrameCount() const
+{
+	return m_frameCount;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::GetStats() const
+{
+	DescriptorAllocatorStats stats = {};
+	const HeapAllocatorStats persistentStats = m_persistent.GetStats();
+	stats.persistentUsed = static_cast<uint32_t>(persistentStats.usedBytes);
+	stats.persistentAllocations = persistentStats.allocationCount;
+	stats.frameUsed = m_frameCount > 0 ? static_cast<uint32_t>(m_frame.GetUsedBytes()) : 0;
+	stats.framePeak = m_framePeak;
+	stats.frameFailures = m_frameCount > 0 ? m_frame.GetStats().failedAllocations : 0;
+	return stats;
+}
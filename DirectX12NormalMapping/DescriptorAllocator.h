@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "HeapAllocator.h"
+#include "UploadRing.h"
+
+// a descriptor index that is not one, see DescriptorHandle
+const uint32_t DESCRIPTOR_NONE = ~0u;
+
+// count descriptors in a row, the pointers are those of D3D12_CPU_DESCRIPTOR_HANDLE and D3D12_GPU_DESCRIPTOR_HANDLE
+struct DescriptorHandle
+{
+	uint32_t index;	// in the heap, DESCRIPTOR_NONE when nothing was allocated
+	uint32_t count;
+	size_t cpu;
+	uint64_t gpu;	// 0 in a heap that is not shader visible
+	uint32_t block;	// of a persistent range, pass the handle to FreePersistent
+};
+
+struct DescriptorAllocatorStats
+{
+	uint32_t persistentUsed;
+	uint32_t persistentAllocations;
+	uint32_t frameUsed;	// not reclaimed yet, the end of the region skipped on a wrap included
+	uint32_t framePeak;
+	uint32_t frameFailures;	// the frame region was full
+};
+
+// Hands out ranges of one descriptor heap. The first persistentCount
+// descriptors are allocated and freed like heap memory, through a
+// HeapAllocator with a granularity of one descriptor, and keep their index
+// until freed. The frameCount after them are a ring like the upload ring:
+// ranges for one frame, taken in order and reused once the fence passes the
+// value the frame was submitted with. The heap's start addresses and
+// increment come from the caller and the completed fence value from the
+// injected clock.
+class DescriptorAllocator
+{
+private:
+	uint32_t m_persistentCount;
+	uint32_t m_frameCount;
+	uint32_t m_incrementSize;
+	size_t m_cpuStart;
+	uint64_t m_gpuStart;
+	HeapAllocator m_persistent;
+	UploadRing m_frame;
+	uint32_t m_framePeak;
+
+	DescriptorHandle GetHandle(uint32_t index, uint32_t count, uint32_t block) const;
+
+public:
+	DescriptorAllocator(uint32_t persistentCount, uint32_t frameCount, uint32_t incrementSize, size_t cpuStart, uint64_t gpuStart,
+		std::function<uint64_t()> completedFenceValue);
+
+	// index is DESCRIPTOR_NONE when the persistent region has no count descriptors in a row
+	DescriptorHandle AllocatePersistent(uint32_t count);
+	void FreePersistent(DescriptorHandle& handle);
+	// valid for the frame being recorded, index is DESCRIPTOR_NONE when the frames in flight hold the whole region
+	DescriptorHandle AllocateFrame(uint32_t count);
+	// the ranges allocated for the frame are read until the fence reaches fenceValue
+	void Submit(uint64_t fenceValue);
+	// the descriptor offset descriptors into the range
+	size_t GetCpu(const DescriptorHandle& handle, uint32_t offset) const;
+
+	uint32_t GetPersistentCount() const;
+	uint32_t GetFrameCount() const;
+	DescriptorAllocatorStats GetStats() const;
+};
@@ -0,0 +1,190 @@
+#include "DescriptorAllocatorTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <vector>
+#include "DescriptorAllocator.h"
+
+using std::mt19937;
+using std::vector;
+
+namespace
+{
+	// nothing is written at these, the allocator only adds to them
+	const size_t CPU_START = 0x10000;
+	const uint64_t GPU_START = 0x200000000ull;
+	const uint32_t INCREMENT_SIZE = 32;
+
+	struct Range
+	{
+		uint32_t index;
+		uint32_t count;
+		uint64_t fenceValue;	// frame ranges, read until the fence gets here
+	};
+
+	bool Overlaps(const Range& a, const Range& b)
+	{
+		return a.index < b.index + b.count && b.index < a.index + a.count;
+	}
+
+	// the addresses follow from the index, the range lies in its region
+	bool CheckHandle(const DescriptorHandle& handle, uint32_t count, uint32_t first, uint32_t end, bool shaderVisible)
+	{
+		return handle.index != DESCRIPTOR_NONE && handle.count == count && handle.index >= first && handle.index + count <= end &&
+			handle.cpu == CPU_START + handle.index * INCREMENT_SIZE &&
+			handle.gpu == (shaderVisible ? GPU_START + handle.index * INCREMENT_SIZE : 0);
+	}
+
+	// tables of one actor and single SRVs come and go, the live ones stay where they were put
+	bool TestPersistent()
+	{
+		const uint32_t persistentCount = 64;
+		DescriptorAllocator allocator(persistentCount, 0, INCREMENT_SIZE, CPU_START, 0, []() { return 0ull; });
+		mt19937 random(3456);
+		vector<DescriptorHandle> live;
+		bool passed = true;
+		uint32_t failures = 0;
+
+		for (uint32_t i = 0; i < 5000; ++i)
+		{
+			if (!live.empty() && random() % 2 == 0)
+			{
+				const size_t index = random() % live.size();
+				allocator.FreePersistent(live[index]);
+				passed = passed && live[index].index == DESCRIPTOR_NONE;
+				live[index] = live.back();
+				live.pop_back();
+				continue;
+			}
+
+			const uint32_t count = random() % 3 == 0 ? 4 : 1;
+			const DescriptorHandle handle = allocator.AllocatePersistent(count);
+			if (handle.index == DESCRIPTOR_NONE)
+			{
+				++failures;
+				continue;
+			}
+
+			passed = passed && CheckHandle(handle, count, 0, persistentCount, false);
+			const Range range = { handle.index, count, 0 };
+			uint32_t used = count;
+			for (const DescriptorHandle& other : live)
+			{
+				const Range otherRange = { other.index, other.count, 0 };
+				passed = passed && !Overlaps(range, otherRange);
+				used += other.count;
+			}
+			live.push_back(handle);
+			passed = passed && allocator.GetStats().persistentUsed == used;
+		}
+
+		// everything back, the whole region is one range again
+		for (DescriptorHandle& handle : live)
+		{
+			allocator.FreePersistent(handle);
+		}
+		const DescriptorHandle whole = allocator.AllocatePersistent(persistentCount);
+		passed = passed && whole.index == 0 && allocator.AllocatePersistent(1).index == DESCRIPTOR_NONE;
+		passed = passed && allocator.AllocateFrame(1).index == DESCRIPTOR_NONE;
+
+		wprintf(L"  %-40s %s  %u failed\n", L"persistent ranges", passed ? L"ok" : L"FAILED", failures);
+		return passed;
+	}
+
+	// a freed range is handed out again, a live one is never moved
+	bool TestStableHandles()
+	{
+		DescriptorAllocator allocator(16, 0, INCREMENT_SIZE, CPU_START, GPU_START, []() { return 0ull; });
+		DescriptorHandle a = allocator.AllocatePersistent(4);
+		DescriptorHandle b = allocator.AllocatePersistent(4);
+		DescriptorHandle c = allocator.AllocatePersistent(4);
+		bool passed = a.index == 0 && b.index == 4 && c.index == 8 && CheckHandle(b, 4, 0, 16, true);
+		passed = passed && allocator.GetCpu(b, 3) == CPU_START + 7 * INCREMENT_SIZE;
+
+		allocator.FreePersistent(b);
+		const DescriptorHandle single = allocator.AllocatePersistent(1);
+		const DescriptorHandle table = allocator.AllocatePersistent(4);
+		passed = passed && single.index == 4 && table.index == 12 && allocator.AllocatePersistent(4).index == DESCRIPTOR_NONE;
+		passed = passed && a.index == 0 && c.index == 8 && allocator.GetStats().persistentAllocations == 4;
+
+		// freeing twice does nothing
+		allocator.FreePersistent(a);
+		allocator.FreePersistent(a);
+		passed = passed && allocator.GetStats().persistentAllocations == 3 && allocator.AllocatePersistent(4).index == 0;
+
+		wprintf(L"  %-40s %s\n", L"stable handles", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// every frame builds a few tables, the fence lags framesInFlight frames behind
+	bool RunFrames(const wchar_t* name, uint32_t frameCount, uint32_t framesInFlight, uint32_t tablesPerFrame, bool mayFail)
+	{
+		const uint32_t persistentCount = 8;
+		uint64_t completedFenceValue = 0;
+		DescriptorAllocator allocator(persistentCount, frameCount, INCREMENT_SIZE, CPU_START, GPU_START,
+			[&]() { return completedFenceValue; });
+		mt19937 random(7890);
+		vector<Range> inFlight;
+		bool passed = true;
+
+		const DescriptorHandle persistent = allocator.AllocatePersistent(persistentCount);
+		for (uint32_t frame = 0; frame < 1000; ++frame)
+		{
+			const uint64_t fenceValue = frame + 1;
+			completedFenceValue = fenceValue > framesInFlight ? fenceValue - framesInFlight : 0;
+			for (size_t i = 0; i < inFlight.size();)
+			{
+				if (inFlight[i].fenceValue <= completedFenceValue)
+				{
+					inFlight[i] = inFlight.back();
+					inFlight.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+
+			for (uint32_t table = 0; table < tablesPerFrame; ++table)
+			{
+				const uint32_t count = 1 + random() % 4;
+				const DescriptorHandle handle = allocator.AllocateFrame(count);
+				if (handle.index == DESCRIPTOR_NONE)
+				{
+					passed = passed && mayFail;
+					continue;
+				}
+
+				passed = passed && CheckHandle(handle, count, persistentCount, persistentCount + frameCount, true);
+				const Range range = { handle.index, count, fenceValue };
+				for (const Range& other : inFlight)
+				{
+					passed = passed && !Overlaps(range, other);
+				}
+				inFlight.push_back(range);
+			}
+			allocator.Submit(fenceValue);
+		}
+		passed = passed && persistent.index == 0;
+
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		passed = passed && stats.framePeak <= frameCount && (mayFail || stats.frameFailures == 0);
+		wprintf(L"  %-40s %s  peak %u of %u, %u failed\n", name, passed ? L"ok" : L"FAILED", stats.framePeak, frameCount,
+			stats.frameFailures);
+		return passed;
+	}
+}
+
+int RunDescriptorAllocatorTests()
+{
+	int failures = 0;
+
+	failures += TestPersistent() ? 0 : 1;
+	failures += TestStableHandles() ? 0 : 1;
+	failures += RunFrames(L"one frame in flight, 64 descriptors", 64, 1, 8, false) ? 0 : 1;
+	failures += RunFrames(L"three frames in flight, 128 descriptors", 128, 3, 8, false) ? 0 : 1;
+	failures += RunFrames(L"three frames in flight, 32 descriptors", 32, 3, 8, true) ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// DescriptorAllocator over a fake heap, made up start addresses and a fake
+// increment size with a fake fence, checks that persistent ranges keep their
+// index and never overlap, that frame ranges are not reused while a frame in
+// flight could still read them, prints every case and returns 0 when all of
+// them pass
+int RunDescriptorAllocatorTests();
@@ -1,7 +1,11 @@
 #include "stdafx.h"
 #include <comdef.h>
+#include <algorithm>
 #include <iostream>
+#include <cstdio>
+#include <cfloat>
 #include "Engine.h"
+#include "VertexQuantizer.h"
 
 const XMFLOAT3 X_UNIT_VEC_FLOAT = XMFLOAT3(1.0f, 0.0f, 0.0f);
 const XMFLOAT3 Y_UNIT_VEC_FLOAT = XMFLOAT3(0.0f, 1.0f, 0.0f);
@@ -11,11 +15,94 @@ const XMVECTOR X_UNIT_VEC = XMLoadFloat3(&X_UNIT_VEC_FLOAT);
 const XMVECTOR Y_UNIT_VEC = XMLoadFloat3(&Y_UNIT_VEC_FLOAT);
 const XMVECTOR Z_UNIT_VEC = XMLoadFloat3(&Z_UNIT_VEC_FLOAT);
 
+namespace
+{
+	// a texture cooked with -cook-texture, or converted to KTX2, is mapped instead of decoding the PNG next to it
+	bool FindCookedTexture(const wstring& baseName, wstring& fileName)
+	{
+		const wchar_t* extensions[] = { L".dds", L".ktx2" };
+		for (const wchar_t* extension : extensions)
+		{
+			fileName = baseName + extension;
+			if (GetFileAttributesW(fileName.c_str()) != INVALID_FILE_ATTRIBUTES)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	wstring SelectTextureFile(const wstring& baseName)
+	{
+		wstring fileName;
+		return FindCookedTexture(baseName, fileName) ? fileName : baseName + L".png";
+	}
+}
+
+// the coarsest LOD whose error projects to at most this many pixels is drawn
+const float LOD_PIXEL_ERROR = 1.0f;
+
+const D3D12_INPUT_ELEMENT_DESC FULL_INPUT_LAYOUT[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
+const D3D12_INPUT_ELEMENT_DESC QUANTIZED_INPUT_LAYOUT[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
 Engine::Engine(UINT resolutionWidth, UINT resolutionHeight)
 	: m_resolutionWidth(resolutionWidth), m_resolutionHeight(resolutionHeight),
-	m_actor(this)
+	m_vertexFormat(VertexFormat::Quantized),
+	m_sceneStates(m_resourceStates),
+	m_lightStates(m_resourceStates),
+	m_uploadStates(m_resourceStates),
+	m_lod(0),
+	m_shadowLod(0),
+	m_meshletCulling(false),
+	m_meshletStats(),
+	m_meshResident(false),
+	m_placeholderLod(),
+	m_uploadsRecorded(false),
+	m_copyWaitPending(false),
+	m_copyWaitValue(0),
+	m_assetsResident(false),
+	m_firstFramePresented(false),
+	m_startTime(high_resolution_clock::now()),
+	m_residency(~0ull),
+	m_releaseQueue([this]() { return m_fence->GetCompletedValue(); }),
+	m_copyReleaseQueue([this]() { return m_copyFence->GetCompletedValue(); }),
+	m_copyAllocator(0),
+	m_copyListOpen(false),
+	m_copyFenceValue(1),
+	m_uploadRingData(nullptr),
+	m_uploadRing(UPLOAD_RING_SIZE, [this]() { return m_fence->GetCompletedValue(); }),
+	m_copyRingData(nullptr),
+	m_copyRing(UPLOAD_RING_SIZE, [this]() { return m_copyFence->GetCompletedValue(); }),
+	m_textureCache(this),
+	m_textureStreaming(false),
+	m_textureBudget(0),
+	m_mipStreamer(0),
+	m_actor(this),
+	m_assetLoader(ThreadPool::GetShared())
 {
 	m_shadowMapRes = 1024;
+	for (MeshBuffers* mesh : { &m_mesh, &m_placeholderMesh })
+	{
+		mesh->vertexBufferView = {};
+		mesh->indexBufferView = {};
+		mesh->allocations[0] = RESIDENCY_NONE;
+		mesh->allocations[1] = RESIDENCY_NONE;
+		mesh->placements[0].block = HEAP_ALLOCATOR_NONE;
+		mesh->placements[1].block = HEAP_ALLOCATOR_NONE;
+	}
 }
 
 
@@ -67,6 +154,10 @@ void Engine::WaitForPreviousFrame()
 
 	++m_fenceValue;
 
+	// the copies recorded this frame read the ring until the fence gets here, the scene pass its table
+	m_uploadRing.Submit(fence);
+	m_textureDescriptors->Submit(fence);
+
 	if (m_fence->GetCompletedValue() < fence)
 	{
 		hr = m_fence->SetEventOnCompletion(fence, m_fenceEvent);
@@ -95,7 +186,7 @@ void Engine::CreateRootSignature()
 	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
 	// albedo texture
-	D3D12_DESCRIPTOR_RANGE descriptorRanges[5];
+	D3D12_DESCRIPTOR_RANGE descriptorRanges[4];
 	descriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	descriptorRanges[0].NumDescriptors = 1;
 	descriptorRanges[0].BaseShaderRegister = 0;
@@ -109,27 +200,20 @@ void Engine::CreateRootSignature()
 	descriptorRanges[1].RegisterSpace = 0;
 	descriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-	// oclussion texture
+	// occlusion, roughness and specular packed into one texture
 	descriptorRanges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	descriptorRanges[2].NumDescriptors = 1;
 	descriptorRanges[2].BaseShaderRegister = 2;
 	descriptorRanges[2].RegisterSpace = 0;
 	descriptorRanges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-	// roughness texture
+	// depth buffer texture
 	descriptorRanges[3].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	descriptorRanges[3].NumDescriptors = 1;
 	descriptorRanges[3].BaseShaderRegister = 3;
 	descriptorRanges[3].RegisterSpace = 0;
 	descriptorRanges[3].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-	// depth buffer texture
-	descriptorRanges[4].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	descriptorRanges[4].NumDescriptors = 1;
-	descriptorRanges[4].BaseShaderRegister = 4;
-	descriptorRanges[4].RegisterSpace = 0;
-	descriptorRanges[4].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
 	D3D12_ROOT_DESCRIPTOR_TABLE descriptorTable;
 	descriptorTable.NumDescriptorRanges = _countof(descriptorRanges);
 	descriptorTable.pDescriptorRanges = &descriptorRanges[0];
@@ -265,9 +349,12 @@ void Engine::LoadShaders()
 	UINT compileFlags = 0;
 #endif
 
+	const D3D_SHADER_MACRO quantizedDefines[] = { { "QUANTIZED_VERTICES", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO* defines = m_vertexFormat == VertexFormat::Quantized ? quantizedDefines : nullptr;
+
 	ComPtr<ID3DBlob> vsErrorMsgs;
 	HRESULT hr = D3DCompileFromFile(
-		TEXT("Shaders.hlsl"), nullptr, nullptr, "vsMain", "vs_5_0", compileFlags, 0, &m_vertexShader, &vsErrorMsgs);
+		TEXT("Shaders.hlsl"), defines, nullptr, "vsMain", "vs_5_0", compileFlags, 0, &m_vertexShader, &vsErrorMsgs);
 
 	if (FAILED(hr))
 	{
@@ -278,7 +365,7 @@ void Engine::LoadShaders()
 
 	ComPtr<ID3DBlob> psErrorMsgs;
 	hr = D3DCompileFromFile(
-		TEXT("Shaders.hlsl"), nullptr, nullptr, "psMain", "ps_5_0", compileFlags, 0, &m_pixelShader, &psErrorMsgs);
+		TEXT("Shaders.hlsl"), defines, nullptr, "psMain", "ps_5_0", compileFlags, 0, &m_pixelShader, &psErrorMsgs);
 
 	if (FAILED(hr))
 	{
@@ -289,7 +376,7 @@ void Engine::LoadShaders()
 
 	ComPtr<ID3DBlob> psDepthErrorMsgs;
 	hr = D3DCompileFromFile(
-		TEXT("Shaders.hlsl"), nullptr, nullptr, "psDepth", "ps_5_0", compileFlags, 0, &m_lightPixelShader, &psDepthErrorMsgs);
+		TEXT("Shaders.hlsl"), defines, nullptr, "psDepth", "ps_5_0", compileFlags, 0, &m_lightPixelShader, &psDepthErrorMsgs);
 
 	if (FAILED(hr))
 	{
@@ -300,7 +387,7 @@ void Engine::LoadShaders()
 
 	ComPtr<ID3DBlob> vsDepthErrorMsgs;
 	hr = D3DCompileFromFile(
-		TEXT("Shaders.hlsl"), nullptr, nullptr, "vsDepth", "vs_5_0", compileFlags, 0, &m_lightVertexShader, &vsDepthErrorMsgs);
+		TEXT("Shaders.hlsl"), defines, nullptr, "vsDepth", "vs_5_0", compileFlags, 0, &m_lightVertexShader, &vsDepthErrorMsgs);
 
 	if (FAILED(hr))
 	{
@@ -315,7 +402,7 @@ void Engine::LoadTextures()
 	// SRV descriptor heap
 	D3D12_DESCRIPTOR_HEAP_DESC srvDescriptorHeapDesc = {};
 	srvDescriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	srvDescriptorHeapDesc.NumDescriptors = 5;
+	srvDescriptorHeapDesc.NumDescriptors = SRV_HEAP_FRAME_DESCRIPTORS;
 	srvDescriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 
 	HRESULT hr = m_device->CreateDescriptorHeap(&srvDescriptorHeapDesc, IID_PPV_ARGS(&m_textureDescriptorHeap));
@@ -326,37 +413,48 @@ void Engine::LoadTextures()
 	}
 
 	m_textureDescriptorHeap->SetName(TEXT("SRV Descriptor Heap"));
+	const UINT descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	m_textureDescriptors = std::make_unique<DescriptorAllocator>(0, SRV_HEAP_FRAME_DESCRIPTORS, descriptorSize,
+		m_textureDescriptorHeap->GetCPUDescriptorHandleForHeapStart().ptr, m_textureDescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr,
+		[this]() { return m_fence->GetCompletedValue(); });
+
+	// copies are made from CPU side heaps only
+	D3D12_DESCRIPTOR_HEAP_DESC stagingHeapDesc = {};
+	stagingHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	stagingHeapDesc.NumDescriptors = SRV_STAGING_DESCRIPTORS;
+	stagingHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+	hr = m_device->CreateDescriptorHeap(&stagingHeapDesc, IID_PPV_ARGS(&m_srvStagingHeap));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
 
-	m_actor.LoadAlbedoFromFile(TEXT("Assets\\color.png"));
-	m_actor.UploadAlbedoResource(m_textureDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	D3D12_CPU_DESCRIPTOR_HANDLE textureDescriptorHeapStart = m_textureDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	UINT srvHandleDescriptorIncrementSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-
-	m_actor.LoadNormalFromFile(TEXT("Assets\\normal.png"));
-	CD3DX12_CPU_DESCRIPTOR_HANDLE normalCPUDescriptorHandle(
-		textureDescriptorHeapStart,
-		1,
-		srvHandleDescriptorIncrementSize
-	);
-	m_actor.UploadNormalResource(normalCPUDescriptorHandle);
+	m_srvStagingHeap->SetName(TEXT("SRV Staging Descriptor Heap"));
+	m_stagingDescriptors = std::make_unique<DescriptorAllocator>(SRV_STAGING_DESCRIPTORS, 0, descriptorSize,
+		m_srvStagingHeap->GetCPUDescriptorHandleForHeapStart().ptr, 0, [this]() { return m_fence->GetCompletedValue(); });
+	m_textureCache.CreateDescriptorHeap(m_device.Get());
 
-	m_actor.LoadOcclusionFromFile(TEXT("Assets\\oclussion.png"));
-	CD3DX12_CPU_DESCRIPTOR_HANDLE oclussionCpuDescriptorHandle(
-		textureDescriptorHeapStart,
-		2,
-		srvHandleDescriptorIncrementSize
-	);
-	m_actor.UploadOclussionResource(oclussionCpuDescriptorHandle);
+	// flat placeholders until the loader has uploaded the real textures
+	const BYTE placeholderColors[3][4] =
+	{
+		{ 128, 128, 128, 255 },	// albedo, BGRA
+		{ 255, 128, 128, 255 },	// normal, straight out of the surface
+		{ 255, 128, 255, 255 }	// ORM: full specular, mid roughness, white occlusion
+	};
+	const wchar_t* placeholderNames[3] = { L"Albedo Placeholder", L"Normal Placeholder", L"ORM Placeholder" };
 
-	m_actor.LoadRoughnessFromFile(TEXT("Assets\\roughness.png"));
-	CD3DX12_CPU_DESCRIPTOR_HANDLE roughnessCpuDescriptorHandle(
-		textureDescriptorHeapStart,
-		3,
-		srvHandleDescriptorIncrementSize
-	);
-	m_actor.UploadRoughnessResource(roughnessCpuDescriptorHandle);
+	m_placeholderTextures.clear();
+	m_placeholderTextures.reserve(3);
+	for (UINT i = 0; i < 3; ++i)
+	{
+		m_placeholderTextures.emplace_back(this);
+		m_placeholderTextures[i].LoadSolidColor(placeholderColors[i][0], placeholderColors[i][1], placeholderColors[i][2], placeholderColors[i][3]);
+		m_placeholderSrvs[i] = m_stagingDescriptors->AllocatePersistent(1);
+		m_placeholderTextures[i].CreateResource(placeholderNames[i], D3D12_CPU_DESCRIPTOR_HANDLE{ m_placeholderSrvs[i].cpu });
+		m_placeholderTextures[i].UploadToResource(m_commandList.Get());
+		TrackTexture(&m_placeholderTextures[i], true);
+	}
 
 	// light depth
 	// SRV descriptor
@@ -366,32 +464,589 @@ void Engine::LoadTextures()
 	srvLightDepthTextDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvLightDepthTextDesc.Texture2D.MipLevels = 1;
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE lightCPUDescriptorHandle(
-		textureDescriptorHeapStart,
-		4,
-		srvHandleDescriptorIncrementSize
-	);
+	m_lightDepthSrv = m_stagingDescriptors->AllocatePersistent(1);
 	m_device->CreateShaderResourceView(
 		m_dsLightBuffer.Get(),
 		&srvLightDepthTextDesc,
-		lightCPUDescriptorHandle
+		D3D12_CPU_DESCRIPTOR_HANDLE{ m_lightDepthSrv.cpu }
 	);
 }
 
-void Engine::CreatePipelineStateObject()
+D3D12_GPU_DESCRIPTOR_HANDLE Engine::BuildSceneTable()
 {
-	// input layout
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
+	// copied into this frame's region, so a table a frame in flight reads is never rewritten
+	const DescriptorHandle table = m_textureDescriptors->AllocateFrame(SCENE_TABLE_SIZE);
+	if (table.index == DESCRIPTOR_NONE)
+	{
+		exit(-1);
+	}
+
+	for (UINT slot = 0; slot < _countof(m_boundTextures); ++slot)
+	{
+		const D3D12_CPU_DESCRIPTOR_HANDLE source = m_boundTextures[slot] ? m_textureCache.GetDescriptorHandle(m_boundTextures[slot]) :
+			D3D12_CPU_DESCRIPTOR_HANDLE{ m_placeholderSrvs[slot].cpu };
+		m_device->CopyDescriptorsSimple(1, D3D12_CPU_DESCRIPTOR_HANDLE{ m_textureDescriptors->GetCpu(table, slot) }, source,
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	}
+	m_device->CopyDescriptorsSimple(1, D3D12_CPU_DESCRIPTOR_HANDLE{ m_textureDescriptors->GetCpu(table, _countof(m_boundTextures)) },
+		D3D12_CPU_DESCRIPTOR_HANDLE{ m_lightDepthSrv.cpu }, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	return D3D12_GPU_DESCRIPTOR_HANDLE{ table.gpu };
+}
+
+void Engine::UploadTexture(const TextureHandle& texture, const wchar_t* const textureName, UINT slot)
+{
+	// a texture another actor loaded already has its resource
+	if (!m_textureCache.IsUploaded(texture))
+	{
+		// streamed textures start with their tail, StreamTextures brings in the finer levels
+		UINT firstMip = 0;
+		if (m_textureStreaming)
+		{
+			UINT streamed = m_mipStreamer.AddTexture(texture->GetWidth(), texture->GetHeight(), texture->GetMipLevels(),
+				texture->GetFormat());
+			m_streamedTextures.push_back(texture.Get());
+			texture->SetStreaming(true);
+			firstMip = m_mipStreamer.GetTexture(streamed).residentMip;
+		}
+
+		// on the copy queue, the placeholder stays bound until the copy has run
+		m_textureCache.Upload(texture, textureName, firstMip, GetCopyCommandList());
+	}
+
+	// a texture another actor loaded can still be on the copy queue, so binding waits for this frame's copies either way
+	PendingCopy bind = { m_copyFenceValue, [this, texture, slot]()
+	{
+		if (texture->IsCopyPending())
+		{
+			texture->FinishCopy(m_uploadCommandList.Get());
+			TrackTexture(texture.Get(), !m_textureStreaming);
+		}
+		BindTexture(texture, slot);
+	} };
+	m_pendingCopies.push_back(bind);
+}
+
+void Engine::BindTexture(const TextureHandle& texture, UINT slot)
+{
+	// the scene pass table is built from the bindings every frame
+	m_boundTextures[slot] = texture;
+}
+
+void Engine::LoadAssetsAsync()
+{
+	// file I/O and decoding on the thread pool, resource creation and copies
+	// on the render thread in UploadLoadedAssets
+	m_assetLoader.Load("model mesh", [this]() { LoadMesh(); }, [this]() { UploadMesh(); });
+
+	m_assetLoader.Load("color",
+		[this]() { m_actor.LoadAlbedoFromFile(SelectTextureFile(TEXT("Assets\\color")).c_str()); },
+		[this]() { UploadTexture(m_actor.GetAlbedo(), L"Albedo", 0); });
+
+	m_assetLoader.Load("normal",
+		[this]() { m_actor.LoadNormalFromFile(SelectTextureFile(TEXT("Assets\\normal")).c_str()); },
+		[this]() { UploadTexture(m_actor.GetNormal(), L"Normal", 1); });
+
+	// packed on load unless cooked with -pack-orm
+	m_assetLoader.Load("orm",
+		[this]()
+		{
+			wstring ormFileName;
+			if (FindCookedTexture(TEXT("Assets\\orm"), ormFileName))
+			{
+				m_actor.LoadOrmFromFile(ormFileName.c_str());
+			}
+			else
+			{
+				m_actor.LoadOrmFromFiles(TEXT("Assets\\oclussion.png"), TEXT("Assets\\roughness.png"));
+			}
+		},
+		[this]() { UploadTexture(m_actor.GetOrm(), L"ORM", 2); });
+}
+
+void Engine::ResetUploadCommandList()
+{
+	// the previous frame has finished, so the allocator can be reused
+	HRESULT hr = m_uploadCommandAllocator->Reset();
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	hr = m_uploadCommandList->Reset(m_uploadCommandAllocator.Get(), nullptr);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_uploadStates.Begin();
+}
+
+void Engine::CloseUploadCommandList()
+{
+	EndCommandList(m_uploadCommandList.Get());
+	HRESULT hr = m_uploadCommandList->Close();
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+}
+
+void Engine::CreateCopyQueue()
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+
+	if (FAILED(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue))))
+	{
+		exit(-1);
+	}
+	m_copyQueue->SetName(L"Copy Queue");
+
+	HRESULT hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_copyFence));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_copyFenceValue = 1;
+}
+
+ID3D12GraphicsCommandList* Engine::GetCopyCommandList()
+{
+	if (m_copyListOpen)
+	{
+		return m_copyCommandList.Get();
+	}
+
+	// an allocator whose copies have run, or a new one while they are all in flight
+	const UINT64 completedValue = m_copyFence->GetCompletedValue();
+	m_copyAllocator = 0;
+	while (m_copyAllocator < m_copyAllocators.size() && m_copyAllocators[m_copyAllocator].fenceValue > completedValue)
+	{
+		++m_copyAllocator;
+	}
+
+	HRESULT hr;
+	if (m_copyAllocator == m_copyAllocators.size())
+	{
+		CopyAllocator copyAllocator = { nullptr, 0 };
+		hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&copyAllocator.allocator));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		m_copyAllocators.push_back(copyAllocator);
+	}
+	else
+	{
+		hr = m_copyAllocators[m_copyAllocator].allocator->Reset();
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+
+	ID3D12CommandAllocator* allocator = m_copyAllocators[m_copyAllocator].allocator.Get();
+	if (!m_copyCommandList)
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator, nullptr, IID_PPV_ARGS(&m_copyCommandList));
+	}
+	else
+	{
+		hr = m_copyCommandList->Reset(allocator, nullptr);
+	}
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_copyListOpen = true;
+	return m_copyCommandList.Get();
+}
+
+void Engine::SubmitCopies()
+{
+	// nothing recorded and nothing waiting for the current value
+	const bool waited = !m_pendingCopies.empty() && m_pendingCopies.back().fenceValue == m_copyFenceValue;
+	if (!m_copyListOpen && !waited)
+	{
+		return;
+	}
+
+	if (m_copyListOpen)
+	{
+		HRESULT hr = m_copyCommandList->Close();
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+
+		ID3D12CommandList* ppCopyCommandLists[] = { m_copyCommandList.Get() };
+		m_copyQueue->ExecuteCommandLists(_countof(ppCopyCommandLists), ppCopyCommandLists);
+		m_copyAllocators[m_copyAllocator].fenceValue = m_copyFenceValue;
+		m_copyListOpen = false;
+	}
+
+	const UINT64 fence = m_copyFenceValue;
+	HRESULT hr = m_copyQueue->Signal(m_copyFence.Get(), fence);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	++m_copyFenceValue;
+
+	// the copy queue reads the ring until its fence gets here
+	m_copyRing.Submit(fence);
+}
+
+void Engine::CompleteCopies()
+{
+	// the copies that have run are used from this frame on, in the order they were recorded
+	const UINT64 completedValue = m_copyFence->GetCompletedValue();
+	size_t completed = 0;
+	while (completed < m_pendingCopies.size() && m_pendingCopies[completed].fenceValue <= completedValue)
+	{
+		m_copyWaitValue = m_pendingCopies[completed].fenceValue;
+		m_pendingCopies[completed].firstUse();
+		++completed;
+	}
+
+	if (completed > 0)
+	{
+		m_pendingCopies.erase(m_pendingCopies.begin(), m_pendingCopies.begin() + completed);
+
+		// the transitions out of COMMON are on the upload list
+		m_copyWaitPending = true;
+		m_uploadsRecorded = true;
+	}
+}
+
+void Engine::WaitForCopies()
+{
+	SubmitCopies();
+	const UINT64 fence = m_copyFenceValue - 1;
+	if (m_copyFence->GetCompletedValue() < fence)
+	{
+		HRESULT hr = m_copyFence->SetEventOnCompletion(fence, m_fenceEvent);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+void Engine::UploadLoadedAssets()
+{
+	if (m_assetsResident)
+	{
+		return;
+	}
+
+	m_assetLoader.UploadLoaded();
+
+	// resident once the copy queue has run the last upload and the direct queue has started using it
+	if (m_assetLoader.IsIdle() && m_pendingCopies.empty() && !m_copyListOpen)
+	{
+		m_assetsResident = true;
+
+		char residentMsg[128];
+		sprintf_s(residentMsg, "All assets resident %.2f ms after startup\n",
+			duration<float, std::milli>(high_resolution_clock::now() - m_startTime).count());
+		OutputDebugStringA(residentMsg);
+
+		LogStartupReport();
+	}
+}
+
+UINT Engine::TrackBuffer(ID3D12Resource* const buffer)
+{
+	D3D12_RESOURCE_DESC bufferDesc = buffer->GetDesc();
+	return m_residency.AddAllocation(ResidencyKind::Buffer, m_device->GetResourceAllocationInfo(0, 1, &bufferDesc).SizeInBytes);
+}
+
+void Engine::TrackTexture(Texture* const texture, bool managed)
+{
+	const UINT mipCount = texture->GetMipLevels() < TEXTURE_FILE_MAX_MIPS ? texture->GetMipLevels() : TEXTURE_FILE_MAX_MIPS;
+	UINT64 chainSizes[TEXTURE_FILE_MAX_MIPS] = {};
+	for (UINT mip = 0; mip < mipCount; ++mip)
+	{
+		chainSizes[mip] = texture->GetAllocationSize(mip);
+	}
+
+	const UINT index = m_residency.AddTexture(texture->GetWidth(), texture->GetHeight(), mipCount, texture->GetFormat(),
+		texture->GetFirstResidentMip(), chainSizes, managed);
+	if (index >= m_residentTextures.size())
+	{
+		m_residentTextures.resize(index + 1, nullptr);
+	}
+	m_residentTextures[index] = texture;
+	texture->SetResidencyIndex(index);
+}
+
+void Engine::Retire(DeferredReleaseQueue& queue, UINT64 fenceValue, ComPtr<ID3D12Resource>& resource, PlacedAllocation& placement,
+	UINT allocation)
+{
+	if (!resource)
+	{
+		return;
+	}
+
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	const UINT64 bytes = m_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+
+	// the state tracker and the heaps can hand its address out again once it is gone
+	ComPtr<ID3D12Resource> retired = resource;
+	PlacedAllocation retiredPlacement = placement;
+	queue.Retire(fenceValue, bytes, [this, retired, retiredPlacement, allocation]() mutable
+	{
+		ForgetResourceState(retired.Get());
+		retired.Reset();
+		m_resourceHeaps.Release(retiredPlacement);
+		if (allocation != RESIDENCY_NONE)
+		{
+			m_residency.RemoveAllocation(allocation);
+		}
+	});
+
+	resource.Reset();
+	placement.block = HEAP_ALLOCATOR_NONE;
+}
+
+void Engine::CreateUploadRing(const wchar_t* const name, ComPtr<ID3D12Resource>& buffer, BYTE*& data)
+{
+	HRESULT hr = m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(UPLOAD_RING_SIZE),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer)
+	);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	buffer->SetName(name);
+	D3D12_RESOURCE_DESC ringDesc = buffer->GetDesc();
+	m_residency.AddAllocation(ResidencyKind::Staging, m_device->GetResourceAllocationInfo(0, 1, &ringDesc).SizeInBytes);
+
+	// mapped for as long as the engine runs, the CPU only writes regions the GPU is done with
+	CD3DX12_RANGE readRange(0, 0);
+	hr = buffer->Map(0, &readRange, reinterpret_cast<void**>(&data));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+}
+
+UploadAllocation Engine::AllocateUpload(ID3D12GraphicsCommandList* const commandList, UINT64 size, UINT64 alignment)
+{
+	// each queue frees its regions as its own fence advances
+	const bool copyQueue = commandList->GetType() == D3D12_COMMAND_LIST_TYPE_COPY;
+	UploadRing& ring = copyQueue ? m_copyRing : m_uploadRing;
+
+	UploadAllocation upload = {};
+	UINT64 offset;
+	if (ring.Allocate(size, alignment, offset))
+	{
+		upload.resource = copyQueue ? m_copyRingBuffer.Get() : m_uploadRingBuffer.Get();
+		upload.offset = offset;
+		upload.data = (copyQueue ? m_copyRingData : m_uploadRingData) + offset;
+		return upload;
+	}
+
+	// larger than what the ring has free this frame, an upload heap of its own that goes once the copy has run
+	ComPtr<ID3D12Resource> uploadHeap;
+	HRESULT hr = m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadHeap)
+	);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	uploadHeap->SetName(L"Oversized Upload Heap");
+
+	CD3DX12_RANGE readRange(0, 0);
+	hr = uploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&upload.data));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	upload.resource = uploadHeap.Get();
+
+	// retired right away, the copy runs before the fence of its queue is signaled with the current value
+	D3D12_RESOURCE_DESC uploadHeapDesc = uploadHeap->GetDesc();
+	const UINT allocation = m_residency.AddAllocation(ResidencyKind::Staging,
+		m_device->GetResourceAllocationInfo(0, 1, &uploadHeapDesc).SizeInBytes);
+	PlacedAllocation committed = {};
+	committed.block = HEAP_ALLOCATOR_NONE;
+	Retire(copyQueue ? m_copyReleaseQueue : m_releaseQueue, copyQueue ? m_copyFenceValue : m_fenceValue, uploadHeap, committed,
+		allocation);
+	return upload;
+}
+
+void Engine::ReleaseRetiredResources()
+{
+	// whatever the frames and copies the GPU has finished were the last to use
+	const UINT64 releasedBytes = m_releaseQueue.Release() + m_copyReleaseQueue.Release();
+	if (releasedBytes > 0)
+	{
+		const DeferredReleaseStats& stats = m_releaseQueue.GetStats();
+		const DeferredReleaseStats& copyStats = m_copyReleaseQueue.GetStats();
+		char releaseMsg[160];
+		sprintf_s(releaseMsg, "deferred release: %u resources, %.2f MB reclaimed, %u resources and %.2f MB still in flight\n",
+			stats.lastReleasedCount + copyStats.lastReleasedCount, releasedBytes / (1024.0 * 1024.0),
+			stats.pendingCount + copyStats.pendingCount, (stats.pendingBytes + copyStats.pendingBytes) / (1024.0 * 1024.0));
+		OutputDebugStringA(releaseMsg);
+	}
+}
+
+void Engine::LogStartupReport()
+{
+	// the texture steps, matched to the loader's timings by asset name
+	struct TextureSteps
+	{
+		const char* name;
+		const TextureLoadTimes& times;
 	};
+	const TextureSteps textureSteps[] =
+	{
+		{ "color", m_actor.GetAlbedoLoadTimes() },
+		{ "normal", m_actor.GetNormalLoadTimes() },
+		{ "orm", m_actor.GetOrmLoadTimes() }
+	};
+
+	OutputDebugStringA("Startup report (ms):\n  asset          start      load    decode      pack      mips    upload\n");
+
+	double wallMs = 0.0;
+	double workMs = 0.0;
+	for (const AssetTiming& timing : m_assetLoader.GetTimings())
+	{
+		char line[192];
+		sprintf_s(line, "  %-10s %9.2f %9.2f %9s %9s %9s %9.2f\n", timing.name.c_str(), timing.startMs, timing.loadMs, "-", "-", "-", timing.uploadMs);
+
+		for (const TextureSteps& steps : textureSteps)
+		{
+			if (timing.name == steps.name)
+			{
+				sprintf_s(line, "  %-10s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", timing.name.c_str(), timing.startMs, timing.loadMs,
+					steps.times.decodeMs, steps.times.packMs, steps.times.mipMs, timing.uploadMs);
+			}
+		}
+		OutputDebugStringA(line);
+
+		wallMs = max(wallMs, timing.startMs + timing.loadMs);
+		workMs += timing.loadMs;
+	}
+
+	char summary[128];
+	sprintf_s(summary, "  loads finished after %.2f ms, %.2f ms of work on %u threads\n",
+		wallMs, workMs, ThreadPool::GetShared().GetThreadCount());
+	OutputDebugStringA(summary);
+
+	TextureCacheStats cacheStats = m_textureCache.GetStats();
+	char cacheMsg[160];
+	sprintf_s(cacheMsg, "  texture cache: %u hits, %u misses, %u textures, %u handles, %.2f MB resident\n",
+		cacheStats.hits, cacheStats.misses, cacheStats.textureCount, cacheStats.handleCount,
+		cacheStats.residentBytes / (1024.0 * 1024.0));
+	OutputDebugStringA(cacheMsg);
+
+	ResidencyStats residencyStats = m_residency.GetStats();
+	char budgetText[32] = "unlimited";
+	if (m_residency.GetBudget() != ~0ull)
+	{
+		sprintf_s(budgetText, "%.2f MB", m_residency.GetBudget() / (1024.0 * 1024.0));
+	}
+	char residencyMsg[192];
+	sprintf_s(residencyMsg, "  residency: %.2f MB in %u textures, %.2f MB of buffers, %.2f MB staging, budget %s\n",
+		residencyStats.textureBytes / (1024.0 * 1024.0), residencyStats.textureCount, residencyStats.bufferBytes / (1024.0 * 1024.0),
+		residencyStats.stagingBytes / (1024.0 * 1024.0), budgetText);
+	OutputDebugStringA(residencyMsg);
+
+	const char* ringNames[] = { "direct", "copy" };
+	const UploadRing* rings[] = { &m_uploadRing, &m_copyRing };
+	for (UINT i = 0; i < _countof(rings); ++i)
+	{
+		const UploadRingStats& ringStats = rings[i]->GetStats();
+		char ringMsg[192];
+		sprintf_s(ringMsg, "  %s upload ring: %.2f MB in %u allocations, %.2f MB peak of %.2f MB, %u wraps, %u oversized\n", ringNames[i],
+			ringStats.allocatedBytes / (1024.0 * 1024.0), ringStats.allocations, ringStats.peakUsedBytes / (1024.0 * 1024.0),
+			rings[i]->GetCapacity() / (1024.0 * 1024.0), ringStats.wraps, ringStats.failedAllocations);
+		OutputDebugStringA(ringMsg);
+	}
 
+	const DeferredReleaseQueue* releaseQueues[] = { &m_releaseQueue, &m_copyReleaseQueue };
+	for (UINT i = 0; i < _countof(releaseQueues); ++i)
+	{
+		const DeferredReleaseStats& releaseStats = releaseQueues[i]->GetStats();
+		char releaseMsg[192];
+		sprintf_s(releaseMsg, "  %s release queue: %u released, %.2f MB reclaimed, %u waiting with %.2f MB, %.2f MB peak\n",
+			ringNames[i], releaseStats.releasedCount, releaseStats.releasedBytes / (1024.0 * 1024.0), releaseStats.pendingCount,
+			releaseStats.pendingBytes / (1024.0 * 1024.0), releaseStats.peakPendingBytes / (1024.0 * 1024.0));
+		OutputDebugStringA(releaseMsg);
+	}
+
+	const char* heapKindNames[] = { "buffers", "textures", "depth", "upload" };
+	for (UINT kind = 0; kind < static_cast<UINT>(ResourceHeapKind::Count); ++kind)
+	{
+		const ResourceHeapStats heapStats = m_resourceHeaps.GetStats(static_cast<ResourceHeapKind>(kind));
+		char heapMsg[192];
+		sprintf_s(heapMsg, "  %s heaps: %u, %.2f MB of %.2f MB used by %u resources, %.1f%% fragmented\n", heapKindNames[kind],
+			heapStats.heapCount, heapStats.usedBytes / (1024.0 * 1024.0), heapStats.reservedBytes / (1024.0 * 1024.0),
+			heapStats.allocationCount, heapStats.fragmentation * 100.0f);
+		OutputDebugStringA(heapMsg);
+	}
+
+	ResourceStateStats barrierStats = {};
+	for (const CommandListStates* states : { &m_sceneStates, &m_lightStates, &m_uploadStates })
+	{
+		barrierStats.requested += states->GetStats().requested;
+		barrierStats.issued += states->GetStats().issued;
+		barrierStats.batches += states->GetStats().batches;
+	}
+	char barrierMsg[160];
+	sprintf_s(barrierMsg, "  barriers: %u transitions asked for, %u recorded in %u ResourceBarrier calls, %zu resources tracked\n",
+		barrierStats.requested, barrierStats.issued, barrierStats.batches, m_resourceStates.GetTrackedCount());
+	OutputDebugStringA(barrierMsg);
+
+	const DescriptorAllocatorStats frameStats = m_textureDescriptors->GetStats();
+	const DescriptorAllocatorStats stagingStats = m_stagingDescriptors->GetStats();
+	char descriptorMsg[192];
+	sprintf_s(descriptorMsg, "  descriptors: %u of %u staging, frame tables peak at %u of %u, %u failed\n", stagingStats.persistentUsed,
+		m_stagingDescriptors->GetPersistentCount(), frameStats.framePeak, m_textureDescriptors->GetFrameCount(), frameStats.frameFailures);
+	OutputDebugStringA(descriptorMsg);
+}
+
+D3D12_INPUT_LAYOUT_DESC Engine::GetInputLayoutDesc() const
+{
 	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
-	inputLayoutDesc.NumElements = _countof(inputLayout);
-	inputLayoutDesc.pInputElementDescs = inputLayout;
+
+	if (m_vertexFormat == VertexFormat::Quantized)
+	{
+		inputLayoutDesc.NumElements = _countof(QUANTIZED_INPUT_LAYOUT);
+		inputLayoutDesc.pInputElementDescs = QUANTIZED_INPUT_LAYOUT;
+	}
+	else
+	{
+		inputLayoutDesc.NumElements = _countof(FULL_INPUT_LAYOUT);
+		inputLayoutDesc.pInputElementDescs = FULL_INPUT_LAYOUT;
+	}
+
+	return inputLayoutDesc;
+}
+
+void Engine::CreatePipelineStateObject()
+{
+	// input layout
+	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = GetInputLayoutDesc();
 
 	// shaders
 	D3D12_SHADER_BYTECODE vertexShaderBytecode = {};
@@ -431,17 +1086,7 @@ void Engine::CreatePipelineStateObject()
 void Engine::CreateLightPso()
 {
 	// input layout
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
-
-	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
-	inputLayoutDesc.NumElements = _countof(inputLayout);
-	inputLayoutDesc.pInputElementDescs = inputLayout;
+	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = GetInputLayoutDesc();
 
 	// shaders
 	D3D12_SHADER_BYTECODE vertexShaderBytecode = {};
@@ -478,100 +1123,65 @@ void Engine::CreateLightPso()
 	}
 }
 
-void Engine::CreateVertexBuffer()
-{
-	m_actor.LoadObjFromFile(TEXT("Assets\\model.obj"));
-
-	std::vector<Vertex>& verticles = m_actor.GetVertices();
-	int vBufferSize = verticles.size() * sizeof(Vertex);
-
-	// create default heap - memory on GPU. Only GPU has access to it.
-	HRESULT hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&m_vertexBuffer)
-	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
-
-	m_vertexBuffer->SetName(L"Vertex Buffer Resource Type");
-	
-	// create upload heap - cpu can write to it, gpu can read from it
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_vBufferUploadHeap)
-	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
-
-	m_vBufferUploadHeap->SetName(L"Vertex Buffer Upload Resource Heap");
-
-	// store vertex buffer in upload heap
-	D3D12_SUBRESOURCE_DATA vertexData = {};
-	vertexData.pData = reinterpret_cast<BYTE*>(&verticles[0]);
-	vertexData.RowPitch = verticles.size();
-	vertexData.SlicePitch = verticles.size();
-
-	// copy from upload heap to default heap
-	UpdateSubresources(m_commandList.Get(), m_vertexBuffer.Get(), m_vBufferUploadHeap.Get(), 0, 0, 1, &vertexData);
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
-	// index buffer
-	UINT iBufferSize = m_actor.GetIndices().size() * sizeof(DWORD);
-
-	// create deafult heap
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(iBufferSize),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&m_indexBuffer)
-	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
-	m_indexBuffer->SetName(L"Index buffer default heap");
-
-	// create upload heap
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(iBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_iBufferUploadHeap)
-	);
-	if (FAILED(hr))
+void Engine::CreateVertexBuffer()
+{
+	// unit cube, drawn until the loader has uploaded the real mesh
+	std::vector<Vertex> vertices;
+	std::vector<DWORD> indices;
+	for (UINT face = 0; face < 6; ++face)
 	{
-		exit(-1);
+		const UINT axis = face / 2;
+		const float sign = face % 2 == 0 ? 1.0f : -1.0f;
+		const DWORD firstVertex = static_cast<DWORD>(vertices.size());
+
+		for (UINT corner = 0; corner < 4; ++corner)
+		{
+			const float u = corner == 0 || corner == 1 ? -1.0f : 1.0f;
+			const float v = corner == 0 || corner == 3 ? -1.0f : 1.0f;
+
+			Vertex vertex = {};
+			float* position = &vertex.position.x;
+			position[axis] = 0.5f * sign;
+			position[(axis + 1) % 3] = 0.5f * u;
+			position[(axis + 2) % 3] = 0.5f * v;
+			(&vertex.normal.x)[axis] = sign;
+			(&vertex.tangent.x)[(axis + 1) % 3] = 1.0f;
+			vertex.textureCoordinate = XMFLOAT2(0.5f + 0.5f * u, 0.5f - 0.5f * v);
+			vertices.push_back(vertex);
+		}
+
+		// clockwise seen from outside
+		const DWORD quad[] = { 0, 1, 2, 0, 2, 3 };
+		const DWORD flippedQuad[] = { 0, 2, 1, 0, 3, 2 };
+		for (UINT i = 0; i < 6; ++i)
+		{
+			indices.push_back(firstVertex + (sign > 0.0f ? flippedQuad[i] : quad[i]));
+		}
 	}
 
-	// store index data in upload heap
-	D3D12_SUBRESOURCE_DATA indexData = {};
-	indexData.pData = reinterpret_cast<BYTE*>(&m_actor.GetIndices()[0]);
-	indexData.RowPitch = iBufferSize;
-	indexData.SlicePitch = iBufferSize;
+	m_placeholderLod.indexOffset = 0;
+	m_placeholderLod.indexCount = static_cast<UINT32>(indices.size());
+	m_placeholderLod.error = 0.0f;
 
-	UpdateSubresources(m_commandList.Get(), m_indexBuffer.Get(), m_iBufferUploadHeap.Get(), 0, 0, 1, &indexData);
+	const XMFLOAT3 boundsMin(-0.5f, -0.5f, -0.5f);
+	const XMFLOAT3 boundsMax(0.5f, 0.5f, 0.5f);
+	const UINT vertexCount = static_cast<UINT>(vertices.size());
 
-	m_commandList->ResourceBarrier(
-		1,
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(),
-			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
-	);
+	if (m_vertexFormat == VertexFormat::Quantized)
+	{
+		std::vector<QuantizedVertex> quantizedVertices(vertexCount);
+		VertexQuantizer::Encode(QuantizeKernel::Sse, vertices.data(), vertexCount, boundsMin, boundsMax, quantizedVertices.data());
+		m_wvpData.positionOffset = boundsMin;
+		m_wvpData.positionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+		CreateMeshBuffers(m_commandList.Get(), reinterpret_cast<const BYTE*>(quantizedVertices.data()), sizeof(QuantizedVertex),
+			vertexCount, indices.data(), static_cast<UINT>(indices.size()), m_placeholderMesh);
+	}
+	else
+	{
+		CreateMeshBuffers(m_commandList.Get(), reinterpret_cast<const BYTE*>(vertices.data()), sizeof(Vertex),
+			vertexCount, indices.data(), static_cast<UINT>(indices.size()), m_placeholderMesh);
+	}
 
 	// create depth/stencil descriptor heap
 	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
@@ -579,7 +1189,7 @@ void Engine::CreateVertexBuffer()
 	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
 	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 
-	hr = m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsDescriptorHeap));
+	HRESULT hr = m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsDescriptorHeap));
 	if (FAILED(hr))
 	{
 		exit(-1);
@@ -595,26 +1205,25 @@ void Engine::CreateVertexBuffer()
 	depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
 	depthOptimizedClearValue.DepthStencil.Stencil = 0;
 
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_resolutionWidth, m_resolutionHeight, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+	// placed for as long as the engine runs, cleared before every use
+	PlacedAllocation dsPlacement;
+	m_dsBuffer = m_resourceHeaps.CreateResource(
+		CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_resolutionWidth, m_resolutionHeight, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+		D3D12_HEAP_TYPE_DEFAULT,
 		D3D12_RESOURCE_STATE_DEPTH_WRITE,
 		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&m_dsBuffer)
+		dsPlacement
 	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
 
 	m_dsBuffer->SetName(TEXT("DS Buffer"));
+	TrackBuffer(m_dsBuffer.Get());
 
 	m_dsDescriptorHeap->SetName(L"Depth Stencil Resource Heap");
 
 	m_device->CreateDepthStencilView(m_dsBuffer.Get(), &depthStencilDesc, m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
 	// execute command list to upload initial assets
+	EndCommandList(m_commandList.Get());
 	m_commandList->Close();
 
 	ID3D12CommandList* ppCommandLists[] = { m_lightCommandList.Get(), m_commandList.Get() };
@@ -625,16 +1234,141 @@ void Engine::CreateVertexBuffer()
 	{
 		exit(-1);
 	}
+}
+
+void Engine::CreateMeshBuffers(ID3D12GraphicsCommandList* const commandList, const BYTE* const vertexSource, UINT vertexStride,
+	UINT vertexCount, const DWORD* const indices, UINT indexCount, MeshBuffers& mesh)
+{
+	// replaces the buffers of the previous mesh, they go once the frames that drew them have finished
+	RetireResource(mesh.vertexBuffer, mesh.placements[0], mesh.allocations[0]);
+	RetireResource(mesh.indexBuffer, mesh.placements[1], mesh.allocations[1]);
+
+	// a copy queue cannot transition to the vertex and index buffer states, the buffers decay to COMMON after its copies
+	const bool direct = commandList->GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+	UINT vBufferSize = vertexCount * vertexStride;
+
+	// placed in a default heap - memory on GPU. Only GPU has access to it.
+	mesh.vertexBuffer = m_resourceHeaps.CreateResource(CD3DX12_RESOURCE_DESC::Buffer(vBufferSize), D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, mesh.placements[0]);
+	mesh.vertexBuffer->SetName(L"Vertex Buffer Resource Type");
+	SetResourceState(mesh.vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	mesh.allocations[0] = TrackBuffer(mesh.vertexBuffer.Get());
+	
+	// through the upload ring
+	const UploadAllocation vertexUpload = AllocateUpload(commandList, vBufferSize, UPLOAD_RING_BUFFER_ALIGNMENT);
+	memcpy(vertexUpload.data, vertexSource, vBufferSize);
+	commandList->CopyBufferRegion(mesh.vertexBuffer.Get(), 0, vertexUpload.resource, vertexUpload.offset, vBufferSize);
+	if (direct)
+	{
+		TransitionResource(commandList, mesh.vertexBuffer.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	}
+
+	// index buffer
+	UINT iBufferSize = indexCount * sizeof(DWORD);
+
+	mesh.indexBuffer = m_resourceHeaps.CreateResource(CD3DX12_RESOURCE_DESC::Buffer(iBufferSize), D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, mesh.placements[1]);
+	mesh.indexBuffer->SetName(L"Index buffer default heap");
+	SetResourceState(mesh.indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	mesh.allocations[1] = TrackBuffer(mesh.indexBuffer.Get());
+
+	const UploadAllocation indexUpload = AllocateUpload(commandList, iBufferSize, UPLOAD_RING_BUFFER_ALIGNMENT);
+	memcpy(indexUpload.data, indices, iBufferSize);
+	commandList->CopyBufferRegion(mesh.indexBuffer.Get(), 0, indexUpload.resource, indexUpload.offset, iBufferSize);
+
+	if (direct)
+	{
+		TransitionResource(commandList, mesh.indexBuffer.Get(), D3D12_RESOURCE_STATE_INDEX_BUFFER);
+	}
 
 	// create vertex buffer view
-	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-	m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-	m_vertexBufferView.SizeInBytes = vBufferSize;
+	mesh.vertexBufferView.BufferLocation = mesh.vertexBuffer->GetGPUVirtualAddress();
+	mesh.vertexBufferView.StrideInBytes = vertexStride;
+	mesh.vertexBufferView.SizeInBytes = vBufferSize;
 
 	// create index buffer view
-	m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-	m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	m_indexBufferView.SizeInBytes = iBufferSize;
+	mesh.indexBufferView.BufferLocation = mesh.indexBuffer->GetGPUVirtualAddress();
+	mesh.indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	mesh.indexBufferView.SizeInBytes = iBufferSize;
+}
+
+void Engine::LoadMesh()
+{
+	// prefer the cooked mesh, fall back to parsing the OBJ
+	bool cookedMeshLoaded = m_actor.LoadCookedMeshFromFile(TEXT("Assets\\model.mesh"));
+	if (!cookedMeshLoaded)
+	{
+		m_actor.LoadObjFromFile(TEXT("Assets\\model.obj"));
+	}
+	OutputDebugStringA(cookedMeshLoaded ? "Mesh loaded from model.mesh\n" : "Mesh loaded from model.obj\n");
+
+	if (m_meshletCulling)
+	{
+		m_actor.BuildMeshlets();
+	}
+
+	if (m_vertexFormat == VertexFormat::Quantized)
+	{
+		high_resolution_clock::time_point encodeStart = high_resolution_clock::now();
+		m_quantizedVertices.resize(m_actor.GetVertexCount());
+		VertexQuantizer::Encode(QuantizeKernel::Sse, m_actor.GetVertices(), m_actor.GetVertexCount(),
+			m_actor.GetBoundsMin(), m_actor.GetBoundsMax(), m_quantizedVertices.data());
+		float encodeMs = duration<float, std::milli>(high_resolution_clock::now() - encodeStart).count();
+
+		char quantizeMsg[128];
+		sprintf_s(quantizeMsg, "Vertices quantized in %.2f ms: %u -> %u bytes\n", encodeMs,
+			m_actor.GetVertexCount() * static_cast<UINT>(sizeof(Vertex)), m_actor.GetVertexCount() * static_cast<UINT>(sizeof(QuantizedVertex)));
+		OutputDebugStringA(quantizeMsg);
+	}
+}
+
+void Engine::UploadMesh()
+{
+	// on the copy queue, the placeholder cube is drawn until the copies have run
+	const bool quantized = m_vertexFormat == VertexFormat::Quantized;
+	if (quantized)
+	{
+		CreateMeshBuffers(GetCopyCommandList(), reinterpret_cast<const BYTE*>(m_quantizedVertices.data()), sizeof(QuantizedVertex),
+			m_actor.GetVertexCount(), m_actor.GetIndices(), m_actor.GetIndexCount(), m_mesh);
+
+		// already copied to the upload ring
+		m_quantizedVertices.clear();
+		m_quantizedVertices.shrink_to_fit();
+	}
+	else
+	{
+		CreateMeshBuffers(GetCopyCommandList(), reinterpret_cast<const BYTE*>(m_actor.GetVertices()), sizeof(Vertex),
+			m_actor.GetVertexCount(), m_actor.GetIndices(), m_actor.GetIndexCount(), m_mesh);
+	}
+
+	// dequantization constants
+	const XMFLOAT3 boundsMin = m_actor.GetBoundsMin();
+	const XMFLOAT3 boundsMax = m_actor.GetBoundsMax();
+	const XMFLOAT3 boundsSize(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+
+	// before the constant buffer is written, the mesh brings its own dequantization constants
+	PendingCopy firstDraw = { m_copyFenceValue, [this, quantized, boundsMin, boundsSize]()
+	{
+		SetResourceState(m_mesh.vertexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
+		SetResourceState(m_mesh.indexBuffer.Get(), D3D12_RESOURCE_STATE_COMMON);
+		TransitionResource(m_uploadCommandList.Get(), m_mesh.vertexBuffer.Get(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		TransitionResource(m_uploadCommandList.Get(), m_mesh.indexBuffer.Get(), D3D12_RESOURCE_STATE_INDEX_BUFFER);
+
+		if (quantized)
+		{
+			m_wvpData.positionOffset = boundsMin;
+			m_wvpData.positionScale = boundsSize;
+		}
+		m_meshResident = true;
+
+		// the cube is not drawn again, the frames that drew it may still be on the GPU
+		RetireResource(m_placeholderMesh.vertexBuffer, m_placeholderMesh.placements[0], m_placeholderMesh.allocations[0]);
+		RetireResource(m_placeholderMesh.indexBuffer, m_placeholderMesh.placements[1], m_placeholderMesh.allocations[1]);
+		m_placeholderMesh.allocations[0] = RESIDENCY_NONE;
+		m_placeholderMesh.allocations[1] = RESIDENCY_NONE;
+	} };
+	m_pendingCopies.push_back(firstDraw);
 }
 
 void Engine::CreateLightDepthBuffer()
@@ -662,20 +1396,19 @@ void Engine::CreateLightDepthBuffer()
 	depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
 	depthOptimizedClearValue.DepthStencil.Stencil = 0;
 
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_shadowMapRes, m_shadowMapRes, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+	// placed for as long as the engine runs, cleared before every use
+	PlacedAllocation dsPlacement;
+	m_dsLightBuffer = m_resourceHeaps.CreateResource(
+		CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_shadowMapRes, m_shadowMapRes, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+		D3D12_HEAP_TYPE_DEFAULT,
 		D3D12_RESOURCE_STATE_DEPTH_WRITE,
 		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&m_dsLightBuffer)
+		dsPlacement
 	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
 
 	m_dsLightBuffer->SetName(TEXT("Light DS buffer"));
+	SetResourceState(m_dsLightBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	TrackBuffer(m_dsLightBuffer.Get());
 
 	m_device->CreateDepthStencilView(m_dsLightBuffer.Get(), &depthStencilDesc, m_dsLightDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 }
@@ -728,21 +1461,13 @@ void Engine::CreateConstantBuffers()
 	// resource heap
 	for (int i = 0; i < 2; ++i)
 	{
-		// WVP matrix
-
-		hr = m_device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE::D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_cbWvpUploadHeap[i]));
-
-		if (FAILED(hr))
-		{
-			exit(-1);
-		}
+		// WVP matrix, placed for as long as the engine runs
+		PlacedAllocation cbPlacement;
+		m_cbWvpUploadHeap[i] = m_resourceHeaps.CreateResource(CD3DX12_RESOURCE_DESC::Buffer(1024 * 64), D3D12_HEAP_TYPE_UPLOAD,
+			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, cbPlacement);
 
 		m_cbWvpUploadHeap[i]->SetName(L"Constant buffer WVP upload heap");
+		TrackBuffer(m_cbWvpUploadHeap[i].Get());
 
 		// WVP
 		D3D12_CONSTANT_BUFFER_VIEW_DESC cbWvpDesc;
@@ -817,6 +1542,10 @@ void Engine::InitWvp()
 	XMStoreFloat3(&m_wvpData.lightWorldPos, m_light.GetTranslation());
 	XMStoreFloat3(&m_wvpData.lightDirection, m_light.GetDirectionVec());
 	m_wvpData.lightFov = m_light.GetFov();
+
+	// identity until a quantized vertex buffer is created
+	m_wvpData.positionOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	m_wvpData.positionScale = XMFLOAT3(1.0f, 1.0f, 1.0f);
 }
 
 void Engine::UpdateWvp(float deltaSec)
@@ -888,10 +1617,236 @@ void Engine::UpdateWvp(float deltaSec)
 	m_wvpData.lightFov = m_light.GetFov();
 }
 
+float Engine::GetPixelsPerModelUnit(XMVECTOR eyePosition, float fov, float viewportHeight) const
+{
+	// bounding sphere of the actor in world space
+	XMFLOAT3 boundsMin = m_actor.GetBoundsMin();
+	XMFLOAT3 boundsMax = m_actor.GetBoundsMax();
+	XMVECTOR minVec = XMLoadFloat3(&boundsMin);
+	XMVECTOR maxVec = XMLoadFloat3(&boundsMax);
+
+	XMMATRIX worldMat = m_actor.GetWorldMat();
+	float scale = XMVectorGetX(XMVector3Length(worldMat.r[0]));
+	scale = max(scale, XMVectorGetX(XMVector3Length(worldMat.r[1])));
+	scale = max(scale, XMVectorGetX(XMVector3Length(worldMat.r[2])));
+
+	XMVECTOR center = XMVector3TransformCoord((minVec + maxVec) * 0.5f, worldMat);
+	float radius = XMVectorGetX(XMVector3Length(maxVec - minVec)) * 0.5f * scale;
+	float distance = XMVectorGetX(XMVector3Length(center - eyePosition)) - radius;
+
+	if (distance <= 0.0f)
+	{
+		return FLT_MAX;
+	}
+
+	// pixels covered by one world unit at the nearest point of the sphere, and by one unit of the mesh
+	float pixelsPerUnit = viewportHeight * 0.5f / (distance * tanf(fov * 0.5f));
+	return pixelsPerUnit * scale;
+}
+
+UINT Engine::SelectLod(XMVECTOR eyePosition, float fov, float viewportHeight) const
+{
+	float pixelsPerUnit = GetPixelsPerModelUnit(eyePosition, fov, viewportHeight);
+	if (pixelsPerUnit == FLT_MAX)
+	{
+		return 0;
+	}
+
+	UINT lod = 0;
+	for (UINT i = 1; i < m_actor.GetLodCount(); ++i)
+	{
+		if (m_actor.GetLod(i).error * pixelsPerUnit > LOD_PIXEL_ERROR)
+		{
+			break;
+		}
+		lod = i;
+	}
+
+	return lod;
+}
+
+void Engine::UpdateLods()
+{
+	if (!m_meshResident)
+	{
+		return;
+	}
+
+	UINT lod = SelectLod(m_camera.GetPosition(), m_camera.GetFov(), static_cast<float>(m_resolutionHeight));
+	UINT shadowLod = SelectLod(m_light.GetTranslation(), m_light.GetFov(), static_cast<float>(m_shadowMapRes));
+
+	if (lod != m_lod || shadowLod != m_shadowLod)
+	{
+		char lodMsg[128];
+		sprintf_s(lodMsg, "LOD %u (%u triangles), shadow LOD %u (%u triangles)\n",
+			lod, m_actor.GetLod(lod).indexCount / 3, shadowLod, m_actor.GetLod(shadowLod).indexCount / 3);
+		OutputDebugStringA(lodMsg);
+	}
+
+	m_lod = lod;
+	m_shadowLod = shadowLod;
+}
+
+void Engine::StreamTextures()
+{
+	if (!m_textureStreaming)
+	{
+		return;
+	}
+
+	// every texture is on the actor, until its mesh arrives only the tails are needed
+	m_mipStreamer.BeginFrame();
+	if (m_meshResident)
+	{
+		float pixelsPerUnit = GetPixelsPerModelUnit(m_camera.GetPosition(), m_camera.GetFov(), static_cast<float>(m_resolutionHeight));
+		for (UINT i = 0; i < m_streamedTextures.size(); ++i)
+		{
+			const Texture* texture = m_streamedTextures[i];
+			if (texture->IsCopyPending())
+			{
+				continue;	// its tail is still on the copy queue
+			}
+			float texelsPerUnit = max(texture->GetWidth(), texture->GetHeight()) * m_actor.GetUvDensity();
+			m_mipStreamer.Request(i, MipStreamer::GetRequiredMip(texelsPerUnit, pixelsPerUnit));
+		}
+	}
+
+	m_mipStreamer.Update(m_mipStreamChanges);
+	for (const MipStreamChange& change : m_mipStreamChanges)
+	{
+		Texture* texture = m_streamedTextures[change.texture];
+		texture->StreamMips(change.residentMip, m_uploadCommandList.Get());
+		m_residency.SetResidentMip(texture->GetResidencyIndex(), change.residentMip);
+		m_uploadsRecorded = true;
+	}
+
+	if (!m_mipStreamChanges.empty())
+	{
+		const MipStreamStats& stats = m_mipStreamer.GetStats();
+		char streamMsg[160];
+		sprintf_s(streamMsg, "texture streaming: %zu changed, %.2f MB resident, %.2f MB requested, %.2f MB budget\n",
+			m_mipStreamChanges.size(), stats.residentBytes / (1024.0 * 1024.0), stats.requestedBytes / (1024.0 * 1024.0),
+			m_mipStreamer.GetBudget() / (1024.0 * 1024.0));
+		OutputDebugStringA(streamMsg);
+	}
+}
+
+void Engine::ManageResidency()
+{
+	// the textures the scene pass samples, the placeholders until something real is bound
+	m_residency.BeginFrame();
+	bool restored = false;
+	for (UINT slot = 0; slot < _countof(m_boundTextures); ++slot)
+	{
+		Texture* texture = m_boundTextures[slot] ? m_boundTextures[slot].Get() : &m_placeholderTextures[slot];
+		const UINT index = texture->GetResidencyIndex();
+
+		// evicted while nothing used it, loaded again on the render thread
+		if (m_residency.GetTexture(index).residentMip == m_residency.GetTexture(index).mipCount)
+		{
+			texture->Restore(m_uploadCommandList.Get());
+			m_residency.SetResidentMip(index, texture->GetFirstResidentMip());
+			restored = true;
+		}
+		m_residency.Touch(index);
+	}
+
+	m_residency.Update(m_residencyChanges);
+	for (const ResidencyChange& change : m_residencyChanges)
+	{
+		Texture* texture = m_residentTextures[change.texture];
+		if (change.residentMip < m_residency.GetTexture(change.texture).mipCount)
+		{
+			texture->StreamMips(change.residentMip, m_uploadCommandList.Get());
+		}
+		else
+		{
+			texture->Evict();
+		}
+	}
+
+	// the new resources have new SRVs, rewritten in place, the next scene pass table copies them
+	if (restored || !m_residencyChanges.empty())
+	{
+		m_uploadsRecorded = true;
+	}
+
+	// the streamed textures get what the rest leaves of the budget
+	if (m_textureStreaming)
+	{
+		const UINT64 unmanagedBudget = m_residency.GetUnmanagedBudget();
+		m_mipStreamer.SetBudget(m_textureBudget < unmanagedBudget ? m_textureBudget : unmanagedBudget);
+	}
+
+	if (!m_residencyChanges.empty())
+	{
+		const ResidencyStats stats = m_residency.GetStats();
+		char residencyMsg[192];
+		sprintf_s(residencyMsg, "residency: %zu textures reduced, %.2f MB freed, %.2f MB textures and %.2f MB buffers, %.2f MB budget\n",
+			m_residencyChanges.size(), stats.evictedBytes / (1024.0 * 1024.0), stats.textureBytes / (1024.0 * 1024.0),
+			stats.bufferBytes / (1024.0 * 1024.0), m_residency.GetBudget() / (1024.0 * 1024.0));
+		OutputDebugStringA(residencyMsg);
+	}
+}
+
+void Engine::CullMeshlets()
+{
+	m_visibleRanges.clear();
+	if (!m_meshResident || !m_meshletCulling || m_lod != 0 || m_actor.GetMeshlets().empty())
+	{
+		return;
+	}
+
+	// meshlet bounds are in object space, so bring the camera there instead
+	XMMATRIX worldMat = m_actor.GetWorldMat();
+	XMFLOAT3 eyePosition;
+	XMStoreFloat3(&eyePosition, XMVector3TransformCoord(m_camera.GetPosition(), XMMatrixInverse(nullptr, worldMat)));
+
+	MeshletCuller culler(worldMat * m_camera.GetViewProjectionMat(), eyePosition);
+	MeshletCullStats stats;
+	culler.Cull(m_actor.GetMeshlets(), m_visibleRanges, stats);
+
+	if (stats.visibleTriangles != m_meshletStats.visibleTriangles)
+	{
+		char cullMsg[160];
+		sprintf_s(cullMsg, "meshlets: %u frustum culled, %u cone culled of %u, %u/%u triangles in %zu draws\n",
+			stats.frustumCulled, stats.coneCulled, stats.meshlets, stats.visibleTriangles, stats.triangles, m_visibleRanges.size());
+		OutputDebugStringA(cullMsg);
+	}
+	m_meshletStats = stats;
+}
+
+void Engine::SetMeshletCulling(bool meshletCulling)
+{
+	// takes effect in Init, where the meshlets are built
+	m_meshletCulling = meshletCulling;
+}
+
+void Engine::SetTextureStreaming(UINT64 budgetBytes)
+{
+	m_textureStreaming = true;
+	m_textureBudget = budgetBytes;
+	m_mipStreamer.SetBudget(budgetBytes);
+}
+
+void Engine::SetMemoryBudget(UINT64 budgetBytes)
+{
+	m_residency.SetBudget(budgetBytes);
+}
+
+void Engine::SetVertexFormat(VertexFormat vertexFormat)
+{
+	// takes effect in Init, where shaders, pipelines and the vertex buffer are created
+	m_vertexFormat = vertexFormat;
+}
+
 void Engine::Init(HWND hwnd)
 {
 	m_hwnd = hwnd;
 
+	// the loads only need the CPU, overlap them with the device setup
+	LoadAssetsAsync();
+
 	// debug
 #if defined(_DEBUG)
 	UINT dxgiFactoryFlags = 0;
@@ -922,6 +1877,7 @@ void Engine::Init(HWND hwnd)
 	{
 		exit(-1);
 	}
+	m_resourceHeaps.Init(m_device.Get());
 
 	// create command queue
 	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
@@ -998,6 +1954,7 @@ void Engine::Init(HWND hwnd)
 			}
 
 			m_device->CreateRenderTargetView(m_renderTarget[i].Get(), nullptr, rtvHandle);
+			SetResourceState(m_renderTarget[i].Get(), D3D12_RESOURCE_STATE_PRESENT);
 			rtvHandle.Offset(1, m_rtvDescriptorSize);
 		}
 	}
@@ -1032,6 +1989,21 @@ void Engine::Init(HWND hwnd)
 
 	m_lightCommandList->Close();
 
+	// create upload command allocator and list, recorded while assets arrive
+	hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_uploadCommandAllocator));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_uploadCommandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_uploadCommandList));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_uploadCommandList->Close();
+
 	// create fence
 	hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
 	if (FAILED(hr))
@@ -1046,12 +2018,16 @@ void Engine::Init(HWND hwnd)
 		exit(-1);
 	}
 
+	CreateCopyQueue();
+
 	CreateRootSignature();
 	CreateLightRootSignature();
 	LoadShaders();
 	CreatePipelineStateObject();
 	CreateLightPso();
 	CreateLightDepthBuffer();
+	CreateUploadRing(L"Upload Ring", m_uploadRingBuffer, m_uploadRingData);
+	CreateUploadRing(L"Copy Upload Ring", m_copyRingBuffer, m_copyRingData);
 	LoadTextures();
 	InitWvp();
 	CreateConstantBuffers();
@@ -1062,6 +2038,10 @@ void Engine::Init(HWND hwnd)
 	WaitForPreviousFrame();
 
 	m_prevTime = high_resolution_clock::now();
+
+	char initMsg[128];
+	sprintf_s(initMsg, "Init finished %.2f ms after startup\n", duration<float, std::milli>(m_prevTime - m_startTime).count());
+	OutputDebugStringA(initMsg);
 }
 
 void Engine::Input(int mouseX, int mouseY, bool rightMouseBtnIsDown)
@@ -1082,8 +2062,23 @@ void Engine::Update()
 	float deltaSec = duration<float>(now - m_prevTime).count();
 	m_prevTime = now;
 
+	// streaming and the memory budget can record copies in any frame
+	ResetUploadCommandList();
+	ReleaseRetiredResources();
+
+	// what the copy queue has finished is bound now, what arrived since goes to it right away
+	CompleteCopies();
+	UploadLoadedAssets();
+	SubmitCopies();
+
 	// WVP matrix
 	UpdateWvp(deltaSec);
+	UpdateLods();
+	StreamTextures();
+	ManageResidency();
+	CullMeshlets();
+
+	CloseUploadCommandList();
 
 	memcpy(m_cbWvpGpuAddress[m_frameIndex], &m_wvpData, sizeof(Wvp));
 
@@ -1104,7 +2099,25 @@ void Engine::Render()
 	RenderLightDepth();
 	RenderScene();
 
-	// execute command list
+	// the first frame that uses uploads of the copy queue waits for them, they have run by then so the wait costs nothing
+	if (m_copyWaitPending)
+	{
+		HRESULT hr = m_commandQueue->Wait(m_copyFence.Get(), m_copyWaitValue);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		m_copyWaitPending = false;
+	}
+
+	// execute command list, uploads first so both passes see the new assets
+	if (m_uploadsRecorded)
+	{
+		ID3D12CommandList* ppUploadCommandLists[]{ m_uploadCommandList.Get() };
+		m_commandQueue->ExecuteCommandLists(_countof(ppUploadCommandLists), ppUploadCommandLists);
+		m_uploadsRecorded = false;
+	}
+
 	ID3D12CommandList* ppCommandLists[]{ m_lightCommandList.Get(), m_commandList.Get() };
 	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
@@ -1115,6 +2128,17 @@ void Engine::Render()
 		exit(-1);
 	}
 
+	if (!m_firstFramePresented)
+	{
+		m_firstFramePresented = true;
+
+		char firstFrameMsg[128];
+		sprintf_s(firstFrameMsg, "Time to first frame: %.2f ms (%s)\n",
+			duration<float, std::milli>(high_resolution_clock::now() - m_startTime).count(),
+			m_assetsResident ? "all assets resident" : "placeholders");
+		OutputDebugStringA(firstFrameMsg);
+	}
+
 	WaitForPreviousFrame();
 }
 
@@ -1131,15 +2155,17 @@ void Engine::RenderScene()
 	{
 		exit(-1);
 	}
+	m_sceneStates.Begin();
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
 	// record commands
 	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
 
-	// indicate that the back buffer will be used as a render target
-	m_commandList->ResourceBarrier(1,
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	// the back buffer is rendered to, the light depth map written by the light pass is sampled
+	TransitionResource(m_commandList.Get(), m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+	TransitionResource(m_commandList.Get(), m_dsLightBuffer.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	FlushBarriers(m_commandList.Get());
 
 	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
 	const float clearColor[] = { 0.5f, 0.5f, 0.5f, 1.0f };
@@ -1153,20 +2179,32 @@ void Engine::RenderScene()
 	ID3D12DescriptorHeap* descriptorHeaps[] = { m_textureDescriptorHeap.Get(), m_lightSamplerDescriptorHeap.Get() };
 	m_commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 	m_commandList->SetGraphicsRootConstantBufferView(0, m_cbWvpUploadHeap[m_frameIndex]->GetGPUVirtualAddress());
-	m_commandList->SetGraphicsRootDescriptorTable(1, m_textureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	m_commandList->SetGraphicsRootDescriptorTable(1, BuildSceneTable());
 	m_commandList->SetGraphicsRootDescriptorTable(2, m_lightSamplerDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 
 	m_commandList->RSSetViewports(1, &m_viewport);
 	m_commandList->RSSetScissorRects(1, &m_scissorRect);
 	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	m_commandList->IASetIndexBuffer(&m_indexBufferView);
-	m_commandList->DrawIndexedInstanced(m_actor.GetIndices().size(), 1, 0, 0, 0);
+	const MeshBuffers& mesh = m_meshResident ? m_mesh : m_placeholderMesh;
+	m_commandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
+	m_commandList->IASetIndexBuffer(&mesh.indexBufferView);
+	if (m_meshResident && m_meshletCulling && m_lod == 0 && !m_actor.GetMeshlets().empty())
+	{
+		for (const IndexRange& range : m_visibleRanges)
+		{
+			m_commandList->DrawIndexedInstanced(range.indexCount, 1, range.indexOffset, 0, 0);
+		}
+	}
+	else
+	{
+		const MeshLod& lod = m_meshResident ? m_actor.GetLod(m_lod) : m_placeholderLod;
+		m_commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.indexOffset, 0, 0);
+	}
 
 	// indicate that the back buffer will be used to present
-	m_commandList->ResourceBarrier(1,
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	TransitionResource(m_commandList.Get(), m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT);
 
+	EndCommandList(m_commandList.Get());
 	hr = m_commandList->Close();
 	if (FAILED(hr))
 	{
@@ -1187,6 +2225,11 @@ void Engine::RenderLightDepth()
 	{
 		exit(-1);
 	}
+	m_lightStates.Begin();
+
+	// the scene pass of the previous frame sampled it
+	TransitionResource(m_lightCommandList.Get(), m_dsLightBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	FlushBarriers(m_lightCommandList.Get());
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE lightDsvHandle(m_dsLightDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
@@ -1203,11 +2246,14 @@ void Engine::RenderLightDepth()
 	m_lightCommandList->RSSetViewports(1, &m_lightViewport);
 	m_lightCommandList->RSSetScissorRects(1, &m_lightDepthScissorRect);
 	m_lightCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_lightCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	m_lightCommandList->IASetIndexBuffer(&m_indexBufferView);
-	m_lightCommandList->DrawIndexedInstanced(m_actor.GetIndices().size(), 1, 0, 0, 0);
+	const MeshBuffers& mesh = m_meshResident ? m_mesh : m_placeholderMesh;
+	m_lightCommandList->IASetVertexBuffers(0, 1, &mesh.vertexBufferView);
+	m_lightCommandList->IASetIndexBuffer(&mesh.indexBufferView);
+	const MeshLod& lod = m_meshResident ? m_actor.GetLod(m_shadowLod) : m_placeholderLod;
+	m_lightCommandList->DrawIndexedInstanced(lod.indexCount, 1, lod.indexOffset, 0, 0);
 
 
+	EndCommandList(m_lightCommandList.Get());
 	hr = m_lightCommandList->Close();
 	if (FAILED(hr))
 	{
@@ -1217,12 +2263,22 @@ void Engine::RenderLightDepth()
 
 void Engine::Destroy()
 {
+	m_assetLoader.WaitForLoads();
+	WaitForCopies();
 	CloseHandle(m_fenceEvent);
 	m_actor.ReleaseObj();
 	m_actor.ReleaseAlbedo();
 	m_actor.ReleaseNormal();
-	m_actor.ReleaseOclussion();
-	m_actor.ReleaseRoughness();
+	m_actor.ReleaseOrm();
+	m_streamedTextures.clear();
+	for (TextureHandle& texture : m_boundTextures)
+	{
+		texture = TextureHandle();
+	}
+
+	// the last frame waited for its fence, nothing retired is in use any more
+	m_releaseQueue.ReleaseAll();
+	m_copyReleaseQueue.ReleaseAll();
 }
 
 ComPtr<ID3D12Device> Engine::GetDevice() const
@@ -1235,3 +2291,96 @@ ComPtr<ID3D12GraphicsCommandList> Engine::GetCommandList() const
 	return m_commandList;
 }
 
+TextureCache& Engine::GetTextureCache()
+{
+	return m_textureCache;
+}
+
+ResourceHeaps& Engine::GetResourceHeaps()
+{
+	return m_resourceHeaps;
+}
+
+CommandListStates& Engine::GetStates(ID3D12GraphicsCommandList* const commandList)
+{
+	if (commandList == m_commandList.Get())
+	{
+		return m_sceneStates;
+	}
+	if (commandList == m_lightCommandList.Get())
+	{
+		return m_lightStates;
+	}
+	if (commandList != m_uploadCommandList.Get())
+	{
+		// the copy list transitions nothing, the first use on the direct queue does
+		exit(-1);
+	}
+	return m_uploadStates;
+}
+
+void Engine::RecordBarriers(ID3D12GraphicsCommandList* const commandList)
+{
+	if (m_transitions.empty())
+	{
+		return;
+	}
+
+	// all of them in one call
+	m_barriers.clear();
+	for (const StateTransition& transition : m_transitions)
+	{
+		m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(transition.resource),
+			static_cast<D3D12_RESOURCE_STATES>(transition.before), static_cast<D3D12_RESOURCE_STATES>(transition.after)));
+	}
+	commandList->ResourceBarrier(static_cast<UINT>(m_barriers.size()), m_barriers.data());
+}
+
+void Engine::EndCommandList(ID3D12GraphicsCommandList* const commandList)
+{
+	GetStates(commandList).End(m_transitions);
+	RecordBarriers(commandList);
+}
+
+void Engine::TransitionResource(ID3D12GraphicsCommandList* const commandList, ID3D12Resource* const resource, D3D12_RESOURCE_STATES state)
+{
+	GetStates(commandList).Transition(resource, state);
+}
+
+void Engine::FlushBarriers(ID3D12GraphicsCommandList* const commandList)
+{
+	GetStates(commandList).Flush(m_transitions);
+	RecordBarriers(commandList);
+}
+
+void Engine::SetResourceState(ID3D12Resource* const resource, D3D12_RESOURCE_STATES state)
+{
+	m_resourceStates.SetState(resource, state);
+}
+
+void Engine::ForgetResourceState(ID3D12Resource* const resource)
+{
+	m_resourceStates.Forget(resource);
+}
+
+void Engine::ForgetTexture(Texture* const texture)
+{
+	const UINT index = texture->GetResidencyIndex();
+	if (index == RESIDENCY_NONE)
+	{
+		return;
+	}
+
+	m_residency.RemoveTexture(index);
+	m_residentTextures[index] = nullptr;
+	texture->SetResidencyIndex(RESIDENCY_NONE);
+
+	// its heap space goes back once the GPU has finished the frames that sampled it
+	texture->Evict();
+}
+
+void Engine::RetireResource(ComPtr<ID3D12Resource>& resource, PlacedAllocation& placement, UINT allocation)
+{
+	Retire(m_releaseQueue, m_fenceValue, resource, placement, allocation);
+}
+
@@ -11,9 +11,20 @@
 #include <chrono>
 #include <wincodec.h>
 #include <memory>
+#include <functional>
 #include "Camera.h"
 #include "Actor.h"
 #include "Light.h"
+#include "QuantizedVertex.h"
+#include "MeshletCuller.h"
+#include "AssetLoader.h"
+#include "MipStreamer.h"
+#include "ResidencyManager.h"
+#include "UploadRing.h"
+#include "ResourceHeaps.h"
+#include "DescriptorAllocator.h"
+#include "ResourceStateTracker.h"
+#include "DeferredReleaseQueue.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -36,8 +47,53 @@ struct Wvp
 	BYTE padding2[4];
 	XMFLOAT3 lightDirection;
 	float lightFov;
+	XMFLOAT3 positionOffset;	// quantized positions: offset + position * scale
+	BYTE padding3[4];
+	XMFLOAT3 positionScale;
 };
 
+// the vertex and index buffer of a mesh with their views
+struct MeshBuffers
+{
+	ComPtr<ID3D12Resource> vertexBuffer;
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+	ComPtr<ID3D12Resource> indexBuffer;
+	D3D12_INDEX_BUFFER_VIEW indexBufferView;
+	UINT allocations[2];	// of the vertex and index buffer in the residency manager
+	PlacedAllocation placements[2];
+};
+
+// a copy queue allocator, it can be reset once the copy fence reaches fenceValue
+struct CopyAllocator
+{
+	ComPtr<ID3D12CommandAllocator> allocator;
+	UINT64 fenceValue;
+};
+
+// what the direct queue does with an upload of the copy queue the first frame after the copy fence reaches fenceValue
+struct PendingCopy
+{
+	UINT64 fenceValue;
+	std::function<void()> firstUse;
+};
+
+// where the data of one upload is written and copied from
+struct UploadAllocation
+{
+	ID3D12Resource* resource;	// the upload ring, or an upload heap of its own when the ring is full
+	UINT64 offset;	// of the data in resource
+	BYTE* data;	// mapped, at offset
+};
+
+// every upload is suballocated from one of two of them, one per queue, 3 BGRA8 1024x1024 textures with their mips and the mesh fit
+const UINT64 UPLOAD_RING_SIZE = 32 * 1024 * 1024;
+
+// the shader visible heap only holds the tables built every frame, the SRVs they are copied from are in CPU side heaps
+const UINT SRV_HEAP_FRAME_DESCRIPTORS = 1024;
+const UINT SRV_STAGING_DESCRIPTORS = 64;
+// the scene pass table: albedo, normal, ORM and the light depth map
+const UINT SCENE_TABLE_SIZE = 4;
+
 extern const XMVECTOR X_UNIT_VEC;
 extern const XMVECTOR Y_UNIT_VEC;
 extern const XMVECTOR Z_UNIT_VEC;
@@ -61,6 +117,8 @@ private:
 	ComPtr<ID3D12GraphicsCommandList> m_commandList;
 	ComPtr<ID3D12CommandAllocator> m_lightCommandAllocator;
 	ComPtr<ID3D12GraphicsCommandList> m_lightCommandList;
+	ComPtr<ID3D12CommandAllocator> m_uploadCommandAllocator;
+	ComPtr<ID3D12GraphicsCommandList> m_uploadCommandList;
 	ComPtr<ID3D12PipelineState> m_pipelineState;
 	ComPtr<ID3D12PipelineState> m_lightPipelineState;
 	ComPtr<ID3D12Resource> m_renderTarget[2];
@@ -69,18 +127,22 @@ private:
 	ComPtr<IDXGISwapChain3> m_swapChain;
 	ComPtr<ID3D12Fence> m_fence;
 	ComPtr<ID3D12Device> m_device;
+	ResourceHeaps m_resourceHeaps;	// every buffer, texture and depth buffer below is placed in them
+
+	// resource states, each direct list records its transitions as a batch before the copy or draw that needs them
+	ResourceStateTracker m_resourceStates;
+	CommandListStates m_sceneStates;	// m_commandList, which also records the uploads of Init
+	CommandListStates m_lightStates;
+	CommandListStates m_uploadStates;
+	std::vector<StateTransition> m_transitions;
+	std::vector<D3D12_RESOURCE_BARRIER> m_barriers;
 
 	// drawing triangles
 	ComPtr<ID3D12RootSignature> m_rootSignature;
 	ComPtr<ID3D12RootSignature> m_lightRootSignature;
 
-	ComPtr<ID3D12Resource> m_vertexBuffer;
-	ComPtr<ID3D12Resource> m_vBufferUploadHeap;
-	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-
-	ComPtr<ID3D12Resource> m_indexBuffer;
-	ComPtr<ID3D12Resource> m_iBufferUploadHeap;
-	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+	MeshBuffers m_mesh;	// drawn once m_meshResident
+	MeshBuffers m_placeholderMesh;
 
 	ComPtr<ID3DBlob> m_vertexShader;
 	ComPtr<ID3DBlob> m_pixelShader;
@@ -106,14 +168,77 @@ private:
 	Wvp m_wvpData;
 	UINT8* m_cbWvpGpuAddress[2];
 
+	VertexFormat m_vertexFormat;
+	UINT m_lod;	// level of detail drawn by the scene pass
+	UINT m_shadowLod;	// and by the light depth pass
+	bool m_meshletCulling;	// draw only the visible meshlets of LOD 0
+	std::vector<IndexRange> m_visibleRanges;
+	MeshletCullStats m_meshletStats;
+
+	// asynchronous loading, placeholders are drawn until the assets are resident
+	bool m_meshResident;
+	MeshLod m_placeholderLod;
+	std::vector<QuantizedVertex> m_quantizedVertices;	// encoded by the loader, freed after upload
+	std::vector<Texture> m_placeholderTextures;
+	bool m_uploadsRecorded;	// m_uploadCommandList has to run before this frame
+	bool m_copyWaitPending;	// this frame is the first to use uploads of the copy queue, the direct queue waits for m_copyWaitValue
+	UINT64 m_copyWaitValue;
+	bool m_assetsResident;
+	bool m_firstFramePresented;
+	high_resolution_clock::time_point m_startTime;
+
+	// memory of every texture and buffer, declared before the texture cache, which lets go of textures through ForgetTexture
+	ResidencyManager m_residency;
+	std::vector<Texture*> m_residentTextures;	// by residency index, null where a texture was forgotten
+	std::vector<ResidencyChange> m_residencyChanges;
+
+	// replaced and oversized upload resources, released once the fence of the queue that last used them passes
+	DeferredReleaseQueue m_releaseQueue;	// on the frame fence
+	DeferredReleaseQueue m_copyReleaseQueue;	// on the copy fence
+
+	// asset uploads run on a copy queue of their own while the direct queue keeps rendering
+	ComPtr<ID3D12CommandQueue> m_copyQueue;
+	ComPtr<ID3D12GraphicsCommandList> m_copyCommandList;	// open while m_copyListOpen
+	std::vector<CopyAllocator> m_copyAllocators;
+	UINT m_copyAllocator;	// the one m_copyCommandList records into
+	bool m_copyListOpen;
+	ComPtr<ID3D12Fence> m_copyFence;
+	UINT64 m_copyFenceValue;	// signaled after the copies recorded now
+	std::vector<PendingCopy> m_pendingCopies;	// in submission order
+
+	// upload memory, persistently mapped, a region is reused once the queue that copied from it is past it
+	ComPtr<ID3D12Resource> m_uploadRingBuffer;
+	BYTE* m_uploadRingData;
+	UploadRing m_uploadRing;	// copies on the direct queue
+	ComPtr<ID3D12Resource> m_copyRingBuffer;
+	BYTE* m_copyRingData;
+	UploadRing m_copyRing;	// copies on the copy queue
+
+	// one resource and SRV per unique texture, declared before the actor that holds handles to them
+	TextureCache m_textureCache;
+	TextureHandle m_boundTextures[3];	// the textures whose SRVs are copied into the scene pass table
+
+	// mip streaming, the streamed textures in the order the streamer knows them
+	bool m_textureStreaming;
+	UINT64 m_textureBudget;	// the streamer gets less when the memory budget needs it
+	MipStreamer m_mipStreamer;
+	std::vector<Texture*> m_streamedTextures;
+	std::vector<MipStreamChange> m_mipStreamChanges;
+
 	Actor m_actor;
 	Light m_light;
 	Camera m_camera;
+	AssetLoader m_assetLoader;	// after the actor, its jobs have to finish before the actor goes away
 
 	// textures
 	ComPtr<ID3D12Resource> m_textureDefaultHeap;
 	ComPtr<ID3D12Resource> m_textureUploadHeap;
-	ComPtr<ID3D12DescriptorHeap> m_textureDescriptorHeap;
+	ComPtr<ID3D12DescriptorHeap> m_textureDescriptorHeap;	// shader visible
+	std::unique_ptr<DescriptorAllocator> m_textureDescriptors;	// a table per draw, reused once its frame has finished
+	ComPtr<ID3D12DescriptorHeap> m_srvStagingHeap;	// the SRVs of what the texture cache does not hold
+	std::unique_ptr<DescriptorAllocator> m_stagingDescriptors;
+	DescriptorHandle m_placeholderSrvs[3];
+	DescriptorHandle m_lightDepthSrv;
 
 	int m_frameIndex;	// render target index
 	UINT m_rtvDescriptorSize;	// Render Target View descriptor heap size
@@ -126,14 +251,47 @@ private:
 	void CreateRootSignature();
 	void CreateLightRootSignature();
 	void LoadShaders();
+	D3D12_INPUT_LAYOUT_DESC GetInputLayoutDesc() const;
 	void CreateLightDepthBuffer();
 	void LoadTextures();
 	void CreatePipelineStateObject();
 	void CreateLightPso();
 	void CreateVertexBuffer();
+	void CreateMeshBuffers(ID3D12GraphicsCommandList* const commandList, const BYTE* const vertexSource, UINT vertexStride,
+		UINT vertexCount, const DWORD* const indices, UINT indexCount, MeshBuffers& mesh);
+	D3D12_GPU_DESCRIPTOR_HANDLE BuildSceneTable();
+	void UploadTexture(const TextureHandle& texture, const wchar_t* const textureName, UINT slot);
+	void BindTexture(const TextureHandle& texture, UINT slot);
+	void LoadAssetsAsync();
+	void LoadMesh();
+	void UploadMesh();
+	CommandListStates& GetStates(ID3D12GraphicsCommandList* const commandList);
+	void RecordBarriers(ID3D12GraphicsCommandList* const commandList);
+	void EndCommandList(ID3D12GraphicsCommandList* const commandList);
+	void ResetUploadCommandList();
+	void CloseUploadCommandList();
+	void CreateCopyQueue();
+	ID3D12GraphicsCommandList* GetCopyCommandList();
+	void SubmitCopies();
+	void CompleteCopies();
+	void WaitForCopies();
+	void UploadLoadedAssets();
+	UINT TrackBuffer(ID3D12Resource* const buffer);
+	void TrackTexture(Texture* const texture, bool managed);
+	void Retire(DeferredReleaseQueue& queue, UINT64 fenceValue, ComPtr<ID3D12Resource>& resource, PlacedAllocation& placement,
+		UINT allocation);
+	void CreateUploadRing(const wchar_t* const name, ComPtr<ID3D12Resource>& buffer, BYTE*& data);
+	void ReleaseRetiredResources();
+	void ManageResidency();
+	void LogStartupReport();
 	void FillOutViewportAndScissorRect();
 	void InitWvp();
 	void UpdateWvp(float deltaSec);
+	float GetPixelsPerModelUnit(XMVECTOR eyePosition, float fov, float viewportHeight) const;
+	UINT SelectLod(XMVECTOR eyePosition, float fov, float viewportHeight) const;
+	void UpdateLods();
+	void StreamTextures();
+	void CullMeshlets();
 	void CreateConstantBuffers();
 	void CreateSamplers();
 
@@ -144,6 +302,10 @@ public:
 	Engine(UINT resolutionWidth, UINT resolutionHeight);
 	~Engine();
 
+	void SetVertexFormat(VertexFormat vertexFormat);
+	void SetMeshletCulling(bool meshletCulling);
+	void SetTextureStreaming(UINT64 budgetBytes);
+	void SetMemoryBudget(UINT64 budgetBytes);
 	void Init(HWND hwnd);
 	void Input(int mouseX, int mouseY, bool rightMouseBtnPressed);
 	void Update();
@@ -153,4 +315,20 @@ public:
 
 	ComPtr<ID3D12Device> GetDevice() const;
 	ComPtr<ID3D12GraphicsCommandList> GetCommandList() const;
+	TextureCache& GetTextureCache();
+	ResourceHeaps& GetResourceHeaps();
+	// size bytes of upload memory at alignment in the ring of the queue commandList runs on,
+	// the copies out of it have to be recorded on commandList this frame
+	UploadAllocation AllocateUpload(ID3D12GraphicsCommandList* const commandList, UINT64 size, UINT64 alignment);
+	void ForgetTexture(Texture* const texture);	// the texture cache is about to free it
+	// the frame being recorded is the last to use the resource, it goes with its placement and residency
+	// allocation once the GPU has finished that frame, resource and placement are left empty
+	void RetireResource(ComPtr<ID3D12Resource>& resource, PlacedAllocation& placement, UINT allocation = RESIDENCY_NONE);
+
+	// direct lists only, the transition is recorded with the others at the next FlushBarriers or when the list is closed
+	void TransitionResource(ID3D12GraphicsCommandList* const commandList, ID3D12Resource* const resource, D3D12_RESOURCE_STATES state);
+	void FlushBarriers(ID3D12GraphicsCommandList* const commandList);
+	// the state a resource was created in, or the one a copy queue left it in
+	void SetResourceState(ID3D12Resource* const resource, D3D12_RESOURCE_STATES state);
+	void ForgetResourceState(ID3D12Resource* const resource);	// before the resource is released
 };
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "HeapAllocator.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// value is not 0
+	uint32_t GetHighestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	uint32_t GetLowestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+}
+
+HeapAllocator::HeapAllocator(uint64_t capacity, uint64_t granularity)
+	: m_capacity(capacity), m_granularity(granularity), m_firstLevelBitmap(0), m_usedBytes(0), m_allocationCount(0),
+	m_freeBlockCount(0)
+{
+	for (uint32_t firstLevel = 0; firstLevel < FIRST_LEVEL_COUNT; ++firstLevel)
+	{
+		m_secondLevelBitmaps[firstLevel] = 0;
+		for (uint32_t secondLevel = 0; secondLevel < SECOND_LEVEL_COUNT; ++secondLevel)
+		{
+			m_freeLists[firstLevel][secondLevel] = HEAP_ALLOCATOR_NONE;
+		}
+	}
+
+	InsertFree(NewBlock(0, capacity));
+}
+
+void HeapAllocator::GetSizeClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	// sizes below 16 get a class each, above that every power of two is split in 16
+	if (size < SECOND_LEVEL_COUNT)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t highestBit = GetHighestBit(size);
+	firstLevel = highestBit - SECOND_LEVEL_BITS + 1;
+	secondLevel = static_cast<uint32_t>(size >> (highestBit - SECOND_LEVEL_BITS)) - SECOND_LEVEL_COUNT;
+}
+
+uint32_t HeapAllocator::NewBlock(uint64_t offset, uint64_t size)
+{
+	Block block = { offset, size, HEAP_ALLOCATOR_NONE, HEAP_ALLOCATOR_NONE, HEAP_ALLOCATOR_NONE, HEAP_ALLOCATOR_NONE, false };
+	if (m_unusedBlocks.empty())
+	{
+		m_blocks.push_back(block);
+		return static_cast<uint32_t>(m_blocks.size() - 1);
+	}
+
+	uint32_t index = m_unusedBlocks.back();
+	m_unusedBlocks.pop_back();
+	m_blocks[index] = block;
+	return index;
+}
+
+void HeapAllocator::InsertFree(uint32_t block)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	GetSizeClass(m_blocks[block].size, firstLevel, secondLevel);
+
+	const uint32_t head = m_freeLists[firstLevel][secondLevel];
+	m_blocks[block].free = true;
+	m_blocks[block].previousFree = HEAP_ALLOCATOR_NONE;
+	m_blocks[block].nextFree = head;
+	if (head != HEAP_ALLOCATOR_NONE)
+	{
+		m_blocks[head].previousFree = block;
+	}
+
+	m_freeLists[firstLevel][secondLevel] = block;
+	m_firstLevelBitmap |= 1ull << firstLevel;
+	m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	++m_freeBlockCount;
+}
+
+void HeapAllocator::RemoveFree(uint32_t block)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	GetSizeClass(m_blocks[block].size, firstLevel, secondLevel);
+
+	const uint32_t previousFree = m_blocks[block].previousFree;
+	const uint32_t nextFree = m_blocks[block].nextFree;
+	if (previousFree != HEAP_ALLOCATOR_NONE)
+	{
+		m_blocks[previousFree].nextFree = nextFree;
+	}
+	else
+	{
+		m_freeLists[firstLevel][secondLevel] = nextFree;
+	}
+	if (nextFree != HEAP_ALLOCATOR_NONE)
+	{
+		m_blocks[nextFree].previousFree = previousFree;
+	}
+
+	if (m_freeLists[firstLevel][secondLevel] == HEAP_ALLOCATOR_NONE)
+	{
+		m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (m_secondLevelBitmaps[firstLevel] == 0)
+		{
+			m_firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+
+	m_blocks[block].free = false;
+	--m_freeBlockCount;
+}
+
+uint32_t HeapAllocator::FindFree(uint64_t size) const
+{
+	// rounded up to the next size class, so every block of the class found is large enough
+	uint64_t searchSize = size;
+	if (size >= SECOND_LEVEL_COUNT)
+	{
+		searchSize += (1ull << (GetHighestBit(size) - SECOND_LEVEL_BITS)) - 1;
+	}
+
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	GetSizeClass(searchSize, firstLevel, secondLevel);
+	if (firstLevel >= FIRST_LEVEL_COUNT)
+	{
+		return HEAP_ALLOCATOR_NONE;
+	}
+
+	uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		const uint64_t firstLevelMap = firstLevel + 1 < FIRST_LEVEL_COUNT ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+		{
+			// the class of the size itself can still hold a block that fits
+			GetSizeClass(size, firstLevel, secondLevel);
+			for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != HEAP_ALLOCATOR_NONE; block = m_blocks[block].nextFree)
+			{
+				if (m_blocks[block].size >= size)
+				{
+					return block;
+				}
+			}
+			return HEAP_ALLOCATOR_NONE;
+		}
+
+		firstLevel = GetLowestBit(firstLevelMap);
+		secondLevelMap = m_secondLevelBitmaps[firstLevel];
+	}
+
+	return m_freeLists[firstLevel][GetLowestBit(secondLevelMap)];
+}
+
+void HeapAllocator::Split(uint32_t block, uint64_t size)
+{
+	const uint32_t rest = NewBlock(m_blocks[block].offset + size, m_blocks[block].size - size);
+	m_blocks[rest].previous = block;
+	m_blocks[rest].next = m_blocks[block].next;
+	if (m_blocks[rest].next != HEAP_ALLOCATOR_NONE)
+	{
+		m_blocks[m_blocks[rest].next].previous = rest;
+	}
+
+	m_blocks[block].size = size;
+	m_blocks[block].next = rest;
+	InsertFree(rest);
+}
+
+void HeapAllocator::MergeNext(uint32_t block)
+{
+	const uint32_t next = m_blocks[block].next;
+	m_blocks[block].size += m_blocks[next].size;
+	m_blocks[block].next = m_blocks[next].next;
+	if (m_blocks[block].next != HEAP_ALLOCATOR_NONE)
+	{
+		m_blocks[m_blocks[block].next].previous = block;
+	}
+	m_unusedBlocks.push_back(next);
+}
+
+HeapAllocation HeapAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	HeapAllocation allocation = { 0, 0, HEAP_ALLOCATOR_NONE };
+	size = size > 0 ? AlignUp(size, m_granularity) : m_granularity;
+	alignment = alignment > m_granularity ? alignment : m_granularity;
+
+	// room for the worst case padding in front, blocks start on the granularity
+	const uint64_t searchSize = size + alignment - m_granularity;
+	if (searchSize > m_capacity)
+	{
+		return allocation;
+	}
+
+	// a block that happens to be aligned is a better fit than one with room for the padding
+	uint32_t block = FindFree(size);
+	if (block == HEAP_ALLOCATOR_NONE || AlignUp(m_blocks[block].offset, alignment) + size > m_blocks[block].offset + m_blocks[block].size)
+	{
+		block = FindFree(searchSize);
+	}
+	if (block == HEAP_ALLOCATOR_NONE)
+	{
+		return allocation;
+	}
+	RemoveFree(block);
+
+	// the padding stays free as a block of its own
+	const uint64_t alignedOffset = AlignUp(m_blocks[block].offset, alignment);
+	if (alignedOffset > m_blocks[block].offset)
+	{
+		Split(block, alignedOffset - m_blocks[block].offset);
+		const uint32_t padding = block;
+		block = m_blocks[block].next;
+		RemoveFree(block);
+		InsertFree(padding);
+	}
+
+	if (m_blocks[block].size > size)
+	{
+		Split(block, size);
+	}
+
+	m_usedBytes += size;
+	++m_allocationCount;
+
+	allocation.offset = m_blocks[block].offset;
+	allocation.size = size;
+	allocation.block = block;
+	return allocation;
+}
+
+void HeapAllocator::Free(uint32_t block)
+{
+	m_usedBytes -= m_blocks[block].size;
+	--m_allocationCount;
+
+	// a free block never has a free neighbour
+	const uint32_t next = m_blocks[block].next;
+	if (next != HEAP_ALLOCATOR_NONE && m_blocks[next].free)
+	{
+		RemoveFree(next);
+		MergeNext(block);
+	}
+
+	const uint32_t previous = m_blocks[block].previous;
+	if (previous != HEAP_ALLOCATOR_NONE && m_blocks[previous].free)
+	{
+		RemoveFree(previous);
+		MergeNext(previous);
+		block = previous;
+	}
+
+	InsertFree(block);
+}
+
+uint64_t HeapAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+bool HeapAllocator::IsEmpty() const
+{
+	return m_allocationCount == 0;
+}
+
+HeapAllocatorStats HeapAllocator::GetStats() const
+{
+	HeapAllocatorStats stats = {};
+	stats.capacity = m_capacity;
+	stats.usedBytes = m_usedBytes;
+	stats.freeBytes = m_capacity - m_usedBytes;
+	stats.allocationCount = m_allocationCount;
+	stats.freeBlockCount = m_freeBlockCount;
+
+	// the largest free block is in the highest size class that has any
+	if (m_firstLevelBitmap != 0)
+	{
+		const uint32_t firstLevel = GetHighestBit(m_firstLevelBitmap);
+		const uint32_t secondLevel = GetHighestBit(m_secondLevelBitmaps[firstLevel]);
+		for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != HEAP_ALLOCATOR_NONE; block = m_blocks[block].nextFree)
+		{
+			stats.largestFreeBlock = m_blocks[block].size > stats.largestFreeBlock ? m_blocks[block].size : stats.largestFreeBlock;
+		}
+	}
+
+	stats.fragmentation = stats.freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeBlock) / stats.freeBytes : 0.0f;
+	return stats;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// a block index that is not one, see HeapAllocation
+const uint32_t HEAP_ALLOCATOR_NONE = ~0u;
+
+struct HeapAllocation
+{
+	uint64_t offset;
+	uint64_t size;	// rounded up to the granularity
+	uint32_t block;	// pass to Free, HEAP_ALLOCATOR_NONE when nothing was allocated
+};
+
+struct HeapAllocatorStats
+{
+	uint64_t capacity;
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBlock;
+	uint32_t allocationCount;
+	uint32_t freeBlockCount;
+	float fragmentation;	// 1 - largest free block / free bytes, 0 when the free space is in one piece
+};
+
+// Hands out regions of a heap of fixed capacity with a two level segregated
+// fit (TLSF) scheme: free blocks are kept in lists by size class, a power of
+// two split into 16 linear steps, and two levels of bitmaps find a list with a
+// block large enough in constant time. Allocations are split off a free block,
+// freed blocks are merged with their free neighbours. Offsets only, the
+// caller places resources at them.
+class HeapAllocator
+{
+private:
+	static const uint32_t SECOND_LEVEL_BITS = 4;
+	static const uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+	static const uint32_t FIRST_LEVEL_COUNT = 64;
+
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t previous;	// physical neighbours, HEAP_ALLOCATOR_NONE at the ends of the heap
+		uint32_t next;
+		uint32_t previousFree;	// in the list of its size class while free
+		uint32_t nextFree;
+		bool free;
+	};
+
+	uint64_t m_capacity;
+	uint64_t m_granularity;
+	std::vector<Block> m_blocks;
+	std::vector<uint32_t> m_unusedBlocks;	// slots of merged blocks, reused
+	uint64_t m_firstLevelBitmap;
+	uint32_t m_secondLevelBitmaps[FIRST_LEVEL_COUNT];
+	uint32_t m_freeLists[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+	uint64_t m_usedBytes;
+	uint32_t m_allocationCount;
+	uint32_t m_freeBlockCount;
+
+	static void GetSizeClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	uint32_t NewBlock(uint64_t offset, uint64_t size);
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+	uint32_t FindFree(uint64_t size) const;
+	// splits the end of a block off into a new free block
+	void Split(uint32_t block, uint64_t size);
+	// the next block goes into block
+	void MergeNext(uint32_t block);
+
+public:
+	// capacity is a multiple of granularity, every allocation is rounded up to it and aligned to it at least
+	HeapAllocator(uint64_t capacity, uint64_t granularity);
+
+	// alignment is a power of two, returns an allocation with block HEAP_ALLOCATOR_NONE when nothing large enough is free
+	HeapAllocation Allocate(uint64_t size, uint64_t alignment);
+	void Free(uint32_t block);
+
+	uint64_t GetCapacity() const;
+	bool IsEmpty() const;
+	HeapAllocatorStats GetStats() const;
+};
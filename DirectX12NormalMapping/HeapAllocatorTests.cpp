@@ -0,0 +1,241 @@
+#include "HeapAllocatorTests.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <vector>
+#include "HeapAllocator.h"
+
+using std::mt19937;
+using std::vector;
+using std::chrono::duration;
+using std::chrono::high_resolution_clock;
+
+namespace
+{
+	// D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT and D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, without the Direct3D headers
+	const uint64_t SMALL_ALIGNMENT = 4 * 1024;
+	const uint64_t DEFAULT_ALIGNMENT = 64 * 1024;
+	const uint64_t MB = 1024 * 1024;
+
+	struct Live
+	{
+		HeapAllocation allocation;
+		uint64_t alignment;
+	};
+
+	// what a heap of textures and buffers sees: mostly small resources, some mip chains of up to 8 MB
+	uint64_t GetResourceSize(mt19937& random, uint64_t& alignment)
+	{
+		const uint32_t kind = random() % 8;
+		if (kind < 4)
+		{
+			alignment = SMALL_ALIGNMENT;
+			return SMALL_ALIGNMENT * (1 + random() % 16);
+		}
+
+		alignment = DEFAULT_ALIGNMENT;
+		return kind < 7 ? DEFAULT_ALIGNMENT * (1 + random() % 16) : 1 * MB + random() % (7 * MB);
+	}
+
+	// aligned, inside the heap, no two overlapping, and the stats add up
+	bool CheckLive(const HeapAllocator& allocator, vector<Live> live)
+	{
+		bool passed = true;
+		uint64_t usedBytes = 0;
+		std::sort(live.begin(), live.end(), [](const Live& a, const Live& b) { return a.allocation.offset < b.allocation.offset; });
+		for (size_t i = 0; i < live.size(); ++i)
+		{
+			const HeapAllocation& allocation = live[i].allocation;
+			passed = passed && allocation.offset % live[i].alignment == 0 && allocation.offset + allocation.size <= allocator.GetCapacity();
+			passed = passed && (i == 0 || live[i - 1].allocation.offset + live[i - 1].allocation.size <= allocation.offset);
+			usedBytes += allocation.size;
+		}
+
+		const HeapAllocatorStats stats = allocator.GetStats();
+		passed = passed && stats.usedBytes == usedBytes && stats.allocationCount == live.size() &&
+			stats.freeBytes == stats.capacity - usedBytes && stats.largestFreeBlock <= stats.freeBytes;
+		return passed;
+	}
+
+	bool RunRandom(const wchar_t* name, uint64_t capacity, uint64_t granularity, uint32_t operations, bool resourceSizes)
+	{
+		HeapAllocator allocator(capacity, granularity);
+		mt19937 random(5678);
+		vector<Live> live;
+		bool passed = true;
+		uint32_t failures = 0;
+
+		for (uint32_t i = 0; i < operations; ++i)
+		{
+			// the heap fills up to about half before frees catch up with allocations
+			if (!live.empty() && random() % 100 < 45 + 10 * live.size() / (live.size() + 16))
+			{
+				const size_t index = random() % live.size();
+				allocator.Free(live[index].allocation.block);
+				live[index] = live.back();
+				live.pop_back();
+			}
+			else
+			{
+				Live allocation = {};
+				uint64_t size;
+				if (resourceSizes)
+				{
+					size = GetResourceSize(random, allocation.alignment);
+				}
+				else
+				{
+					size = 1 + random() % (capacity / 16);
+					allocation.alignment = 1ull << (random() % 8);
+				}
+
+				allocation.allocation = allocator.Allocate(size, allocation.alignment);
+				if (allocation.allocation.block == HEAP_ALLOCATOR_NONE)
+				{
+					++failures;
+					continue;
+				}
+				passed = passed && allocation.allocation.size >= size;
+				live.push_back(allocation);
+			}
+
+			if (i % 64 == 0)
+			{
+				passed = passed && CheckLive(allocator, live);
+			}
+		}
+		passed = passed && CheckLive(allocator, live);
+		const HeapAllocatorStats busy = allocator.GetStats();
+
+		// everything merges back into one block
+		for (const Live& allocation : live)
+		{
+			allocator.Free(allocation.allocation.block);
+		}
+		const HeapAllocatorStats empty = allocator.GetStats();
+		passed = passed && allocator.IsEmpty() && empty.freeBlockCount == 1 && empty.largestFreeBlock == capacity &&
+			empty.fragmentation == 0.0f;
+
+		wprintf(L"  %-36s %s  %u failed, %u live, %u free blocks, %.1f%% fragmented\n", name, passed ? L"ok" : L"FAILED",
+			failures, busy.allocationCount, busy.freeBlockCount, busy.fragmentation * 100.0f);
+		return passed;
+	}
+
+	// a freed block is found again, padding for alignment stays usable
+	bool TestReuseAndAlignment()
+	{
+		HeapAllocator allocator(MB, SMALL_ALIGNMENT);
+		const HeapAllocation a = allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT);
+		const HeapAllocation b = allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT);
+		const HeapAllocation c = allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT);
+		bool passed = a.offset == 0 && b.offset == DEFAULT_ALIGNMENT && c.offset == 2 * DEFAULT_ALIGNMENT;
+
+		allocator.Free(b.block);
+		const HeapAllocation reused = allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT);
+		passed = passed && reused.offset == b.offset;
+
+		// a small one after c, then one at 64 KB that leaves the 60 KB in between free for the next small ones
+		const HeapAllocation small = allocator.Allocate(100, SMALL_ALIGNMENT);
+		const HeapAllocation aligned = allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT);
+		const HeapAllocation padding = allocator.Allocate(SMALL_ALIGNMENT, SMALL_ALIGNMENT);
+		passed = passed && small.offset == 3 * DEFAULT_ALIGNMENT && small.size == SMALL_ALIGNMENT &&
+			aligned.offset == 4 * DEFAULT_ALIGNMENT && padding.offset == small.offset + SMALL_ALIGNMENT;
+		passed = passed && allocator.GetStats().freeBlockCount == 2;
+
+		wprintf(L"  %-36s %s\n", L"reuse and alignment padding", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// free space in pieces too small for a request is reported as fragmentation
+	bool TestFragmentation()
+	{
+		HeapAllocator allocator(MB, DEFAULT_ALIGNMENT);
+		vector<HeapAllocation> allocations;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			allocations.push_back(allocator.Allocate(DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT));
+		}
+		bool passed = allocator.Allocate(1, 1).block == HEAP_ALLOCATOR_NONE;
+
+		for (uint32_t i = 0; i < 16; i += 2)
+		{
+			allocator.Free(allocations[i].block);
+		}
+		HeapAllocatorStats stats = allocator.GetStats();
+		passed = passed && stats.freeBytes == MB / 2 && stats.largestFreeBlock == DEFAULT_ALIGNMENT &&
+			stats.freeBlockCount == 8 && stats.fragmentation > 0.85f;
+		passed = passed && allocator.Allocate(2 * DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT).block == HEAP_ALLOCATOR_NONE;
+
+		// freeing the ones in between merges their neighbours
+		allocator.Free(allocations[1].block);
+		allocator.Free(allocations[3].block);
+		stats = allocator.GetStats();
+		passed = passed && stats.largestFreeBlock == 5 * DEFAULT_ALIGNMENT && stats.freeBlockCount == 6;
+		passed = passed && allocator.Allocate(5 * DEFAULT_ALIGNMENT, DEFAULT_ALIGNMENT).offset == 0;
+
+		wprintf(L"  %-36s %s\n", L"fragmentation and merging", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+}
+
+int RunHeapAllocatorTests()
+{
+	int failures = 0;
+
+	failures += RunRandom(L"random sizes and alignments, 1 MB", MB, 1, 20000, false) ? 0 : 1;
+	failures += RunRandom(L"resource sizes, 64 MB", 64 * MB, SMALL_ALIGNMENT, 20000, true) ? 0 : 1;
+	failures += RunRandom(L"resource sizes, 16 MB", 16 * MB, SMALL_ALIGNMENT, 20000, true) ? 0 : 1;
+	failures += TestReuseAndAlignment() ? 0 : 1;
+	failures += TestFragmentation() ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
+
+int RunHeapAllocatorBenchmark(uint32_t iterations)
+{
+	// a working set of resource shaped allocations, each iteration frees one at random and allocates another
+	const uint64_t capacity = 256 * MB;
+	const uint32_t workingSet = 128;
+	HeapAllocator allocator(capacity, SMALL_ALIGNMENT);
+	mt19937 random(9012);
+
+	vector<uint64_t> sizes(iterations);
+	vector<uint64_t> alignments(iterations);
+	vector<uint32_t> frees(iterations);
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		sizes[i] = GetResourceSize(random, alignments[i]);
+		frees[i] = random() % workingSet;
+	}
+
+	vector<uint32_t> live;
+	for (uint32_t i = 0; i < workingSet; ++i)
+	{
+		uint64_t alignment;
+		const uint64_t size = GetResourceSize(random, alignment);
+		live.push_back(allocator.Allocate(size, alignment).block);
+	}
+
+	uint32_t failures = 0;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		if (live[frees[i]] != HEAP_ALLOCATOR_NONE)
+		{
+			allocator.Free(live[frees[i]]);
+		}
+		live[frees[i]] = allocator.Allocate(sizes[i], alignments[i]).block;
+		failures += live[frees[i]] == HEAP_ALLOCATOR_NONE ? 1 : 0;
+	}
+	const double ms = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+
+	const HeapAllocatorStats stats = allocator.GetStats();
+	wprintf(L"%u frees and allocations in %.2f ms, %.1f ns each, %.2f M per second\n", iterations, ms,
+		iterations > 0 ? ms * 1000000.0 / iterations : 0.0, ms > 0.0 ? iterations / ms / 1000.0 : 0.0);
+	wprintf(L"%u failed, %u live, %.2f MB used of %.2f MB in %u free blocks, %.1f%% fragmented\n", failures, stats.allocationCount,
+		stats.usedBytes / static_cast<double>(MB), capacity / static_cast<double>(MB), stats.freeBlockCount, stats.fragmentation * 100.0f);
+	return 0;
+}
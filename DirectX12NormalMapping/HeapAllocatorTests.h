@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// HeapAllocator through random and resource shaped workloads, checks that
+// allocations are aligned, never overlap and that freeing everything merges
+// the heap back into one block, prints every case and returns 0 when all of
+// them pass
+int RunHeapAllocatorTests();
+
+// allocations and frees per second of the resource shaped workload, and the
+// fragmentation it leaves
+int RunHeapAllocatorBenchmark(uint32_t iterations);
@@ -0,0 +1,141 @@
+#include "Ktx2File.h"
+#include <cstring>
+
+namespace
+{
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t MAX_DIMENSION = 16384;	// D3D12 texture size limit
+
+	struct Ktx2Header
+	{
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+	static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index layout");
+
+	// VkFormat values of the supported formats
+	uint32_t GetDxgiFormat(uint32_t vkFormat)
+	{
+		switch (vkFormat)
+		{
+		case 44:	// VK_FORMAT_B8G8R8A8_UNORM
+			return DDS_FORMAT_B8G8R8A8_UNORM;
+		case 50:	// VK_FORMAT_B8G8R8A8_SRGB
+			return DDS_FORMAT_B8G8R8A8_UNORM_SRGB;
+		case 131:	// VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133:	// VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+			return DDS_FORMAT_BC1_UNORM;
+		case 132:	// VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		case 134:	// VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+			return DDS_FORMAT_BC1_UNORM_SRGB;
+		case 139:	// VK_FORMAT_BC4_UNORM_BLOCK
+			return DDS_FORMAT_BC4_UNORM;
+		case 141:	// VK_FORMAT_BC5_UNORM_BLOCK
+			return DDS_FORMAT_BC5_UNORM;
+		}
+		return 0;
+	}
+}
+
+bool Ktx2File::Parse(const uint8_t* data, uint64_t size, TextureFileInfo& info)
+{
+	if (data == nullptr || size < sizeof(Ktx2Header))
+	{
+		return false;
+	}
+
+	Ktx2Header header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+	{
+		return false;
+	}
+
+	// 2D, no array, no cube map, no supercompression (which also means no global data)
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 ||
+		header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0)
+	{
+		return false;
+	}
+
+	if (header.pixelWidth > MAX_DIMENSION || header.pixelHeight > MAX_DIMENSION)
+	{
+		return false;
+	}
+
+	const uint32_t format = GetDxgiFormat(header.vkFormat);
+	if (format == 0 || header.typeSize != 1)
+	{
+		return false;
+	}
+
+	// as for DDS, a block compressed top level has to be whole blocks
+	if (DdsFile::IsBlockCompressed(format) && (header.pixelWidth % 4 != 0 || header.pixelHeight % 4 != 0))
+	{
+		return false;
+	}
+
+	// 0 asks the loader to generate the mips, only the base level is stored then
+	const uint32_t mipCount = header.levelCount == 0 ? 1 : header.levelCount;
+	if (mipCount > DdsFile::GetMaxMipCount(header.pixelWidth, header.pixelHeight))
+	{
+		return false;
+	}
+
+	if (size - sizeof(Ktx2Header) < static_cast<uint64_t>(mipCount) * sizeof(Ktx2Level))
+	{
+		return false;
+	}
+
+	uint32_t mipWidth = header.pixelWidth;
+	uint32_t mipHeight = header.pixelHeight;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		Ktx2Level level;
+		memcpy(&level, data + sizeof(Ktx2Header) + mip * sizeof(Ktx2Level), sizeof(level));
+
+		// written without overflow, byteOffset comes from the file
+		const uint64_t expectedSize = DdsFile::GetMipChainSize(format, mipWidth, mipHeight, 1);
+		if (level.byteLength != expectedSize || level.uncompressedByteLength != expectedSize ||
+			level.byteOffset > size || level.byteLength > size - level.byteOffset)
+		{
+			return false;
+		}
+
+		info.mipOffsets[mip] = level.byteOffset;
+		info.mipSizes[mip] = level.byteLength;
+		mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+		mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+	}
+
+	info.width = header.pixelWidth;
+	info.height = header.pixelHeight;
+	info.mipCount = mipCount;
+	info.format = format;
+
+	return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include "DdsFile.h"
+
+// .ktx2 files holding a single 2D texture without supercompression, in the
+// Vulkan equivalents of the DDS_FORMAT_* formats. Like DdsFile::Parse it
+// only reads memory and checks the level index against the buffer, the
+// format is translated to its DXGI value and the levels may be anywhere in
+// the file.
+class Ktx2File
+{
+public:
+	static bool Parse(const uint8_t* data, uint64_t size, TextureFileInfo& info);
+};
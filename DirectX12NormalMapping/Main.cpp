@@ -1,7 +1,10 @@
 #include "resource.h"
 #include "stdafx.h"
 #include "Engine.h"
+#include "Tools.h"
 #include <comdef.h>
+#include <shellapi.h>
+#include <cwchar>
 #include <WinUser.h>
 #include <windowsx.h>
 
@@ -13,6 +16,36 @@ LRESULT CALLBACK wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow)
 {
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv != nullptr && argc > 1 && IsToolCommand(argv[1]))
+	{
+		int result = RunTool(argc, argv);
+		LocalFree(argv);
+		return result;
+	}
+
+	for (int i = 1; argv != nullptr && i < argc; ++i)
+	{
+		if (wcscmp(argv[i], L"-full-vertices") == 0)
+		{
+			g_engine.SetVertexFormat(VertexFormat::Full);
+		}
+		else if (wcscmp(argv[i], L"-meshlets") == 0)
+		{
+			g_engine.SetMeshletCulling(true);
+		}
+		else if (wcscmp(argv[i], L"-texture-budget") == 0 && i + 1 < argc)
+		{
+			g_engine.SetTextureStreaming(static_cast<UINT64>(_wtoi(argv[++i])) * 1024 * 1024);
+		}
+		else if (wcscmp(argv[i], L"-memory-budget") == 0 && i + 1 < argc)
+		{
+			g_engine.SetMemoryBudget(static_cast<UINT64>(_wtoi(argv[++i])) * 1024 * 1024);
+		}
+	}
+	LocalFree(argv);
+
 	const WCHAR * WND_CLASS_NAME = TEXT("MyWndClassName");
 
 	WNDCLASSEX wndClass = {};
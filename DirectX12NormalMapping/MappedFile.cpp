@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+	: m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_view(nullptr),
+	m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const wchar_t* const fileName)
+{
+	Close();
+
+	m_file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	m_size = static_cast<UINT64>(fileSize.QuadPart);
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_view = reinterpret_cast<const BYTE*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_view == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_view != nullptr)
+	{
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+	}
+
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+	m_size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return m_view != nullptr;
+}
+
+const BYTE* MappedFile::GetData() const
+{
+	return m_view;
+}
+
+UINT64 MappedFile::GetSize() const
+{
+	return m_size;
+}
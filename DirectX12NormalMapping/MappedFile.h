@@ -0,0 +1,28 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const BYTE* m_view;
+	UINT64 m_size;
+
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const wchar_t* const fileName);
+	void Close();
+	bool IsOpen() const;
+
+	const BYTE* GetData() const;
+	UINT64 GetSize() const;
+};
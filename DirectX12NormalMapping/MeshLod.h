@@ -0,0 +1,14 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+
+// one level of detail, a range of the shared index buffer drawn with the
+// shared vertex buffer
+struct MeshLod
+{
+	UINT32 indexOffset;
+	UINT32 indexCount;
+	float error;	// simplification error in object space units, 0 for the full mesh
+};
@@ -0,0 +1,198 @@
+#include "MeshOptimizer.h"
+#include <DirectXMesh.h>
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+	// a cluster ends once its own ACMR gets this close to the whole mesh,
+	// so reordering clusters costs at most a few percent of cache efficiency
+	const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+	const size_t MIN_CLUSTER_FACES = 32;
+
+	struct TriangleCluster
+	{
+		size_t firstFace;
+		size_t faceCount;
+		float sortKey;
+	};
+
+	void ReorderClustersForOverdraw(const vector<Vertex>& vertices, const vector<DWORD>& input,
+		float meshAcmr, vector<DWORD>& output)
+	{
+		const size_t faceCount = input.size() / 3;
+		const UINT cacheSize = MeshOptimizer::VERTEX_CACHE_SIZE;
+
+		// FIFO cache simulation, a vertex is cached while fewer than cacheSize
+		// vertices were inserted after it
+		vector<UINT> insertionTime(vertices.size(), 0);
+		UINT time = cacheSize + 1;
+
+		vector<TriangleCluster> clusters;
+		TriangleCluster cluster = { 0, 0, 0.0f };
+		size_t clusterMisses = 0;
+		const float thresholdAcmr = meshAcmr * OVERDRAW_ACMR_THRESHOLD;
+
+		for (size_t face = 0; face < faceCount; ++face)
+		{
+			size_t misses = 0;
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const DWORD vertex = input[face * 3 + corner];
+				if (time - insertionTime[vertex] > cacheSize)
+				{
+					insertionTime[vertex] = time++;
+					++misses;
+				}
+			}
+
+			// hard boundary: the face shares nothing with the cache,
+			// soft boundary: the cluster is already as cache friendly as the mesh
+			const bool hardBoundary = misses == 3;
+			const bool softBoundary = cluster.faceCount >= MIN_CLUSTER_FACES &&
+				static_cast<float>(clusterMisses) / cluster.faceCount <= thresholdAcmr;
+
+			if (cluster.faceCount > 0 && (hardBoundary || softBoundary))
+			{
+				clusters.push_back(cluster);
+				cluster.firstFace = face;
+				cluster.faceCount = 0;
+				clusterMisses = 0;
+			}
+
+			++cluster.faceCount;
+			clusterMisses += misses;
+		}
+
+		if (cluster.faceCount > 0)
+		{
+			clusters.push_back(cluster);
+		}
+
+		// view independent overdraw metric: clusters far out along their
+		// normal are likely to occlude the rest, so they are drawn first
+		XMVECTOR meshCentroid = XMVectorZero();
+		for (DWORD index : input)
+		{
+			meshCentroid += XMLoadFloat3(&vertices[index].position);
+		}
+		meshCentroid /= static_cast<float>(input.size() > 0 ? input.size() : 1);
+
+		for (TriangleCluster& c : clusters)
+		{
+			XMVECTOR centroid = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+
+			for (size_t i = c.firstFace * 3; i < (c.firstFace + c.faceCount) * 3; ++i)
+			{
+				centroid += XMLoadFloat3(&vertices[input[i]].position);
+				normal += XMLoadFloat3(&vertices[input[i]].normal);
+			}
+
+			centroid /= static_cast<float>(c.faceCount * 3);
+			normal = XMVector3Normalize(normal);
+			c.sortKey = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, normal));
+		}
+
+		stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b)
+		{
+			return a.sortKey > b.sortKey;
+		});
+
+		output.clear();
+		output.reserve(input.size());
+		for (const TriangleCluster& c : clusters)
+		{
+			output.insert(output.end(), input.begin() + c.firstFace * 3, input.begin() + (c.firstFace + c.faceCount) * 3);
+		}
+	}
+}
+
+bool MeshOptimizer::Optimize(vector<Vertex>& vertices, vector<DWORD>& indices, MeshOptimizerStats& stats)
+{
+	// DWORD and uint32_t have the same representation, DirectXMesh only takes the latter
+	static_assert(sizeof(DWORD) == sizeof(uint32_t), "32-bit indices expected");
+
+	const size_t faceCount = indices.size() / 3;
+	const size_t vertexCount = vertices.size();
+
+	ComputeCacheStats(indices, vertexCount, stats.acmrBefore, stats.atvrBefore);
+	stats.acmrAfter = stats.acmrBefore;
+	stats.atvrAfter = stats.atvrBefore;
+
+	if (faceCount == 0)
+	{
+		return true;
+	}
+
+	// vertex cache
+	vector<DWORD> cacheOrdered = indices;
+	if (!OptimizeFaces(cacheOrdered))
+	{
+		return false;
+	}
+
+	// overdraw
+	float cacheOrderedAcmr, cacheOrderedAtvr;
+	ComputeCacheStats(cacheOrdered, vertexCount, cacheOrderedAcmr, cacheOrderedAtvr);
+
+	vector<DWORD> overdrawOrdered;
+	ReorderClustersForOverdraw(vertices, cacheOrdered, cacheOrderedAcmr, overdrawOrdered);
+
+	// vertex fetch
+	vector<uint32_t> vertexRemap(vertexCount);
+	size_t trailingUnused = 0;
+	HRESULT hr = OptimizeVertices(reinterpret_cast<const uint32_t*>(overdrawOrdered.data()), faceCount, vertexCount,
+		vertexRemap.data(), &trailingUnused);
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	hr = FinalizeIB(reinterpret_cast<const uint32_t*>(overdrawOrdered.data()), faceCount, vertexRemap.data(), vertexCount,
+		reinterpret_cast<uint32_t*>(indices.data()));
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	vector<Vertex> remappedVertices(vertexCount);
+	hr = FinalizeVB(vertices.data(), sizeof(Vertex), vertexCount, nullptr, 0, vertexRemap.data(), remappedVertices.data());
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	// vertices no triangle references end up at the back
+	remappedVertices.resize(vertexCount - trailingUnused);
+	vertices.swap(remappedVertices);
+
+	ComputeCacheStats(indices, vertices.size(), stats.acmrAfter, stats.atvrAfter);
+	return true;
+}
+
+bool MeshOptimizer::OptimizeFaces(vector<DWORD>& indices)
+{
+	const size_t faceCount = indices.size() / 3;
+	if (faceCount == 0)
+	{
+		return true;
+	}
+
+	vector<uint32_t> faceRemap(faceCount);
+	HRESULT hr = OptimizeFacesLRU(reinterpret_cast<const uint32_t*>(indices.data()), faceCount, faceRemap.data());
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	hr = ReorderIB(reinterpret_cast<uint32_t*>(indices.data()), faceCount, faceRemap.data());
+	return SUCCEEDED(hr);
+}
+
+void MeshOptimizer::ComputeCacheStats(const vector<DWORD>& indices, size_t vertexCount, float& acmr, float& atvr)
+{
+	ComputeVertexCacheMissRate(reinterpret_cast<const uint32_t*>(indices.data()), indices.size() / 3, vertexCount,
+		VERTEX_CACHE_SIZE, acmr, atvr);
+}
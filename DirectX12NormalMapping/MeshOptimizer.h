@@ -0,0 +1,29 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <vector>
+#include "Vertex.h"
+
+struct MeshOptimizerStats
+{
+	float acmrBefore;	// average cache miss ratio, transformed vertices per triangle
+	float atvrBefore;	// average transformed vertex ratio, transformed vertices per vertex
+	float acmrAfter;
+	float atvrAfter;
+};
+
+// Reorders the mesh for the post-transform vertex cache (LRU face ordering),
+// then reorders clusters of triangles for less overdraw without giving back
+// the cache gains, then renumbers the vertices in order of first use.
+class MeshOptimizer
+{
+public:
+	static const UINT VERTEX_CACHE_SIZE = 16;
+
+	static bool Optimize(std::vector<Vertex>& vertices, std::vector<DWORD>& indices, MeshOptimizerStats& stats);
+	// face reordering only, for index buffers sharing an already optimized vertex buffer
+	static bool OptimizeFaces(std::vector<DWORD>& indices);
+	static void ComputeCacheStats(const std::vector<DWORD>& indices, size_t vertexCount, float& acmr, float& atvr);
+};
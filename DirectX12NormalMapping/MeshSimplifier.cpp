@@ -0,0 +1,389 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+	const DWORD NO_VERTEX = 0xffffffff;
+	const float MIN_LOD_REDUCTION = 0.9f;	// a level has to drop at least 10% of the previous one
+
+	// symmetric 4x4 matrix of the summed squared plane distances, weighted by
+	// triangle area so that the error can be normalized back to a distance
+	struct Quadric
+	{
+		double a2, b2, c2, d2;
+		double ab, ac, ad, bc, bd, cd;
+		double weight;
+	};
+
+	void AddPlane(Quadric& q, double a, double b, double c, double d, double weight)
+	{
+		q.a2 += weight * a * a;
+		q.b2 += weight * b * b;
+		q.c2 += weight * c * c;
+		q.d2 += weight * d * d;
+		q.ab += weight * a * b;
+		q.ac += weight * a * c;
+		q.ad += weight * a * d;
+		q.bc += weight * b * c;
+		q.bd += weight * b * d;
+		q.cd += weight * c * d;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a2 += other.a2;
+		q.b2 += other.b2;
+		q.c2 += other.c2;
+		q.d2 += other.d2;
+		q.ab += other.ab;
+		q.ac += other.ac;
+		q.ad += other.ad;
+		q.bc += other.bc;
+		q.bd += other.bd;
+		q.cd += other.cd;
+		q.weight += other.weight;
+	}
+
+	// root mean square distance of the point to the planes in the quadric
+	double Evaluate(const Quadric& q, const XMFLOAT3& point)
+	{
+		const double x = point.x;
+		const double y = point.y;
+		const double z = point.z;
+		const double sum = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z + q.d2 +
+			2.0 * (q.ab * x * y + q.ac * x * z + q.ad * x + q.bc * y * z + q.bd * y + q.cd * z);
+
+		return q.weight > 0.0 ? sqrt(max(sum, 0.0) / q.weight) : 0.0;
+	}
+
+	inline XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMLoadFloat3(&p1) - v0, XMLoadFloat3(&p2) - v0);
+	}
+
+	struct PositionKey
+	{
+		UINT32 x;
+		UINT32 y;
+		UINT32 z;
+
+		bool operator==(const PositionKey& other) const
+		{
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			return static_cast<size_t>((key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u));
+		}
+	};
+
+	struct Collapse
+	{
+		DWORD from;
+		DWORD to;
+		double error;
+	};
+
+	// vertices on edges not shared by exactly two triangles (open borders, UV
+	// seams after welding, non-manifold edges) and vertices whose position
+	// another vertex shares must not move
+	vector<bool> FindLockedVertices(const vector<Vertex>& vertices, const vector<DWORD>& indices)
+	{
+		vector<bool> locked(vertices.size(), false);
+
+		unordered_map<UINT64, UINT> edgeUses;
+		edgeUses.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				DWORD a = indices[i + corner];
+				DWORD b = indices[i + (corner + 1) % 3];
+				UINT64 key = (static_cast<UINT64>(min(a, b)) << 32) | max(a, b);
+				++edgeUses[key];
+			}
+		}
+
+		for (const auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				locked[static_cast<DWORD>(edge.first >> 32)] = true;
+				locked[static_cast<DWORD>(edge.first & 0xffffffff)] = true;
+			}
+		}
+
+		unordered_map<PositionKey, DWORD, PositionKeyHash> positions;
+		positions.reserve(vertices.size());
+		for (DWORD index : indices)
+		{
+			PositionKey key;
+			memcpy(&key.x, &vertices[index].position.x, sizeof(UINT32));
+			memcpy(&key.y, &vertices[index].position.y, sizeof(UINT32));
+			memcpy(&key.z, &vertices[index].position.z, sizeof(UINT32));
+
+			auto inserted = positions.emplace(key, index);
+			if (!inserted.second && inserted.first->second != index)
+			{
+				locked[index] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+
+		return locked;
+	}
+
+	bool CollapseFlipsTriangle(const vector<Vertex>& vertices, const DWORD* triangle, const Collapse& collapse)
+	{
+		XMFLOAT3 moved[3];
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			if (triangle[corner] == collapse.to)
+			{
+				// collapsed away, cannot flip
+				return false;
+			}
+
+			DWORD vertex = triangle[corner] == collapse.from ? collapse.to : triangle[corner];
+			moved[corner] = vertices[vertex].position;
+		}
+
+		XMVECTOR before = TriangleNormal(vertices[triangle[0]].position, vertices[triangle[1]].position, vertices[triangle[2]].position);
+		XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+		return XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+	}
+}
+
+void MeshSimplifier::Simplify(const vector<Vertex>& vertices, const vector<DWORD>& indices,
+	size_t targetIndexCount, vector<DWORD>& result, float& error)
+{
+	result = indices;
+	error = 0.0f;
+
+	if (result.size() <= targetIndexCount)
+	{
+		return;
+	}
+
+	const size_t vertexCount = vertices.size();
+
+	vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[indices[i]].position;
+		XMVECTOR normal = TriangleNormal(p0, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (!(length > 0.0f))
+		{
+			continue;
+		}
+
+		XMFLOAT3 plane;
+		XMStoreFloat3(&plane, normal / length);
+		double d = -(static_cast<double>(plane.x) * p0.x + static_cast<double>(plane.y) * p0.y + static_cast<double>(plane.z) * p0.z);
+		double area = 0.5 * length;
+
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			AddPlane(quadrics[indices[i + corner]], plane.x, plane.y, plane.z, d, area);
+		}
+	}
+
+	const vector<bool> locked = FindLockedVertices(vertices, indices);
+
+	vector<UINT> triangleStart(vertexCount + 1);
+	vector<UINT> triangleList;
+	vector<DWORD> collapseTarget(vertexCount);
+	vector<bool> touched(vertexCount);
+	vector<Collapse> collapses;
+	double maxError = 0.0;
+
+	// every pass collapses as many independent edges as it can, cheapest first
+	while (result.size() > targetIndexCount)
+	{
+		const size_t triangleCount = result.size() / 3;
+
+		// triangles around every vertex
+		fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (DWORD index : result)
+		{
+			++triangleStart[index + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			triangleStart[v + 1] += triangleStart[v];
+		}
+
+		triangleList.resize(result.size());
+		vector<UINT> fillPosition(triangleStart.begin(), triangleStart.end() - 1);
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			triangleList[fillPosition[result[i]]++] = static_cast<UINT>(i / 3);
+		}
+
+		// cheapest neighbour for every vertex that may move
+		collapses.clear();
+		for (DWORD v = 0; v < vertexCount; ++v)
+		{
+			if (locked[v] || triangleStart[v] == triangleStart[v + 1])
+			{
+				continue;
+			}
+
+			Collapse best = { v, NO_VERTEX, 0.0 };
+			for (UINT t = triangleStart[v]; t < triangleStart[v + 1]; ++t)
+			{
+				const DWORD* triangle = &result[triangleList[t] * 3];
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					DWORD neighbour = triangle[corner];
+					if (neighbour == v)
+					{
+						continue;
+					}
+
+					Quadric combined = quadrics[v];
+					AddQuadric(combined, quadrics[neighbour]);
+					double collapseError = Evaluate(combined, vertices[neighbour].position);
+
+					if (best.to == NO_VERTEX || collapseError < best.error)
+					{
+						best.to = neighbour;
+						best.error = collapseError;
+					}
+				}
+			}
+
+			if (best.to != NO_VERTEX)
+			{
+				collapses.push_back(best);
+			}
+		}
+
+		sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			return a.error < b.error;
+		});
+
+		for (DWORD v = 0; v < vertexCount; ++v)
+		{
+			collapseTarget[v] = v;
+		}
+		fill(touched.begin(), touched.end(), false);
+
+		const size_t triangleBudget = triangleCount - targetIndexCount / 3;
+		size_t removedTriangles = 0;
+		size_t appliedCollapses = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (removedTriangles >= triangleBudget)
+			{
+				break;
+			}
+
+			// collapses in one pass must not share triangles
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			bool flips = false;
+			for (UINT t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1] && !flips; ++t)
+			{
+				flips = CollapseFlipsTriangle(vertices, &result[triangleList[t] * 3], collapse);
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			for (UINT t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1]; ++t)
+			{
+				const DWORD* triangle = &result[triangleList[t] * 3];
+				bool removed = false;
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					touched[triangle[corner]] = true;
+					removed = removed || triangle[corner] == collapse.to;
+				}
+				removedTriangles += removed ? 1 : 0;
+			}
+
+			collapseTarget[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			maxError = max(maxError, collapse.error);
+			++appliedCollapses;
+		}
+
+		if (appliedCollapses == 0)
+		{
+			break;
+		}
+
+		// remap and drop the triangles that collapsed to an edge
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			DWORD a = collapseTarget[result[i]];
+			DWORD b = collapseTarget[result[i + 1]];
+			DWORD c = collapseTarget[result[i + 2]];
+			if (a == b || b == c || a == c)
+			{
+				continue;
+			}
+
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+	}
+
+	error = static_cast<float>(maxError);
+}
+
+void MeshSimplifier::BuildLods(const vector<Vertex>& vertices, vector<DWORD>& indices, vector<MeshLod>& lods)
+{
+	lods.clear();
+
+	MeshLod fullLod = { 0, static_cast<UINT32>(indices.size()), 0.0f };
+	lods.push_back(fullLod);
+
+	vector<DWORD> previous = indices;
+	vector<DWORD> simplified;
+
+	while (lods.size() < MAX_LOD_COUNT)
+	{
+		float levelError = 0.0f;
+		Simplify(vertices, previous, previous.size() / 6 * 3, simplified, levelError);
+
+		if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+		{
+			break;
+		}
+
+		MeshOptimizer::OptimizeFaces(simplified);
+
+		// errors of successive levels add up, each one is simplified from the last
+		MeshLod lod = { static_cast<UINT32>(indices.size()), static_cast<UINT32>(simplified.size()),
+			lods.back().error + levelError };
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		lods.push_back(lod);
+		previous.swap(simplified);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <vector>
+#include "Vertex.h"
+#include "MeshLod.h"
+
+// Quadric error edge collapse simplification (Garland and Heckbert) that only
+// rewrites the index buffer: every collapse moves a vertex onto one of its
+// neighbours, so all levels of detail share one vertex buffer. Vertices on
+// open or attribute seam edges never move, which keeps UV seams and borders
+// intact at the cost of less reduction around them.
+class MeshSimplifier
+{
+public:
+	static const UINT MAX_LOD_COUNT = 5;
+
+	// simplifies towards targetIndexCount, error is the largest collapse error
+	// as a distance in object space
+	static void Simplify(const std::vector<Vertex>& vertices, const std::vector<DWORD>& indices,
+		size_t targetIndexCount, std::vector<DWORD>& result, float& error);
+
+	// replaces indices (the full mesh) with all levels back to back, each
+	// level about half the triangles of the previous one
+	static void BuildLods(const std::vector<Vertex>& vertices, std::vector<DWORD>& indices, std::vector<MeshLod>& lods);
+};
@@ -0,0 +1,120 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+	void ComputeBounds(const Vertex* vertices, const uint32_t* indices, Meshlet& meshlet)
+	{
+		const uint32_t* first = indices + meshlet.indexOffset;
+		const uint32_t* last = first + meshlet.indexCount;
+
+		// sphere around the box center
+		XMVECTOR boundsMin = XMLoadFloat3(&vertices[*first].position);
+		XMVECTOR boundsMax = boundsMin;
+		for (const uint32_t* index = first; index != last; ++index)
+		{
+			XMVECTOR position = XMLoadFloat3(&vertices[*index].position);
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+		}
+
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (const uint32_t* index = first; index != last; ++index)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&vertices[*index].position) - center));
+			radius = max(radius, distance);
+		}
+
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = radius;
+
+		// normal cone from the geometric triangle normals
+		XMVECTOR axis = XMVectorZero();
+		for (const uint32_t* triangle = first; triangle != last; triangle += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].position);
+			XMVECTOR normal = XMVector3Cross(XMLoadFloat3(&vertices[triangle[1]].position) - p0,
+				XMLoadFloat3(&vertices[triangle[2]].position) - p0);
+			axis += XMVector3Normalize(normal);
+		}
+		axis = XMVector3Normalize(axis);
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+
+		float minDot = 1.0f;
+		for (const uint32_t* triangle = first; triangle != last; triangle += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].position);
+			XMVECTOR normal = XMVector3Cross(XMLoadFloat3(&vertices[triangle[1]].position) - p0,
+				XMLoadFloat3(&vertices[triangle[2]].position) - p0);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+			{
+				minDot = min(minDot, XMVectorGetX(XMVector3Dot(XMVector3Normalize(normal), axis)));
+			}
+		}
+
+		// all triangles face away once the view direction is within 90 degrees
+		// minus the spread of the axis
+		meshlet.coneCutoff = minDot > 0.0f && XMVectorGetX(XMVector3LengthSq(axis)) > 0.0f ?
+			sqrtf(1.0f - minDot * minDot) : 1.0f;
+	}
+}
+
+void MeshletBuilder::Build(const Vertex* vertices, size_t vertexCount,
+	const uint32_t* indices, uint32_t indexOffset, uint32_t indexCount,
+	vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+
+	// meshlet number + 1 that last used each vertex
+	vector<uint32_t> lastUse(vertexCount, 0);
+
+	auto countNewVertices = [&](uint32_t triangle, uint32_t tag)
+	{
+		uint32_t newVertices = 0;
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			uint32_t vertex = indices[triangle + corner];
+			bool repeated = (corner > 0 && indices[triangle] == vertex) || (corner > 1 && indices[triangle + 1] == vertex);
+			newVertices += lastUse[vertex] != tag && !repeated ? 1 : 0;
+		}
+		return newVertices;
+	};
+
+	Meshlet meshlet = {};
+	meshlet.indexOffset = indexOffset;
+
+	for (uint32_t i = indexOffset; i + 3 <= indexOffset + indexCount; i += 3)
+	{
+		uint32_t tag = static_cast<uint32_t>(meshlets.size()) + 1;
+		uint32_t newVertices = countNewVertices(i, tag);
+
+		if (meshlet.indexCount > 0 &&
+			(meshlet.vertexCount + newVertices > MAX_VERTICES || meshlet.indexCount / 3 + 1 > MAX_TRIANGLES))
+		{
+			ComputeBounds(vertices, indices, meshlet);
+			meshlets.push_back(meshlet);
+
+			meshlet = Meshlet();
+			meshlet.indexOffset = i;
+			tag = static_cast<uint32_t>(meshlets.size()) + 1;
+			newVertices = countNewVertices(i, tag);
+		}
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			lastUse[indices[i + corner]] = tag;
+		}
+		meshlet.vertexCount += newVertices;
+		meshlet.indexCount += 3;
+	}
+
+	if (meshlet.indexCount > 0)
+	{
+		ComputeBounds(vertices, indices, meshlet);
+		meshlets.push_back(meshlet);
+	}
+}
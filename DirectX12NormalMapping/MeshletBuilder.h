@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+
+// a run of consecutive triangles of the index buffer with culling bounds,
+// everything in object space
+struct Meshlet
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t vertexCount;	// unique vertices
+	XMFLOAT3 center;	// bounding sphere
+	float radius;
+	XMFLOAT3 coneAxis;	// average facing direction of the triangles
+	float coneCutoff;	// sine of the normal spread, 1 when the cone cannot cull
+};
+
+// Splits an index buffer into meshlets of at most MAX_VERTICES unique
+// vertices and MAX_TRIANGLES triangles, keeping the triangle order, so a
+// cache optimized index buffer gives spatially compact meshlets and every
+// meshlet can be drawn as an index range. Platform independent, no D3D.
+class MeshletBuilder
+{
+public:
+	static const uint32_t MAX_VERTICES = 64;
+	static const uint32_t MAX_TRIANGLES = 124;
+
+	static void Build(const Vertex* vertices, size_t vertexCount,
+		const uint32_t* indices, uint32_t indexOffset, uint32_t indexCount,
+		std::vector<Meshlet>& meshlets);
+};
@@ -0,0 +1,93 @@
+#include "MeshletCuller.h"
+#include <cmath>
+
+using namespace std;
+
+MeshletCuller::MeshletCuller(const XMMATRIX& objectToClip, const XMFLOAT3& eyePosition)
+	: m_eyePosition(eyePosition)
+{
+	// Gribb/Hartmann, the columns of the matrix are the rows of the transpose
+	XMMATRIX columns = XMMatrixTranspose(objectToClip);
+
+	const XMVECTOR planes[6] =
+	{
+		columns.r[3] + columns.r[0],	// left
+		columns.r[3] - columns.r[0],	// right
+		columns.r[3] + columns.r[1],	// bottom
+		columns.r[3] - columns.r[1],	// top
+		columns.r[2],	// near
+		columns.r[3] - columns.r[2]	// far
+	};
+
+	for (size_t i = 0; i < 6; ++i)
+	{
+		XMStoreFloat4(&m_planes[i], XMPlaneNormalize(planes[i]));
+	}
+}
+
+bool MeshletCuller::IsInFrustum(const Meshlet& meshlet) const
+{
+	for (size_t i = 0; i < 6; ++i)
+	{
+		const XMFLOAT4& plane = m_planes[i];
+		float distance = plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w;
+		if (distance < -meshlet.radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MeshletCuller::IsBackfacing(const Meshlet& meshlet) const
+{
+	if (meshlet.coneCutoff >= 1.0f)
+	{
+		return false;
+	}
+
+	// every point of the bounding sphere sees the whole cone from behind
+	float x = meshlet.center.x - m_eyePosition.x;
+	float y = meshlet.center.y - m_eyePosition.y;
+	float z = meshlet.center.z - m_eyePosition.z;
+	float alongAxis = x * meshlet.coneAxis.x + y * meshlet.coneAxis.y + z * meshlet.coneAxis.z;
+
+	return alongAxis >= meshlet.coneCutoff * sqrtf(x * x + y * y + z * z) + meshlet.radius;
+}
+
+void MeshletCuller::Cull(const vector<Meshlet>& meshlets, vector<IndexRange>& ranges, MeshletCullStats& stats) const
+{
+	ranges.clear();
+	stats = MeshletCullStats();
+	stats.meshlets = static_cast<uint32_t>(meshlets.size());
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		stats.triangles += meshlet.indexCount / 3;
+
+		if (!IsInFrustum(meshlet))
+		{
+			++stats.frustumCulled;
+			continue;
+		}
+
+		if (IsBackfacing(meshlet))
+		{
+			++stats.coneCulled;
+			continue;
+		}
+
+		stats.visibleTriangles += meshlet.indexCount / 3;
+
+		if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset)
+		{
+			ranges.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			IndexRange range = { meshlet.indexOffset, meshlet.indexCount };
+			ranges.push_back(range);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MeshletBuilder.h"
+
+struct IndexRange
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+};
+
+struct MeshletCullStats
+{
+	uint32_t meshlets;
+	uint32_t frustumCulled;
+	uint32_t coneCulled;
+	uint32_t triangles;
+	uint32_t visibleTriangles;
+};
+
+// CPU meshlet culling against the view frustum and the normal cones, in
+// object space so nothing has to be transformed per meshlet. Visible
+// meshlets that follow each other in the index buffer are merged into one
+// index range. Platform independent, no D3D.
+class MeshletCuller
+{
+private:
+	XMFLOAT4 m_planes[6];	// normalized, inside is positive
+	XMFLOAT3 m_eyePosition;
+
+public:
+	// objectToClip is world * view * projection (row vectors, D3D clip space
+	// with 0 <= z <= w), eyePosition is in object space
+	MeshletCuller(const XMMATRIX& objectToClip, const XMFLOAT3& eyePosition);
+
+	bool IsInFrustum(const Meshlet& meshlet) const;
+	bool IsBackfacing(const Meshlet& meshlet) const;
+
+	void Cull(const std::vector<Meshlet>& meshlets, std::vector<IndexRange>& ranges, MeshletCullStats& stats) const;
+};
@@ -0,0 +1,314 @@
+#include "MeshletTests.h"
+#include <cmath>
+#include <cstdio>
+#include <cwchar>
+#include <vector>
+#include "MeshletBuilder.h"
+#include "MeshletCuller.h"
+
+using std::vector;
+
+namespace
+{
+	struct Shape
+	{
+		const wchar_t* name;
+		vector<Vertex> vertices;
+		vector<uint32_t> indices;
+	};
+
+	Vertex MakeVertex(float x, float y, float z)
+	{
+		Vertex vertex = {};
+		vertex.position = XMFLOAT3(x, y, z);
+		return vertex;
+	}
+
+	// unit sphere, a vertex at each pole and rings in between, the triangles face outwards
+	Shape BuildSphere(uint32_t rings, uint32_t segments)
+	{
+		Shape sphere = { L"sphere", {}, {} };
+		sphere.vertices.push_back(MakeVertex(0.0f, 1.0f, 0.0f));
+		for (uint32_t ring = 1; ring < rings; ++ring)
+		{
+			const float theta = XM_PI * ring / rings;
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				const float phi = 2.0f * XM_PI * segment / segments;
+				sphere.vertices.push_back(MakeVertex(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+			}
+		}
+		sphere.vertices.push_back(MakeVertex(0.0f, -1.0f, 0.0f));
+
+		const uint32_t bottom = static_cast<uint32_t>(sphere.vertices.size() - 1);
+		auto ringVertex = [=](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * segments + segment % segments; };
+		for (uint32_t segment = 0; segment < segments; ++segment)
+		{
+			sphere.indices.insert(sphere.indices.end(), { 0, ringVertex(1, segment + 1), ringVertex(1, segment) });
+		}
+		for (uint32_t ring = 1; ring + 1 < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				const uint32_t a = ringVertex(ring, segment);
+				const uint32_t b = ringVertex(ring + 1, segment);
+				const uint32_t c = ringVertex(ring + 1, segment + 1);
+				const uint32_t d = ringVertex(ring, segment + 1);
+				sphere.indices.insert(sphere.indices.end(), { a, d, b, d, c, b });
+			}
+		}
+		for (uint32_t segment = 0; segment < segments; ++segment)
+		{
+			sphere.indices.insert(sphere.indices.end(), { ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1), bottom });
+		}
+		return sphere;
+	}
+
+	// quads x quads square of side 2 at y = 0, facing +Y
+	Shape BuildPlane(uint32_t quads)
+	{
+		Shape plane = { L"plane", {}, {} };
+		for (uint32_t z = 0; z <= quads; ++z)
+		{
+			for (uint32_t x = 0; x <= quads; ++x)
+			{
+				plane.vertices.push_back(MakeVertex(2.0f * x / quads - 1.0f, 0.0f, 2.0f * z / quads - 1.0f));
+			}
+		}
+
+		for (uint32_t z = 0; z < quads; ++z)
+		{
+			for (uint32_t x = 0; x < quads; ++x)
+			{
+				const uint32_t a = z * (quads + 1) + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + quads + 2;
+				const uint32_t d = a + quads + 1;
+				plane.indices.insert(plane.indices.end(), { a, d, b, d, c, b });
+			}
+		}
+		return plane;
+	}
+
+	// small enough to be one meshlet, its normals cancel out
+	Shape BuildOctahedron()
+	{
+		Shape octahedron = { L"octahedron", {}, {} };
+		octahedron.vertices = { MakeVertex(1.0f, 0.0f, 0.0f), MakeVertex(-1.0f, 0.0f, 0.0f), MakeVertex(0.0f, 1.0f, 0.0f),
+			MakeVertex(0.0f, -1.0f, 0.0f), MakeVertex(0.0f, 0.0f, 1.0f), MakeVertex(0.0f, 0.0f, -1.0f) };
+		octahedron.indices = { 2, 4, 0, 2, 1, 4, 2, 5, 1, 2, 0, 5, 3, 0, 4, 3, 4, 1, 3, 1, 5, 3, 5, 0 };
+		return octahedron;
+	}
+
+	XMVECTOR GetTriangleNormal(const Shape& shape, const uint32_t* triangle)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&shape.vertices[triangle[0]].position);
+		return XMVector3Cross(XMLoadFloat3(&shape.vertices[triangle[1]].position) - p0,
+			XMLoadFloat3(&shape.vertices[triangle[2]].position) - p0);
+	}
+
+	// the limits, the index range covered in order without gaps, the unique vertex counts and the bounding spheres
+	bool TestBuild(const Shape& shape, uint32_t firstTriangle, vector<Meshlet>& meshlets)
+	{
+		const uint32_t indexOffset = firstTriangle * 3;
+		const uint32_t indexCount = static_cast<uint32_t>(shape.indices.size()) - indexOffset;
+		MeshletBuilder::Build(shape.vertices.data(), shape.vertices.size(), shape.indices.data(), indexOffset, indexCount, meshlets);
+
+		bool passed = !meshlets.empty();
+		uint32_t nextIndex = indexOffset;
+		vector<uint32_t> lastUse(shape.vertices.size(), 0);
+		float worstFit = 0.0f;
+
+		for (size_t i = 0; i < meshlets.size(); ++i)
+		{
+			const Meshlet& meshlet = meshlets[i];
+			passed = passed && meshlet.indexOffset == nextIndex && meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0 &&
+				meshlet.indexCount / 3 <= MeshletBuilder::MAX_TRIANGLES;
+			nextIndex = meshlet.indexOffset + meshlet.indexCount;
+
+			uint32_t uniqueVertices = 0;
+			for (uint32_t index = meshlet.indexOffset; index < meshlet.indexOffset + meshlet.indexCount; ++index)
+			{
+				const uint32_t vertex = shape.indices[index];
+				uniqueVertices += lastUse[vertex] != i + 1 ? 1 : 0;
+				lastUse[vertex] = static_cast<uint32_t>(i + 1);
+
+				const XMFLOAT3& position = shape.vertices[vertex].position;
+				const float x = position.x - meshlet.center.x;
+				const float y = position.y - meshlet.center.y;
+				const float z = position.z - meshlet.center.z;
+				const float distance = sqrtf(x * x + y * y + z * z);
+				worstFit = distance - meshlet.radius > worstFit ? distance - meshlet.radius : worstFit;
+			}
+			passed = passed && uniqueVertices == meshlet.vertexCount && uniqueVertices <= MeshletBuilder::MAX_VERTICES;
+		}
+		passed = passed && nextIndex == indexOffset + indexCount && worstFit <= 1e-5f;
+
+		wprintf(L"  %-40s %s  %zu meshlets for %u triangles from triangle %u\n", shape.name, passed ? L"ok" : L"FAILED",
+			meshlets.size(), indexCount / 3, firstTriangle);
+		return passed;
+	}
+
+	// a flat patch has its normal as the axis and a cone that culls, a closed shape a cone that never does
+	bool TestCones(const vector<Meshlet>& planeMeshlets, const Shape& octahedron)
+	{
+		bool passed = true;
+		for (const Meshlet& meshlet : planeMeshlets)
+		{
+			passed = passed && fabsf(meshlet.coneAxis.y - 1.0f) < 1e-5f && meshlet.coneCutoff < 1e-3f;
+		}
+
+		// seen from underneath every meshlet of the plane faces away, from above none does
+		const XMMATRIX projectionMat = XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 1.0f, 0.1f, 100.0f);
+		const XMFLOAT3 below(0.0f, -3.0f, 0.0f);
+		const XMFLOAT3 above(0.0f, 3.0f, 0.0f);
+		const XMVECTOR up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+		MeshletCuller belowCuller(XMMatrixLookAtLH(XMLoadFloat3(&below), XMVectorZero(), up) * projectionMat, below);
+		MeshletCuller aboveCuller(XMMatrixLookAtLH(XMLoadFloat3(&above), XMVectorZero(), up) * projectionMat, above);
+		for (const Meshlet& meshlet : planeMeshlets)
+		{
+			passed = passed && belowCuller.IsBackfacing(meshlet) && !aboveCuller.IsBackfacing(meshlet);
+		}
+
+		vector<Meshlet> meshlets;
+		MeshletBuilder::Build(octahedron.vertices.data(), octahedron.vertices.size(), octahedron.indices.data(), 0,
+			static_cast<uint32_t>(octahedron.indices.size()), meshlets);
+		passed = passed && meshlets.size() == 1 && meshlets[0].coneCutoff == 1.0f;
+		const XMFLOAT3 eyePositions[] = { XMFLOAT3(3.0f, 0.0f, 0.0f), XMFLOAT3(-3.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 3.0f, 0.0f),
+			XMFLOAT3(0.0f, -3.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 3.0f), XMFLOAT3(0.0f, 0.0f, -3.0f) };
+		for (const XMFLOAT3& eyePosition : eyePositions)
+		{
+			MeshletCuller culler(XMMatrixIdentity(), eyePosition);
+			passed = passed && meshlets.size() == 1 && !culler.IsBackfacing(meshlets[0]);
+		}
+
+		// every triangle of the octahedron faces outwards, so some of them face any eye outside it
+		for (size_t i = 0; i < octahedron.indices.size(); i += 3)
+		{
+			XMVECTOR centroid = (XMLoadFloat3(&octahedron.vertices[octahedron.indices[i]].position) +
+				XMLoadFloat3(&octahedron.vertices[octahedron.indices[i + 1]].position) +
+				XMLoadFloat3(&octahedron.vertices[octahedron.indices[i + 2]].position)) / 3.0f;
+			passed = passed && XMVectorGetX(XMVector3Dot(GetTriangleNormal(octahedron, &octahedron.indices[i]), centroid)) > 0.0f;
+		}
+
+		wprintf(L"  %-40s %s\n", L"normal cones, flat and closed", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// cameras on a sphere around the shape, alternating between seeing all of it and being close,
+	// none may cull a triangle it sees
+	bool TestViews(const Shape& shape, const vector<Meshlet>& meshlets, uint32_t views)
+	{
+		const XMMATRIX projectionMat = XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+		uint32_t violations = 0;
+		double rejectedTriangles = 0.0;
+		vector<IndexRange> ranges;
+
+		for (uint32_t view = 0; view < views; ++view)
+		{
+			const float y = 1.0f - 2.0f * (view + 0.5f) / views;
+			const float ring = sqrtf(1.0f - y * y);
+			const float angle = view * 2.39996323f;	// golden angle
+			const float distance = view % 2 == 0 ? 4.0f : 1.5f;
+			XMVECTOR eye = XMVectorSet(ring * cosf(angle), y, ring * sinf(angle), 0.0f) * distance;
+			XMVECTOR up = fabsf(y) > 0.99f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			XMMATRIX objectToClip = XMMatrixLookAtLH(eye, XMVectorZero(), up) * projectionMat;
+
+			XMFLOAT3 eyePosition;
+			XMStoreFloat3(&eyePosition, eye);
+			MeshletCuller culler(objectToClip, eyePosition);
+			MeshletCullStats stats;
+			culler.Cull(meshlets, ranges, stats);
+			rejectedTriangles += 1.0 - stats.visibleTriangles / static_cast<double>(stats.triangles);
+
+			for (const Meshlet& meshlet : meshlets)
+			{
+				if (culler.IsInFrustum(meshlet) && !culler.IsBackfacing(meshlet))
+				{
+					continue;
+				}
+
+				for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3)
+				{
+					violations += IsTriangleVisible(shape.vertices.data(), &shape.indices[i], objectToClip, eye) ? 1 : 0;
+				}
+			}
+		}
+
+		const bool passed = violations == 0;
+		wprintf(L"  %-40s %s  %u views, %.1f%% triangles rejected, %u visible triangles culled\n", shape.name,
+			passed ? L"ok" : L"FAILED", views, 100.0 * rejectedTriangles / views, violations);
+		return passed;
+	}
+
+	// the sphere from the front, all of it in the frustum, so only the cones reject triangles
+	bool TestRejectionRate(const vector<Meshlet>& meshlets, uint32_t expectedVisible)
+	{
+		const XMFLOAT3 eyePosition(0.0f, 0.0f, -3.0f);
+		MeshletCuller culler(XMMatrixLookAtLH(XMLoadFloat3(&eyePosition), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+			XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 1.0f, 0.1f, 100.0f), eyePosition);
+		vector<IndexRange> ranges;
+		MeshletCullStats stats;
+		culler.Cull(meshlets, ranges, stats);
+
+		uint32_t rangeTriangles = 0;
+		for (const IndexRange& range : ranges)
+		{
+			rangeTriangles += range.indexCount / 3;
+		}
+		const bool passed = stats.frustumCulled == 0 && stats.visibleTriangles == expectedVisible && rangeTriangles == expectedVisible;
+
+		wprintf(L"  %-40s %s  %u of %u triangles visible, %.1f%% rejected, %u meshlets cone culled, %zu draws\n", L"fixed camera",
+			passed ? L"ok" : L"FAILED", stats.visibleTriangles, stats.triangles,
+			100.0 * (1.0 - stats.visibleTriangles / static_cast<double>(stats.triangles)), stats.coneCulled, ranges.size());
+		return passed;
+	}
+}
+
+bool IsTriangleVisible(const Vertex* vertices, const uint32_t* triangle, FXMMATRIX objectToClip, FXMVECTOR eye)
+{
+	XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].position);
+	XMVECTOR p1 = XMLoadFloat3(&vertices[triangle[1]].position);
+	XMVECTOR p2 = XMLoadFloat3(&vertices[triangle[2]].position);
+	if (XMVectorGetX(XMVector3Dot(XMVector3Cross(p1 - p0, p2 - p0), eye - p0)) <= 0.0f)
+	{
+		return false;
+	}
+
+	const XMVECTOR corners[] = { p0, p1, p2 };
+	for (const XMVECTOR& corner : corners)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(corner, objectToClip));
+		if (fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && clip.z >= 0.0f && clip.z <= clip.w)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int RunMeshletTests()
+{
+	const Shape sphere = BuildSphere(32, 64);
+	const Shape plane = BuildPlane(64);
+	const Shape octahedron = BuildOctahedron();
+	vector<Meshlet> sphereMeshlets;
+	vector<Meshlet> planeMeshlets;
+	vector<Meshlet> lodMeshlets;
+	int failures = 0;
+
+	failures += TestBuild(sphere, 0, sphereMeshlets) ? 0 : 1;
+	failures += TestBuild(plane, 0, planeMeshlets) ? 0 : 1;
+	// a LOD that starts in the middle of the index buffer
+	failures += TestBuild(sphere, 1000, lodMeshlets) ? 0 : 1;
+
+	failures += TestCones(planeMeshlets, octahedron) ? 0 : 1;
+	failures += TestViews(sphere, sphereMeshlets, 256) ? 0 : 1;
+	failures += TestViews(plane, planeMeshlets, 256) ? 0 : 1;
+	failures += TestRejectionRate(sphereMeshlets, 3570) ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include "Vertex.h"
+
+// MeshletBuilder and MeshletCuller on a sphere, a plane and an octahedron
+// built in memory, checks the vertex and triangle limits, that the meshlets
+// cover the index range exactly, that the bounding spheres hold their
+// vertices, the normal cones of flat and closed shapes, that cameras around
+// the shapes never cull a triangle they see, and the rejection rate of one
+// fixed camera, prints every case and returns 0 when all of them pass
+int RunMeshletTests();
+
+// a triangle that faces the eye with a corner inside the clip volume must
+// never be culled, the reference for the tests and -bench-meshlets
+bool IsTriangleVisible(const Vertex* vertices, const uint32_t* triangle, FXMMATRIX objectToClip, FXMVECTOR eye);
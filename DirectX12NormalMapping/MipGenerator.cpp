@@ -0,0 +1,489 @@
+#include "MipGenerator.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const UINT CHANNELS = 4;
+	const UINT ALPHA = 3;
+	const UINT KAISER_TAPS = 6;
+	const UINT KAISER_FIRST_TAP = 2;	// source texels 2x - 2 .. 2x + 3 around destination texel x
+	const double KAISER_ALPHA = 4.0;
+	const double KAISER_HALF_WIDTH = 3.0;
+	const UINT SRGB_TABLE_SIZE = 16384;
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			double factor = x / (2.0 * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	struct Tables
+	{
+		float srgbToLinear[256];
+		BYTE linearToSrgb[SRGB_TABLE_SIZE + 1];
+		float kaiserWeights[KAISER_TAPS];
+
+		Tables()
+		{
+			for (UINT i = 0; i < 256; ++i)
+			{
+				double value = i / 255.0;
+				srgbToLinear[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4));
+			}
+
+			for (UINT i = 0; i <= SRGB_TABLE_SIZE; ++i)
+			{
+				double value = static_cast<double>(i) / SRGB_TABLE_SIZE;
+				double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+				linearToSrgb[i] = static_cast<BYTE>(encoded * 255.0 + 0.5);
+			}
+
+			// sinc at half the source rate, the taps sit at -2.5 .. 2.5 source texels from the destination center
+			const double pi = 3.14159265358979323846;
+			double sum = 0.0;
+			double weights[KAISER_TAPS];
+			for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				double distance = tap - (KAISER_TAPS - 1) * 0.5;
+				double x = distance * 0.5;
+				double sinc = sin(pi * x) / (pi * x);
+				double window = distance / KAISER_HALF_WIDTH;
+				weights[tap] = sinc * BesselI0(KAISER_ALPHA * sqrt(1.0 - window * window)) / BesselI0(KAISER_ALPHA);
+				sum += weights[tap];
+			}
+			for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				kaiserWeights[tap] = static_cast<float>(weights[tap] / sum);
+			}
+		}
+	};
+
+	const Tables& GetTables()
+	{
+		static const Tables tables;
+		return tables;
+	}
+
+	inline UINT Clamp(int value, UINT size)
+	{
+		return value < 0 ? 0 : (static_cast<UINT>(value) < size ? static_cast<UINT>(value) : size - 1);
+	}
+
+	void DecodeRow(MipContent content, const BYTE* bgra, UINT width, float* texels)
+	{
+		const Tables& tables = GetTables();
+		for (UINT i = 0; i < width * CHANNELS; ++i)
+		{
+			const bool color = i % CHANNELS != ALPHA;
+			if (content == MipContent::Srgb && color)
+			{
+				texels[i] = tables.srgbToLinear[bgra[i]];
+			}
+			else if (content == MipContent::Normal && color)
+			{
+				texels[i] = bgra[i] * (2.0f / 255.0f) - 1.0f;
+			}
+			else
+			{
+				texels[i] = bgra[i] * (1.0f / 255.0f);
+			}
+		}
+	}
+
+	// the scalar and SSE kernels below add in the same order, so they round the same way
+
+	void BoxRowScalar(const float* source, UINT sourceWidth, UINT sourceHeight, UINT y, UINT width, float* texels)
+	{
+		const float* row0 = source + static_cast<size_t>(Clamp(2 * y, sourceHeight)) * sourceWidth * CHANNELS;
+		const float* row1 = source + static_cast<size_t>(Clamp(2 * y + 1, sourceHeight)) * sourceWidth * CHANNELS;
+		for (UINT x = 0; x < width; ++x)
+		{
+			const UINT x0 = Clamp(2 * x, sourceWidth) * CHANNELS;
+			const UINT x1 = Clamp(2 * x + 1, sourceWidth) * CHANNELS;
+			for (UINT c = 0; c < CHANNELS; ++c)
+			{
+				texels[x * CHANNELS + c] = ((row0[x0 + c] + row0[x1 + c]) + (row1[x0 + c] + row1[x1 + c])) * 0.25f;
+			}
+		}
+	}
+
+	void BoxRowSse(const float* source, UINT sourceWidth, UINT sourceHeight, UINT y, UINT width, float* texels)
+	{
+		const float* row0 = source + static_cast<size_t>(Clamp(2 * y, sourceHeight)) * sourceWidth * CHANNELS;
+		const float* row1 = source + static_cast<size_t>(Clamp(2 * y + 1, sourceHeight)) * sourceWidth * CHANNELS;
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		for (UINT x = 0; x < width; ++x)
+		{
+			const UINT x0 = Clamp(2 * x, sourceWidth) * CHANNELS;
+			const UINT x1 = Clamp(2 * x + 1, sourceWidth) * CHANNELS;
+			__m128 top = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+			__m128 bottom = _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1));
+			_mm_storeu_ps(texels + x * CHANNELS, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+		}
+	}
+
+	// filters a full height source row horizontally to the destination width
+	void KaiserRowScalar(const float* sourceRow, UINT sourceWidth, UINT width, float* texels)
+	{
+		const float* weights = GetTables().kaiserWeights;
+		for (UINT x = 0; x < width; ++x)
+		{
+			for (UINT c = 0; c < CHANNELS; ++c)
+			{
+				float sum = 0.0f;
+				for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+				{
+					const UINT sourceX = Clamp(static_cast<int>(2 * x + tap) - KAISER_FIRST_TAP, sourceWidth);
+					sum += weights[tap] * sourceRow[sourceX * CHANNELS + c];
+				}
+				texels[x * CHANNELS + c] = sum;
+			}
+		}
+	}
+
+	void KaiserRowSse(const float* sourceRow, UINT sourceWidth, UINT width, float* texels)
+	{
+		const float* weights = GetTables().kaiserWeights;
+		for (UINT x = 0; x < width; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				const UINT sourceX = Clamp(static_cast<int>(2 * x + tap) - KAISER_FIRST_TAP, sourceWidth);
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(sourceRow + sourceX * CHANNELS)));
+			}
+			_mm_storeu_ps(texels + x * CHANNELS, sum);
+		}
+	}
+
+	// filters the horizontally filtered rows vertically into destination row y
+	void KaiserColumnScalar(const float* filtered, UINT sourceHeight, UINT y, UINT width, float* texels)
+	{
+		const float* weights = GetTables().kaiserWeights;
+		const float* rows[KAISER_TAPS];
+		for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+		{
+			rows[tap] = filtered + static_cast<size_t>(Clamp(static_cast<int>(2 * y + tap) - KAISER_FIRST_TAP, sourceHeight)) * width * CHANNELS;
+		}
+
+		for (UINT i = 0; i < width * CHANNELS; ++i)
+		{
+			float sum = 0.0f;
+			for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				sum += weights[tap] * rows[tap][i];
+			}
+			texels[i] = sum;
+		}
+	}
+
+	void KaiserColumnSse(const float* filtered, UINT sourceHeight, UINT y, UINT width, float* texels)
+	{
+		const float* weights = GetTables().kaiserWeights;
+		const float* rows[KAISER_TAPS];
+		for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+		{
+			rows[tap] = filtered + static_cast<size_t>(Clamp(static_cast<int>(2 * y + tap) - KAISER_FIRST_TAP, sourceHeight)) * width * CHANNELS;
+		}
+
+		for (UINT i = 0; i < width * CHANNELS; i += CHANNELS)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (UINT tap = 0; tap < KAISER_TAPS; ++tap)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(rows[tap] + i)));
+			}
+			_mm_storeu_ps(texels + i, sum);
+		}
+	}
+
+	// zero length normals are left as they are and encode to the flat 128
+	void NormalizeRowScalar(float* texels, UINT width)
+	{
+		for (UINT x = 0; x < width; ++x)
+		{
+			float* texel = texels + x * CHANNELS;
+			float lengthSquared = (texel[0] * texel[0] + texel[1] * texel[1]) + texel[2] * texel[2];
+			if (lengthSquared > 0.0f)
+			{
+				float length = sqrtf(lengthSquared);
+				texel[0] /= length;
+				texel[1] /= length;
+				texel[2] /= length;
+			}
+		}
+	}
+
+	void NormalizeRowSse(float* texels, UINT width)
+	{
+		const __m128 colorMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		for (UINT x = 0; x < width; ++x)
+		{
+			float* texel = texels + x * CHANNELS;
+			__m128 value = _mm_loadu_ps(texel);
+			__m128 squared = _mm_mul_ps(value, value);
+			__m128 lengthSquared = _mm_add_ss(_mm_add_ss(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1))),
+				_mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2)));
+			if (_mm_cvtss_f32(lengthSquared) > 0.0f)
+			{
+				__m128 length = _mm_sqrt_ss(lengthSquared);
+				length = _mm_shuffle_ps(length, length, _MM_SHUFFLE(0, 0, 0, 0));
+				__m128 normalized = _mm_div_ps(value, length);
+				_mm_storeu_ps(texel, _mm_or_ps(_mm_and_ps(colorMask, normalized), _mm_andnot_ps(colorMask, value)));
+			}
+		}
+	}
+
+	// normals map [-1, 1] to [0, 1] first, sRGB colors go through the encoding table
+	void EncodeRowScalar(MipContent content, const float* texels, UINT width, BYTE* bgra)
+	{
+		const Tables& tables = GetTables();
+		for (UINT i = 0; i < width * CHANNELS; ++i)
+		{
+			const bool color = i % CHANNELS != ALPHA;
+			float value = content == MipContent::Normal && color ? texels[i] * 0.5f + 0.5f : texels[i];
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+
+			if (content == MipContent::Srgb && color)
+			{
+				bgra[i] = tables.linearToSrgb[static_cast<int>(value * SRGB_TABLE_SIZE + 0.5f)];
+			}
+			else
+			{
+				bgra[i] = static_cast<BYTE>(static_cast<int>(value * 255.0f + 0.5f));
+			}
+		}
+	}
+
+	void EncodeRowSse(MipContent content, const float* texels, UINT width, BYTE* bgra)
+	{
+		const Tables& tables = GetTables();
+		const float colorScale = content == MipContent::Srgb ? static_cast<float>(SRGB_TABLE_SIZE) : 255.0f;
+		const float normalScale = content == MipContent::Normal ? 0.5f : 1.0f;
+		const float normalBias = content == MipContent::Normal ? 0.5f : 0.0f;
+		const __m128 scale = _mm_set_ps(255.0f, colorScale, colorScale, colorScale);
+		const __m128 bias = _mm_set_ps(0.0f, normalBias, normalBias, normalBias);
+		const __m128 normalMultiplier = _mm_set_ps(1.0f, normalScale, normalScale, normalScale);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		for (UINT x = 0; x < width; ++x)
+		{
+			__m128 value = _mm_loadu_ps(texels + x * CHANNELS);
+			if (content == MipContent::Normal)
+			{
+				value = _mm_add_ps(_mm_mul_ps(value, normalMultiplier), bias);
+			}
+			value = _mm_min_ps(_mm_max_ps(value, zero), one);
+			__m128i quantized = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+
+			if (content == MipContent::Srgb)
+			{
+				alignas(16) int indices[CHANNELS];
+				_mm_store_si128(reinterpret_cast<__m128i*>(indices), quantized);
+				BYTE* texel = bgra + x * CHANNELS;
+				texel[0] = tables.linearToSrgb[indices[0]];
+				texel[1] = tables.linearToSrgb[indices[1]];
+				texel[2] = tables.linearToSrgb[indices[2]];
+				texel[ALPHA] = static_cast<BYTE>(indices[ALPHA]);
+			}
+			else
+			{
+				quantized = _mm_packs_epi32(quantized, quantized);
+				quantized = _mm_packus_epi16(quantized, quantized);
+				const int packed = _mm_cvtsi128_si32(quantized);
+				memcpy(bgra + x * CHANNELS, &packed, CHANNELS);
+			}
+		}
+	}
+
+	typedef std::function<void(UINT, const std::function<void(UINT)>&)> RowRunner;
+
+	void GenerateChain(MipFilter filter, MipContent content, MipKernel kernel, const BYTE* bgra, UINT width, UINT height,
+		UINT mipCount, BYTE* chain, const RowRunner& forEachRow)
+	{
+		const bool sse = kernel == MipKernel::Sse;
+		const size_t topSize = static_cast<size_t>(width) * height * CHANNELS;
+		memcpy(chain, bgra, topSize);
+
+		if (mipCount < 2)
+		{
+			return;
+		}
+
+		std::vector<float> source(topSize);
+		std::vector<float> destination;
+		std::vector<float> filtered;
+
+		forEachRow(height, [&](UINT y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width * CHANNELS;
+			DecodeRow(content, bgra + offset, width, source.data() + offset);
+		});
+
+		BYTE* level = chain + topSize;
+		UINT sourceWidth = width;
+		UINT sourceHeight = height;
+
+		for (UINT mip = 1; mip < mipCount; ++mip)
+		{
+			const UINT mipWidth = sourceWidth > 1 ? sourceWidth / 2 : 1;
+			const UINT mipHeight = sourceHeight > 1 ? sourceHeight / 2 : 1;
+			destination.resize(static_cast<size_t>(mipWidth) * mipHeight * CHANNELS);
+
+			if (filter == MipFilter::Kaiser)
+			{
+				filtered.resize(static_cast<size_t>(mipWidth) * sourceHeight * CHANNELS);
+				forEachRow(sourceHeight, [&](UINT y)
+				{
+					const float* sourceRow = source.data() + static_cast<size_t>(y) * sourceWidth * CHANNELS;
+					float* filteredRow = filtered.data() + static_cast<size_t>(y) * mipWidth * CHANNELS;
+					if (sse)
+					{
+						KaiserRowSse(sourceRow, sourceWidth, mipWidth, filteredRow);
+					}
+					else
+					{
+						KaiserRowScalar(sourceRow, sourceWidth, mipWidth, filteredRow);
+					}
+				});
+			}
+
+			forEachRow(mipHeight, [&](UINT y)
+			{
+				const size_t offset = static_cast<size_t>(y) * mipWidth * CHANNELS;
+				float* texels = destination.data() + offset;
+
+				if (filter == MipFilter::Kaiser)
+				{
+					if (sse)
+					{
+						KaiserColumnSse(filtered.data(), sourceHeight, y, mipWidth, texels);
+					}
+					else
+					{
+						KaiserColumnScalar(filtered.data(), sourceHeight, y, mipWidth, texels);
+					}
+				}
+				else
+				{
+					if (sse)
+					{
+						BoxRowSse(source.data(), sourceWidth, sourceHeight, y, mipWidth, texels);
+					}
+					else
+					{
+						BoxRowScalar(source.data(), sourceWidth, sourceHeight, y, mipWidth, texels);
+					}
+				}
+
+				if (content == MipContent::Normal)
+				{
+					if (sse)
+					{
+						NormalizeRowSse(texels, mipWidth);
+					}
+					else
+					{
+						NormalizeRowScalar(texels, mipWidth);
+					}
+				}
+
+				if (sse)
+				{
+					EncodeRowSse(content, texels, mipWidth, level + offset);
+				}
+				else
+				{
+					EncodeRowScalar(content, texels, mipWidth, level + offset);
+				}
+			});
+
+			level += destination.size();
+			source.swap(destination);
+			sourceWidth = mipWidth;
+			sourceHeight = mipHeight;
+		}
+	}
+}
+
+const wchar_t* MipGenerator::GetKernelName(MipKernel kernel)
+{
+	switch (kernel)
+	{
+	case MipKernel::Scalar:
+		return L"scalar";
+	case MipKernel::Sse:
+		return L"SSE";
+	}
+	return L"unknown";
+}
+
+const wchar_t* MipGenerator::GetFilterName(MipFilter filter)
+{
+	switch (filter)
+	{
+	case MipFilter::Box:
+		return L"box";
+	case MipFilter::Kaiser:
+		return L"kaiser";
+	}
+	return L"unknown";
+}
+
+UINT MipGenerator::GetMipCount(UINT width, UINT height)
+{
+	UINT mipCount = 1;
+	for (UINT size = width > height ? width : height; size > 1; size /= 2)
+	{
+		++mipCount;
+	}
+	return mipCount;
+}
+
+UINT64 MipGenerator::GetChainSize(UINT width, UINT height, UINT mipCount)
+{
+	UINT64 size = 0;
+	for (UINT mip = 0; mip < mipCount; ++mip)
+	{
+		size += static_cast<UINT64>(width) * height * CHANNELS;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return size;
+}
+
+void MipGenerator::Generate(MipFilter filter, MipContent content, MipKernel kernel, const BYTE* bgra, UINT width, UINT height,
+	UINT mipCount, BYTE* chain)
+{
+	GenerateChain(filter, content, kernel, bgra, width, height, mipCount, chain,
+		[](UINT count, const std::function<void(UINT)>& job)
+		{
+			for (UINT i = 0; i < count; ++i)
+			{
+				job(i);
+			}
+		});
+}
+
+void MipGenerator::Generate(MipFilter filter, MipContent content, MipKernel kernel, const BYTE* bgra, UINT width, UINT height,
+	UINT mipCount, BYTE* chain, ThreadPool& threadPool)
+{
+	GenerateChain(filter, content, kernel, bgra, width, height, mipCount, chain,
+		[&threadPool](UINT count, const std::function<void(UINT)>& job)
+		{
+			threadPool.ParallelFor(count, job);
+		});
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include "ThreadPool.h"
+
+enum class MipFilter
+{
+	Box,	// 2x2 average
+	Kaiser	// separable 6 tap Kaiser windowed sinc, sharper minification
+};
+
+enum class MipContent
+{
+	Linear,	// filtered as stored
+	Srgb,	// color channels filtered in linear space, alpha as stored
+	Normal	// tangent space normal in RGB, renormalized on every level
+};
+
+enum class MipKernel
+{
+	Scalar,
+	Sse	// one texel, all four channels, per iteration
+};
+
+// Builds the mip chain of a BGRA8 image on the CPU. Every level is filtered
+// from the float copy of the previous one so rounding does not accumulate.
+// Dimensions are halved and rounded down, odd sizes drop the last row or
+// column in the box filter. Both kernels give bit identical chains.
+class MipGenerator
+{
+public:
+	static const wchar_t* GetKernelName(MipKernel kernel);
+	static const wchar_t* GetFilterName(MipFilter filter);
+	static UINT GetMipCount(UINT width, UINT height);	// down to 1x1
+	static UINT64 GetChainSize(UINT width, UINT height, UINT mipCount);
+
+	// chain receives the levels one after the other, from the largest, with the first one a copy of bgra
+	static void Generate(MipFilter filter, MipContent content, MipKernel kernel, const BYTE* bgra, UINT width, UINT height,
+		UINT mipCount, BYTE* chain);
+	// the rows of every level are spread over the thread pool
+	static void Generate(MipFilter filter, MipContent content, MipKernel kernel, const BYTE* bgra, UINT width, UINT height,
+		UINT mipCount, BYTE* chain, ThreadPool& threadPool);
+};
@@ -0,0 +1,199 @@
+#include "MipStreamer.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace std;
+
+MipStreamer::MipStreamer(uint64_t budgetBytes)
+	: m_budgetBytes(budgetBytes), m_stats()
+{
+}
+
+void MipStreamer::SetBudget(uint64_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+uint64_t MipStreamer::GetBudget() const
+{
+	return m_budgetBytes;
+}
+
+uint64_t MipStreamer::GetLevelSize(const MipStreamTexture& texture, uint32_t mip) const
+{
+	return texture.chainSizes[mip] - (mip + 1 < texture.mipCount ? texture.chainSizes[mip + 1] : 0);
+}
+
+uint32_t MipStreamer::AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t format)
+{
+	MipStreamTexture texture = {};
+	texture.width = width;
+	texture.height = height;
+	texture.mipCount = mipCount < TEXTURE_FILE_MAX_MIPS ? mipCount : TEXTURE_FILE_MAX_MIPS;
+	texture.format = format;
+
+	uint32_t mipWidth = width;
+	uint32_t mipHeight = height;
+	texture.tailMip = texture.mipCount - 1;
+	for (uint32_t mip = 0; mip < texture.mipCount; ++mip)
+	{
+		if (mipWidth <= MIP_STREAM_TAIL_SIZE && mipHeight <= MIP_STREAM_TAIL_SIZE && mip < texture.tailMip)
+		{
+			texture.tailMip = mip;
+		}
+		texture.chainSizes[mip] = DdsFile::GetMipChainSize(format, mipWidth, mipHeight, texture.mipCount - mip);
+
+		mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+		mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+	}
+
+	// a block compressed texture can't start at a level that isn't whole blocks
+	const uint32_t coarsestFirstMip = DdsFile::GetCoarsestFirstMip(format, width, height, texture.mipCount);
+	texture.tailMip = texture.tailMip < coarsestFirstMip ? texture.tailMip : coarsestFirstMip;
+
+	texture.residentMip = texture.tailMip;
+	texture.requestedMip = texture.tailMip;
+	texture.targetMip = texture.tailMip;
+
+	m_textures.push_back(texture);
+	return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+float MipStreamer::GetRequiredMip(float texelsPerUnit, float pixelsPerUnit)
+{
+	if (pixelsPerUnit <= 0.0f)
+	{
+		return FLT_MAX;
+	}
+
+	float texelsPerPixel = texelsPerUnit / pixelsPerUnit;
+	return texelsPerPixel > 1.0f ? log2f(texelsPerPixel) : 0.0f;
+}
+
+uint64_t MipStreamer::GetResidentSize(uint32_t texture, uint32_t firstMip) const
+{
+	const MipStreamTexture& streamed = m_textures[texture];
+	return firstMip < streamed.mipCount ? streamed.chainSizes[firstMip] : 0;
+}
+
+void MipStreamer::BeginFrame()
+{
+	for (MipStreamTexture& texture : m_textures)
+	{
+		texture.requestedMip = texture.tailMip;
+	}
+}
+
+void MipStreamer::Request(uint32_t texture, float mip)
+{
+	MipStreamTexture& streamed = m_textures[texture];
+
+	// rounded to the finer level, a texel should never cover more than a pixel
+	uint32_t level = streamed.tailMip;
+	if (mip < static_cast<float>(streamed.tailMip))
+	{
+		level = mip > 0.0f ? static_cast<uint32_t>(mip) : 0;
+	}
+
+	if (level < streamed.requestedMip)
+	{
+		streamed.requestedMip = level;
+	}
+}
+
+void MipStreamer::Update(vector<MipStreamChange>& changes)
+{
+	changes.clear();
+	m_stats = {};
+
+	uint64_t targetBytes = 0;
+	for (MipStreamTexture& texture : m_textures)
+	{
+		texture.framesUnneeded = texture.residentMip < texture.requestedMip ? texture.framesUnneeded + 1 : 0;
+		texture.targetMip = texture.requestedMip;
+		targetBytes += texture.chainSizes[texture.targetMip];
+		m_stats.requestedBytes += texture.chainSizes[texture.requestedMip];
+	}
+
+	// coarsen the largest target level until the targets fit, the tails stay
+	while (targetBytes > m_budgetBytes)
+	{
+		MipStreamTexture* largest = nullptr;
+		uint64_t largestSize = 0;
+		for (MipStreamTexture& texture : m_textures)
+		{
+			if (texture.targetMip < texture.tailMip && GetLevelSize(texture, texture.targetMip) > largestSize)
+			{
+				largest = &texture;
+				largestSize = GetLevelSize(texture, texture.targetMip);
+			}
+		}
+
+		if (largest == nullptr)
+		{
+			break;
+		}
+
+		++largest->targetMip;
+		targetBytes -= largestSize;
+	}
+
+	// recently needed levels stay while what is left of the budget holds them
+	uint64_t slackBytes = targetBytes < m_budgetBytes ? m_budgetBytes - targetBytes : 0;
+	for (MipStreamTexture& texture : m_textures)
+	{
+		if (texture.residentMip < texture.targetMip && texture.framesUnneeded < MIP_STREAM_DROP_DELAY)
+		{
+			uint64_t keptBytes = texture.chainSizes[texture.residentMip] - texture.chainSizes[texture.targetMip];
+			if (keptBytes <= slackBytes)
+			{
+				texture.targetMip = texture.residentMip;
+				slackBytes -= keptBytes;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < m_textures.size(); ++i)
+	{
+		MipStreamTexture& texture = m_textures[i];
+		MipStreamChange change = { i, texture.residentMip, texture.residentMip };
+
+		if (texture.targetMip > texture.residentMip)
+		{
+			m_stats.droppedBytes += texture.chainSizes[texture.residentMip] - texture.chainSizes[texture.targetMip];
+			change.residentMip = texture.targetMip;
+		}
+		else if (texture.targetMip < texture.residentMip)
+		{
+			change.residentMip = texture.residentMip - 1;
+			m_stats.streamedInBytes += GetLevelSize(texture, change.residentMip);
+		}
+
+		if (change.residentMip != change.previousMip)
+		{
+			texture.residentMip = change.residentMip;
+			changes.push_back(change);
+		}
+
+		m_stats.residentBytes += texture.chainSizes[texture.residentMip];
+		if (texture.targetMip > texture.requestedMip)
+		{
+			++m_stats.texturesOverBudget;
+		}
+	}
+}
+
+uint32_t MipStreamer::GetTextureCount() const
+{
+	return static_cast<uint32_t>(m_textures.size());
+}
+
+const MipStreamTexture& MipStreamer::GetTexture(uint32_t texture) const
+{
+	return m_textures[texture];
+}
+
+const MipStreamStats& MipStreamer::GetStats() const
+{
+	return m_stats;
+}
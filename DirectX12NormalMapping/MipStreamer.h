@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "DdsFile.h"
+
+// levels up to this size in both dimensions are the tail, uploaded with the texture and never dropped
+const uint32_t MIP_STREAM_TAIL_SIZE = 64;
+// frames resident levels finer than needed are kept while the budget allows it, so they do not thrash
+const uint32_t MIP_STREAM_DROP_DELAY = 30;
+
+struct MipStreamTexture
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	uint32_t format;	// DDS_FORMAT_*
+	uint32_t tailMip;	// most detailed level of the tail
+	uint32_t residentMip;	// most detailed resident level, the coarser ones are resident as well
+	uint32_t requestedMip;	// needed this frame, the tail when nothing asked for the texture
+	uint32_t targetMip;	// the requested level, coarser when the budget is short
+	uint32_t framesUnneeded;	// the resident levels have been finer than requested for this many frames
+	uint64_t chainSizes[TEXTURE_FILE_MAX_MIPS];	// bytes from a level down to 1x1
+};
+
+// a texture whose resident levels changed, finer levels have to be uploaded or the finest ones released
+struct MipStreamChange
+{
+	uint32_t texture;
+	uint32_t previousMip;
+	uint32_t residentMip;
+};
+
+struct MipStreamStats
+{
+	uint64_t residentBytes;
+	uint64_t requestedBytes;	// with every texture at its requested level
+	uint64_t streamedInBytes;	// by the last Update
+	uint64_t droppedBytes;
+	uint32_t texturesOverBudget;	// left coarser than requested
+};
+
+// Decides which mip levels of the streamed textures are resident. Every frame
+// the renderer requests the level each texture needs from the screen space
+// size of what uses it, and Update fits the requests into the budget by
+// coarsening the largest levels first. Finer levels come in one per texture
+// per frame, levels that are no longer needed go once they have been unneeded
+// for MIP_STREAM_DROP_DELAY frames, or right away when the budget needs the
+// memory. Only the tails can take the resident size over the budget. Sizes
+// come from DdsFile.
+class MipStreamer
+{
+private:
+	uint64_t m_budgetBytes;
+	std::vector<MipStreamTexture> m_textures;
+	MipStreamStats m_stats;
+
+	uint64_t GetLevelSize(const MipStreamTexture& texture, uint32_t mip) const;
+
+public:
+	explicit MipStreamer(uint64_t budgetBytes);
+
+	void SetBudget(uint64_t budgetBytes);
+	uint64_t GetBudget() const;
+
+	// the texture starts with its tail resident, returns its index
+	uint32_t AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t format);
+	// the level at which one texel covers about one pixel, texelsPerUnit is the density of level 0
+	static float GetRequiredMip(float texelsPerUnit, float pixelsPerUnit);
+	// bytes of the levels from firstMip down to 1x1
+	uint64_t GetResidentSize(uint32_t texture, uint32_t firstMip) const;
+
+	void BeginFrame();	// every request goes back to the tail
+	void Request(uint32_t texture, float mip);	// of several requests the most detailed one is kept
+	void Update(std::vector<MipStreamChange>& changes);
+
+	uint32_t GetTextureCount() const;
+	const MipStreamTexture& GetTexture(uint32_t texture) const;
+	const MipStreamStats& GetStats() const;	// of the last Update
+};
@@ -0,0 +1,211 @@
+#include "MipStreamerTests.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cwchar>
+#include <functional>
+#include <vector>
+#include "MipStreamer.h"
+
+using std::function;
+using std::vector;
+
+namespace
+{
+	// a row of actors along +Z, each with a color, normal and ORM texture, seen by a camera looking down +Z
+	const uint32_t ACTOR_COUNT = 8;
+	const float ACTOR_SPACING = 20.0f;
+	const float ACTOR_RADIUS = 1.0f;
+	const float UV_PER_UNIT = 0.5f;	// texture coordinate units per world unit on the actor surfaces
+	const uint32_t TEXTURE_SIZE = 2048;
+	const uint32_t TEXTURE_FORMATS[] = { DDS_FORMAT_BC1_UNORM_SRGB, DDS_FORMAT_BC5_UNORM, DDS_FORMAT_B8G8R8A8_UNORM };
+	const uint32_t TEXTURES_PER_ACTOR = sizeof(TEXTURE_FORMATS) / sizeof(TEXTURE_FORMATS[0]);
+	const float VIEWPORT_HEIGHT = 600.0f;
+	const float FOV = 0.785f;
+	const uint64_t MB = 1024 * 1024;
+
+	struct CameraPath
+	{
+		const wchar_t* name;
+		uint64_t budgetBytes;
+		uint32_t frameCount;
+		function<float(uint32_t)> cameraZ;
+		// after every frame, with the frame index, returns false when the path's own expectation fails
+		function<bool(const MipStreamer&, uint32_t)> check;
+	};
+
+	// the pixels covered by one world unit at the nearest point of an actor, like Engine::SelectLod, 0 behind the camera
+	float GetPixelsPerUnit(float actorZ, float cameraZ)
+	{
+		if (actorZ + ACTOR_RADIUS < cameraZ)
+		{
+			return 0.0f;
+		}
+
+		float distance = actorZ - cameraZ - ACTOR_RADIUS;
+		return distance > 0.0f ? VIEWPORT_HEIGHT * 0.5f / (distance * tanf(FOV * 0.5f)) : FLT_MAX;
+	}
+
+	bool CheckFrame(const MipStreamer& streamer, const vector<MipStreamChange>& changes, uint64_t tailBytes)
+	{
+		const MipStreamStats& stats = streamer.GetStats();
+		bool passed = stats.residentBytes <= (streamer.GetBudget() > tailBytes ? streamer.GetBudget() : tailBytes);
+
+		for (uint32_t i = 0; i < streamer.GetTextureCount(); ++i)
+		{
+			const MipStreamTexture& texture = streamer.GetTexture(i);
+			passed = passed && texture.residentMip <= texture.tailMip && texture.residentMip >= texture.targetMip;
+			// levels finer than needed only stay for the drop delay
+			passed = passed && (texture.residentMip >= texture.requestedMip || texture.framesUnneeded < MIP_STREAM_DROP_DELAY);
+		}
+
+		for (const MipStreamChange& change : changes)
+		{
+			// one level comes in per frame
+			passed = passed && (change.residentMip > change.previousMip || change.previousMip - change.residentMip == 1);
+			passed = passed && streamer.GetTexture(change.texture).residentMip == change.residentMip;
+		}
+
+		return passed;
+	}
+
+	bool RunPath(const CameraPath& path)
+	{
+		MipStreamer streamer(path.budgetBytes);
+		uint64_t tailBytes = 0;
+		for (uint32_t actor = 0; actor < ACTOR_COUNT; ++actor)
+		{
+			for (uint32_t format : TEXTURE_FORMATS)
+			{
+				uint32_t texture = streamer.AddTexture(TEXTURE_SIZE, TEXTURE_SIZE, DdsFile::GetMaxMipCount(TEXTURE_SIZE, TEXTURE_SIZE), format);
+				tailBytes += streamer.GetResidentSize(texture, streamer.GetTexture(texture).tailMip);
+			}
+		}
+
+		vector<MipStreamChange> changes;
+		uint64_t streamedInBytes = 0;
+		uint64_t droppedBytes = 0;
+		uint64_t peakResidentBytes = 0;
+		uint32_t framesOverBudget = 0;
+		bool passed = true;
+
+		for (uint32_t frame = 0; frame < path.frameCount; ++frame)
+		{
+			const float cameraZ = path.cameraZ(frame);
+
+			streamer.BeginFrame();
+			for (uint32_t actor = 0; actor < ACTOR_COUNT; ++actor)
+			{
+				float pixelsPerUnit = GetPixelsPerUnit(actor * ACTOR_SPACING, cameraZ);
+				if (pixelsPerUnit == 0.0f)
+				{
+					continue;
+				}
+
+				for (uint32_t i = 0; i < TEXTURES_PER_ACTOR; ++i)
+				{
+					streamer.Request(actor * TEXTURES_PER_ACTOR + i, MipStreamer::GetRequiredMip(TEXTURE_SIZE * UV_PER_UNIT, pixelsPerUnit));
+				}
+			}
+			streamer.Update(changes);
+
+			const MipStreamStats& stats = streamer.GetStats();
+			streamedInBytes += stats.streamedInBytes;
+			droppedBytes += stats.droppedBytes;
+			peakResidentBytes = stats.residentBytes > peakResidentBytes ? stats.residentBytes : peakResidentBytes;
+			framesOverBudget += stats.texturesOverBudget > 0 ? 1 : 0;
+
+			passed = CheckFrame(streamer, changes, tailBytes) && path.check(streamer, frame) && passed;
+		}
+
+		wprintf(L"  %-32s %4u frames, %8.2f MB in, %8.2f MB dropped, peak %7.2f MB, %4u frames over budget %s\n", path.name,
+			path.frameCount, static_cast<double>(streamedInBytes) / MB, static_cast<double>(droppedBytes) / MB,
+			static_cast<double>(peakResidentBytes) / MB, framesOverBudget, passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	bool AllRequestedResident(const MipStreamer& streamer)
+	{
+		for (uint32_t i = 0; i < streamer.GetTextureCount(); ++i)
+		{
+			if (streamer.GetTexture(i).residentMip != streamer.GetTexture(i).requestedMip)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int RunMipStreamerTests()
+{
+	const uint64_t unlimited = ~0ull;
+	const float rowEnd = (ACTOR_COUNT - 1) * ACTOR_SPACING;
+	const uint32_t settleFrames = 60;	// longer than a full chain streaming in and the drop delay
+	const uint32_t flyByFrames = static_cast<uint32_t>(rowEnd + 50.0f) + settleFrames;
+	int failures = 0;
+
+	const vector<CameraPath> paths =
+	{
+		{ L"fly-by, unlimited budget", unlimited, flyByFrames,
+			[=](uint32_t frame) { return frame < flyByFrames - settleFrames ? frame - 50.0f : rowEnd - 10.0f; },
+			[=](const MipStreamer& streamer, uint32_t frame)
+			{
+				return streamer.GetStats().texturesOverBudget == 0 && (frame + 1 < flyByFrames || AllRequestedResident(streamer));
+			} },
+		{ L"fly-by, 16 MB budget", 16 * MB, flyByFrames,
+			[=](uint32_t frame) { return frame < flyByFrames - settleFrames ? frame - 50.0f : 5.0f; },
+			[](const MipStreamer&, uint32_t) { return true; } },
+		{ L"fly-by, tails only", 0, flyByFrames,
+			[=](uint32_t frame) { return frame - 50.0f; },
+			[](const MipStreamer& streamer, uint32_t)
+			{
+				bool tails = true;
+				for (uint32_t i = 0; i < streamer.GetTextureCount(); ++i)
+				{
+					tails = tails && streamer.GetTexture(i).residentMip == streamer.GetTexture(i).tailMip;
+				}
+				return tails;
+			} },
+		// crosses a mip boundary of the first actor back and forth faster than the drop delay
+		{ L"oscillating, unlimited budget", unlimited, 300,
+			[](uint32_t frame) { return (frame / 8) % 2 == 0 ? -9.0f : -15.0f; },
+			[](const MipStreamer& streamer, uint32_t frame) { return frame < 16 || streamer.GetStats().droppedBytes == 0; } },
+		// the first set needs level 0 but does not fit, its largest level gives way and the rest comes in
+		{ L"parked at the first actor, 24 MB", 24 * MB, 120,
+			[](uint32_t) { return -1.2f; },
+			[](const MipStreamer& streamer, uint32_t frame)
+			{
+				bool settled = streamer.GetStats().texturesOverBudget > 0 && streamer.GetStats().residentBytes > 12 * MB;
+				for (uint32_t i = 0; i < TEXTURES_PER_ACTOR; ++i)
+				{
+					settled = settled && streamer.GetTexture(i).residentMip == streamer.GetTexture(i).targetMip;
+				}
+				return frame + 1 < 120 || settled;
+			} },
+	};
+
+	for (const CameraPath& path : paths)
+	{
+		failures += RunPath(path) ? 0 : 1;
+	}
+
+	// the required level halves the detail with every doubling of the distance
+	bool mipsMatch = MipStreamer::GetRequiredMip(1024.0f, 1024.0f) == 0.0f && MipStreamer::GetRequiredMip(1024.0f, 2048.0f) == 0.0f &&
+		fabsf(MipStreamer::GetRequiredMip(1024.0f, 256.0f) - 2.0f) < 1e-5f && MipStreamer::GetRequiredMip(1024.0f, 0.0f) == FLT_MAX;
+	failures += mipsMatch ? 0 : 1;
+	wprintf(L"  required mip %s\n", mipsMatch ? L"ok" : L"FAILED");
+
+	// a block compressed tail starts at whole blocks, 1000 halves to 500 but not 250
+	MipStreamer streamer(0);
+	const uint32_t mipCount = DdsFile::GetMaxMipCount(1000, 1000);
+	bool tailsMatch = streamer.GetTexture(streamer.AddTexture(1000, 1000, mipCount, DDS_FORMAT_BC1_UNORM)).tailMip == 1 &&
+		streamer.GetTexture(streamer.AddTexture(1000, 1000, mipCount, DDS_FORMAT_B8G8R8A8_UNORM)).tailMip == 4 &&
+		streamer.GetTexture(streamer.AddTexture(TEXTURE_SIZE, TEXTURE_SIZE, DdsFile::GetMaxMipCount(TEXTURE_SIZE, TEXTURE_SIZE),
+			DDS_FORMAT_BC5_UNORM)).tailMip == 5;
+	failures += tailsMatch ? 0 : 1;
+	wprintf(L"  block compressed tail %s\n", tailsMatch ? L"ok" : L"FAILED");
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
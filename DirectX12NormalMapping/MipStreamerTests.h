@@ -0,0 +1,6 @@
+#pragma once
+
+// MipStreamer driven by simulated camera paths past rows of material sets,
+// checks the budget and residency rules every frame, prints every path and
+// returns 0 when all of them pass
+int RunMipStreamerTests();
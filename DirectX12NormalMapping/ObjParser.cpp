@@ -0,0 +1,646 @@
+#include "ObjParser.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace
+{
+	const size_t MIN_CHUNK_SIZE = 256 * 1024;
+	const UINT INVALID_INDEX = 0xffffffff;
+
+	// face corner flags
+	const UINT32 CORNER_RELATIVE_POSITION = 0x01;	// negative index, relative to the chunk
+	const UINT32 CORNER_RELATIVE_TEXCOORD = 0x02;
+	const UINT32 CORNER_RELATIVE_NORMAL = 0x04;
+	const UINT32 CORNER_HAS_TEXCOORD = 0x08;
+	const UINT32 CORNER_HAS_NORMAL = 0x10;
+
+	// powers of ten exactly representable as float
+	const float POWERS_OF_TEN[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	struct FaceCorner
+	{
+		INT32 position;
+		INT32 texCoord;
+		INT32 normal;
+		UINT32 flags;
+	};
+
+	struct ResolvedCorner
+	{
+		UINT position;
+		UINT texCoord;
+		UINT normal;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		vector<XMFLOAT3> positions;
+		vector<XMFLOAT2> texCoords;
+		vector<XMFLOAT3> normals;
+		vector<FaceCorner> corners;
+		vector<UINT> faceSizes;
+		size_t triangleCount;
+		bool failed;
+	};
+
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline bool IsLineEnd(char c)
+	{
+		return c == '\n' || c == '\r';
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline void SkipBlanks(const char*& cursor, const char* end)
+	{
+		while (cursor < end && IsBlank(*cursor))
+		{
+			++cursor;
+		}
+	}
+
+	inline void SkipLine(const char*& cursor, const char* end)
+	{
+		const char* lineEnd = reinterpret_cast<const char*>(memchr(cursor, '\n', end - cursor));
+		cursor = lineEnd != nullptr ? lineEnd + 1 : end;
+	}
+
+	// fallback for everything the fast path can't round exactly
+	bool ParseFloatSlow(const char*& cursor, const char* end, float& value)
+	{
+		char buffer[64];
+		size_t length = 0;
+		while (cursor + length < end && length < sizeof(buffer) - 1 &&
+			!IsBlank(cursor[length]) && !IsLineEnd(cursor[length]))
+		{
+			buffer[length] = cursor[length];
+			++length;
+		}
+		buffer[length] = '\0';
+
+		char* parsedEnd = nullptr;
+		value = strtof(buffer, &parsedEnd);
+		if (parsedEnd == buffer)
+		{
+			return false;
+		}
+
+		cursor += parsedEnd - buffer;
+		return true;
+	}
+
+	bool ParseFloat(const char*& cursor, const char* end, float& value)
+	{
+		SkipBlanks(cursor, end);
+
+		const char* p = cursor;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+
+		UINT64 mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+		bool truncated = false;
+
+		for (; p < end && IsDigit(*p); ++p)
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				significantDigits += mantissa != 0 ? 1 : 0;
+			}
+			else
+			{
+				++exponent;
+				truncated = true;
+			}
+		}
+
+		if (p < end && *p == '.')
+		{
+			++p;
+			for (; p < end && IsDigit(*p); ++p)
+			{
+				anyDigits = true;
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					significantDigits += mantissa != 0 ? 1 : 0;
+					--exponent;
+				}
+				else
+				{
+					truncated = true;
+				}
+			}
+		}
+
+		if (!anyDigits || (p < end && (*p == 'e' || *p == 'E')))
+		{
+			// nan, inf or exponent notation
+			return ParseFloatSlow(cursor, end, value);
+		}
+
+		// Clinger's fast path: the mantissa and the power of ten are exact
+		// floats, so a single rounding gives the correctly rounded result
+		if (truncated || mantissa > (1 << 24) || exponent < -10 || exponent > 10)
+		{
+			return ParseFloatSlow(cursor, end, value);
+		}
+
+		float result = static_cast<float>(mantissa);
+		result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+		value = negative ? -result : result;
+		cursor = p;
+		return true;
+	}
+
+	bool ParseInt(const char*& cursor, const char* end, INT64& value)
+	{
+		const char* p = cursor;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+
+		if (p >= end || !IsDigit(*p))
+		{
+			return false;
+		}
+
+		INT64 result = 0;
+		for (; p < end && IsDigit(*p); ++p)
+		{
+			result = result * 10 + (*p - '0');
+			if (result > 0xffffffffLL)
+			{
+				return false;
+			}
+		}
+
+		value = negative ? -result : result;
+		cursor = p;
+		return true;
+	}
+
+	// OBJ indices are 1-based, negative ones count back from the last element
+	bool ResolveRawIndex(INT64 raw, size_t chunkElementCount, INT32& index, UINT32& flags, UINT32 relativeFlag)
+	{
+		if (raw == 0)
+		{
+			return false;
+		}
+
+		if (raw > 0)
+		{
+			index = static_cast<INT32>(raw - 1);
+		}
+		else
+		{
+			index = static_cast<INT32>(static_cast<INT64>(chunkElementCount) + raw);
+			flags |= relativeFlag;
+		}
+
+		return true;
+	}
+
+	bool ParseFace(const char*& cursor, const char* end, ObjChunk& chunk)
+	{
+		UINT cornerCount = 0;
+
+		for (;;)
+		{
+			SkipBlanks(cursor, end);
+			if (cursor >= end || IsLineEnd(*cursor))
+			{
+				break;
+			}
+
+			FaceCorner corner = {};
+			INT64 raw;
+
+			if (!ParseInt(cursor, end, raw) ||
+				!ResolveRawIndex(raw, chunk.positions.size(), corner.position, corner.flags, CORNER_RELATIVE_POSITION))
+			{
+				return false;
+			}
+
+			if (cursor < end && *cursor == '/')
+			{
+				++cursor;
+				if (cursor < end && *cursor != '/')
+				{
+					if (!ParseInt(cursor, end, raw) ||
+						!ResolveRawIndex(raw, chunk.texCoords.size(), corner.texCoord, corner.flags, CORNER_RELATIVE_TEXCOORD))
+					{
+						return false;
+					}
+					corner.flags |= CORNER_HAS_TEXCOORD;
+				}
+
+				if (cursor < end && *cursor == '/')
+				{
+					++cursor;
+					if (!ParseInt(cursor, end, raw) ||
+						!ResolveRawIndex(raw, chunk.normals.size(), corner.normal, corner.flags, CORNER_RELATIVE_NORMAL))
+					{
+						return false;
+					}
+					corner.flags |= CORNER_HAS_NORMAL;
+				}
+			}
+
+			chunk.corners.push_back(corner);
+			++cornerCount;
+
+			// like WaveFrontReader, anything up to the next index or the line end is ignored
+			while (cursor < end && !IsLineEnd(*cursor) && !IsDigit(*cursor) && *cursor != '-' && *cursor != '+')
+			{
+				++cursor;
+			}
+		}
+
+		if (cornerCount < 3)
+		{
+			return false;
+		}
+
+		chunk.faceSizes.push_back(cornerCount);
+		chunk.triangleCount += cornerCount - 2;
+		return true;
+	}
+
+	void ParseChunk(ObjChunk& chunk)
+	{
+		const char* cursor = chunk.begin;
+		const char* end = chunk.end;
+
+		while (cursor < end)
+		{
+			SkipBlanks(cursor, end);
+			if (cursor + 1 >= end)
+			{
+				break;
+			}
+
+			bool succeeded = true;
+
+			if (cursor[0] == 'v' && IsBlank(cursor[1]))
+			{
+				cursor += 2;
+				XMFLOAT3 position;
+				succeeded = ParseFloat(cursor, end, position.x) &&
+					ParseFloat(cursor, end, position.y) &&
+					ParseFloat(cursor, end, position.z);
+				chunk.positions.push_back(position);
+			}
+			else if (cursor[0] == 'v' && cursor[1] == 't' && cursor + 2 < end && IsBlank(cursor[2]))
+			{
+				cursor += 3;
+				float u, v;
+				succeeded = ParseFloat(cursor, end, u) && ParseFloat(cursor, end, v);
+				chunk.texCoords.push_back(XMFLOAT2(u, 1.0f - v));
+			}
+			else if (cursor[0] == 'v' && cursor[1] == 'n' && cursor + 2 < end && IsBlank(cursor[2]))
+			{
+				cursor += 3;
+				XMFLOAT3 normal;
+				succeeded = ParseFloat(cursor, end, normal.x) &&
+					ParseFloat(cursor, end, normal.y) &&
+					ParseFloat(cursor, end, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (cursor[0] == 'f' && IsBlank(cursor[1]))
+			{
+				cursor += 2;
+				succeeded = ParseFace(cursor, end, chunk);
+			}
+
+			if (!succeeded)
+			{
+				chunk.failed = true;
+				return;
+			}
+
+			SkipLine(cursor, end);
+		}
+	}
+
+	bool ResolveIndex(INT32 index, bool relative, size_t chunkBase, size_t count, UINT& resolved)
+	{
+		INT64 absolute = relative ? static_cast<INT64>(chunkBase) + index : index;
+		if (absolute < 0 || absolute >= static_cast<INT64>(count))
+		{
+			return false;
+		}
+
+		resolved = static_cast<UINT>(absolute);
+		return true;
+	}
+}
+
+ObjParser::ObjParser(ThreadPool& threadPool)
+	: m_threadPool(threadPool)
+{
+}
+
+bool ObjParser::Load(const wchar_t* const fileName, vector<Vertex>& vertices, vector<DWORD>& indices)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+	{
+		return false;
+	}
+
+	return Parse(reinterpret_cast<const char*>(file.GetData()), static_cast<size_t>(file.GetSize()), vertices, indices);
+}
+
+bool ObjParser::Parse(const char* data, size_t size, vector<Vertex>& vertices, vector<DWORD>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	const UINT workerCount = m_threadPool.GetThreadCount() + 1;
+
+	// split into line aligned chunks
+	size_t chunkCount = size / MIN_CHUNK_SIZE;
+	chunkCount = chunkCount < workerCount * 4 ? chunkCount : workerCount * 4;
+	chunkCount = chunkCount > 0 ? chunkCount : 1;
+
+	vector<ObjChunk> chunks(chunkCount);
+	const char* dataEnd = data + size;
+	const char* chunkBegin = data;
+
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const char* chunkEnd = dataEnd;
+		if (i + 1 < chunkCount)
+		{
+			chunkEnd = data + size * (i + 1) / chunkCount;
+			chunkEnd = chunkEnd > chunkBegin ? chunkEnd : chunkBegin;
+			SkipLine(chunkEnd, dataEnd);
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunks[i].triangleCount = 0;
+		chunks[i].failed = false;
+		chunkBegin = chunkEnd;
+	}
+
+	m_threadPool.ParallelFor(static_cast<UINT>(chunkCount), [&chunks](UINT i)
+	{
+		ParseChunk(chunks[i]);
+	});
+
+	// element offsets of every chunk
+	vector<size_t> positionBase(chunkCount + 1, 0);
+	vector<size_t> texCoordBase(chunkCount + 1, 0);
+	vector<size_t> normalBase(chunkCount + 1, 0);
+	vector<size_t> cornerBase(chunkCount + 1, 0);
+	vector<size_t> triangleBase(chunkCount + 1, 0);
+
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		if (chunks[i].failed)
+		{
+			return false;
+		}
+
+		positionBase[i + 1] = positionBase[i] + chunks[i].positions.size();
+		texCoordBase[i + 1] = texCoordBase[i] + chunks[i].texCoords.size();
+		normalBase[i + 1] = normalBase[i] + chunks[i].normals.size();
+		cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+		triangleBase[i + 1] = triangleBase[i] + chunks[i].triangleCount;
+	}
+
+	const size_t positionCount = positionBase[chunkCount];
+	const size_t texCoordCount = texCoordBase[chunkCount];
+	const size_t normalCount = normalBase[chunkCount];
+	const size_t cornerCount = cornerBase[chunkCount];
+	const size_t triangleCount = triangleBase[chunkCount];
+
+	if (positionCount >= INVALID_INDEX || cornerCount >= INVALID_INDEX || triangleCount * 3 >= INVALID_INDEX)
+	{
+		return false;
+	}
+
+	// merge attributes and resolve corner indices to absolute ones
+	vector<XMFLOAT3> positions(positionCount);
+	vector<XMFLOAT2> texCoords(texCoordCount);
+	vector<XMFLOAT3> normals(normalCount);
+	vector<ResolvedCorner> corners(cornerCount);
+	atomic<bool> failed(false);
+
+	m_threadPool.ParallelFor(static_cast<UINT>(chunkCount), [&](UINT i)
+	{
+		const ObjChunk& chunk = chunks[i];
+		copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[i]);
+		copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + texCoordBase[i]);
+		copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[i]);
+
+		for (size_t c = 0; c < chunk.corners.size(); ++c)
+		{
+			const FaceCorner& corner = chunk.corners[c];
+			ResolvedCorner& resolved = corners[cornerBase[i] + c];
+			resolved.texCoord = INVALID_INDEX;
+			resolved.normal = INVALID_INDEX;
+
+			bool valid = ResolveIndex(corner.position, (corner.flags & CORNER_RELATIVE_POSITION) != 0,
+				positionBase[i], positionCount, resolved.position);
+
+			if (valid && (corner.flags & CORNER_HAS_TEXCOORD))
+			{
+				valid = ResolveIndex(corner.texCoord, (corner.flags & CORNER_RELATIVE_TEXCOORD) != 0,
+					texCoordBase[i], texCoordCount, resolved.texCoord);
+			}
+
+			if (valid && (corner.flags & CORNER_HAS_NORMAL))
+			{
+				valid = ResolveIndex(corner.normal, (corner.flags & CORNER_RELATIVE_NORMAL) != 0,
+					normalBase[i], normalCount, resolved.normal);
+			}
+
+			if (!valid)
+			{
+				failed = true;
+				return;
+			}
+		}
+	});
+
+	if (failed)
+	{
+		return false;
+	}
+
+	const XMFLOAT2 zeroTexCoord(0.0f, 0.0f);
+	const XMFLOAT3 zeroNormal(0.0f, 0.0f, 0.0f);
+
+	auto cornerTexCoord = [&](UINT c) -> const XMFLOAT2&
+	{
+		return corners[c].texCoord != INVALID_INDEX ? texCoords[corners[c].texCoord] : zeroTexCoord;
+	};
+
+	auto cornerNormal = [&](UINT c) -> const XMFLOAT3&
+	{
+		return corners[c].normal != INVALID_INDEX ? normals[corners[c].normal] : zeroNormal;
+	};
+
+	// Deduplicate like WaveFrontReader: corners sharing a position index are the
+	// same vertex when their attribute bits match. Every worker owns a range of
+	// position indices, so the per-position lists need no locking. The first
+	// corner with a given value becomes its representative.
+	vector<UINT> representative(cornerCount);
+	vector<UINT> nextRepresentative(cornerCount);
+	vector<UINT> firstRepresentative(positionCount, INVALID_INDEX);
+
+	// the range a position belongs to, ranges grow with the position index
+	auto positionRange = [&](UINT position) -> UINT
+	{
+		return static_cast<UINT>(static_cast<UINT64>(position) * workerCount / positionCount);
+	};
+
+	// counting sort of the corners by range, so a worker only reads its own corners: every
+	// worker counts a slice of the corners, then scatters them to where the prefix sum puts them
+	vector<UINT> rangeCounts(workerCount * workerCount, 0);	// slice * workerCount + range
+
+	m_threadPool.ParallelFor(workerCount, [&](UINT slice)
+	{
+		const UINT sliceBegin = static_cast<UINT>(cornerCount * slice / workerCount);
+		const UINT sliceEnd = static_cast<UINT>(cornerCount * (slice + 1) / workerCount);
+		UINT* counts = rangeCounts.data() + slice * workerCount;
+
+		for (UINT c = sliceBegin; c < sliceEnd; ++c)
+		{
+			++counts[positionRange(corners[c].position)];
+		}
+	});
+
+	// range by range, and slice by slice within a range, which keeps the corners of a range in order
+	vector<UINT> rangeBegin(workerCount + 1);
+	vector<UINT> sliceOffsets(workerCount * workerCount);
+	UINT offset = 0;
+	for (UINT range = 0; range < workerCount; ++range)
+	{
+		rangeBegin[range] = offset;
+		for (UINT slice = 0; slice < workerCount; ++slice)
+		{
+			sliceOffsets[slice * workerCount + range] = offset;
+			offset += rangeCounts[slice * workerCount + range];
+		}
+	}
+	rangeBegin[workerCount] = offset;
+
+	vector<UINT> rangeCorners(cornerCount);
+
+	m_threadPool.ParallelFor(workerCount, [&](UINT slice)
+	{
+		const UINT sliceBegin = static_cast<UINT>(cornerCount * slice / workerCount);
+		const UINT sliceEnd = static_cast<UINT>(cornerCount * (slice + 1) / workerCount);
+		UINT* offsets = sliceOffsets.data() + slice * workerCount;
+
+		for (UINT c = sliceBegin; c < sliceEnd; ++c)
+		{
+			rangeCorners[offsets[positionRange(corners[c].position)]++] = c;
+		}
+	});
+
+	m_threadPool.ParallelFor(workerCount, [&](UINT range)
+	{
+		for (UINT i = rangeBegin[range]; i < rangeBegin[range + 1]; ++i)
+		{
+			const UINT c = rangeCorners[i];
+			const UINT position = corners[c].position;
+			const XMFLOAT2& texCoord = cornerTexCoord(c);
+			const XMFLOAT3& normal = cornerNormal(c);
+
+			UINT r = firstRepresentative[position];
+			while (r != INVALID_INDEX &&
+				(memcmp(&cornerTexCoord(r), &texCoord, sizeof(XMFLOAT2)) != 0 ||
+					memcmp(&cornerNormal(r), &normal, sizeof(XMFLOAT3)) != 0))
+			{
+				r = nextRepresentative[r];
+			}
+
+			if (r == INVALID_INDEX)
+			{
+				nextRepresentative[c] = firstRepresentative[position];
+				firstRepresentative[position] = c;
+				r = c;
+			}
+
+			representative[c] = r;
+		}
+	});
+
+	// number the vertices in order of first use
+	vector<DWORD> cornerVertex(cornerCount);
+	for (UINT c = 0; c < cornerCount; ++c)
+	{
+		if (representative[c] == c)
+		{
+			cornerVertex[c] = static_cast<DWORD>(vertices.size());
+
+			Vertex vertex;
+			vertex.position = positions[corners[c].position];
+			vertex.normal = cornerNormal(c);
+			vertex.tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			vertex.textureCoordinate = cornerTexCoord(c);
+			vertices.push_back(vertex);
+		}
+		else
+		{
+			cornerVertex[c] = cornerVertex[representative[c]];
+		}
+	}
+
+	// triangulate polygons as fans
+	indices.resize(triangleCount * 3);
+
+	m_threadPool.ParallelFor(static_cast<UINT>(chunkCount), [&](UINT i)
+	{
+		size_t corner = cornerBase[i];
+		DWORD* output = indices.data() + triangleBase[i] * 3;
+
+		for (UINT faceSize : chunks[i].faceSizes)
+		{
+			DWORD i0 = cornerVertex[corner];
+			DWORD i1 = cornerVertex[corner + 1];
+
+			for (UINT j = 2; j < faceSize; ++j)
+			{
+				DWORD index = cornerVertex[corner + j];
+				*output++ = i0;
+				*output++ = i1;
+				*output++ = index;
+				i1 = index;
+			}
+
+			corner += faceSize;
+		}
+	});
+
+	return true;
+}
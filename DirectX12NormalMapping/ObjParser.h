@@ -0,0 +1,23 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <vector>
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+// Wavefront OBJ loader producing the same vertices and indices as
+// WaveFrontReader<DWORD>::Load (ccw), but parsing line-aligned chunks of the
+// memory mapped file in parallel. Tangents are left zeroed.
+class ObjParser
+{
+private:
+	ThreadPool& m_threadPool;
+
+public:
+	explicit ObjParser(ThreadPool& threadPool);
+
+	bool Load(const wchar_t* const fileName, std::vector<Vertex>& vertices, std::vector<DWORD>& indices);
+	bool Parse(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<DWORD>& indices);
+};
@@ -0,0 +1,47 @@
+#include "OrmPacker.h"
+
+namespace
+{
+	const UINT SOURCE_CHANNEL = 2;	// red of the grey sources
+	const BYTE FULL_SPECULAR = 255;
+}
+
+void OrmPacker::Pack(const BYTE* occlusion, const BYTE* roughness, const BYTE* specular, size_t texelCount, BYTE* orm)
+{
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		// read before writing, orm may alias a source
+		const BYTE occlusionValue = occlusion[i * 4 + SOURCE_CHANNEL];
+		const BYTE roughnessValue = roughness[i * 4 + SOURCE_CHANNEL];
+		const BYTE specularValue = specular != nullptr ? specular[i * 4 + SOURCE_CHANNEL] : FULL_SPECULAR;
+
+		orm[i * 4 + ORM_OCCLUSION_CHANNEL] = occlusionValue;
+		orm[i * 4 + ORM_ROUGHNESS_CHANNEL] = roughnessValue;
+		orm[i * 4 + ORM_SPECULAR_CHANNEL] = specularValue;
+		orm[i * 4 + 3] = 255;
+	}
+}
+
+void OrmPacker::Compare(const BYTE* occlusion, const BYTE* roughness, const BYTE* specular, const BYTE* orm, size_t texelCount,
+	OrmChannelError errors[ORM_CHANNEL_COUNT])
+{
+	const BYTE* sources[ORM_CHANNEL_COUNT] = { occlusion, roughness, specular };
+	const UINT channels[ORM_CHANNEL_COUNT] = { ORM_OCCLUSION_CHANNEL, ORM_ROUGHNESS_CHANNEL, ORM_SPECULAR_CHANNEL };
+
+	for (UINT c = 0; c < ORM_CHANNEL_COUNT; ++c)
+	{
+		int maxError = 0;
+		double squaredError = 0.0;
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			const int expected = sources[c] != nullptr ? sources[c][i * 4 + SOURCE_CHANNEL] : FULL_SPECULAR;
+			const int difference = orm[i * 4 + channels[c]] - expected;
+			const int absoluteDifference = difference < 0 ? -difference : difference;
+			maxError = absoluteDifference > maxError ? absoluteDifference : maxError;
+			squaredError += static_cast<double>(difference) * difference;
+		}
+
+		errors[c].maxError = maxError;
+		errors[c].meanSquaredError = texelCount > 0 ? squaredError / texelCount : 0.0;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+
+// BGRA byte offsets of the channels in the packed texture, the shader reads them as .r, .g and .b
+const UINT ORM_OCCLUSION_CHANNEL = 2;
+const UINT ORM_ROUGHNESS_CHANNEL = 1;
+const UINT ORM_SPECULAR_CHANNEL = 0;
+const UINT ORM_CHANNEL_COUNT = 3;
+
+struct OrmChannelError
+{
+	int maxError;
+	double meanSquaredError;
+};
+
+// Packs grey occlusion, roughness and specular images into one BGRA8 texture
+// so the pixel shader fetches all three with one sample. The sources are
+// BGRA8 as well, their red channel is taken.
+class OrmPacker
+{
+public:
+	// specular can be null for a full specular channel, orm can be one of the sources
+	static void Pack(const BYTE* occlusion, const BYTE* roughness, const BYTE* specular, size_t texelCount, BYTE* orm);
+	// per packed channel in the order occlusion, roughness, specular
+	static void Compare(const BYTE* occlusion, const BYTE* roughness, const BYTE* specular, const BYTE* orm, size_t texelCount,
+		OrmChannelError errors[ORM_CHANNEL_COUNT]);
+};
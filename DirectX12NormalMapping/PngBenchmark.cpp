@@ -0,0 +1,138 @@
+#include "PngBenchmark.h"
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include "PngDecoder.h"
+
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace
+{
+	// relative to the project directory, like the textures the engine loads
+	const char* const SHIPPED_TEXTURES[] = { "Assets/color.png", "Assets/normal.png", "Assets/oclussion.png", "Assets/roughness.png" };
+
+	double ElapsedMs(high_resolution_clock::time_point start)
+	{
+		return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+
+	bool ReadFile(const string& fileName, vector<uint8_t>& data)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	// FNV-1a, to compare the pixels with other decoders
+	uint32_t HashPixels(const uint8_t* pixels, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ pixels[i]) * 16777619u;
+		}
+		return hash;
+	}
+}
+
+int RunPngBenchmark(const vector<string>& fileNames, int iterations)
+{
+	const vector<string> files = fileNames.empty() ?
+		vector<string>(std::begin(SHIPPED_TEXTURES), std::end(SHIPPED_TEXTURES)) : fileNames;
+	const PngKernel kernels[] = { PngKernel::Scalar, PngKernel::Sse };
+	bool allMatch = true;
+
+	printf("best of %d\n", iterations);
+	for (const string& fileName : files)
+	{
+		vector<uint8_t> data;
+		if (!ReadFile(fileName, data))
+		{
+			printf("%s: cannot be read\n", fileName.c_str());
+			allMatch = false;
+			continue;
+		}
+
+		unique_ptr<uint8_t[]> reference;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		for (PngKernel kernel : kernels)
+		{
+			unique_ptr<uint8_t[]> pixels;
+			PngDecodeTimes bestTimes = { DBL_MAX, DBL_MAX, DBL_MAX };
+			double bestMs = DBL_MAX;
+			for (int i = 0; i < iterations; ++i)
+			{
+				PngDecodeTimes times;
+				high_resolution_clock::time_point start = high_resolution_clock::now();
+				pixels = PngDecoder::Decode(data.data(), data.size(), width, height, kernel, &times);
+				double ms = ElapsedMs(start);
+				if (!pixels)
+				{
+					break;
+				}
+
+				bestMs = ms < bestMs ? ms : bestMs;
+				bestTimes.chunkMs = times.chunkMs < bestTimes.chunkMs ? times.chunkMs : bestTimes.chunkMs;
+				bestTimes.inflateMs = times.inflateMs < bestTimes.inflateMs ? times.inflateMs : bestTimes.inflateMs;
+				bestTimes.unfilterMs = times.unfilterMs < bestTimes.unfilterMs ? times.unfilterMs : bestTimes.unfilterMs;
+			}
+
+			if (!pixels)
+			{
+				printf("%s: not decoded\n", fileName.c_str());
+				allMatch = false;
+				break;
+			}
+
+			const size_t size = static_cast<size_t>(width) * height * 4;
+			if (!reference)
+			{
+				printf("%s: %ux%u, %.2f MB, pixel hash %08x\n", fileName.c_str(), width, height, data.size() / (1024.0 * 1024.0),
+					HashPixels(pixels.get(), size));
+			}
+
+			bool match = !reference || memcmp(pixels.get(), reference.get(), size) == 0;
+			allMatch = allMatch && match;
+
+			printf("  %-6s %8.3f ms %8.2f MPixel/s %8.2f MB/s in (chunks %.3f, inflate %.3f, unfilter %.3f) %s\n",
+				PngDecoder::GetKernelName(kernel), bestMs, static_cast<double>(width) * height / 1e6 / (bestMs / 1000.0),
+				data.size() / (1024.0 * 1024.0) / (bestMs / 1000.0), bestTimes.chunkMs, bestTimes.inflateMs,
+				bestTimes.unfilterMs, match ? "ok" : "MISMATCH");
+
+			if (!reference)
+			{
+				reference = std::move(pixels);
+			}
+		}
+	}
+
+	return allMatch ? 0 : -1;
+}
+
+#ifdef PNG_BENCHMARK_MAIN
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 10;
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	return RunPngBenchmark(vector<string>(argv + (argc > 2 ? 2 : argc), argv + argc), iterations);
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Decodes every file with both PngDecoder kernels, prints the best time of the
+// iterations per stage and checks that the kernels give the same pixels, the
+// shipped textures when no files are given. Returns 0 when every file decoded
+// and matched. Platform independent, it builds on its own on other systems:
+//   g++ -std=c++14 -O2 -DPNG_BENCHMARK_MAIN PngDecoder.cpp PngBenchmark.cpp -o png-bench
+//   ./png-bench [iterations] [file.png ...]
+int RunPngBenchmark(const std::vector<std::string>& fileNames, int iterations);
@@ -0,0 +1,1207 @@
+#include "PngDecoder.h"
+#include <emmintrin.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+using std::unique_ptr;
+using std::vector;
+
+namespace
+{
+	const uint8_t PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	const uint32_t MAX_IMAGE_SIZE = 16384;	// the largest 2D texture D3D12 takes
+
+	enum ColorType
+	{
+		COLOR_GREY = 0,
+		COLOR_RGB = 2,
+		COLOR_PALETTE = 3,
+		COLOR_GREY_ALPHA = 4,
+		COLOR_RGBA = 6
+	};
+
+	enum FilterType
+	{
+		FILTER_NONE = 0,
+		FILTER_SUB = 1,
+		FILTER_UP = 2,
+		FILTER_AVERAGE = 3,
+		FILTER_PAETH = 4
+	};
+
+	// inflate, codes up to FAST_BITS long are looked up in one step
+	const int FAST_BITS = 10;
+	const uint32_t FAST_MASK = (1 << FAST_BITS) - 1;
+	const int MAX_CODE_LENGTH = 15;
+
+	const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+		131, 163, 195, 227, 258 };
+	const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+		2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12,
+		13, 13 };
+	const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	double ElapsedMs(high_resolution_clock::time_point start)
+	{
+		return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+
+	uint32_t ReadBigEndian32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 |
+			static_cast<uint32_t>(data[2]) << 8 | data[3];
+	}
+
+	uint32_t ReadBigEndian16(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 8 | data[1];
+	}
+
+	uint32_t ReverseBits(uint32_t bits, int count)
+	{
+		bits = ((bits & 0xAAAA) >> 1) | ((bits & 0x5555) << 1);
+		bits = ((bits & 0xCCCC) >> 2) | ((bits & 0x3333) << 2);
+		bits = ((bits & 0xF0F0) >> 4) | ((bits & 0x0F0F) << 4);
+		bits = ((bits & 0xFF00) >> 8) | ((bits & 0x00FF) << 8);
+		return bits >> (16 - count);
+	}
+
+	// canonical Huffman code, deflate sends the codes starting with their lowest bit
+	struct HuffmanTable
+	{
+		uint16_t fast[1 << FAST_BITS];	// length << 9 | symbol by the next FAST_BITS bits, 0 for longer codes
+		uint32_t maxCode[MAX_CODE_LENGTH + 2];	// one past the last code of every length, left aligned to 16 bits
+		uint16_t firstCode[MAX_CODE_LENGTH + 1];
+		uint16_t firstSymbol[MAX_CODE_LENGTH + 1];
+		uint16_t symbols[288];
+	};
+
+	bool BuildHuffmanTable(HuffmanTable& table, const uint8_t* lengths, int symbolCount)
+	{
+		int counts[MAX_CODE_LENGTH + 1] = {};
+		for (int i = 0; i < symbolCount; ++i)
+		{
+			++counts[lengths[i]];
+		}
+		counts[0] = 0;
+
+		uint32_t nextCode[MAX_CODE_LENGTH + 1] = {};
+		uint32_t code = 0;
+		uint32_t symbol = 0;
+		for (int length = 1; length <= MAX_CODE_LENGTH; ++length)
+		{
+			nextCode[length] = code;
+			table.firstCode[length] = static_cast<uint16_t>(code);
+			table.firstSymbol[length] = static_cast<uint16_t>(symbol);
+			code += counts[length];
+			if (counts[length] != 0 && code - 1 >= (1u << length))
+			{
+				return false;	// oversubscribed
+			}
+
+			table.maxCode[length] = code << (16 - length);
+			code <<= 1;
+			symbol += counts[length];
+		}
+		table.maxCode[MAX_CODE_LENGTH + 1] = 0x10000;
+
+		memset(table.fast, 0, sizeof(table.fast));
+		for (int i = 0; i < symbolCount; ++i)
+		{
+			const int length = lengths[i];
+			if (length == 0)
+			{
+				continue;
+			}
+
+			table.symbols[nextCode[length] - table.firstCode[length] + table.firstSymbol[length]] = static_cast<uint16_t>(i);
+			if (length <= FAST_BITS)
+			{
+				const uint16_t entry = static_cast<uint16_t>(length << 9 | i);
+				for (uint32_t j = ReverseBits(nextCode[length], length); j < (1u << FAST_BITS); j += 1u << length)
+				{
+					table.fast[j] = entry;
+				}
+			}
+			++nextCode[length];
+		}
+		return true;
+	}
+
+	struct FixedHuffmanTables
+	{
+		HuffmanTable literals;
+		HuffmanTable distances;
+
+		FixedHuffmanTables()
+		{
+			uint8_t lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			BuildHuffmanTable(literals, lengths, 288);
+
+			memset(lengths, 5, 30);
+			BuildHuffmanTable(distances, lengths, 30);
+		}
+	};
+
+	const FixedHuffmanTables& GetFixedHuffmanTables()
+	{
+		static const FixedHuffmanTables tables;
+		return tables;
+	}
+
+	// little endian bit buffer, reads 8 bytes at a time and zeros past the end of the data
+	struct BitReader
+	{
+		const uint8_t* next;
+		const uint8_t* end;
+		uint64_t buffer;	// the bits above bitCount are either 0 or the bits of the following bytes
+		uint32_t bitCount;
+		size_t paddingBytes;	// zeros read past the end
+
+		BitReader(const uint8_t* data, const uint8_t* dataEnd)
+			: next(data), end(dataEnd), buffer(0), bitCount(0), paddingBytes(0)
+		{
+		}
+
+		// at least 56 bits afterwards
+		inline void Refill()
+		{
+			if (end - next >= 8)
+			{
+				uint64_t word;
+				memcpy(&word, next, sizeof(word));
+				buffer |= word << bitCount;
+				next += (63 - bitCount) >> 3;
+				bitCount |= 56;
+				return;
+			}
+
+			while (bitCount <= 56)
+			{
+				uint64_t byte = 0;
+				if (next < end)
+				{
+					byte = *next++;
+				}
+				else
+				{
+					++paddingBytes;
+				}
+				buffer |= byte << bitCount;
+				bitCount += 8;
+			}
+		}
+
+		inline uint32_t Bits(uint32_t count)
+		{
+			const uint32_t bits = static_cast<uint32_t>(buffer & ((1ull << count) - 1));
+			buffer >>= count;
+			bitCount -= count;
+			return bits;
+		}
+
+		// -1 for a code the table does not have, needs 15 bits in the buffer
+		inline int DecodeSymbol(const HuffmanTable& table)
+		{
+			const uint32_t entry = table.fast[buffer & FAST_MASK];
+			if (entry != 0)
+			{
+				const uint32_t length = entry >> 9;
+				buffer >>= length;
+				bitCount -= length;
+				return entry & 511;
+			}
+
+			const uint32_t code = ReverseBits(static_cast<uint32_t>(buffer & 0xFFFF), 16);
+			int length = FAST_BITS + 1;
+			while (code >= table.maxCode[length])
+			{
+				++length;
+			}
+			if (length > MAX_CODE_LENGTH)
+			{
+				return -1;
+			}
+
+			buffer >>= length;
+			bitCount -= length;
+			return table.symbols[(code >> (16 - length)) - table.firstCode[length] + table.firstSymbol[length]];
+		}
+	};
+
+	bool InflateStoredBlock(BitReader& reader, uint8_t* output, size_t& position, size_t outputSize)
+	{
+		reader.Bits(reader.bitCount & 7);
+		reader.Refill();
+		uint32_t length = reader.Bits(16);
+		const uint32_t inverse = reader.Bits(16);
+		if (length != (~inverse & 0xFFFF) || length > outputSize - position)
+		{
+			return false;
+		}
+
+		// what the bit buffer already holds, then straight from the data
+		for (; length > 0 && reader.bitCount >= 8; --length)
+		{
+			output[position++] = static_cast<uint8_t>(reader.Bits(8));
+		}
+		if (length > 0)
+		{
+			if (static_cast<size_t>(reader.end - reader.next) < length)
+			{
+				return false;
+			}
+
+			memcpy(output + position, reader.next, length);
+			reader.next += length;
+			reader.buffer = 0;
+			position += length;
+		}
+		return true;
+	}
+
+	bool InflateHuffmanBlock(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances, uint8_t* output,
+		size_t& position, size_t outputSize)
+	{
+		uint8_t* out = output + position;
+		uint8_t* const outEnd = output + outputSize;
+		for (;;)
+		{
+			// enough for a literal or length code, its extra bits, a distance code and its extra bits
+			reader.Refill();
+			int symbol = reader.DecodeSymbol(literals);
+			if (symbol < 256)
+			{
+				if (symbol < 0 || out == outEnd)
+				{
+					return false;
+				}
+
+				*out++ = static_cast<uint8_t>(symbol);
+				// a second literal while the buffer still holds a whole code
+				symbol = reader.DecodeSymbol(literals);
+				if (symbol < 256)
+				{
+					if (symbol < 0 || out == outEnd)
+					{
+						return false;
+					}
+
+					*out++ = static_cast<uint8_t>(symbol);
+					continue;
+				}
+				reader.Refill();
+			}
+			if (symbol == 256)
+			{
+				break;
+			}
+
+			symbol -= 257;
+			if (symbol >= 29)
+			{
+				return false;
+			}
+			const size_t length = LENGTH_BASE[symbol] + reader.Bits(LENGTH_EXTRA[symbol]);
+
+			const int distanceSymbol = reader.DecodeSymbol(distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+			{
+				return false;
+			}
+			const size_t distance = DISTANCE_BASE[distanceSymbol] + reader.Bits(DISTANCE_EXTRA[distanceSymbol]);
+			if (distance > static_cast<size_t>(out - output) || length > static_cast<size_t>(outEnd - out))
+			{
+				return false;
+			}
+
+			const uint8_t* source = out - distance;
+			if (distance >= 8 && static_cast<size_t>(outEnd - out) >= length + 8)
+			{
+				// 8 bytes at a time, every chunk reads bytes written before it
+				uint8_t* const copyEnd = out + length;
+				do
+				{
+					memcpy(out, source, 8);
+					out += 8;
+					source += 8;
+				} while (out < copyEnd);
+				out = copyEnd;
+			}
+			else if (distance == 1)
+			{
+				memset(out, out[-1], length);
+				out += length;
+			}
+			else
+			{
+				for (size_t i = 0; i < length; ++i)
+				{
+					out[i] = source[i];
+				}
+				out += length;
+			}
+		}
+
+		position = out - output;
+		return true;
+	}
+
+	bool InflateDynamicBlock(BitReader& reader, uint8_t* output, size_t& position, size_t outputSize)
+	{
+		reader.Refill();
+		const int literalCount = reader.Bits(5) + 257;
+		const int distanceCount = reader.Bits(5) + 1;
+		const int codeLengthCount = reader.Bits(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+		{
+			return false;
+		}
+
+		uint8_t codeLengthLengths[19] = {};
+		for (int i = 0; i < codeLengthCount; ++i)
+		{
+			reader.Refill();
+			codeLengthLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.Bits(3));
+		}
+
+		HuffmanTable codeLengths;
+		if (!BuildHuffmanTable(codeLengths, codeLengthLengths, 19))
+		{
+			return false;
+		}
+
+		// the literal and distance code lengths are one sequence, repeats can cross from one to the other
+		uint8_t lengths[286 + 30];
+		const int totalCount = literalCount + distanceCount;
+		for (int count = 0; count < totalCount;)
+		{
+			reader.Refill();
+			const int symbol = reader.DecodeSymbol(codeLengths);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 16)
+			{
+				lengths[count++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t value = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (count == 0)
+				{
+					return false;
+				}
+				value = lengths[count - 1];
+				repeat = 3 + reader.Bits(2);
+			}
+			else if (symbol == 17)
+			{
+				repeat = 3 + reader.Bits(3);
+			}
+			else
+			{
+				repeat = 11 + reader.Bits(7);
+			}
+
+			if (repeat > totalCount - count)
+			{
+				return false;
+			}
+			memset(lengths + count, value, repeat);
+			count += repeat;
+		}
+
+		if (lengths[256] == 0)
+		{
+			return false;
+		}
+
+		HuffmanTable literals;
+		HuffmanTable distances;
+		if (!BuildHuffmanTable(literals, lengths, literalCount) ||
+			!BuildHuffmanTable(distances, lengths + literalCount, distanceCount))
+		{
+			return false;
+		}
+
+		return InflateHuffmanBlock(reader, literals, distances, output, position, outputSize);
+	}
+
+	// a zlib stream that has to fill output exactly
+	bool Inflate(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize)
+	{
+		// deflate with a window of up to 32K and no preset dictionary
+		if (size < 2 || (data[0] & 15) != 8 || (data[0] >> 4) > 7 || ReadBigEndian16(data) % 31 != 0 || (data[1] & 32) != 0)
+		{
+			return false;
+		}
+
+		BitReader reader(data + 2, data + size);
+		size_t position = 0;
+		bool lastBlock = false;
+		while (!lastBlock)
+		{
+			reader.Refill();
+			lastBlock = reader.Bits(1) != 0;
+			const uint32_t blockType = reader.Bits(2);
+
+			bool inflated;
+			switch (blockType)
+			{
+			case 0:
+				inflated = InflateStoredBlock(reader, output, position, outputSize);
+				break;
+			case 1:
+				inflated = InflateHuffmanBlock(reader, GetFixedHuffmanTables().literals, GetFixedHuffmanTables().distances, output,
+					position, outputSize);
+				break;
+			case 2:
+				inflated = InflateDynamicBlock(reader, output, position, outputSize);
+				break;
+			default:
+				inflated = false;
+				break;
+			}
+
+			if (!inflated)
+			{
+				return false;
+			}
+		}
+
+		// the zeros past the end must not have been used
+		return position == outputSize && reader.paddingBytes * 8 <= reader.bitCount;
+	}
+
+	struct PngImage
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t bitDepth;
+		uint32_t colorType;
+		uint32_t channels;
+		size_t rowBytes;	// without the filter type byte
+		uint32_t filterStride;	// bytes between a byte and the one it is predicted from, at least 1
+		uint32_t palette[256];	// BGRA
+		bool colorKey;	// tRNS for grey and RGB, pixels of exactly this color are transparent
+		uint32_t keyRed;	// the grey value for grey images
+		uint32_t keyGreen;
+		uint32_t keyBlue;
+	};
+
+	uint8_t PaethPredictor(int a, int b, int c)
+	{
+		const int pa = abs(b - c);
+		const int pb = abs(a - c);
+		const int pc = abs(a + b - 2 * c);
+		// without branches, the order of preference on ties is a, b, c
+		const int nearest = pb < pa ? b : a;
+		const int nearestDistance = pb < pa ? pb : pa;
+		return static_cast<uint8_t>(pc < nearestDistance ? c : nearest);
+	}
+
+	void UnfilterRowScalar(uint32_t filter, uint8_t* row, const uint8_t* above, size_t rowBytes, uint32_t stride)
+	{
+		switch (filter)
+		{
+		case FILTER_SUB:
+			for (size_t i = stride; i < rowBytes; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+			}
+			break;
+		case FILTER_UP:
+			for (size_t i = 0; i < rowBytes; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + above[i]);
+			}
+			break;
+		case FILTER_AVERAGE:
+			for (size_t i = 0; i < stride; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + (above[i] >> 1));
+			}
+			for (size_t i = stride; i < rowBytes; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + ((row[i - stride] + above[i]) >> 1));
+			}
+			break;
+		case FILTER_PAETH:
+			for (size_t i = 0; i < stride; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + above[i]);
+			}
+			for (size_t i = stride; i < rowBytes; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + PaethPredictor(row[i - stride], above[i], above[i - stride]));
+			}
+			break;
+		}
+	}
+
+	// a pixel of up to 8 bytes in the low bytes of a register
+	template <uint32_t Stride>
+	inline __m128i LoadPixel(const uint8_t* source)
+	{
+		uint64_t pixel = 0;
+		memcpy(&pixel, source, Stride);
+		return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&pixel));
+	}
+
+	template <uint32_t Stride>
+	inline void StorePixel(uint8_t* destination, __m128i value)
+	{
+		uint64_t pixel;
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(&pixel), value);
+		memcpy(destination, &pixel, Stride);
+	}
+
+	inline __m128i Select(__m128i mask, __m128i ifSet, __m128i ifClear)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, ifSet), _mm_andnot_si128(mask, ifClear));
+	}
+
+	inline __m128i Abs16(__m128i value)
+	{
+		return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+	}
+
+	// the running sum of every stride-th byte over 16 bytes
+	template <uint32_t Stride>
+	void UnfilterSubSse(uint8_t* row, size_t rowBytes)
+	{
+		__m128i carry = _mm_setzero_si128();	// the last pixel of the previous 16 bytes in every pixel
+		size_t i = 0;
+		for (; i + 16 <= rowBytes; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, Stride));
+			if (Stride < 8)
+			{
+				x = _mm_add_epi8(x, _mm_slli_si128(x, Stride * 2 < 16 ? Stride * 2 : 0));
+			}
+			if (Stride < 4)
+			{
+				x = _mm_add_epi8(x, _mm_slli_si128(x, Stride * 4 < 16 ? Stride * 4 : 0));
+			}
+			if (Stride < 2)
+			{
+				x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+			}
+			x = _mm_add_epi8(x, carry);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), x);
+
+			switch (Stride)
+			{
+			case 1:
+				carry = _mm_unpackhi_epi8(x, x);
+				carry = _mm_shufflehi_epi16(carry, 0xFF);
+				carry = _mm_shuffle_epi32(carry, 0xFF);
+				break;
+			case 2:
+				carry = _mm_shuffle_epi32(_mm_shufflehi_epi16(x, 0xFF), 0xFF);
+				break;
+			case 4:
+				carry = _mm_shuffle_epi32(x, 0xFF);
+				break;
+			default:
+				carry = _mm_unpackhi_epi64(x, x);
+				break;
+			}
+		}
+
+		for (i = i > 0 ? i : Stride; i < rowBytes; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + row[i - Stride]);
+		}
+	}
+
+	// Average and Paeth depend on the pixel before, the channels of a pixel run side by side
+	template <uint32_t Stride>
+	void UnfilterAverageSse(uint8_t* row, const uint8_t* above, size_t rowBytes)
+	{
+		// the rounded down average from the rounded up one
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i a = _mm_setzero_si128();
+		for (size_t i = 0; i < rowBytes; i += Stride)
+		{
+			const __m128i b = LoadPixel<Stride>(above + i);
+			const __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(LoadPixel<Stride>(row + i), average);
+			StorePixel<Stride>(row + i, a);
+		}
+	}
+
+	// in 16 bit lanes, the pixel to the left, above and above left
+	template <uint32_t Stride>
+	void UnfilterPaethSse(uint8_t* row, const uint8_t* above, size_t rowBytes)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = zero;
+		__m128i c = zero;
+		for (size_t i = 0; i < rowBytes; i += Stride)
+		{
+			const __m128i b = _mm_unpacklo_epi8(LoadPixel<Stride>(above + i), zero);
+			const __m128i bc = _mm_sub_epi16(b, c);
+			const __m128i ac = _mm_sub_epi16(a, c);
+			const __m128i pa = Abs16(bc);
+			const __m128i pb = Abs16(ac);
+			const __m128i pc = Abs16(_mm_add_epi16(bc, ac));
+			const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+			__m128i nearest = Select(_mm_cmpeq_epi16(pb, smallest), b, c);
+			nearest = Select(_mm_cmpeq_epi16(pa, smallest), a, nearest);
+
+			const __m128i x = _mm_add_epi8(LoadPixel<Stride>(row + i), _mm_packus_epi16(nearest, nearest));
+			StorePixel<Stride>(row + i, x);
+			a = _mm_unpacklo_epi8(x, zero);
+			c = b;
+		}
+	}
+
+	void UnfilterRowSse(uint32_t filter, uint8_t* row, const uint8_t* above, size_t rowBytes, uint32_t stride)
+	{
+		// Sub is a running sum for the power of two strides, Average and Paeth take a pixel per iteration,
+		// the grey images with their 1 and 2 byte pixels are left to the scalar code
+		if (filter == FILTER_SUB && (stride == 1 || stride == 2 || stride == 4 || stride == 8))
+		{
+			switch (stride)
+			{
+			case 1:
+				UnfilterSubSse<1>(row, rowBytes);
+				break;
+			case 2:
+				UnfilterSubSse<2>(row, rowBytes);
+				break;
+			case 4:
+				UnfilterSubSse<4>(row, rowBytes);
+				break;
+			default:
+				UnfilterSubSse<8>(row, rowBytes);
+				break;
+			}
+			return;
+		}
+
+		if (filter == FILTER_UP)
+		{
+			size_t i = 0;
+			for (; i + 16 <= rowBytes; i += 16)
+			{
+				const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+				const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+			}
+			for (; i < rowBytes; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + above[i]);
+			}
+			return;
+		}
+
+		if (filter == FILTER_AVERAGE)
+		{
+			switch (stride)
+			{
+			case 3:
+				UnfilterAverageSse<3>(row, above, rowBytes);
+				return;
+			case 4:
+				UnfilterAverageSse<4>(row, above, rowBytes);
+				return;
+			case 6:
+				UnfilterAverageSse<6>(row, above, rowBytes);
+				return;
+			case 8:
+				UnfilterAverageSse<8>(row, above, rowBytes);
+				return;
+			}
+		}
+		else if (filter == FILTER_PAETH)
+		{
+			switch (stride)
+			{
+			case 3:
+				UnfilterPaethSse<3>(row, above, rowBytes);
+				return;
+			case 4:
+				UnfilterPaethSse<4>(row, above, rowBytes);
+				return;
+			case 6:
+				UnfilterPaethSse<6>(row, above, rowBytes);
+				return;
+			case 8:
+				UnfilterPaethSse<8>(row, above, rowBytes);
+				return;
+			}
+		}
+
+		UnfilterRowScalar(filter, row, above, rowBytes, stride);
+	}
+
+	// 8 bit rows without a color key, pixels from first on
+	void ConvertGreyRow(const uint8_t* row, uint8_t* bgra, uint32_t first, uint32_t width)
+	{
+		for (uint32_t x = first; x < width; ++x)
+		{
+			bgra[x * 4 + 0] = row[x];
+			bgra[x * 4 + 1] = row[x];
+			bgra[x * 4 + 2] = row[x];
+			bgra[x * 4 + 3] = 255;
+		}
+	}
+
+	void ConvertGreyAlphaRow(const uint8_t* row, uint8_t* bgra, uint32_t first, uint32_t width)
+	{
+		for (uint32_t x = first; x < width; ++x)
+		{
+			bgra[x * 4 + 0] = row[x * 2];
+			bgra[x * 4 + 1] = row[x * 2];
+			bgra[x * 4 + 2] = row[x * 2];
+			bgra[x * 4 + 3] = row[x * 2 + 1];
+		}
+	}
+
+	void ConvertRgbRow(const uint8_t* row, uint8_t* bgra, uint32_t first, uint32_t width)
+	{
+		for (uint32_t x = first; x < width; ++x)
+		{
+			bgra[x * 4 + 0] = row[x * 3 + 2];
+			bgra[x * 4 + 1] = row[x * 3 + 1];
+			bgra[x * 4 + 2] = row[x * 3];
+			bgra[x * 4 + 3] = 255;
+		}
+	}
+
+	void ConvertRgbaRow(const uint8_t* row, uint8_t* bgra, uint32_t first, uint32_t width)
+	{
+		for (uint32_t x = first; x < width; ++x)
+		{
+			bgra[x * 4 + 0] = row[x * 4 + 2];
+			bgra[x * 4 + 1] = row[x * 4 + 1];
+			bgra[x * 4 + 2] = row[x * 4];
+			bgra[x * 4 + 3] = row[x * 4 + 3];
+		}
+	}
+
+	void ConvertGreyRowSse(const uint8_t* row, uint8_t* bgra, uint32_t width)
+	{
+		const __m128i opaque = _mm_set1_epi8(-1);
+		uint32_t x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+			const __m128i greyGrey[2] = { _mm_unpacklo_epi8(grey, grey), _mm_unpackhi_epi8(grey, grey) };
+			const __m128i greyAlpha[2] = { _mm_unpacklo_epi8(grey, opaque), _mm_unpackhi_epi8(grey, opaque) };
+			for (int half = 0; half < 2; ++half)
+			{
+				__m128i* destination = reinterpret_cast<__m128i*>(bgra + (x + half * 8) * 4);
+				_mm_storeu_si128(destination, _mm_unpacklo_epi16(greyGrey[half], greyAlpha[half]));
+				_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(greyGrey[half], greyAlpha[half]));
+			}
+		}
+		ConvertGreyRow(row, bgra, x, width);
+	}
+
+	void ConvertGreyAlphaRowSse(const uint8_t* row, uint8_t* bgra, uint32_t width)
+	{
+		const __m128i lowBytes = _mm_set1_epi16(0xFF);
+		uint32_t x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			// 16 bit lanes of grey | alpha << 8, the grey is doubled into the lanes before them
+			const __m128i greyAlpha = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 2));
+			const __m128i grey = _mm_and_si128(greyAlpha, lowBytes);
+			const __m128i greyGrey = _mm_or_si128(grey, _mm_slli_epi16(grey, 8));
+			__m128i* destination = reinterpret_cast<__m128i*>(bgra + x * 4);
+			_mm_storeu_si128(destination, _mm_unpacklo_epi16(greyGrey, greyAlpha));
+			_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(greyGrey, greyAlpha));
+		}
+		ConvertGreyAlphaRow(row, bgra, x, width);
+	}
+
+	void ConvertRgbaRowSse(const uint8_t* row, uint8_t* bgra, uint32_t width)
+	{
+		// red and blue swap places in every 32 bit lane
+		const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+		const __m128i lowByte = _mm_set1_epi32(0xFF);
+		uint32_t x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4));
+			const __m128i red = _mm_slli_epi32(_mm_and_si128(rgba, lowByte), 16);
+			const __m128i blue = _mm_and_si128(_mm_srli_epi32(rgba, 16), lowByte);
+			const __m128i result = _mm_or_si128(_mm_and_si128(rgba, greenAlpha), _mm_or_si128(red, blue));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + x * 4), result);
+		}
+		ConvertRgbaRow(row, bgra, x, width);
+	}
+
+	// a sample of any bit depth, the samples of a row are packed from the highest bit
+	inline uint32_t GetSample(const uint8_t* row, size_t index, uint32_t bitDepth)
+	{
+		if (bitDepth == 16)
+		{
+			return ReadBigEndian16(row + index * 2);
+		}
+		if (bitDepth == 8)
+		{
+			return row[index];
+		}
+
+		const size_t bit = index * bitDepth;
+		return (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) & ((1u << bitDepth) - 1);
+	}
+
+	inline uint8_t ScaleSample(uint32_t sample, uint32_t bitDepth)
+	{
+		if (bitDepth == 16)
+		{
+			return static_cast<uint8_t>(sample >> 8);
+		}
+		return static_cast<uint8_t>(sample * 255 / ((1u << bitDepth) - 1));
+	}
+
+	// every color type and bit depth
+	void ConvertRowGeneric(const PngImage& image, const uint8_t* row, uint8_t* bgra)
+	{
+		const uint32_t bitDepth = image.bitDepth;
+		for (uint32_t x = 0; x < image.width; ++x)
+		{
+			uint8_t* pixel = bgra + static_cast<size_t>(x) * 4;
+			const size_t sample = static_cast<size_t>(x) * image.channels;
+			switch (image.colorType)
+			{
+			case COLOR_PALETTE:
+				memcpy(pixel, &image.palette[GetSample(row, x, bitDepth)], 4);
+				break;
+			case COLOR_GREY:
+			case COLOR_GREY_ALPHA:
+			{
+				const uint32_t grey = GetSample(row, sample, bitDepth);
+				pixel[0] = pixel[1] = pixel[2] = ScaleSample(grey, bitDepth);
+				if (image.colorType == COLOR_GREY_ALPHA)
+				{
+					pixel[3] = ScaleSample(GetSample(row, sample + 1, bitDepth), bitDepth);
+				}
+				else
+				{
+					pixel[3] = image.colorKey && grey == image.keyRed ? 0 : 255;
+				}
+				break;
+			}
+			default:
+			{
+				const uint32_t red = GetSample(row, sample, bitDepth);
+				const uint32_t green = GetSample(row, sample + 1, bitDepth);
+				const uint32_t blue = GetSample(row, sample + 2, bitDepth);
+				pixel[0] = ScaleSample(blue, bitDepth);
+				pixel[1] = ScaleSample(green, bitDepth);
+				pixel[2] = ScaleSample(red, bitDepth);
+				if (image.colorType == COLOR_RGBA)
+				{
+					pixel[3] = ScaleSample(GetSample(row, sample + 3, bitDepth), bitDepth);
+				}
+				else
+				{
+					pixel[3] = image.colorKey && red == image.keyRed && green == image.keyGreen && blue == image.keyBlue ? 0 : 255;
+				}
+				break;
+			}
+			}
+		}
+	}
+
+	void ConvertRow(PngKernel kernel, const PngImage& image, const uint8_t* row, uint8_t* bgra)
+	{
+		if (image.bitDepth != 8 || image.colorKey || image.colorType == COLOR_PALETTE)
+		{
+			ConvertRowGeneric(image, row, bgra);
+			return;
+		}
+
+		if (kernel == PngKernel::Scalar || image.colorType == COLOR_RGB)
+		{
+			switch (image.colorType)
+			{
+			case COLOR_GREY:
+				ConvertGreyRow(row, bgra, 0, image.width);
+				break;
+			case COLOR_GREY_ALPHA:
+				ConvertGreyAlphaRow(row, bgra, 0, image.width);
+				break;
+			case COLOR_RGB:
+				ConvertRgbRow(row, bgra, 0, image.width);
+				break;
+			default:
+				ConvertRgbaRow(row, bgra, 0, image.width);
+				break;
+			}
+			return;
+		}
+
+		switch (image.colorType)
+		{
+		case COLOR_GREY:
+			ConvertGreyRowSse(row, bgra, image.width);
+			break;
+		case COLOR_GREY_ALPHA:
+			ConvertGreyAlphaRowSse(row, bgra, image.width);
+			break;
+		default:
+			ConvertRgbaRowSse(row, bgra, image.width);
+			break;
+		}
+	}
+
+	bool ReadHeader(const uint8_t* chunk, uint32_t length, PngImage& image)
+	{
+		if (length != 13)
+		{
+			return false;
+		}
+
+		image.width = ReadBigEndian32(chunk);
+		image.height = ReadBigEndian32(chunk + 4);
+		image.bitDepth = chunk[8];
+		image.colorType = chunk[9];
+		if (image.width == 0 || image.height == 0 || image.width > MAX_IMAGE_SIZE || image.height > MAX_IMAGE_SIZE ||
+			chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1)
+		{
+			return false;
+		}
+
+		const uint32_t bitDepth = image.bitDepth;
+		bool validDepth;
+		switch (image.colorType)
+		{
+		case COLOR_GREY:
+			image.channels = 1;
+			validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+			break;
+		case COLOR_PALETTE:
+			image.channels = 1;
+			validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+			break;
+		case COLOR_RGB:
+		case COLOR_GREY_ALPHA:
+		case COLOR_RGBA:
+			image.channels = image.colorType == COLOR_RGB ? 3 : (image.colorType == COLOR_RGBA ? 4 : 2);
+			validDepth = bitDepth == 8 || bitDepth == 16;
+			break;
+		default:
+			return false;
+		}
+
+		// interlaced images are left to WIC
+		if (!validDepth || chunk[12] != 0)
+		{
+			return false;
+		}
+
+		const uint32_t pixelBits = image.channels * bitDepth;
+		image.rowBytes = (static_cast<size_t>(image.width) * pixelBits + 7) / 8;
+		image.filterStride = pixelBits >= 8 ? pixelBits / 8 : 1;
+		return true;
+	}
+}
+
+const char* PngDecoder::GetKernelName(PngKernel kernel)
+{
+	return kernel == PngKernel::Sse ? "SSE" : "scalar";
+}
+
+bool PngDecoder::IsPng(const uint8_t* data, size_t size)
+{
+	return size >= sizeof(PNG_SIGNATURE) && memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0;
+}
+
+unique_ptr<uint8_t[]> PngDecoder::Decode(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height,
+	PngKernel kernel, PngDecodeTimes* times)
+{
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	if (!IsPng(data, size))
+	{
+		return nullptr;
+	}
+
+	PngImage image = {};
+	bool headerRead = false;
+	uint32_t paletteSize = 0;
+	vector<const uint8_t*> imageChunks;	// IDAT, the zlib stream is split over them
+	vector<uint32_t> imageChunkSizes;
+	size_t imageDataSize = 0;
+
+	size_t offset = sizeof(PNG_SIGNATURE);
+	for (;;)
+	{
+		if (size - offset < 12)
+		{
+			return nullptr;
+		}
+
+		const uint32_t length = ReadBigEndian32(data + offset);
+		const uint8_t* type = data + offset + 4;
+		const uint8_t* chunk = data + offset + 8;
+		if (length > size - offset - 12)
+		{
+			return nullptr;
+		}
+		offset += 12 + static_cast<size_t>(length);
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (headerRead || !ReadHeader(chunk, length, image))
+			{
+				return nullptr;
+			}
+			headerRead = true;
+
+			// opaque black for indices the palette does not have
+			for (uint32_t& color : image.palette)
+			{
+				color = 0xFF000000;
+			}
+		}
+		else if (!headerRead)
+		{
+			return nullptr;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			imageChunks.push_back(chunk);
+			imageChunkSizes.push_back(length);
+			imageDataSize += length;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length / 3 > 256)
+			{
+				return nullptr;
+			}
+
+			paletteSize = length / 3;
+			for (uint32_t i = 0; i < paletteSize; ++i)
+			{
+				const uint8_t* color = chunk + i * 3;
+				image.palette[i] = 0xFF000000 | static_cast<uint32_t>(color[0]) << 16 | static_cast<uint32_t>(color[1]) << 8 | color[2];
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (image.colorType == COLOR_PALETTE)
+			{
+				for (uint32_t i = 0; i < length && i < 256; ++i)
+				{
+					image.palette[i] = (image.palette[i] & 0x00FFFFFF) | static_cast<uint32_t>(chunk[i]) << 24;
+				}
+			}
+			else if (image.colorType == COLOR_GREY && length == 2)
+			{
+				image.colorKey = true;
+				image.keyRed = ReadBigEndian16(chunk);
+			}
+			else if (image.colorType == COLOR_RGB && length == 6)
+			{
+				image.colorKey = true;
+				image.keyRed = ReadBigEndian16(chunk);
+				image.keyGreen = ReadBigEndian16(chunk + 2);
+				image.keyBlue = ReadBigEndian16(chunk + 4);
+			}
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+		else if ((type[0] & 32) == 0)
+		{
+			return nullptr;	// a critical chunk this decoder does not know
+		}
+	}
+
+	if (imageChunks.empty() || (image.colorType == COLOR_PALETTE && paletteSize == 0))
+	{
+		return nullptr;
+	}
+
+	// one contiguous zlib stream, copied only when it is split
+	const uint8_t* imageData = imageChunks[0];
+	vector<uint8_t> joinedImageData;
+	if (imageChunks.size() > 1)
+	{
+		joinedImageData.resize(imageDataSize);
+		size_t joinedSize = 0;
+		for (size_t i = 0; i < imageChunks.size(); ++i)
+		{
+			memcpy(joinedImageData.data() + joinedSize, imageChunks[i], imageChunkSizes[i]);
+			joinedSize += imageChunkSizes[i];
+		}
+		imageData = joinedImageData.data();
+	}
+
+	PngDecodeTimes decodeTimes = {};
+	decodeTimes.chunkMs = ElapsedMs(start);
+
+	// every row starts with its filter type, neither buffer is cleared as every byte is written
+	start = high_resolution_clock::now();
+	const size_t filteredRowBytes = image.rowBytes + 1;
+	const size_t filteredSize = filteredRowBytes * image.height;
+	unique_ptr<uint8_t[]> filtered(new uint8_t[filteredSize]);
+	if (!Inflate(imageData, imageDataSize, filtered.get(), filteredSize))
+	{
+		return nullptr;
+	}
+	decodeTimes.inflateMs = ElapsedMs(start);
+
+	// each row is converted right after it is unfiltered, while it is in the cache
+	start = high_resolution_clock::now();
+	unique_ptr<uint8_t[]> pixels(new uint8_t[static_cast<size_t>(image.width) * image.height * 4]);
+	const vector<uint8_t> zeroRow(image.rowBytes, 0);
+	const uint8_t* above = zeroRow.data();
+	for (uint32_t y = 0; y < image.height; ++y)
+	{
+		uint8_t* row = filtered.get() + y * filteredRowBytes;
+		const uint32_t filter = row[0];
+		if (filter > FILTER_PAETH)
+		{
+			return nullptr;
+		}
+
+		++row;
+		if (kernel == PngKernel::Sse)
+		{
+			UnfilterRowSse(filter, row, above, image.rowBytes, image.filterStride);
+		}
+		else
+		{
+			UnfilterRowScalar(filter, row, above, image.rowBytes, image.filterStride);
+		}
+
+		ConvertRow(kernel, image, row, pixels.get() + static_cast<size_t>(y) * image.width * 4);
+		above = row;
+	}
+	decodeTimes.unfilterMs = ElapsedMs(start);
+
+	if (times != nullptr)
+	{
+		*times = decodeTimes;
+	}
+	width = image.width;
+	height = image.height;
+	return pixels;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+enum class PngKernel
+{
+	Scalar,
+	Sse	// unfilters a pixel per iteration, converts 4 pixels per iteration
+};
+
+// where the decode time of an image went
+struct PngDecodeTimes
+{
+	double chunkMs;	// walking the chunks and gathering the IDAT data
+	double inflateMs;
+	double unfilterMs;	// unfiltering and converting to BGRA8
+};
+
+// Decodes PNG images straight into BGRA8 rows, the layout WIC gives for
+// GUID_WICPixelFormat32bppBGRA. Every color type and bit depth is read, 16 bit
+// samples keep their high byte and tRNS becomes alpha. Interlaced images are
+// left to WIC. The zlib and chunk checksums are not verified, the sizes are.
+// Both kernels give bit identical pixels. Platform independent, no Windows.
+class PngDecoder
+{
+public:
+	static const char* GetKernelName(PngKernel kernel);
+	static bool IsPng(const uint8_t* data, size_t size);
+
+	// null when the file is malformed or interlaced
+	static std::unique_ptr<uint8_t[]> Decode(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height,
+		PngKernel kernel = PngKernel::Sse, PngDecodeTimes* times = nullptr);
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+
+enum class VertexFormat
+{
+	Full,	// Vertex, 44 bytes
+	Quantized	// QuantizedVertex, 20 bytes
+};
+
+// GPU vertex layout decoded by Shaders.hlsl when QUANTIZED_VERTICES is defined
+struct QuantizedVertex
+{
+	UINT16 position[4];	// R16G16B16A16_UNORM relative to the mesh bounds, w unused
+	UINT32 normal;	// R16G16_SNORM octahedral
+	UINT32 tangent;	// R16G16_SNORM octahedral
+	UINT16 textureCoordinate[2];	// R16G16_FLOAT
+};
+
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must match the input layout");
@@ -0,0 +1,220 @@
+#include "ResidencyManager.h"
+#include "DdsFile.h"
+#include <algorithm>
+
+using namespace std;
+
+ResidencyManager::ResidencyManager(uint64_t budgetBytes)
+	: m_budgetBytes(budgetBytes), m_frame(0), m_evictedBytes(0)
+{
+}
+
+void ResidencyManager::SetBudget(uint64_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+uint64_t ResidencyManager::GetBudget() const
+{
+	return m_budgetBytes;
+}
+
+uint64_t ResidencyManager::GetUnmanagedBudget() const
+{
+	const uint64_t managedBytes = GetBytes(true, false, true);
+	return managedBytes < m_budgetBytes ? m_budgetBytes - managedBytes : 0;
+}
+
+uint64_t ResidencyManager::GetTextureBytes(const ResidencyTexture& texture) const
+{
+	return texture.live && texture.residentMip < texture.mipCount ? texture.chainSizes[texture.residentMip] : 0;
+}
+
+uint64_t ResidencyManager::GetBytes(bool managedTextures, bool unmanagedTextures, bool buffers) const
+{
+	uint64_t bytes = 0;
+	for (const ResidencyTexture& texture : m_textures)
+	{
+		if (texture.managed ? managedTextures : unmanagedTextures)
+		{
+			bytes += GetTextureBytes(texture);
+		}
+	}
+	for (const Allocation& allocation : m_allocations)
+	{
+		if (buffers && allocation.live && allocation.kind == ResidencyKind::Buffer)
+		{
+			bytes += allocation.bytes;
+		}
+	}
+	return bytes;
+}
+
+uint32_t ResidencyManager::AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t format, uint32_t residentMip,
+	const uint64_t* chainSizes, bool managed)
+{
+	ResidencyTexture texture = {};
+	texture.mipCount = mipCount < TEXTURE_FILE_MAX_MIPS ? mipCount : TEXTURE_FILE_MAX_MIPS;
+	texture.residentMip = residentMip < texture.mipCount ? residentMip : texture.mipCount;
+	texture.managed = managed;
+	texture.live = true;
+	texture.lastUsedFrame = m_frame;
+
+	// the same tail as a streamed texture
+	texture.tailMip = texture.mipCount - 1;
+	for (uint32_t mip = 0; mip < texture.mipCount; ++mip)
+	{
+		if ((width >> mip) <= MIP_STREAM_TAIL_SIZE && (height >> mip) <= MIP_STREAM_TAIL_SIZE && mip < texture.tailMip)
+		{
+			texture.tailMip = mip;
+		}
+		texture.chainSizes[mip] = chainSizes[mip];
+	}
+	const uint32_t coarsestFirstMip = DdsFile::GetCoarsestFirstMip(format, width, height, texture.mipCount);
+	texture.tailMip = texture.tailMip < coarsestFirstMip ? texture.tailMip : coarsestFirstMip;
+
+	if (m_freeTextures.empty())
+	{
+		m_textures.push_back(texture);
+		return static_cast<uint32_t>(m_textures.size() - 1);
+	}
+
+	uint32_t index = m_freeTextures.back();
+	m_freeTextures.pop_back();
+	m_textures[index] = texture;
+	return index;
+}
+
+void ResidencyManager::RemoveTexture(uint32_t texture)
+{
+	m_textures[texture].live = false;
+	m_freeTextures.push_back(texture);
+}
+
+void ResidencyManager::SetResidentMip(uint32_t texture, uint32_t residentMip)
+{
+	ResidencyTexture& tracked = m_textures[texture];
+	tracked.residentMip = residentMip < tracked.mipCount ? residentMip : tracked.mipCount;
+}
+
+uint32_t ResidencyManager::AddAllocation(ResidencyKind kind, uint64_t bytes)
+{
+	Allocation allocation = { kind, bytes, true };
+	if (m_freeAllocations.empty())
+	{
+		m_allocations.push_back(allocation);
+		return static_cast<uint32_t>(m_allocations.size() - 1);
+	}
+
+	uint32_t index = m_freeAllocations.back();
+	m_freeAllocations.pop_back();
+	m_allocations[index] = allocation;
+	return index;
+}
+
+void ResidencyManager::RemoveAllocation(uint32_t allocation)
+{
+	m_allocations[allocation].live = false;
+	m_freeAllocations.push_back(allocation);
+}
+
+void ResidencyManager::BeginFrame()
+{
+	++m_frame;
+}
+
+void ResidencyManager::Touch(uint32_t texture)
+{
+	m_textures[texture].lastUsedFrame = m_frame;
+}
+
+void ResidencyManager::Update(vector<ResidencyChange>& changes)
+{
+	changes.clear();
+	m_evictedBytes = 0;
+
+	uint64_t usedBytes = GetBytes(true, true, true);
+	if (usedBytes <= m_budgetBytes)
+	{
+		return;
+	}
+
+	// least recently used first, so the textures used this frame come last
+	m_evictionOrder.clear();
+	for (uint32_t i = 0; i < m_textures.size(); ++i)
+	{
+		const ResidencyTexture& texture = m_textures[i];
+		if (texture.live && texture.managed && texture.residentMip < texture.mipCount)
+		{
+			m_evictionOrder.push_back(i);
+		}
+	}
+	stable_sort(m_evictionOrder.begin(), m_evictionOrder.end(),
+		[this](uint32_t a, uint32_t b) { return m_textures[a].lastUsedFrame < m_textures[b].lastUsedFrame; });
+
+	for (uint32_t index : m_evictionOrder)
+	{
+		if (usedBytes <= m_budgetBytes)
+		{
+			break;
+		}
+
+		ResidencyTexture& texture = m_textures[index];
+		const uint64_t residentBytes = texture.chainSizes[texture.residentMip];
+
+		// down to the tail, no further than the budget needs
+		uint32_t targetMip = texture.residentMip;
+		uint64_t freedBytes = 0;
+		while (targetMip < texture.tailMip && usedBytes - freedBytes > m_budgetBytes)
+		{
+			++targetMip;
+			freedBytes = residentBytes - texture.chainSizes[targetMip];
+		}
+
+		// and out entirely when it has not been used for a while
+		if (usedBytes - freedBytes > m_budgetBytes && m_frame - texture.lastUsedFrame >= RESIDENCY_EVICT_DELAY)
+		{
+			targetMip = texture.mipCount;
+			freedBytes = residentBytes;
+		}
+
+		if (targetMip != texture.residentMip)
+		{
+			ResidencyChange change = { index, texture.residentMip, targetMip };
+			changes.push_back(change);
+			texture.residentMip = targetMip;
+			usedBytes -= freedBytes;
+			m_evictedBytes += freedBytes;
+		}
+	}
+}
+
+const ResidencyTexture& ResidencyManager::GetTexture(uint32_t texture) const
+{
+	return m_textures[texture];
+}
+
+ResidencyStats ResidencyManager::GetStats() const
+{
+	ResidencyStats stats = {};
+	for (const ResidencyTexture& texture : m_textures)
+	{
+		if (texture.live)
+		{
+			stats.textureBytes += GetTextureBytes(texture);
+			++stats.textureCount;
+			stats.texturesEvicted += texture.residentMip == texture.mipCount ? 1 : 0;
+		}
+	}
+	for (const Allocation& allocation : m_allocations)
+	{
+		if (allocation.live)
+		{
+			stats.bufferBytes += allocation.kind == ResidencyKind::Buffer ? allocation.bytes : 0;
+			stats.stagingBytes += allocation.kind == ResidencyKind::Staging ? allocation.bytes : 0;
+			++stats.allocationCount;
+		}
+	}
+	stats.evictedBytes = m_evictedBytes;
+	return stats;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MipStreamer.h"
+
+// the index of something the manager does not know
+const uint32_t RESIDENCY_NONE = ~0u;
+// frames a texture has to go unused before the budget can take it out entirely, it only loses levels before that
+const uint32_t RESIDENCY_EVICT_DELAY = 60;
+
+// allocations other than textures
+enum class ResidencyKind
+{
+	Buffer,
+	Staging	// upload heaps, released once their copies have run
+};
+
+struct ResidencyTexture
+{
+	uint32_t mipCount;
+	uint32_t tailMip;	// the coarsest level a texture in use is left with, see MIP_STREAM_TAIL_SIZE
+	uint32_t residentMip;	// most detailed resident level, mipCount when evicted
+	bool managed;	// false for streamed textures, their levels are the MipStreamer's to decide
+	bool live;
+	uint64_t lastUsedFrame;
+	uint64_t chainSizes[TEXTURE_FILE_MAX_MIPS];	// allocation sizes of the resource holding a level down to 1x1
+};
+
+// a texture the budget took levels from, residentMip is mipCount when it has to go entirely
+struct ResidencyChange
+{
+	uint32_t texture;
+	uint32_t previousMip;
+	uint32_t residentMip;
+};
+
+struct ResidencyStats
+{
+	uint64_t textureBytes;
+	uint64_t bufferBytes;
+	uint64_t stagingBytes;
+	uint64_t evictedBytes;	// by the last Update
+	uint32_t textureCount;
+	uint32_t texturesEvicted;	// out entirely
+	uint32_t allocationCount;	// buffers and staging
+};
+
+// Accounts the memory of every texture and buffer the renderer allocates and
+// keeps it within a budget. Textures are touched every frame they are used,
+// and when the textures and buffers go over the budget Update takes it back
+// from the least recently used textures first: each one loses levels down to
+// its tail, and once it has gone unused for RESIDENCY_EVICT_DELAY frames it
+// goes entirely. Textures used this frame only lose levels when nothing else
+// is left. Staging memory is accounted but does not count against the
+// budget, it goes within a frame anyway. Sizes come from the caller.
+class ResidencyManager
+{
+private:
+	struct Allocation
+	{
+		ResidencyKind kind;
+		uint64_t bytes;
+		bool live;
+	};
+
+	uint64_t m_budgetBytes;
+	uint64_t m_frame;
+	std::vector<ResidencyTexture> m_textures;
+	std::vector<uint32_t> m_freeTextures;
+	std::vector<Allocation> m_allocations;
+	std::vector<uint32_t> m_freeAllocations;
+	std::vector<uint32_t> m_evictionOrder;
+	uint64_t m_evictedBytes;
+
+	uint64_t GetTextureBytes(const ResidencyTexture& texture) const;
+	uint64_t GetBytes(bool managedTextures, bool unmanagedTextures, bool buffers) const;
+
+public:
+	explicit ResidencyManager(uint64_t budgetBytes);
+
+	void SetBudget(uint64_t budgetBytes);
+	uint64_t GetBudget() const;
+	// of the budget, what the textures it does not manage can have
+	uint64_t GetUnmanagedBudget() const;
+
+	// chainSizes holds mipCount sizes, returns the index, indices of removed textures are reused
+	uint32_t AddTexture(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t format, uint32_t residentMip, const uint64_t* chainSizes,
+		bool managed);
+	void RemoveTexture(uint32_t texture);
+	// the resident levels changed outside Update, streamed or restored
+	void SetResidentMip(uint32_t texture, uint32_t residentMip);
+	uint32_t AddAllocation(ResidencyKind kind, uint64_t bytes);
+	void RemoveAllocation(uint32_t allocation);
+
+	void BeginFrame();
+	void Touch(uint32_t texture);	// used this frame
+	void Update(std::vector<ResidencyChange>& changes);
+
+	const ResidencyTexture& GetTexture(uint32_t texture) const;
+	ResidencyStats GetStats() const;
+};
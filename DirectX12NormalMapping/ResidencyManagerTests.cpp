@@ -0,0 +1,302 @@
+#include "ResidencyManagerTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <functional>
+#include <vector>
+#include "ResidencyManager.h"
+
+using std::function;
+using std::vector;
+
+namespace
+{
+	// materials of a color, normal and ORM texture each, a few of them in use at a time
+	const uint32_t MATERIAL_COUNT = 6;
+	const uint32_t TEXTURE_SIZE = 1024;
+	const uint32_t TEXTURE_FORMATS[] = { DDS_FORMAT_BC1_UNORM_SRGB, DDS_FORMAT_BC5_UNORM, DDS_FORMAT_B8G8R8A8_UNORM };
+	const uint32_t TEXTURES_PER_MATERIAL = sizeof(TEXTURE_FORMATS) / sizeof(TEXTURE_FORMATS[0]);
+	const uint64_t MB = 1024 * 1024;
+
+	struct FramePlan
+	{
+		const wchar_t* name;
+		uint64_t budgetBytes;
+		uint32_t frameCount;
+		// whether a material is drawn in a frame
+		function<bool(uint32_t material, uint32_t frame)> used;
+		// after every frame, returns false when the plan's own expectation fails
+		function<bool(const ResidencyManager&, const vector<ResidencyChange>&, uint32_t frame)> check;
+	};
+
+	uint32_t AddTexture(ResidencyManager& residency, uint32_t format, bool managed, uint32_t size = TEXTURE_SIZE)
+	{
+		const uint32_t mipCount = DdsFile::GetMaxMipCount(size, size);
+		uint64_t chainSizes[TEXTURE_FILE_MAX_MIPS] = {};
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint32_t mipSize = size >> mip > 0 ? size >> mip : 1;
+			chainSizes[mip] = DdsFile::GetMipChainSize(format, mipSize, mipSize, mipCount - mip);
+		}
+		return residency.AddTexture(size, size, mipCount, format, 0, chainSizes, managed);
+	}
+
+	// the rules that hold in every frame whatever the plan, frame counts BeginFrame calls
+	bool CheckFrame(const ResidencyManager& residency, const vector<ResidencyChange>& changes, uint64_t frame)
+	{
+		bool passed = true;
+		for (const ResidencyChange& change : changes)
+		{
+			const ResidencyTexture& texture = residency.GetTexture(change.texture);
+			// the budget only ever takes levels, and a texture goes entirely only after the delay
+			passed = passed && change.residentMip > change.previousMip && texture.residentMip == change.residentMip;
+			passed = passed && (change.residentMip < texture.mipCount || frame - texture.lastUsedFrame >= RESIDENCY_EVICT_DELAY);
+			// textures in use keep their tail
+			passed = passed && (texture.lastUsedFrame != frame || change.residentMip <= texture.tailMip);
+		}
+
+		// over the budget only when the managed textures have nothing left to give
+		const ResidencyStats stats = residency.GetStats();
+		if (stats.textureBytes + stats.bufferBytes > residency.GetBudget())
+		{
+			for (uint32_t i = 0; i < stats.textureCount; ++i)
+			{
+				const ResidencyTexture& texture = residency.GetTexture(i);
+				const bool stale = frame - texture.lastUsedFrame >= RESIDENCY_EVICT_DELAY;
+				passed = passed && (!texture.live || !texture.managed ||
+					(stale ? texture.residentMip == texture.mipCount : texture.residentMip >= texture.tailMip));
+			}
+		}
+		return passed;
+	}
+
+	bool RunPlan(const FramePlan& plan)
+	{
+		ResidencyManager residency(plan.budgetBytes);
+		for (uint32_t material = 0; material < MATERIAL_COUNT; ++material)
+		{
+			for (uint32_t format : TEXTURE_FORMATS)
+			{
+				AddTexture(residency, format, true);
+			}
+		}
+
+		vector<ResidencyChange> changes;
+		uint64_t evictedBytes = 0;
+		uint64_t peakBytes = 0;
+		uint32_t restores = 0;
+		bool passed = true;
+
+		for (uint32_t frame = 0; frame < plan.frameCount; ++frame)
+		{
+			residency.BeginFrame();
+			for (uint32_t material = 0; material < MATERIAL_COUNT; ++material)
+			{
+				if (!plan.used(material, frame))
+				{
+					continue;
+				}
+
+				// like the engine, a texture that went entirely is reloaded with all its levels before it is drawn
+				for (uint32_t i = 0; i < TEXTURES_PER_MATERIAL; ++i)
+				{
+					const uint32_t texture = material * TEXTURES_PER_MATERIAL + i;
+					if (residency.GetTexture(texture).residentMip == residency.GetTexture(texture).mipCount)
+					{
+						residency.SetResidentMip(texture, 0);
+						++restores;
+					}
+					residency.Touch(texture);
+				}
+			}
+			residency.Update(changes);
+
+			const ResidencyStats stats = residency.GetStats();
+			evictedBytes += stats.evictedBytes;
+			peakBytes = stats.textureBytes > peakBytes ? stats.textureBytes : peakBytes;
+
+			passed = CheckFrame(residency, changes, frame + 1) && plan.check(residency, changes, frame) && passed;
+		}
+
+		wprintf(L"  %-36s %4u frames, %8.2f MB evicted, peak %7.2f MB, %3u restores %s\n", plan.name, plan.frameCount,
+			static_cast<double>(evictedBytes) / MB, static_cast<double>(peakBytes) / MB, restores, passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	bool NoChanges(const ResidencyManager&, const vector<ResidencyChange>& changes, uint32_t)
+	{
+		return changes.empty();
+	}
+
+	// a texture unused for longer than the delay goes before one in use loses a level
+	bool TestStaleBeforeInUse()
+	{
+		ResidencyManager residency(~0ull);
+		const uint32_t used = AddTexture(residency, DDS_FORMAT_B8G8R8A8_UNORM, true);
+		const uint32_t stale = AddTexture(residency, DDS_FORMAT_B8G8R8A8_UNORM, true);
+		const ResidencyTexture& usedTexture = residency.GetTexture(used);
+		const ResidencyTexture& staleTexture = residency.GetTexture(stale);
+		const uint64_t tailBytes = staleTexture.chainSizes[staleTexture.tailMip];
+		residency.SetBudget(usedTexture.chainSizes[0] + tailBytes);
+
+		vector<ResidencyChange> changes;
+		bool passed = true;
+		uint32_t buffer = RESIDENCY_NONE;
+		for (uint32_t frame = 1; frame <= 2 * RESIDENCY_EVICT_DELAY; ++frame)
+		{
+			// memory the stale texture's tail has to make room for, the first time only for a frame
+			if (frame == RESIDENCY_EVICT_DELAY / 2 || frame == RESIDENCY_EVICT_DELAY + 10)
+			{
+				buffer = residency.AddAllocation(ResidencyKind::Buffer, tailBytes / 2);
+			}
+			else if (frame == RESIDENCY_EVICT_DELAY / 2 + 1)
+			{
+				residency.RemoveAllocation(buffer);
+				residency.SetResidentMip(used, 0);
+			}
+
+			residency.BeginFrame();
+			residency.Touch(used);
+			residency.Update(changes);
+
+			if (frame == 1)
+			{
+				passed = passed && changes.size() == 1 && staleTexture.residentMip == staleTexture.tailMip;
+			}
+			else if (frame == RESIDENCY_EVICT_DELAY / 2)
+			{
+				// too recent to go, the texture in use gives a level instead
+				passed = passed && changes.size() == 1 && changes[0].texture == used && usedTexture.residentMip == 1;
+			}
+			else if (frame == RESIDENCY_EVICT_DELAY + 10)
+			{
+				passed = passed && changes.size() == 1 && changes[0].texture == stale && staleTexture.residentMip == staleTexture.mipCount &&
+					usedTexture.residentMip == 0;
+			}
+			else
+			{
+				passed = passed && changes.empty();
+			}
+			passed = CheckFrame(residency, changes, frame) && passed;
+		}
+
+		wprintf(L"  %-36s %s\n", L"stale texture before one in use", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// buffers count against the budget, staging does not, streamed textures are only accounted
+	bool TestAllocationKinds()
+	{
+		ResidencyManager residency(~0ull);
+		const uint32_t managed = AddTexture(residency, DDS_FORMAT_B8G8R8A8_UNORM, true);
+		const uint32_t streamed = AddTexture(residency, DDS_FORMAT_B8G8R8A8_UNORM, false);
+		const uint64_t textureBytes = residency.GetTexture(managed).chainSizes[0];
+		residency.SetBudget(2 * textureBytes + MB);
+
+		vector<ResidencyChange> changes;
+		const uint32_t staging = residency.AddAllocation(ResidencyKind::Staging, 8 * MB);
+		residency.BeginFrame();
+		residency.Update(changes);
+		bool passed = changes.empty() && residency.GetStats().stagingBytes == 8 * MB;
+
+		const uint32_t buffer = residency.AddAllocation(ResidencyKind::Buffer, 2 * MB);
+		residency.BeginFrame();
+		residency.Update(changes);
+		passed = passed && changes.size() == 1 && changes[0].texture == managed && residency.GetTexture(streamed).residentMip == 0;
+		passed = passed && residency.GetUnmanagedBudget() == 2 * textureBytes + MB - 2 * MB - residency.GetTexture(managed).chainSizes[1];
+
+		const ResidencyStats stats = residency.GetStats();
+		passed = passed && stats.bufferBytes == 2 * MB && stats.allocationCount == 2 && stats.textureCount == 2 &&
+			stats.textureBytes == textureBytes + residency.GetTexture(managed).chainSizes[1] && stats.evictedBytes == textureBytes -
+			residency.GetTexture(managed).chainSizes[1];
+
+		// freed indices are handed out again
+		residency.RemoveAllocation(staging);
+		residency.RemoveAllocation(buffer);
+		residency.RemoveTexture(streamed);
+		passed = passed && residency.GetStats().allocationCount == 0 && residency.GetStats().textureCount == 1;
+		passed = passed && residency.AddAllocation(ResidencyKind::Buffer, MB) == buffer &&
+			AddTexture(residency, DDS_FORMAT_BC1_UNORM_SRGB, true) == streamed;
+
+		wprintf(L"  %-36s %s\n", L"allocation kinds and indices", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// with no budget a block compressed texture still keeps a top level of whole blocks, 1000 halves to 500 but not 250
+	bool TestBlockCompressedTail()
+	{
+		ResidencyManager residency(0);
+		const uint32_t compressed = AddTexture(residency, DDS_FORMAT_BC1_UNORM, true, 1000);
+		const uint32_t uncompressed = AddTexture(residency, DDS_FORMAT_B8G8R8A8_UNORM, true, 1000);
+		const ResidencyTexture& compressedTexture = residency.GetTexture(compressed);
+		const ResidencyTexture& uncompressedTexture = residency.GetTexture(uncompressed);
+
+		vector<ResidencyChange> changes;
+		bool passed = compressedTexture.tailMip == 1 && uncompressedTexture.tailMip == 4;
+		for (uint32_t frame = 1; frame <= 10; ++frame)
+		{
+			residency.BeginFrame();
+			residency.Touch(compressed);
+			residency.Touch(uncompressed);
+			residency.Update(changes);
+			passed = passed && compressedTexture.residentMip == 1 && uncompressedTexture.residentMip == 4;
+			passed = CheckFrame(residency, changes, frame) && passed;
+		}
+
+		wprintf(L"  %-36s %s\n", L"block compressed tail", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+}
+
+int RunResidencyManagerTests()
+{
+	const uint32_t phaseFrames = 100;	// longer than the eviction delay
+	int failures = 0;
+
+	const vector<FramePlan> plans =
+	{
+		{ L"two of six materials, unlimited", ~0ull, 6 * phaseFrames,
+			[=](uint32_t material, uint32_t frame) { return material == frame / phaseFrames || material == (frame / phaseFrames + 1) % MATERIAL_COUNT; },
+			NoChanges },
+		// the materials left behind lose their levels, their tails go after the delay and the ones coming back are reloaded
+		{ L"two of six materials, 14.75 MB", 15 * MB - MB / 4, 2 * MATERIAL_COUNT * phaseFrames,
+			[=](uint32_t material, uint32_t frame) { return material == (frame / phaseFrames) % MATERIAL_COUNT ||
+				material == (frame / phaseFrames + 1) % MATERIAL_COUNT; },
+			[=](const ResidencyManager& residency, const vector<ResidencyChange>&, uint32_t frame)
+			{
+				const ResidencyStats stats = residency.GetStats();
+				return stats.textureBytes <= residency.GetBudget() || frame % phaseFrames < RESIDENCY_EVICT_DELAY;
+			} },
+		// only the tails of the materials in use fit, the others go and come back reloaded
+		{ L"two of six materials, 100 KB", 100 * 1024, 2 * MATERIAL_COUNT * phaseFrames,
+			[=](uint32_t material, uint32_t frame) { return material == (frame / phaseFrames) % MATERIAL_COUNT ||
+				material == (frame / phaseFrames + 1) % MATERIAL_COUNT; },
+			[=](const ResidencyManager& residency, const vector<ResidencyChange>&, uint32_t frame)
+			{
+				const ResidencyStats stats = residency.GetStats();
+				return stats.textureBytes <= residency.GetBudget() || frame % phaseFrames < RESIDENCY_EVICT_DELAY;
+			} },
+		// nothing is stale, so levels are taken but nothing goes, once
+		{ L"all materials in use, 4 MB", 4 * MB, phaseFrames,
+			[](uint32_t, uint32_t) { return true; },
+			[](const ResidencyManager& residency, const vector<ResidencyChange>& changes, uint32_t frame)
+			{
+				bool kept = residency.GetStats().textureBytes <= 4 * MB && (frame == 0 || changes.empty());
+				for (const ResidencyChange& change : changes)
+				{
+					kept = kept && change.residentMip < residency.GetTexture(change.texture).mipCount;
+				}
+				return kept;
+			} },
+	};
+
+	for (const FramePlan& plan : plans)
+	{
+		failures += RunPlan(plan) ? 0 : 1;
+	}
+	failures += TestStaleBeforeInUse() ? 0 : 1;
+	failures += TestAllocationKinds() ? 0 : 1;
+	failures += TestBlockCompressedTail() ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
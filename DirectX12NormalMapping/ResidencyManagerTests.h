@@ -0,0 +1,6 @@
+#pragma once
+
+// ResidencyManager driven through simulated frames of material sets that come
+// and go, checks the budget and eviction rules every frame, prints every case
+// and returns 0 when all of them pass
+int RunResidencyManagerTests();
@@ -0,0 +1,148 @@
+#include "ResourceHeaps.h"
+#include "d3dx12.h"
+
+namespace
+{
+	const UINT64 HEAP_SIZES[] =
+	{
+		RESOURCE_HEAP_SIZE_BUFFERS,
+		RESOURCE_HEAP_SIZE_TEXTURES,
+		RESOURCE_HEAP_SIZE_DEPTH,
+		RESOURCE_HEAP_SIZE_UPLOAD
+	};
+
+	const D3D12_HEAP_FLAGS HEAP_FLAGS[] =
+	{
+		D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS
+	};
+
+	const wchar_t* const HEAP_NAMES[] =
+	{
+		L"Buffer Heap",
+		L"Texture Heap",
+		L"Depth Heap",
+		L"Upload Buffer Heap"
+	};
+}
+
+ResourceHeaps::ResourceHeaps()
+	: m_device(nullptr)
+{
+}
+
+void ResourceHeaps::Init(ID3D12Device* const device)
+{
+	m_device = device;
+}
+
+ResourceHeapKind ResourceHeaps::GetKind(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return heapType == D3D12_HEAP_TYPE_UPLOAD ? ResourceHeapKind::Upload : ResourceHeapKind::Buffers;
+	}
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+	{
+		return ResourceHeapKind::Depth;
+	}
+	return ResourceHeapKind::Textures;
+}
+
+UINT ResourceHeaps::CreateHeap(ResourceHeapKind kind, UINT64 size)
+{
+	const UINT kindIndex = static_cast<UINT>(kind);
+	UINT64 heapSize = size > HEAP_SIZES[kindIndex] ? size : HEAP_SIZES[kindIndex];
+	heapSize = (heapSize + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = heapSize;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(kind == ResourceHeapKind::Upload ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = HEAP_FLAGS[kindIndex];
+
+	Heap heap = { nullptr, HeapAllocator(heapSize, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) };
+	HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	heap.heap->SetName(HEAP_NAMES[kindIndex]);
+
+	m_heaps[kindIndex].push_back(std::move(heap));
+	return static_cast<UINT>(m_heaps[kindIndex].size() - 1);
+}
+
+ComPtr<ID3D12Resource> ResourceHeaps::CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType,
+	D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* const clearValue, PlacedAllocation& allocation)
+{
+	allocation.kind = GetKind(desc, heapType);
+	std::vector<Heap>& heaps = m_heaps[static_cast<UINT>(allocation.kind)];
+
+	// small textures can go at 4 KB, the device says whether this one is small enough
+	D3D12_RESOURCE_DESC placedDesc = desc;
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = {};
+	if (allocation.kind == ResourceHeapKind::Textures)
+	{
+		placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	}
+	if (allocationInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+	{
+		placedDesc.Alignment = 0;
+		allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	}
+
+	HeapAllocation placement = { 0, 0, HEAP_ALLOCATOR_NONE };
+	for (allocation.heap = 0; allocation.heap < heaps.size(); ++allocation.heap)
+	{
+		placement = heaps[allocation.heap].allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+		if (placement.block != HEAP_ALLOCATOR_NONE)
+		{
+			break;
+		}
+	}
+	if (placement.block == HEAP_ALLOCATOR_NONE)
+	{
+		allocation.heap = CreateHeap(allocation.kind, allocationInfo.SizeInBytes);
+		placement = heaps[allocation.heap].allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+	}
+	allocation.block = placement.block;
+
+	ComPtr<ID3D12Resource> resource;
+	HRESULT hr = m_device->CreatePlacedResource(heaps[allocation.heap].heap.Get(), placement.offset, &placedDesc, state, clearValue,
+		IID_PPV_ARGS(&resource));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	return resource;
+}
+
+void ResourceHeaps::Release(PlacedAllocation& allocation)
+{
+	if (allocation.block == HEAP_ALLOCATOR_NONE)
+	{
+		return;
+	}
+
+	m_heaps[static_cast<UINT>(allocation.kind)][allocation.heap].allocator.Free(allocation.block);
+	allocation.block = HEAP_ALLOCATOR_NONE;
+}
+
+ResourceHeapStats ResourceHeaps::GetStats(ResourceHeapKind kind) const
+{
+	ResourceHeapStats stats = {};
+	for (const Heap& heap : m_heaps[static_cast<UINT>(kind)])
+	{
+		const HeapAllocatorStats heapStats = heap.allocator.GetStats();
+		++stats.heapCount;
+		stats.reservedBytes += heapStats.capacity;
+		stats.usedBytes += heapStats.usedBytes;
+		stats.allocationCount += heapStats.allocationCount;
+		stats.fragmentation = heapStats.fragmentation > stats.fragmentation ? heapStats.fragmentation : stats.fragmentation;
+	}
+	return stats;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+#include "HeapAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// heaps created as the ones there fill, larger resources get a heap of their own size
+const UINT64 RESOURCE_HEAP_SIZE_BUFFERS = 16 * 1024 * 1024;
+const UINT64 RESOURCE_HEAP_SIZE_TEXTURES = 64 * 1024 * 1024;
+const UINT64 RESOURCE_HEAP_SIZE_DEPTH = 32 * 1024 * 1024;
+const UINT64 RESOURCE_HEAP_SIZE_UPLOAD = 4 * 1024 * 1024;
+
+// the kinds of resources that can share a heap on every resource heap tier
+enum class ResourceHeapKind
+{
+	Buffers,
+	Textures,
+	Depth,	// render target and depth stencil textures
+	Upload,	// buffers the CPU writes
+	Count
+};
+
+// where a placed resource lives, pass it back to Release once the GPU is done with the resource
+struct PlacedAllocation
+{
+	ResourceHeapKind kind;
+	UINT heap;
+	UINT block;	// HEAP_ALLOCATOR_NONE when there is nothing to release
+};
+
+struct ResourceHeapStats
+{
+	UINT heapCount;
+	UINT64 reservedBytes;	// the heaps
+	UINT64 usedBytes;	// the placed resources, aligned
+	UINT allocationCount;
+	float fragmentation;	// of the most fragmented heap
+};
+
+// Reserves large ID3D12Heaps per kind of resource and places resources in
+// them with a HeapAllocator each, instead of a committed resource and its
+// implicit heap per resource. Small textures are placed at 4 KB where the
+// device allows it. Heaps are kept once created.
+class ResourceHeaps
+{
+private:
+	struct Heap
+	{
+		ComPtr<ID3D12Heap> heap;
+		HeapAllocator allocator;
+	};
+
+	ID3D12Device* m_device;
+	std::vector<Heap> m_heaps[static_cast<UINT>(ResourceHeapKind::Count)];
+
+	static ResourceHeapKind GetKind(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType);
+	UINT CreateHeap(ResourceHeapKind kind, UINT64 size);
+
+public:
+	ResourceHeaps();
+
+	void Init(ID3D12Device* const device);
+	// heapType is D3D12_HEAP_TYPE_DEFAULT or, for buffers only, D3D12_HEAP_TYPE_UPLOAD
+	ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES state,
+		const D3D12_CLEAR_VALUE* const clearValue, PlacedAllocation& allocation);
+	// the resource must be gone or unused by the GPU, a new one can be placed over it right away
+	void Release(PlacedAllocation& allocation);
+
+	ResourceHeapStats GetStats(ResourceHeapKind kind) const;
+};
@@ -0,0 +1,119 @@
+#include "ResourceStateTracker.h"
+
+void ResourceStateTracker::SetState(void* resource, uint32_t state)
+{
+	m_states[resource] = state;
+}
+
+void ResourceStateTracker::Forget(void* resource)
+{
+	m_states.erase(resource);
+}
+
+uint32_t ResourceStateTracker::GetState(void* resource) const
+{
+	auto state = m_states.find(resource);
+	return state != m_states.end() ? state->second : RESOURCE_STATE_COMMON;
+}
+
+size_t ResourceStateTracker::GetTrackedCount() const
+{
+	return m_states.size();
+}
+
+CommandListStates::CommandListStates(ResourceStateTracker& tracker)
+	: m_tracker(&tracker), m_stats()
+{
+}
+
+CommandListStates::Entry& CommandListStates::GetEntry(void* resource)
+{
+	// a list uses a handful of resources
+	for (Entry& entry : m_states)
+	{
+		if (entry.resource == resource)
+		{
+			return entry;
+		}
+	}
+
+	Entry entry = { resource, m_tracker->GetState(resource) };
+	m_states.push_back(entry);
+	return m_states.back();
+}
+
+void CommandListStates::Begin()
+{
+	m_states.clear();
+	m_pending.clear();
+}
+
+void CommandListStates::Transition(void* resource, uint32_t state)
+{
+	++m_stats.requested;
+	Entry& entry = GetEntry(resource);
+	if (entry.state == state)
+	{
+		return;
+	}
+
+	// a transition nothing has needed yet is changed instead of followed by another
+	for (size_t i = 0; i < m_pending.size(); ++i)
+	{
+		if (m_pending[i].resource != resource)
+		{
+			continue;
+		}
+
+		m_pending[i].after = state;
+		if (m_pending[i].before == state)
+		{
+			m_pending.erase(m_pending.begin() + i);
+		}
+		entry.state = state;
+		return;
+	}
+
+	StateTransition transition = { resource, entry.state, state };
+	m_pending.push_back(transition);
+	entry.state = state;
+}
+
+void CommandListStates::Flush(std::vector<StateTransition>& transitions)
+{
+	transitions.assign(m_pending.begin(), m_pending.end());
+	m_pending.clear();
+
+	if (!transitions.empty())
+	{
+		m_stats.issued += static_cast<uint32_t>(transitions.size());
+		++m_stats.batches;
+	}
+}
+
+void CommandListStates::End(std::vector<StateTransition>& transitions)
+{
+	Flush(transitions);
+	for (const Entry& entry : m_states)
+	{
+		m_tracker->SetState(entry.resource, entry.state);
+	}
+	m_states.clear();
+}
+
+uint32_t CommandListStates::GetState(void* resource) const
+{
+	for (const Entry& entry : m_states)
+	{
+		if (entry.resource == resource)
+		{
+			return entry.state;
+		}
+	}
+	return m_tracker->GetState(resource);
+}
+
+const ResourceStateStats& CommandListStates::GetStats() const
+{
+	return m_stats;
+}
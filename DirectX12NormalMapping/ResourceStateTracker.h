@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// D3D12_RESOURCE_STATE_COMMON, the state of a resource the tracker has not been told about
+const uint32_t RESOURCE_STATE_COMMON = 0;
+
+// one transition barrier, the states are D3D12_RESOURCE_STATES of every subresource
+struct StateTransition
+{
+	void* resource;	// an ID3D12Resource
+	uint32_t before;
+	uint32_t after;
+};
+
+struct ResourceStateStats
+{
+	uint32_t requested;	// Transition calls
+	uint32_t issued;	// transitions left after the redundant ones were dropped
+	uint32_t batches;	// flushes that had any, one ResourceBarrier call each
+};
+
+// The state each resource is in once the command lists recorded so far
+// have run. Lists on the direct queue run in the order they are recorded, so
+// a list picks its resources up in the state the last one left them in.
+class ResourceStateTracker
+{
+private:
+	std::unordered_map<void*, uint32_t> m_states;
+
+public:
+	void SetState(void* resource, uint32_t state);	// created in state, or a queue left it there
+	void Forget(void* resource);	// the resource is gone, a new one can get its address
+	uint32_t GetState(void* resource) const;
+	size_t GetTrackedCount() const;
+};
+
+// The states of the resources one command list uses while it is recorded.
+// Transition only notes the state the next command needs; the transitions
+// pile up until Flush hands them out for one ResourceBarrier call before
+// the copy or draw that needs them. A transition to the state a resource is
+// already in is dropped, and one that follows a transition not flushed yet
+// is merged into it, or cancels it when it goes back to where it started.
+// Resources are only keys here.
+class CommandListStates
+{
+private:
+	struct Entry
+	{
+		void* resource;
+		uint32_t state;
+	};
+
+	ResourceStateTracker* m_tracker;
+	std::vector<Entry> m_states;	// of the resources this list has used, in the state its commands leave them
+	std::vector<StateTransition> m_pending;
+	ResourceStateStats m_stats;
+
+	Entry& GetEntry(void* resource);
+
+public:
+	explicit CommandListStates(ResourceStateTracker& tracker);
+
+	void Begin();	// the list was reset
+	void Transition(void* resource, uint32_t state);
+	// replaces transitions with the ones to record now, empty when there are none
+	void Flush(std::vector<StateTransition>& transitions);
+	// the list is about to be closed, the tracker takes the states it leaves, transitions as in Flush
+	void End(std::vector<StateTransition>& transitions);
+	uint32_t GetState(void* resource) const;	// as the commands recorded so far leave it
+
+	const ResourceStateStats& GetStats() const;	// since the list was created
+};
@@ -0,0 +1,241 @@
+#include "ResourceStateTrackerTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <vector>
+#include "ResourceStateTracker.h"
+
+using std::mt19937;
+using std::vector;
+
+namespace
+{
+	// D3D12_RESOURCE_STATES, without the Direct3D headers
+	const uint32_t PRESENT = 0;
+	const uint32_t VERTEX_AND_CONSTANT_BUFFER = 0x1;
+	const uint32_t INDEX_BUFFER = 0x2;
+	const uint32_t RENDER_TARGET = 0x4;
+	const uint32_t DEPTH_WRITE = 0x10;
+	const uint32_t PIXEL_SHADER_RESOURCE = 0x80;
+	const uint32_t COPY_DEST = 0x400;
+	const uint32_t COPY_SOURCE = 0x800;
+
+	bool Is(const StateTransition& transition, void* resource, uint32_t before, uint32_t after)
+	{
+		return transition.resource == resource && transition.before == before && transition.after == after;
+	}
+
+	// nothing for the state a resource is in, one transition however often it is asked for
+	bool TestRedundant()
+	{
+		int texture = 0;
+		ResourceStateTracker tracker;
+		tracker.SetState(&texture, PIXEL_SHADER_RESOURCE);
+		CommandListStates list(tracker);
+		vector<StateTransition> transitions;
+
+		list.Transition(&texture, PIXEL_SHADER_RESOURCE);
+		list.Flush(transitions);
+		bool passed = transitions.empty();
+
+		list.Transition(&texture, COPY_SOURCE);
+		list.Transition(&texture, COPY_SOURCE);
+		list.Flush(transitions);
+		passed = passed && transitions.size() == 1 && Is(transitions[0], &texture, PIXEL_SHADER_RESOURCE, COPY_SOURCE);
+
+		list.Transition(&texture, COPY_SOURCE);
+		list.Flush(transitions);
+		passed = passed && transitions.empty();
+		passed = passed && list.GetStats().requested == 4 && list.GetStats().issued == 1 && list.GetStats().batches == 1;
+
+		wprintf(L"  %-40s %s\n", L"redundant transitions", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// transitions nothing needed in between become one, or none when they come back
+	bool TestMerge()
+	{
+		int streamed = 0;
+		int uploaded = 0;
+		ResourceStateTracker tracker;
+		tracker.SetState(&streamed, PIXEL_SHADER_RESOURCE);
+		tracker.SetState(&uploaded, COPY_DEST);
+		CommandListStates list(tracker);
+		vector<StateTransition> transitions;
+
+		list.Transition(&uploaded, COPY_SOURCE);
+		list.Transition(&uploaded, PIXEL_SHADER_RESOURCE);
+		list.Transition(&streamed, COPY_SOURCE);
+		list.Transition(&streamed, PIXEL_SHADER_RESOURCE);
+		list.Flush(transitions);
+		bool passed = transitions.size() == 1 && Is(transitions[0], &uploaded, COPY_DEST, PIXEL_SHADER_RESOURCE);
+
+		// once flushed it is recorded, going back is a transition of its own
+		list.Transition(&streamed, COPY_SOURCE);
+		list.Flush(transitions);
+		list.Transition(&streamed, PIXEL_SHADER_RESOURCE);
+		list.Flush(transitions);
+		passed = passed && transitions.size() == 1 && Is(transitions[0], &streamed, COPY_SOURCE, PIXEL_SHADER_RESOURCE);
+
+		wprintf(L"  %-40s %s\n", L"merged and cancelled transitions", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// a mesh upload, every transition before the draw goes in one batch
+	bool TestBatch()
+	{
+		int vertexBuffer = 0;
+		int indexBuffer = 0;
+		int texture = 0;
+		ResourceStateTracker tracker;
+		CommandListStates list(tracker);
+		vector<StateTransition> transitions;
+
+		// the copy queue left them in COMMON
+		list.Transition(&vertexBuffer, VERTEX_AND_CONSTANT_BUFFER);
+		list.Transition(&indexBuffer, INDEX_BUFFER);
+		list.Transition(&texture, PIXEL_SHADER_RESOURCE);
+		list.End(transitions);
+		bool passed = transitions.size() == 3 && Is(transitions[0], &vertexBuffer, PRESENT, VERTEX_AND_CONSTANT_BUFFER) &&
+			Is(transitions[1], &indexBuffer, PRESENT, INDEX_BUFFER) && Is(transitions[2], &texture, PRESENT, PIXEL_SHADER_RESOURCE);
+		passed = passed && list.GetStats().batches == 1;
+		passed = passed && tracker.GetState(&vertexBuffer) == VERTEX_AND_CONSTANT_BUFFER && tracker.GetState(&texture) == PIXEL_SHADER_RESOURCE;
+
+		tracker.Forget(&texture);
+		passed = passed && tracker.GetState(&texture) == PRESENT && tracker.GetTrackedCount() == 2;
+
+		wprintf(L"  %-40s %s\n", L"one batch per flush", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// the light pass writes the depth map the scene pass samples, the back buffer goes to the screen between frames
+	bool TestFrames()
+	{
+		int lightDepth = 0;
+		int backBuffers[2] = {};
+		ResourceStateTracker tracker;
+		tracker.SetState(&lightDepth, DEPTH_WRITE);
+		tracker.SetState(&backBuffers[0], PRESENT);
+		tracker.SetState(&backBuffers[1], PRESENT);
+		CommandListStates lightList(tracker);
+		CommandListStates sceneList(tracker);
+		vector<StateTransition> transitions;
+		bool passed = true;
+
+		for (uint32_t frame = 0; frame < 4; ++frame)
+		{
+			void* backBuffer = &backBuffers[frame % 2];
+
+			lightList.Begin();
+			lightList.Transition(&lightDepth, DEPTH_WRITE);
+			lightList.Flush(transitions);
+			passed = passed && (frame == 0 ? transitions.empty() :
+				transitions.size() == 1 && Is(transitions[0], &lightDepth, PIXEL_SHADER_RESOURCE, DEPTH_WRITE));
+			lightList.End(transitions);
+			passed = passed && transitions.empty();
+
+			sceneList.Begin();
+			sceneList.Transition(backBuffer, RENDER_TARGET);
+			sceneList.Transition(&lightDepth, PIXEL_SHADER_RESOURCE);
+			sceneList.Flush(transitions);
+			passed = passed && transitions.size() == 2 && Is(transitions[0], backBuffer, PRESENT, RENDER_TARGET) &&
+				Is(transitions[1], &lightDepth, DEPTH_WRITE, PIXEL_SHADER_RESOURCE);
+			sceneList.Transition(backBuffer, PRESENT);
+			sceneList.End(transitions);
+			passed = passed && transitions.size() == 1 && Is(transitions[0], backBuffer, RENDER_TARGET, PRESENT);
+		}
+		passed = passed && tracker.GetState(&lightDepth) == PIXEL_SHADER_RESOURCE && tracker.GetState(&backBuffers[1]) == PRESENT;
+
+		// a list reset before it was closed leaves nothing behind
+		lightList.Begin();
+		lightList.Transition(&lightDepth, DEPTH_WRITE);
+		lightList.Begin();
+		lightList.End(transitions);
+		passed = passed && transitions.empty() && tracker.GetState(&lightDepth) == PIXEL_SHADER_RESOURCE;
+
+		wprintf(L"  %-40s %s\n", L"states carried between lists", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// whatever is asked for, the flushed transitions chain from the tracked states to the last ones asked for
+	bool TestRandom()
+	{
+		const uint32_t states[] = { PRESENT, VERTEX_AND_CONSTANT_BUFFER, PIXEL_SHADER_RESOURCE, COPY_DEST, COPY_SOURCE, DEPTH_WRITE };
+		const uint32_t stateCount = sizeof(states) / sizeof(states[0]);
+		const uint32_t resourceCount = 16;
+		int resources[resourceCount] = {};
+		mt19937 random(2468);
+		ResourceStateTracker tracker;
+		CommandListStates list(tracker);
+		vector<StateTransition> transitions;
+		bool passed = true;
+
+		uint32_t applied[resourceCount];	// what the recorded barriers leave
+		uint32_t requested[resourceCount];
+		for (uint32_t i = 0; i < resourceCount; ++i)
+		{
+			applied[i] = requested[i] = states[random() % stateCount];
+			tracker.SetState(&resources[i], applied[i]);
+		}
+
+		for (uint32_t commandListIndex = 0; commandListIndex < 200; ++commandListIndex)
+		{
+			list.Begin();
+			const uint32_t commandCount = 1 + random() % 32;
+			for (uint32_t command = 0; command < commandCount; ++command)
+			{
+				const uint32_t resource = random() % resourceCount;
+				requested[resource] = states[random() % stateCount];
+				list.Transition(&resources[resource], requested[resource]);
+				passed = passed && list.GetState(&resources[resource]) == requested[resource];
+
+				const bool last = command + 1 == commandCount;
+				if (random() % 4 == 0 || last)
+				{
+					if (last)
+					{
+						list.End(transitions);
+					}
+					else
+					{
+						list.Flush(transitions);
+					}
+
+					// one per resource and batch, none that change nothing, each from where the last left it
+					vector<bool> seen(resourceCount, false);
+					for (const StateTransition& transition : transitions)
+					{
+						const uint32_t index = static_cast<uint32_t>(static_cast<int*>(transition.resource) - resources);
+						passed = passed && !seen[index] && transition.before != transition.after && transition.before == applied[index];
+						seen[index] = true;
+						applied[index] = transition.after;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; i < resourceCount; ++i)
+			{
+				passed = passed && applied[i] == requested[i] && tracker.GetState(&resources[i]) == requested[i];
+			}
+		}
+
+		const ResourceStateStats& stats = list.GetStats();
+		wprintf(L"  %-40s %s  %u requested, %u issued in %u batches\n", L"random transitions", passed ? L"ok" : L"FAILED",
+			stats.requested, stats.issued, stats.batches);
+		return passed;
+	}
+}
+
+int RunResourceStateTrackerTests()
+{
+	int failures = 0;
+
+	failures += TestRedundant() ? 0 : 1;
+	failures += TestMerge() ? 0 : 1;
+	failures += TestBatch() ? 0 : 1;
+	failures += TestFrames() ? 0 : 1;
+	failures += TestRandom() ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// ResourceStateTracker and CommandListStates with made up resources and the
+// D3D12_RESOURCE_STATES values, checks that redundant transitions are
+// dropped or merged, that a flush is one batch, that a list picks up the
+// states the lists recorded before it left, and that random transitions
+// come out as a consistent chain, prints every case and returns 0 when all
+// of them pass
+int RunResourceStateTrackerTests();
@@ -1,3 +1,12 @@
+#ifdef QUANTIZED_VERTICES
+struct VS_INPUT
+{
+	float4 pos : POSITION;	// unorm fraction of the mesh bounds
+	float2 normal : NORMAL;	// octahedral
+	float2 tangent : TANGENT;	// octahedral
+	float2 texCoord : TEXCOORD;
+};
+#else
 struct VS_INPUT
 {
 	float3 pos : POSITION;
@@ -5,6 +14,7 @@ struct VS_INPUT
 	float3 tangent : TANGENT;
 	float2 texCoord : TEXCOORD;
 };
+#endif
 
 struct VS_OUTPUT
 {
@@ -26,34 +36,61 @@ cbuffer WvpConstantBuffer : register(b0)
 	float3 lightWorldPos;
 	float3 lightDirection;	// light's normalized camera forward vector
 	float lightFov;
+	float3 positionOffset;	// quantized positions: offset + position * scale
+	float3 positionScale;
 };
 
 Texture2D tex : register(t0);
 Texture2D normalTex : register(t1);
-Texture2D occlusionTex : register(t2);
-Texture2D roughnessTex : register(t3);
-Texture2D depthTex : register(t4);
+Texture2D ormTex : register(t2);	// occlusion, roughness, specular
+Texture2D depthTex : register(t3);
 SamplerState samplerState : register(s0);
 SamplerComparisonState cmpSampler : register(s1);
 
+#ifdef QUANTIZED_VERTICES
+float3 DecodePosition(float4 pos)
+{
+	return positionOffset + pos.xyz * positionScale;
+}
+
+float3 DecodeDirection(float2 octahedral)
+{
+	float3 direction = float3(octahedral, 1.0f - abs(octahedral.x) - abs(octahedral.y));
+	float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.0f ? -fold : fold;
+	return normalize(direction);
+}
+#else
+float3 DecodePosition(float3 pos)
+{
+	return pos;
+}
+
+float3 DecodeDirection(float3 direction)
+{
+	return direction;
+}
+#endif
+
 VS_OUTPUT vsMain(VS_INPUT input)
 {
 	VS_OUTPUT output;
+	float3 pos = DecodePosition(input.pos);
 
-	output.pos = float4(input.pos, 1.0f);
+	output.pos = float4(pos, 1.0f);
 	output.wvpPos = mul(output.pos, wvp);
 
 	output.worldPos = mul(output.pos, world);
 
-	float3 worldNormal = normalize(mul(input.normal, world));
+	float3 worldNormal = normalize(mul(DecodeDirection(input.normal), world));
 	output.normal = worldNormal;
 
-	float3 worldTangent = mul(input.tangent, world);
+	float3 worldTangent = mul(DecodeDirection(input.tangent), world);
 	output.tangent = worldTangent;
 
 	output.texCoord = input.texCoord;
 
-	output.lightWvpPos = float4(input.pos, 1.0f);
+	output.lightWvpPos = float4(pos, 1.0f);
 	output.lightWvpPos = mul(output.lightWvpPos, lightWvp);
 
 	return output;
@@ -62,6 +99,7 @@ VS_OUTPUT vsMain(VS_INPUT input)
 float4 psMain(VS_OUTPUT input) : SV_TARGET
 {
 	float4 baseColor = tex.Sample(samplerState, input.texCoord);
+	float3 orm = ormTex.Sample(samplerState, input.texCoord).rgb;
 	bool inShadow = false;
 	const float ambient = 0.2f;
 
@@ -96,8 +134,7 @@ float4 psMain(VS_OUTPUT input) : SV_TARGET
 	inShadow = lightFactor <= 0.0f ||
 		(dot(lightDirection, lightVec) < cos(lightFov / 2.0f));
 
-	float occlusion = tex.Sample(samplerState, input.texCoord);
-	occlusion = clamp(occlusion - 0.5f, -0.5f, 0.5f);
+	float occlusion = clamp(orm.r - 0.5f, -0.5f, 0.5f);
 
 	if (inShadow)
 	{
@@ -108,9 +145,10 @@ float4 psMain(VS_OUTPUT input) : SV_TARGET
 		input.tangent = normalize(input.tangent - dot(input.tangent, input.normal) * input.normal);
 		float3 bitangent = cross(input.normal, input.tangent);
 
-		float3 normalMapVec = normalTex.Sample(samplerState, input.texCoord);
-		normalMapVec = 2.0f * normalMapVec - 1.0f;
-		normalMapVec.z = clamp(normalMapVec.z, 0.0f, 1.0f);
+		// only x and y are stored (BC5 has two channels), z is the positive rest of the unit vector
+		float3 normalMapVec;
+		normalMapVec.xy = 2.0f * normalTex.Sample(samplerState, input.texCoord).xy - 1.0f;
+		normalMapVec.z = sqrt(saturate(1.0f - dot(normalMapVec.xy, normalMapVec.xy)));
 		float3x3 TBN2World = float3x3(input.tangent, bitangent, input.normal);
 		float3 absoluteNormal = normalize(mul(normalMapVec, TBN2World));
 
@@ -120,11 +158,12 @@ float4 psMain(VS_OUTPUT input) : SV_TARGET
 		float3 specularDir = lightVec - 2 * dot(lightVec, absoluteNormal) * absoluteNormal;
 		float specular = clamp(dot(specularDir, cameraDir), 0.0f, 1.0f);
 
-		float specularFactor = tex.Sample(samplerState, input.texCoord);
-		specular = pow(specular, 1 / specularFactor);
+		// rough surfaces get a wide highlight, smooth ones a sharp one, the exponent stays between 2 and 1025
+		float specularPower = exp2(10.0f * (1.0f - saturate(orm.g))) + 1.0f;
+		specular = pow(specular, specularPower);
 
 		return clamp(baseColor * (ambient + 0.4 * occlusion +
-			lightFactor * (1.2 * diffuse + specularFactor * specular)), 0.0f, 1.0f);
+			lightFactor * (1.2 * diffuse + orm.b * specular)), 0.0f, 1.0f);
 	}
 }
 
@@ -132,7 +171,7 @@ VS_OUTPUT vsDepth(VS_INPUT input)
 {
 	VS_OUTPUT output;
 
-	output.pos = float4(input.pos, 1.0f);
+	output.pos = float4(DecodePosition(input.pos), 1.0f);
 	output.wvpPos = mul(output.pos, lightWvp);
 
 	return output;
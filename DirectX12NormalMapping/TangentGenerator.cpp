@@ -0,0 +1,472 @@
+#include "TangentGenerator.h"
+#include <intrin.h>
+#include <immintrin.h>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+	// Normalization follows XMVector2Normalize/XMVector3Normalize:
+	// zero length gives zero, infinite length gives QNaN.
+
+	inline void NormalizeScalar3(float& x, float& y, float& z)
+	{
+		float lengthSq = (x * x + y * y) + z * z;
+		float length = sqrtf(lengthSq);
+
+		if (lengthSq == numeric_limits<float>::infinity())
+		{
+			x = y = z = numeric_limits<float>::quiet_NaN();
+		}
+		else if (length == 0.0f)
+		{
+			x = y = z = 0.0f;
+		}
+		else
+		{
+			x /= length;
+			y /= length;
+			z /= length;
+		}
+	}
+
+	inline void NormalizeScalar2(float& x, float& y)
+	{
+		float lengthSq = x * x + y * y;
+		float length = sqrtf(lengthSq);
+
+		if (lengthSq == numeric_limits<float>::infinity())
+		{
+			x = y = numeric_limits<float>::quiet_NaN();
+		}
+		else if (length == 0.0f)
+		{
+			x = y = 0.0f;
+		}
+		else
+		{
+			x /= length;
+			y /= length;
+		}
+	}
+
+	const size_t MIN_TRIANGLES_PER_SLICE = 64 * 1024;
+	const size_t VERTICES_PER_REDUCE_BLOCK = 64 * 1024;
+
+	struct TriangleSlice
+	{
+		size_t firstTriangle;
+		size_t triangleCount;
+		DWORD firstVertex;
+		DWORD lastVertex;	// inclusive
+		vector<XMFLOAT3> tangentSums;
+		vector<UINT> useCounts;
+	};
+
+	inline void AddTangent(XMFLOAT3* tangentSums, UINT* useCounts, DWORD index, float x, float y, float z)
+	{
+		tangentSums[index].x += x;
+		tangentSums[index].y += y;
+		tangentSums[index].z += z;
+		++useCounts[index];
+	}
+
+	void AccumulateScalar(const Vertex* vertices, const DWORD* indices,
+		size_t firstTriangle, size_t lastTriangle,
+		DWORD firstVertex, XMFLOAT3* tangentSums, UINT* useCounts)
+	{
+		for (size_t triangle = firstTriangle; triangle < lastTriangle; ++triangle)
+		{
+			const DWORD index0 = indices[triangle * 3];
+			const DWORD index1 = indices[triangle * 3 + 1];
+			const DWORD index2 = indices[triangle * 3 + 2];
+			const Vertex& vertex0 = vertices[index0];
+			const Vertex& vertex1 = vertices[index1];
+			const Vertex& vertex2 = vertices[index2];
+
+			float deltaPos0X = vertex0.position.x - vertex2.position.x;
+			float deltaPos0Y = vertex0.position.y - vertex2.position.y;
+			float deltaPos0Z = vertex0.position.z - vertex2.position.z;
+			NormalizeScalar3(deltaPos0X, deltaPos0Y, deltaPos0Z);
+
+			float deltaPos1X = vertex2.position.x - vertex1.position.x;
+			float deltaPos1Y = vertex2.position.y - vertex1.position.y;
+			float deltaPos1Z = vertex2.position.z - vertex1.position.z;
+			NormalizeScalar3(deltaPos1X, deltaPos1Y, deltaPos1Z);
+
+			float deltaTexCoord0X = vertex1.textureCoordinate.x - vertex0.textureCoordinate.x;
+			float deltaTexCoord0Y = vertex1.textureCoordinate.y - vertex0.textureCoordinate.y;
+			NormalizeScalar2(deltaTexCoord0X, deltaTexCoord0Y);
+
+			float deltaTexCoord1X = vertex2.textureCoordinate.x - vertex0.textureCoordinate.x;
+			float deltaTexCoord1Y = vertex2.textureCoordinate.y - vertex0.textureCoordinate.y;
+			NormalizeScalar2(deltaTexCoord1X, deltaTexCoord1Y);
+
+			float det = deltaTexCoord0X * deltaTexCoord1Y - deltaTexCoord0Y * deltaTexCoord1X;
+
+			float tangentX = (deltaPos0X * deltaTexCoord0Y - deltaPos1X * deltaTexCoord1Y) / det;
+			float tangentY = (deltaPos0Y * deltaTexCoord0Y - deltaPos1Y * deltaTexCoord1Y) / det;
+			float tangentZ = (deltaPos0Z * deltaTexCoord0Y - deltaPos1Z * deltaTexCoord1Y) / det;
+			NormalizeScalar3(tangentX, tangentY, tangentZ);
+
+			AddTangent(tangentSums, useCounts, index0 - firstVertex, tangentX, tangentY, tangentZ);
+			AddTangent(tangentSums, useCounts, index1 - firstVertex, tangentX, tangentY, tangentZ);
+			AddTangent(tangentSums, useCounts, index2 - firstVertex, tangentX, tangentY, tangentZ);
+		}
+	}
+
+	struct SseOps
+	{
+		typedef __m128 Reg;
+		static const size_t WIDTH = 4;
+
+		static Reg Load(const float* p) { return _mm_load_ps(p); }
+		static void Store(float* p, Reg a) { _mm_store_ps(p, a); }
+		static Reg Set1(float a) { return _mm_set1_ps(a); }
+		static Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+		static Reg Div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm_sqrt_ps(a); }
+		static Reg CmpNeq(Reg a, Reg b) { return _mm_cmpneq_ps(a, b); }
+		static Reg And(Reg a, Reg b) { return _mm_and_ps(a, b); }
+		static Reg AndNot(Reg a, Reg b) { return _mm_andnot_ps(a, b); }
+		static Reg Or(Reg a, Reg b) { return _mm_or_ps(a, b); }
+		static void End() {}
+	};
+
+	struct AvxOps
+	{
+		typedef __m256 Reg;
+		static const size_t WIDTH = 8;
+
+		static Reg Load(const float* p) { return _mm256_load_ps(p); }
+		static void Store(float* p, Reg a) { _mm256_store_ps(p, a); }
+		static Reg Set1(float a) { return _mm256_set1_ps(a); }
+		static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+		static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+		static Reg CmpNeq(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+		static Reg And(Reg a, Reg b) { return _mm256_and_ps(a, b); }
+		static Reg AndNot(Reg a, Reg b) { return _mm256_andnot_ps(a, b); }
+		static Reg Or(Reg a, Reg b) { return _mm256_or_ps(a, b); }
+		static void End() { _mm256_zeroupper(); }
+	};
+
+	template<typename Ops>
+	struct NormalizeConstants
+	{
+		typename Ops::Reg zero;
+		typename Ops::Reg infinity;
+		typename Ops::Reg qnan;
+
+		NormalizeConstants()
+			: zero(Ops::Set1(0.0f)),
+			infinity(Ops::Set1(numeric_limits<float>::infinity())),
+			qnan(Ops::Set1(numeric_limits<float>::quiet_NaN()))
+		{
+		}
+	};
+
+	template<typename Ops>
+	inline typename Ops::Reg NormalizeComponent(typename Ops::Reg component, typename Ops::Reg length,
+		typename Ops::Reg nonZeroMask, typename Ops::Reg finiteMask, const NormalizeConstants<Ops>& constants)
+	{
+		typename Ops::Reg result = Ops::And(Ops::Div(component, length), nonZeroMask);
+		return Ops::Or(Ops::AndNot(finiteMask, constants.qnan), Ops::And(result, finiteMask));
+	}
+
+	template<typename Ops>
+	inline void Normalize3(typename Ops::Reg& x, typename Ops::Reg& y, typename Ops::Reg& z,
+		const NormalizeConstants<Ops>& constants)
+	{
+		typename Ops::Reg lengthSq = Ops::Add(Ops::Add(Ops::Mul(x, x), Ops::Mul(y, y)), Ops::Mul(z, z));
+		typename Ops::Reg length = Ops::Sqrt(lengthSq);
+		typename Ops::Reg nonZeroMask = Ops::CmpNeq(length, constants.zero);
+		typename Ops::Reg finiteMask = Ops::CmpNeq(lengthSq, constants.infinity);
+
+		x = NormalizeComponent<Ops>(x, length, nonZeroMask, finiteMask, constants);
+		y = NormalizeComponent<Ops>(y, length, nonZeroMask, finiteMask, constants);
+		z = NormalizeComponent<Ops>(z, length, nonZeroMask, finiteMask, constants);
+	}
+
+	template<typename Ops>
+	inline void Normalize2(typename Ops::Reg& x, typename Ops::Reg& y, const NormalizeConstants<Ops>& constants)
+	{
+		typename Ops::Reg lengthSq = Ops::Add(Ops::Mul(x, x), Ops::Mul(y, y));
+		typename Ops::Reg length = Ops::Sqrt(lengthSq);
+		typename Ops::Reg nonZeroMask = Ops::CmpNeq(length, constants.zero);
+		typename Ops::Reg finiteMask = Ops::CmpNeq(lengthSq, constants.infinity);
+
+		x = NormalizeComponent<Ops>(x, length, nonZeroMask, finiteMask, constants);
+		y = NormalizeComponent<Ops>(y, length, nonZeroMask, finiteMask, constants);
+	}
+
+	// returns the first triangle that was not processed
+	template<typename Ops>
+	size_t AccumulateSimd(const Vertex* vertices, const DWORD* indices,
+		size_t firstTriangle, size_t lastTriangle,
+		DWORD firstVertex, XMFLOAT3* tangentSums, UINT* useCounts)
+	{
+		typedef typename Ops::Reg Reg;
+		const size_t width = Ops::WIDTH;
+
+		// structure of arrays for one batch
+		alignas(32) float pos0X[width], pos0Y[width], pos0Z[width];
+		alignas(32) float pos1X[width], pos1Y[width], pos1Z[width];
+		alignas(32) float pos2X[width], pos2Y[width], pos2Z[width];
+		alignas(32) float uv0X[width], uv0Y[width];
+		alignas(32) float uv1X[width], uv1Y[width];
+		alignas(32) float uv2X[width], uv2Y[width];
+		alignas(32) float tangentX[width], tangentY[width], tangentZ[width];
+
+		const NormalizeConstants<Ops> constants;
+
+		size_t triangle = firstTriangle;
+		for (; triangle + width <= lastTriangle; triangle += width)
+		{
+			const DWORD* batchIndices = indices + triangle * 3;
+
+			for (size_t lane = 0; lane < width; ++lane)
+			{
+				const Vertex& vertex0 = vertices[batchIndices[lane * 3]];
+				const Vertex& vertex1 = vertices[batchIndices[lane * 3 + 1]];
+				const Vertex& vertex2 = vertices[batchIndices[lane * 3 + 2]];
+
+				pos0X[lane] = vertex0.position.x;
+				pos0Y[lane] = vertex0.position.y;
+				pos0Z[lane] = vertex0.position.z;
+				pos1X[lane] = vertex1.position.x;
+				pos1Y[lane] = vertex1.position.y;
+				pos1Z[lane] = vertex1.position.z;
+				pos2X[lane] = vertex2.position.x;
+				pos2Y[lane] = vertex2.position.y;
+				pos2Z[lane] = vertex2.position.z;
+				uv0X[lane] = vertex0.textureCoordinate.x;
+				uv0Y[lane] = vertex0.textureCoordinate.y;
+				uv1X[lane] = vertex1.textureCoordinate.x;
+				uv1Y[lane] = vertex1.textureCoordinate.y;
+				uv2X[lane] = vertex2.textureCoordinate.x;
+				uv2Y[lane] = vertex2.textureCoordinate.y;
+			}
+
+			Reg p2X = Ops::Load(pos2X);
+			Reg p2Y = Ops::Load(pos2Y);
+			Reg p2Z = Ops::Load(pos2Z);
+
+			Reg deltaPos0X = Ops::Sub(Ops::Load(pos0X), p2X);
+			Reg deltaPos0Y = Ops::Sub(Ops::Load(pos0Y), p2Y);
+			Reg deltaPos0Z = Ops::Sub(Ops::Load(pos0Z), p2Z);
+			Normalize3<Ops>(deltaPos0X, deltaPos0Y, deltaPos0Z, constants);
+
+			Reg deltaPos1X = Ops::Sub(p2X, Ops::Load(pos1X));
+			Reg deltaPos1Y = Ops::Sub(p2Y, Ops::Load(pos1Y));
+			Reg deltaPos1Z = Ops::Sub(p2Z, Ops::Load(pos1Z));
+			Normalize3<Ops>(deltaPos1X, deltaPos1Y, deltaPos1Z, constants);
+
+			Reg t0X = Ops::Load(uv0X);
+			Reg t0Y = Ops::Load(uv0Y);
+
+			Reg deltaTexCoord0X = Ops::Sub(Ops::Load(uv1X), t0X);
+			Reg deltaTexCoord0Y = Ops::Sub(Ops::Load(uv1Y), t0Y);
+			Normalize2<Ops>(deltaTexCoord0X, deltaTexCoord0Y, constants);
+
+			Reg deltaTexCoord1X = Ops::Sub(Ops::Load(uv2X), t0X);
+			Reg deltaTexCoord1Y = Ops::Sub(Ops::Load(uv2Y), t0Y);
+			Normalize2<Ops>(deltaTexCoord1X, deltaTexCoord1Y, constants);
+
+			Reg det = Ops::Sub(Ops::Mul(deltaTexCoord0X, deltaTexCoord1Y), Ops::Mul(deltaTexCoord0Y, deltaTexCoord1X));
+
+			Reg tX = Ops::Div(Ops::Sub(Ops::Mul(deltaPos0X, deltaTexCoord0Y), Ops::Mul(deltaPos1X, deltaTexCoord1Y)), det);
+			Reg tY = Ops::Div(Ops::Sub(Ops::Mul(deltaPos0Y, deltaTexCoord0Y), Ops::Mul(deltaPos1Y, deltaTexCoord1Y)), det);
+			Reg tZ = Ops::Div(Ops::Sub(Ops::Mul(deltaPos0Z, deltaTexCoord0Y), Ops::Mul(deltaPos1Z, deltaTexCoord1Y)), det);
+			Normalize3<Ops>(tX, tY, tZ, constants);
+
+			Ops::Store(tangentX, tX);
+			Ops::Store(tangentY, tY);
+			Ops::Store(tangentZ, tZ);
+
+			// scatter in triangle order so the sums match the scalar kernel
+			for (size_t lane = 0; lane < width; ++lane)
+			{
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					AddTangent(tangentSums, useCounts, batchIndices[lane * 3 + corner] - firstVertex,
+						tangentX[lane], tangentY[lane], tangentZ[lane]);
+				}
+			}
+		}
+
+		Ops::End();
+		return triangle;
+	}
+
+	bool IsAvxSupported()
+	{
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 1);
+
+		const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+		const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx)
+		{
+			return false;
+		}
+
+		// the OS has to save the YMM registers
+		return (_xgetbv(0) & 0x6) == 0x6;
+	}
+
+	bool IsSse2Supported()
+	{
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 1);
+		return (cpuInfo[3] & (1 << 26)) != 0;
+	}
+}
+
+TangentKernel TangentGenerator::SelectKernel()
+{
+	static const TangentKernel kernel =
+		IsAvxSupported() ? TangentKernel::Avx :
+		IsSse2Supported() ? TangentKernel::Sse :
+		TangentKernel::Scalar;
+
+	return kernel;
+}
+
+const wchar_t* TangentGenerator::GetKernelName(TangentKernel kernel)
+{
+	switch (kernel)
+	{
+	case TangentKernel::Sse:
+		return L"SSE";
+	case TangentKernel::Avx:
+		return L"AVX";
+	default:
+		return L"scalar";
+	}
+}
+
+void TangentGenerator::Accumulate(TangentKernel kernel,
+	const Vertex* vertices, const DWORD* indices,
+	size_t firstTriangle, size_t triangleCount,
+	DWORD firstVertex, XMFLOAT3* tangentSums, UINT* useCounts)
+{
+	const size_t lastTriangle = firstTriangle + triangleCount;
+	size_t remaining = firstTriangle;
+
+	if (kernel == TangentKernel::Avx)
+	{
+		remaining = AccumulateSimd<AvxOps>(vertices, indices, firstTriangle, lastTriangle, firstVertex, tangentSums, useCounts);
+	}
+	else if (kernel == TangentKernel::Sse)
+	{
+		remaining = AccumulateSimd<SseOps>(vertices, indices, firstTriangle, lastTriangle, firstVertex, tangentSums, useCounts);
+	}
+
+	AccumulateScalar(vertices, indices, remaining, lastTriangle, firstVertex, tangentSums, useCounts);
+}
+
+void TangentGenerator::Generate(vector<Vertex>& vertices, const vector<DWORD>& indices, TangentKernel kernel)
+{
+	vector<XMFLOAT3> tangentSums(vertices.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	vector<UINT> useCounts(vertices.size(), 0);
+
+	Accumulate(kernel, vertices.data(), indices.data(), 0, indices.size() / 3,
+		0, tangentSums.data(), useCounts.data());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const float count = static_cast<float>(useCounts[i]);
+		vertices[i].tangent.x = tangentSums[i].x / count;
+		vertices[i].tangent.y = tangentSums[i].y / count;
+		vertices[i].tangent.z = tangentSums[i].z / count;
+	}
+}
+
+void TangentGenerator::Generate(vector<Vertex>& vertices, const vector<DWORD>& indices, TangentKernel kernel,
+	ThreadPool& threadPool)
+{
+	const size_t triangleCount = indices.size() / 3;
+	const size_t workerCount = threadPool.GetThreadCount() + 1;
+
+	size_t sliceCount = triangleCount / MIN_TRIANGLES_PER_SLICE;
+	sliceCount = sliceCount < workerCount ? sliceCount : workerCount;
+
+	if (sliceCount < 2 || vertices.empty())
+	{
+		Generate(vertices, indices, kernel);
+		return;
+	}
+
+	// every slice only allocates the vertex range its triangles reference,
+	// which keeps private buffers small for meshes with coherent indices
+	vector<TriangleSlice> slices(sliceCount);
+
+	threadPool.ParallelFor(static_cast<UINT>(sliceCount), [&](UINT i)
+	{
+		TriangleSlice& slice = slices[i];
+		slice.firstTriangle = triangleCount * i / sliceCount;
+		slice.triangleCount = triangleCount * (i + 1) / sliceCount - slice.firstTriangle;
+
+		const DWORD* sliceIndices = indices.data() + slice.firstTriangle * 3;
+		DWORD firstVertex = sliceIndices[0];
+		DWORD lastVertex = sliceIndices[0];
+		for (size_t j = 1; j < slice.triangleCount * 3; ++j)
+		{
+			firstVertex = sliceIndices[j] < firstVertex ? sliceIndices[j] : firstVertex;
+			lastVertex = sliceIndices[j] > lastVertex ? sliceIndices[j] : lastVertex;
+		}
+
+		slice.firstVertex = firstVertex;
+		slice.lastVertex = lastVertex;
+		slice.tangentSums.assign(lastVertex - firstVertex + 1, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		slice.useCounts.assign(lastVertex - firstVertex + 1, 0);
+
+		Accumulate(kernel, vertices.data(), indices.data(), slice.firstTriangle, slice.triangleCount,
+			slice.firstVertex, slice.tangentSums.data(), slice.useCounts.data());
+	});
+
+	// reduce the slices block by block and divide by the use count
+	const size_t vertexCount = vertices.size();
+	const size_t blockCount = (vertexCount + VERTICES_PER_REDUCE_BLOCK - 1) / VERTICES_PER_REDUCE_BLOCK;
+
+	threadPool.ParallelFor(static_cast<UINT>(blockCount), [&](UINT block)
+	{
+		const size_t blockBegin = block * VERTICES_PER_REDUCE_BLOCK;
+		const size_t blockEnd = blockBegin + VERTICES_PER_REDUCE_BLOCK < vertexCount ?
+			blockBegin + VERTICES_PER_REDUCE_BLOCK : vertexCount;
+
+		vector<XMFLOAT3> tangentSums(blockEnd - blockBegin, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		vector<UINT> useCounts(blockEnd - blockBegin, 0);
+
+		for (const TriangleSlice& slice : slices)
+		{
+			const size_t overlapBegin = slice.firstVertex > blockBegin ? slice.firstVertex : blockBegin;
+			const size_t overlapEnd = slice.lastVertex + 1 < blockEnd ? slice.lastVertex + 1 : blockEnd;
+
+			for (size_t v = overlapBegin; v < overlapEnd; ++v)
+			{
+				const XMFLOAT3& sliceSum = slice.tangentSums[v - slice.firstVertex];
+				XMFLOAT3& sum = tangentSums[v - blockBegin];
+				sum.x += sliceSum.x;
+				sum.y += sliceSum.y;
+				sum.z += sliceSum.z;
+				useCounts[v - blockBegin] += slice.useCounts[v - slice.firstVertex];
+			}
+		}
+
+		for (size_t v = blockBegin; v < blockEnd; ++v)
+		{
+			const float count = static_cast<float>(useCounts[v - blockBegin]);
+			vertices[v].tangent.x = tangentSums[v - blockBegin].x / count;
+			vertices[v].tangent.y = tangentSums[v - blockBegin].y / count;
+			vertices[v].tangent.z = tangentSums[v - blockBegin].z / count;
+		}
+	});
+}
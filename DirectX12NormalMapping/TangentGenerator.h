@@ -0,0 +1,40 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <vector>
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+enum class TangentKernel
+{
+	Scalar,
+	Sse,	// 4 triangles per iteration
+	Avx	// 8 triangles per iteration
+};
+
+// Per vertex tangents: the normalized tangent of every triangle is summed into
+// its three vertices and the sum is divided by the number of uses.
+// Triangle data is gathered into structure of arrays form so the SIMD kernels
+// work on several triangles at once. Large meshes are split into triangle
+// slices, each accumulating into a private buffer covering only the vertex
+// range its slice touches, followed by a parallel reduce and divide.
+class TangentGenerator
+{
+public:
+	static TangentKernel SelectKernel();
+	static const wchar_t* GetKernelName(TangentKernel kernel);
+
+	// adds the tangents of triangles [firstTriangle, firstTriangle + triangleCount)
+	// into tangentSums and counts the uses of every vertex, both arrays start
+	// at vertex firstVertex
+	static void Accumulate(TangentKernel kernel,
+		const Vertex* vertices, const DWORD* indices,
+		size_t firstTriangle, size_t triangleCount,
+		DWORD firstVertex, XMFLOAT3* tangentSums, UINT* useCounts);
+
+	static void Generate(std::vector<Vertex>& vertices, const std::vector<DWORD>& indices, TangentKernel kernel);
+	static void Generate(std::vector<Vertex>& vertices, const std::vector<DWORD>& indices, TangentKernel kernel,
+		ThreadPool& threadPool);
+};
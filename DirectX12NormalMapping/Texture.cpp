@@ -2,29 +2,101 @@
 #include <wrl.h>
 #include <wincodec.h>
 #include "Engine.h"
+#include "Ktx2File.h"
+#include "OrmPacker.h"
+#include "PngDecoder.h"
 #include <wchar.h>
+#include <chrono>
+
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+
+namespace
+{
+	double ElapsedMs(high_resolution_clock::time_point start)
+	{
+		return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+}
 
 Texture::Texture(Engine * const engine)
 {
 	m_engine = engine;
+	m_loadTimes = {};
+	m_streaming = false;
+	m_copyPending = false;
+	m_firstMip = 0;
+	m_cpuDescriptorHandle = {};
+	m_placement = {};
+	m_placement.block = HEAP_ALLOCATOR_NONE;
+	m_residencyIndex = RESIDENCY_NONE;
+}
+
+void Texture::LoadFromTextureFile(const wchar_t* const fileName, bool ktx2)
+{
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	m_file = std::make_unique<MappedFile>();
+	if (!m_file->Open(fileName))
+	{
+		exit(-1);
+	}
+
+	const bool parsed = ktx2 ? Ktx2File::Parse(m_file->GetData(), m_file->GetSize(), m_fileInfo) :
+		DdsFile::Parse(m_file->GetData(), m_file->GetSize(), m_fileInfo);
+	if (!parsed)
+	{
+		exit(-1);
+	}
+
+	m_textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(m_fileInfo.format), m_fileInfo.width, m_fileInfo.height, 1,
+		static_cast<UINT16>(m_fileInfo.mipCount));
+	m_data.reset();
+
+	m_loadTimes = {};
+	m_loadTimes.decodeMs = ElapsedMs(start);
+}
+
+const BYTE* Texture::GetMipData(UINT mip) const
+{
+	if (m_file)
+	{
+		return m_file->GetData() + m_fileInfo.mipOffsets[mip];
+	}
+
+	const BYTE* mipData = m_data.get();
+	UINT32 mipWidth = static_cast<UINT32>(m_textureDesc.Width);
+	UINT32 mipHeight = m_textureDesc.Height;
+	for (UINT i = 0; i < mip; ++i)
+	{
+		mipData += DdsFile::GetMipChainSize(m_textureDesc.Format, mipWidth, mipHeight, 1);
+		mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+		mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+	}
+	return mipData;
 }
 
-void Texture::LoadFromFile(const wchar_t * const fileName)
+unique_ptr<BYTE[]> Texture::DecodeFile(const wchar_t* const fileName, UINT& width, UINT& height)
 {
 	using namespace Microsoft::WRL;
 
-	m_textureDesc = {};
-	m_textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	m_textureDesc.Alignment = 0;
-	m_textureDesc.DepthOrArraySize = 1;
-	m_textureDesc.MipLevels = 1;
-	m_textureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-	m_textureDesc.SampleDesc.Count = 1;
-	m_textureDesc.SampleDesc.Quality = 0;
-	m_textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-	m_textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-	CoInitialize(nullptr);
+	// PNGs are decoded here, interlaced ones and other formats go through WIC
+	{
+		MappedFile file;
+		if (file.Open(fileName) && PngDecoder::IsPng(file.GetData(), static_cast<size_t>(file.GetSize())))
+		{
+			uint32_t pngWidth, pngHeight;
+			unique_ptr<BYTE[]> pixels = PngDecoder::Decode(file.GetData(), static_cast<size_t>(file.GetSize()), pngWidth, pngHeight);
+			if (pixels)
+			{
+				width = pngWidth;
+				height = pngHeight;
+				return pixels;
+			}
+		}
+	}
+
+	// runs on the loader threads
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
 	ComPtr<IWICImagingFactory> imagingFactory = nullptr;
 
 	HRESULT hr = CoCreateInstance(
@@ -70,9 +142,6 @@ void Texture::LoadFromFile(const wchar_t * const fileName)
 		exit(-1);
 	}
 
-	m_textureDesc.Width = textureWidth;
-	m_textureDesc.Height = textureHeight;
-
 	const UINT bytesPerPixel = 4;
 
 	UINT textureSize = textureWidth * textureHeight * bytesPerPixel;
@@ -81,106 +150,343 @@ void Texture::LoadFromFile(const wchar_t * const fileName)
 		exit(-1);
 	}
 
-	WICPixelFormatGUID pixelFormat;
-	hr = frame->GetPixelFormat(&pixelFormat);
+	// grey and RGB images as well, the block compressor relies on the channel order
+	ComPtr<IWICFormatConverter> converter;
+	hr = imagingFactory->CreateFormatConverter(&converter);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
 
-	m_data = std::make_unique<BYTE[]>(textureSize);
+	hr = converter->Initialize(frame, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	unique_ptr<BYTE[]> pixels = std::make_unique<BYTE[]>(textureSize);
 
 	UINT bytesPerRow = textureWidth * bytesPerPixel;
-	hr = frame->CopyPixels(nullptr, bytesPerRow, textureSize, m_data.get());
+	hr = converter->CopyPixels(nullptr, bytesPerRow, textureSize, pixels.get());
 
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
+
+	width = textureWidth;
+	height = textureHeight;
+	return pixels;
 }
 
-void Texture::CreateResource(const wchar_t * const textureName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle)
+void Texture::GenerateMips(const BYTE* pixels, UINT width, UINT height, MipContent content, MipFilter filter)
 {
-	//deafult heap
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	const UINT mipCount = MipGenerator::GetMipCount(width, height);
+	m_textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_B8G8R8A8_UNORM, width, height, 1, static_cast<UINT16>(mipCount));
+
+	m_file.reset();
+	m_data = std::make_unique<BYTE[]>(static_cast<size_t>(MipGenerator::GetChainSize(width, height, mipCount)));
+	MipGenerator::Generate(filter, content, MipKernel::Sse, pixels, width, height, mipCount, m_data.get(),
+		ThreadPool::GetShared());
+	m_loadTimes.mipMs = ElapsedMs(start);
+}
 
-	HRESULT hr = m_engine->GetDevice()->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&m_textureDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&m_textureDefaultHeap)
-	);
+void Texture::LoadFromFile(const wchar_t * const fileName, MipContent content, MipFilter filter)
+{
+	const wstring name(fileName);
+	m_reload = [name, content, filter](Texture& texture) { texture.LoadFromFile(name.c_str(), content, filter); };
 
-	if (FAILED(hr))
+	const size_t nameLength = wcslen(fileName);
+	if (nameLength > 4 && _wcsicmp(fileName + nameLength - 4, L".dds") == 0)
 	{
-		exit(-1);
+		LoadFromTextureFile(fileName, false);
+		return;
+	}
+	if (nameLength > 5 && _wcsicmp(fileName + nameLength - 5, L".ktx2") == 0)
+	{
+		LoadFromTextureFile(fileName, true);
+		return;
 	}
 
-	wstring defaultHeapName(textureName);
-	defaultHeapName += L" - DefaultHeap";
-	m_textureDefaultHeap->SetName(defaultHeapName.c_str());
-
-	// upload heap
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	UINT width, height;
+	unique_ptr<BYTE[]> pixels = DecodeFile(fileName, width, height);
+	m_loadTimes = {};
+	m_loadTimes.decodeMs = ElapsedMs(start);
 
-	UINT64 textureBufferUploadSize;
-	m_engine->GetDevice()->GetCopyableFootprints(&m_textureDesc, 0, 1, 0, nullptr, nullptr, nullptr, &textureBufferUploadSize);
+	GenerateMips(pixels.get(), width, height, content, filter);
+}
 
-	hr = m_engine->GetDevice()->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(textureBufferUploadSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_textureUploadHeap)
-	);
+void Texture::LoadOrmFromFiles(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName,
+	const wchar_t* const specularFileName, MipFilter filter)
+{
+	const wstring occlusionName(occlusionFileName);
+	const wstring roughnessName(roughnessFileName);
+	const wstring specularName(specularFileName != nullptr ? specularFileName : L"");
+	m_reload = [occlusionName, roughnessName, specularName, filter](Texture& texture)
+	{
+		texture.LoadOrmFromFiles(occlusionName.c_str(), roughnessName.c_str(), specularName.empty() ? nullptr : specularName.c_str(), filter);
+	};
+
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	const wchar_t* fileNames[ORM_CHANNEL_COUNT] = { occlusionFileName, roughnessFileName, specularFileName };
+	unique_ptr<BYTE[]> sources[ORM_CHANNEL_COUNT];
+	UINT widths[ORM_CHANNEL_COUNT] = {};
+	UINT heights[ORM_CHANNEL_COUNT] = {};
+	const UINT sourceCount = specularFileName != nullptr ? 3 : 2;
+
+	// the calling loader thread decodes one of them itself
+	ThreadPool::GetShared().ParallelFor(sourceCount, [&](UINT i)
+	{
+		sources[i] = DecodeFile(fileNames[i], widths[i], heights[i]);
+	});
 
-	if (FAILED(hr))
+	const UINT width = widths[0];
+	const UINT height = heights[0];
+	for (UINT i = 1; i < sourceCount; ++i)
 	{
-		exit(-1);
+		if (widths[i] != width || heights[i] != height)
+		{
+			exit(-1);
+		}
 	}
 
-	wstring uploadHeapName(textureName);
-	uploadHeapName += L" - Upload Heap";
-	m_textureUploadHeap->SetName(uploadHeapName.c_str());
+	m_loadTimes = {};
+	m_loadTimes.decodeMs = ElapsedMs(start);
+
+	// packed in place of the occlusion pixels
+	start = high_resolution_clock::now();
+	BYTE* occlusion = sources[0].get();
+	OrmPacker::Pack(occlusion, sources[1].get(), sources[2].get(), static_cast<size_t>(width) * height, occlusion);
+	m_loadTimes.packMs = ElapsedMs(start);
+
+	GenerateMips(occlusion, width, height, MipContent::Linear, filter);
+}
 
-	// SRV descriptor
+void Texture::LoadSolidColor(BYTE blue, BYTE green, BYTE red, BYTE alpha)
+{
+	m_textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_B8G8R8A8_UNORM, 1, 1, 1, 1);
+	m_reload = [blue, green, red, alpha](Texture& texture) { texture.LoadSolidColor(blue, green, red, alpha); };
+
+	m_file.reset();
+	m_data = std::make_unique<BYTE[]>(4);
+	m_data[0] = blue;
+	m_data[1] = green;
+	m_data[2] = red;
+	m_data[3] = alpha;
+}
+
+void Texture::SetStreaming(bool streaming)
+{
+	m_streaming = streaming;
+}
+
+D3D12_RESOURCE_DESC Texture::GetResourceDesc(UINT firstMip) const
+{
+	D3D12_RESOURCE_DESC resourceDesc = m_textureDesc;
+	resourceDesc.Width = m_textureDesc.Width >> firstMip > 0 ? m_textureDesc.Width >> firstMip : 1;
+	resourceDesc.Height = m_textureDesc.Height >> firstMip > 0 ? m_textureDesc.Height >> firstMip : 1;
+	resourceDesc.MipLevels = static_cast<UINT16>(m_textureDesc.MipLevels - firstMip);
+	return resourceDesc;
+}
+
+ComPtr<ID3D12Resource> Texture::CreateDefaultHeap(UINT firstMip, PlacedAllocation& placement) const
+{
+	// placed in one of the engine's texture heaps
+	ComPtr<ID3D12Resource> defaultHeap = m_engine->GetResourceHeaps().CreateResource(GetResourceDesc(firstMip), D3D12_HEAP_TYPE_DEFAULT,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, placement);
+
+	wstring defaultHeapName(m_name);
+	defaultHeapName += L" - DefaultHeap";
+	defaultHeap->SetName(defaultHeapName.c_str());
+	m_engine->SetResourceState(defaultHeap.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+	return defaultHeap;
+}
+
+void Texture::CreateShaderResourceView() const
+{
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.Format = m_textureDesc.Format;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.MipLevels = m_textureDesc.MipLevels - m_firstMip;
 
 	m_engine->GetDevice()->CreateShaderResourceView(
 		m_textureDefaultHeap.Get(),
 		&srvDesc,
-		cpuDescriptorHandle
+		m_cpuDescriptorHandle
 	);
 }
 
-void Texture::UploadToResource()
+void Texture::UploadMips(ID3D12GraphicsCommandList* const commandList, ID3D12Resource* destination, UINT firstMip, UINT mipCount)
+{
+	// where the levels go in upload memory, relative to the start of the allocation
+	D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(firstMip);
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT layouts[D3D12_REQ_MIP_LEVELS];
+	UINT rowCounts[D3D12_REQ_MIP_LEVELS];
+	UINT64 rowSizes[D3D12_REQ_MIP_LEVELS];
+	UINT64 uploadSize;
+	m_engine->GetDevice()->GetCopyableFootprints(&resourceDesc, 0, mipCount, 0, layouts, rowCounts, rowSizes, &uploadSize);
+
+	// mapped files go straight from the mapping into the ring
+	const UploadAllocation upload = m_engine->AllocateUpload(commandList, uploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	for (UINT i = 0; i < mipCount; ++i)
+	{
+		const UINT mip = firstMip + i;
+		const UINT32 mipWidth = m_textureDesc.Width >> mip > 0 ? static_cast<UINT32>(m_textureDesc.Width >> mip) : 1;
+		const UINT64 rowPitch = DdsFile::GetRowPitch(m_textureDesc.Format, mipWidth);
+		const BYTE* source = GetMipData(mip);
+		BYTE* uploadData = upload.data + layouts[i].Offset;
+
+		// rows are 256 byte aligned in upload memory, the larger levels are already
+		if (rowPitch == layouts[i].Footprint.RowPitch)
+		{
+			memcpy(uploadData, source, static_cast<size_t>(rowPitch * rowCounts[i]));
+		}
+		else
+		{
+			for (UINT row = 0; row < rowCounts[i]; ++row)
+			{
+				memcpy(uploadData + row * layouts[i].Footprint.RowPitch, source + row * rowPitch, static_cast<size_t>(rowSizes[i]));
+			}
+		}
+
+		layouts[i].Offset += upload.offset;
+		CD3DX12_TEXTURE_COPY_LOCATION copyDestination(destination, i);
+		CD3DX12_TEXTURE_COPY_LOCATION copySource(upload.resource, layouts[i]);
+		commandList->CopyTextureRegion(&copyDestination, 0, 0, 0, &copySource, nullptr);
+	}
+}
+
+void Texture::CreateResource(const wchar_t * const textureName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle, UINT firstMip)
 {
-	D3D12_SUBRESOURCE_DATA textureSubresource = {};
-	textureSubresource.pData = m_data.get();
-	textureSubresource.RowPitch = 4 * m_textureDesc.Width;
-	textureSubresource.SlicePitch = textureSubresource.RowPitch * m_textureDesc.Height;
+	m_name = textureName;
+	m_cpuDescriptorHandle = cpuDescriptorHandle;
+	m_firstMip = firstMip < m_textureDesc.MipLevels ? firstMip : m_textureDesc.MipLevels - 1;
 
-	UpdateSubresources(m_engine->GetCommandList().Get(), 
-		m_textureDefaultHeap.Get(), m_textureUploadHeap.Get(), 0, 0, 1, &textureSubresource);
+	RetireDefaultHeap();
+	m_textureDefaultHeap = CreateDefaultHeap(m_firstMip, m_placement);
+	CreateShaderResourceView();
+}
 
-	m_engine->GetCommandList()->ResourceBarrier(
-		1,
-		&CD3DX12_RESOURCE_BARRIER::Transition(
-			m_textureDefaultHeap.Get(),
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-		)
-	);
+void Texture::UploadToResource(ID3D12GraphicsCommandList* const commandList)
+{
+	// every resident level in one copy
+	UploadMips(commandList, m_textureDefaultHeap.Get(), m_firstMip, m_textureDesc.MipLevels - m_firstMip);
+
+	// the ring has its own copy now, streamed textures still need the finer levels
+	if (!m_streaming)
+	{
+		m_data.reset();
+		m_file.reset();
+	}
+
+	// a copy queue cannot transition to shader states, the resource decays to COMMON once its copies have run
+	if (commandList->GetType() == D3D12_COMMAND_LIST_TYPE_COPY)
+	{
+		m_copyPending = true;
+		return;
+	}
+
+	m_engine->TransitionResource(commandList, m_textureDefaultHeap.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void Texture::FinishCopy(ID3D12GraphicsCommandList* const commandList)
+{
+	m_engine->SetResourceState(m_textureDefaultHeap.Get(), D3D12_RESOURCE_STATE_COMMON);
+	m_engine->TransitionResource(commandList, m_textureDefaultHeap.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	m_copyPending = false;
+}
+
+bool Texture::IsCopyPending() const
+{
+	return m_copyPending;
+}
+
+void Texture::StreamMips(UINT firstMip, ID3D12GraphicsCommandList* const commandList)
+{
+	if (firstMip == m_firstMip || firstMip >= m_textureDesc.MipLevels)
+	{
+		return;
+	}
+
+	PlacedAllocation streamedPlacement;
+	ComPtr<ID3D12Resource> streamedHeap = CreateDefaultHeap(firstMip, streamedPlacement);
+
+	// with whatever else the list has pending
+	m_engine->TransitionResource(commandList, m_textureDefaultHeap.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+	m_engine->FlushBarriers(commandList);
+
+	// the levels both resources hold stay on the GPU
+	const UINT sharedFirstMip = firstMip > m_firstMip ? firstMip : m_firstMip;
+	for (UINT mip = sharedFirstMip; mip < m_textureDesc.MipLevels; ++mip)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION destination(streamedHeap.Get(), mip - firstMip);
+		CD3DX12_TEXTURE_COPY_LOCATION source(m_textureDefaultHeap.Get(), mip - m_firstMip);
+		commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+	}
+
+	// finer levels from the CPU copy
+	if (firstMip < m_firstMip)
+	{
+		UploadMips(commandList, streamedHeap.Get(), firstMip, m_firstMip - firstMip);
+	}
+
+	m_engine->TransitionResource(commandList, streamedHeap.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	RetireDefaultHeap();
+	m_textureDefaultHeap = streamedHeap;
+	m_placement = streamedPlacement;
+	m_firstMip = firstMip;
+	CreateShaderResourceView();
+}
+
+void Texture::RetireDefaultHeap()
+{
+	if (!m_textureDefaultHeap)
+	{
+		return;
+	}
+
+	// replaced while the GPU may still use it, it goes with its heap space once the engine's fence passes this frame
+	m_engine->RetireResource(m_textureDefaultHeap, m_placement);
+}
+
+void Texture::Evict()
+{
+	// the SRV keeps pointing at the retired resource, nothing samples an evicted texture
+	RetireDefaultHeap();
+}
+
+void Texture::Restore(ID3D12GraphicsCommandList* const commandList)
+{
+	if (!m_data && !m_file)
+	{
+		// a copy, the load replaces m_reload
+		function<void(Texture&)> reload = m_reload;
+		reload(*this);
+	}
+
+	const wstring name(m_name);
+	CreateResource(name.c_str(), m_cpuDescriptorHandle);
+	UploadToResource(commandList);
 }
 
 void Texture::Release()
 {
-	m_data.release();
+	m_data.reset();
+	m_file.reset();
+}
+
+void Texture::SetResidencyIndex(UINT residencyIndex)
+{
+	m_residencyIndex = residencyIndex;
+}
+
+UINT Texture::GetResidencyIndex() const
+{
+	return m_residencyIndex;
 }
 
 UINT Texture::GetWidth() const
@@ -193,7 +499,45 @@ UINT Texture::GetHeight() const
 	return m_textureDesc.Height;
 }
 
-BYTE* Texture::GetData() const
+UINT Texture::GetMipLevels() const
+{
+	return m_textureDesc.MipLevels;
+}
+
+UINT Texture::GetFirstResidentMip() const
+{
+	return m_firstMip;
+}
+
+UINT64 Texture::GetResidentBytes() const
+{
+	if (!m_textureDefaultHeap)
+	{
+		return 0;
+	}
+
+	D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(m_firstMip);
+	return DdsFile::GetMipChainSize(resourceDesc.Format, static_cast<UINT32>(resourceDesc.Width), resourceDesc.Height,
+		resourceDesc.MipLevels);
+}
+
+UINT64 Texture::GetAllocationSize(UINT firstMip) const
+{
+	D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(firstMip);
+	return m_engine->GetDevice()->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+}
+
+const TextureLoadTimes& Texture::GetLoadTimes() const
+{
+	return m_loadTimes;
+}
+
+DXGI_FORMAT Texture::GetFormat() const
+{
+	return m_textureDesc.Format;
+}
+
+const BYTE* Texture::GetData() const
 {
-	return m_data.get();
+	return m_file || m_data ? GetMipData(0) : nullptr;
 }
@@ -2,34 +2,103 @@
 
 #define NOMINMAX
 
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 #include <d3d12.h>
 #include <wrl.h>
+#include "MipGenerator.h"
+#include "MappedFile.h"
+#include "DdsFile.h"
+#include "ResourceHeaps.h"
 
 using namespace std;
 using Microsoft::WRL::ComPtr;
 
+// where the load time of a texture went, for the startup report
+struct TextureLoadTimes
+{
+	double decodeMs;	// PNG or WIC decoding, or mapping and parsing a .dds or .ktx2 file
+	double packMs;	// ORM packing
+	double mipMs;	// mip chain generation
+};
+
 class Texture
 {
 private:
 	class Engine* m_engine;
 
-	unique_ptr<BYTE[]> m_data;
+	unique_ptr<BYTE[]> m_data;	// decoded images
+	unique_ptr<MappedFile> m_file;	// .dds and .ktx2 files, mapped until their levels are copied to the upload ring, or while streaming
+	TextureFileInfo m_fileInfo;
+	TextureLoadTimes m_loadTimes;
 	D3D12_RESOURCE_DESC m_textureDesc;
 
 	ComPtr<ID3D12Resource> m_textureDefaultHeap;
-	ComPtr<ID3D12Resource> m_textureUploadHeap;
+	PlacedAllocation m_placement;	// of m_textureDefaultHeap in the engine's resource heaps
+
+	// streaming, the default heap holds the levels from m_firstMip down
+	bool m_streaming;
+	bool m_copyPending;	// uploaded on a copy queue, waiting for FinishCopy
+	UINT m_firstMip;
+	wstring m_name;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_cpuDescriptorHandle;
+
+	// residency, the CPU copy goes once it is in the upload ring, an evicted texture is loaded again
+	function<void(Texture&)> m_reload;
+	UINT m_residencyIndex;
+
+	void LoadFromTextureFile(const wchar_t* const fileName, bool ktx2);
+	const BYTE* GetMipData(UINT mip) const;
+	// any WIC image as BGRA8, PNGs through PngDecoder unless it leaves them to WIC
+	static unique_ptr<BYTE[]> DecodeFile(const wchar_t* const fileName, UINT& width, UINT& height);
+	void GenerateMips(const BYTE* pixels, UINT width, UINT height, MipContent content, MipFilter filter);
+	D3D12_RESOURCE_DESC GetResourceDesc(UINT firstMip) const;
+	ComPtr<ID3D12Resource> CreateDefaultHeap(UINT firstMip, PlacedAllocation& placement) const;
+	void RetireDefaultHeap();
+	void CreateShaderResourceView() const;
+	// levels firstMip to firstMip + mipCount - 1 of the CPU copy, through the engine's upload ring into the first subresources of destination
+	void UploadMips(ID3D12GraphicsCommandList* const commandList, ID3D12Resource* destination, UINT firstMip, UINT mipCount);
 
 public:
 	Texture(Engine* const engine);
 
-	void LoadFromFile(const wchar_t* const fileName);
-	void CreateResource(const wchar_t * const textureName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle);
-	void UploadToResource();
+	// .dds files cooked with -cook-texture and .ktx2 files are mapped and used as they are with their
+	// mips, anything else is decoded to BGRA8 and gets its mip chain generated on the shared thread pool
+	void LoadFromFile(const wchar_t* const fileName, MipContent content, MipFilter filter = MipFilter::Kaiser);
+	// packs the grey images into one ORM texture, see OrmPacker, specularFileName can be null,
+	// the images are decoded concurrently on the shared thread pool
+	void LoadOrmFromFiles(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName,
+		const wchar_t* const specularFileName, MipFilter filter = MipFilter::Kaiser);
+	void LoadSolidColor(BYTE blue, BYTE green, BYTE red, BYTE alpha);	// 1x1 placeholder
+	// a streamed texture keeps its levels on the CPU after the upload, see MipStreamer
+	void SetStreaming(bool streaming);
+	// the resource holds the levels from firstMip down to 1x1
+	void CreateResource(const wchar_t * const textureName, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptorHandle, UINT firstMip = 0);
+	// on a copy list the texture is left for FinishCopy, on a direct list it is ready for the pixel shader
+	void UploadToResource(ID3D12GraphicsCommandList* const commandList);
+	// on a direct list that runs after the copy queue has finished the upload
+	void FinishCopy(ID3D12GraphicsCommandList* const commandList);
+	bool IsCopyPending() const;
+	// replaces the resource with one holding the levels from firstMip down, the levels both have are copied on the GPU,
+	// finer ones come from the CPU copy, and the SRV is rewritten in place
+	void StreamMips(UINT firstMip, ID3D12GraphicsCommandList* const commandList);
+	void Evict();	// gives up the resource, the SRV must not be used until Restore
+	// loads the texture again unless it kept its CPU copy, and uploads every level
+	void Restore(ID3D12GraphicsCommandList* const commandList);
 	void Release();
+	void SetResidencyIndex(UINT residencyIndex);	// see ResidencyManager
+	UINT GetResidencyIndex() const;
 
 	UINT GetWidth() const;
 	UINT GetHeight() const;
-	BYTE* GetData() const;
+	UINT GetMipLevels() const;
+	UINT GetFirstResidentMip() const;
+	UINT64 GetResidentBytes() const;	// of the levels in the resource, 0 before CreateResource
+	UINT64 GetAllocationSize(UINT firstMip) const;	// of a resource holding the levels from firstMip down
+	const TextureLoadTimes& GetLoadTimes() const;	// of the last Load call
+	DXGI_FORMAT GetFormat() const;
+	const BYTE* GetData() const;	// the largest level, for decoded images and .dds files the others follow it
 };
 
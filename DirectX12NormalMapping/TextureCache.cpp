@@ -0,0 +1,350 @@
+#include "TextureCache.h"
+#include <cstring>
+#include <cwctype>
+#include "d3dx12.h"
+#include "Engine.h"
+#include "MappedFile.h"
+
+namespace
+{
+	// keeps the ORM textures apart from single images with the same sources
+	const UINT64 ORM_HASH_SEED = 16;
+
+	UINT64 MixHash(UINT64 hash)
+	{
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// paths compare the way Windows does, without case and with either slash
+	wstring NormalizePath(const wchar_t* const fileName)
+	{
+		wstring path(fileName);
+		for (wchar_t& character : path)
+		{
+			character = character == L'/' ? L'\\' : static_cast<wchar_t>(towlower(character));
+		}
+		return path;
+	}
+}
+
+TextureHandle::TextureHandle()
+	: m_cache(nullptr), m_entry(nullptr)
+{
+}
+
+TextureHandle::TextureHandle(TextureCache* cache, TextureCacheEntry* entry)
+	: m_cache(cache), m_entry(entry)
+{
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+	: m_cache(other.m_cache), m_entry(other.m_entry)
+{
+	if (m_entry != nullptr)
+	{
+		m_cache->AddRef(m_entry);
+	}
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other)
+	: m_cache(other.m_cache), m_entry(other.m_entry)
+{
+	other.m_cache = nullptr;
+	other.m_entry = nullptr;
+}
+
+TextureHandle::~TextureHandle()
+{
+	if (m_entry != nullptr)
+	{
+		m_cache->Release(m_entry);
+	}
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+	// the new reference first, other can be this
+	if (other.m_entry != nullptr)
+	{
+		other.m_cache->AddRef(other.m_entry);
+	}
+	if (m_entry != nullptr)
+	{
+		m_cache->Release(m_entry);
+	}
+
+	m_cache = other.m_cache;
+	m_entry = other.m_entry;
+	return *this;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle&& other)
+{
+	if (this != &other)
+	{
+		if (m_entry != nullptr)
+		{
+			m_cache->Release(m_entry);
+		}
+
+		m_cache = other.m_cache;
+		m_entry = other.m_entry;
+		other.m_cache = nullptr;
+		other.m_entry = nullptr;
+	}
+	return *this;
+}
+
+Texture* TextureHandle::Get() const
+{
+	return m_entry != nullptr ? m_entry->texture.get() : nullptr;
+}
+
+Texture* TextureHandle::operator->() const
+{
+	return Get();
+}
+
+TextureHandle::operator bool() const
+{
+	return m_entry != nullptr;
+}
+
+TextureCache::TextureCache(Engine* const engine)
+	: m_engine(engine), m_descriptorSize(0), m_hits(0), m_misses(0)
+{
+	// slot 0 is handed out first
+	for (UINT slot = TEXTURE_CACHE_CAPACITY; slot > 0; --slot)
+	{
+		m_freeSlots.push_back(slot - 1);
+	}
+}
+
+void TextureCache::CreateDescriptorHeap(ID3D12Device* const device)
+{
+	// not shader visible, the SRVs are copied from here into the tables the shaders read
+	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
+	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	descriptorHeapDesc.NumDescriptors = TEXTURE_CACHE_CAPACITY;
+	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+	HRESULT hr = device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&m_descriptorHeap));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_descriptorHeap->SetName(TEXT("Texture Cache Descriptor Heap"));
+	m_descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+UINT64 TextureCache::HashFiles(const vector<const wchar_t*>& fileNames, UINT64 seed)
+{
+	// 64 bits over every byte and the size of every file, a collision is not checked for
+	UINT64 hash = MixHash(seed + 1);
+	for (const wchar_t* fileName : fileNames)
+	{
+		if (fileName == nullptr)
+		{
+			hash = MixHash(hash + 1);
+			continue;
+		}
+
+		MappedFile file;
+		if (!file.Open(fileName))
+		{
+			exit(-1);
+		}
+
+		const BYTE* data = file.GetData();
+		const UINT64 size = file.GetSize();
+		hash = MixHash(hash ^ size);
+
+		UINT64 offset = 0;
+		for (; offset + sizeof(UINT64) <= size; offset += sizeof(UINT64))
+		{
+			UINT64 word;
+			memcpy(&word, data + offset, sizeof(word));
+			hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+			hash ^= hash >> 29;
+		}
+
+		UINT64 lastWord = 0;
+		memcpy(&lastWord, data + offset, static_cast<size_t>(size - offset));
+		hash = MixHash(hash ^ lastWord);
+	}
+	return hash;
+}
+
+TextureHandle TextureCache::Acquire(const wstring& key, const vector<const wchar_t*>& fileNames, UINT64 seed,
+	const std::function<void(Texture&)>& load)
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		auto found = m_keys.find(key);
+		if (found != m_keys.end())
+		{
+			TextureCacheEntry* entry = found->second;
+			++entry->refCount;
+			++m_hits;
+			m_loadFinished.wait(lock, [entry] { return entry->loaded; });
+			return TextureHandle(this, entry);
+		}
+	}
+
+	// the same bytes under another path, hashed outside the lock
+	const UINT64 contentHash = HashFiles(fileNames, seed);
+
+	unique_lock<mutex> lock(m_mutex);
+	TextureCacheEntry* entry = nullptr;
+	auto foundKey = m_keys.find(key);
+	auto foundHash = m_hashes.find(contentHash);
+	if (foundKey != m_keys.end())
+	{
+		entry = foundKey->second;
+	}
+	else if (foundHash != m_hashes.end())
+	{
+		entry = foundHash->second;
+		m_keys[key] = entry;
+	}
+
+	if (entry != nullptr)
+	{
+		++entry->refCount;
+		++m_hits;
+		m_loadFinished.wait(lock, [entry] { return entry->loaded; });
+		return TextureHandle(this, entry);
+	}
+
+	// a miss, this thread loads it and later loads of it wait
+	if (m_freeSlots.empty())
+	{
+		exit(-1);
+	}
+
+	unique_ptr<TextureCacheEntry> newEntry = std::make_unique<TextureCacheEntry>();
+	newEntry->texture = std::make_unique<Texture>(m_engine);
+	newEntry->contentHash = contentHash;
+	newEntry->refCount = 1;
+	newEntry->loaded = false;
+	newEntry->uploaded = false;
+	newEntry->descriptorSlot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+
+	entry = newEntry.get();
+	m_entries.push_back(std::move(newEntry));
+	m_keys[key] = entry;
+	m_hashes[contentHash] = entry;
+	++m_misses;
+
+	lock.unlock();
+	load(*entry->texture);
+	lock.lock();
+
+	entry->loaded = true;
+	m_loadFinished.notify_all();
+	return TextureHandle(this, entry);
+}
+
+void TextureCache::AddRef(TextureCacheEntry* entry)
+{
+	lock_guard<mutex> lock(m_mutex);
+	++entry->refCount;
+}
+
+void TextureCache::Release(TextureCacheEntry* entry)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (--entry->refCount > 0)
+	{
+		return;
+	}
+
+	// uploaded textures are accounted by the engine's residency manager
+	if (m_engine != nullptr && entry->uploaded)
+	{
+		m_engine->ForgetTexture(entry->texture.get());
+	}
+
+	for (auto key = m_keys.begin(); key != m_keys.end();)
+	{
+		key = key->second == entry ? m_keys.erase(key) : std::next(key);
+	}
+	m_hashes.erase(entry->contentHash);
+	m_freeSlots.push_back(entry->descriptorSlot);
+
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		if (m_entries[i].get() == entry)
+		{
+			m_entries[i] = std::move(m_entries.back());
+			m_entries.pop_back();
+			break;
+		}
+	}
+}
+
+TextureHandle TextureCache::Load(const wchar_t* const fileName, MipContent content)
+{
+	const UINT64 seed = static_cast<UINT64>(content);
+	const wstring key = to_wstring(seed) + L":" + NormalizePath(fileName);
+	return Acquire(key, { fileName }, seed, [fileName, content](Texture& texture) { texture.LoadFromFile(fileName, content); });
+}
+
+TextureHandle TextureCache::LoadOrm(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName,
+	const wchar_t* const specularFileName)
+{
+	const wstring key = L"orm:" + NormalizePath(occlusionFileName) + L"|" + NormalizePath(roughnessFileName) + L"|" +
+		(specularFileName != nullptr ? NormalizePath(specularFileName) : wstring());
+	return Acquire(key, { occlusionFileName, roughnessFileName, specularFileName }, ORM_HASH_SEED,
+		[occlusionFileName, roughnessFileName, specularFileName](Texture& texture)
+		{
+			texture.LoadOrmFromFiles(occlusionFileName, roughnessFileName, specularFileName);
+		});
+}
+
+bool TextureCache::IsUploaded(const TextureHandle& texture)
+{
+	return texture.m_entry != nullptr && texture.m_entry->uploaded;
+}
+
+void TextureCache::Upload(const TextureHandle& texture, const wchar_t* const textureName, UINT firstMip,
+	ID3D12GraphicsCommandList* const commandList)
+{
+	TextureCacheEntry* entry = texture.m_entry;
+	if (entry == nullptr || entry->uploaded)
+	{
+		return;
+	}
+
+	entry->texture->CreateResource(textureName, GetDescriptorHandle(texture), firstMip);
+	entry->texture->UploadToResource(commandList);
+	entry->uploaded = true;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE TextureCache::GetDescriptorHandle(const TextureHandle& texture) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_descriptorHeap->GetCPUDescriptorHandleForHeapStart(),
+		texture.m_entry->descriptorSlot, m_descriptorSize);
+}
+
+TextureCacheStats TextureCache::GetStats()
+{
+	lock_guard<mutex> lock(m_mutex);
+	TextureCacheStats stats = {};
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.textureCount = static_cast<UINT>(m_entries.size());
+	for (const unique_ptr<TextureCacheEntry>& entry : m_entries)
+	{
+		stats.handleCount += entry->refCount;
+		stats.residentBytes += entry->uploaded ? entry->texture->GetResidentBytes() : 0;
+	}
+	return stats;
+}
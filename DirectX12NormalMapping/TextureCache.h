@@ -0,0 +1,114 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <d3d12.h>
+#include <wrl.h>
+#include "Texture.h"
+
+// the textures the cache can hold SRVs for
+const UINT TEXTURE_CACHE_CAPACITY = 256;
+
+struct TextureCacheStats
+{
+	UINT hits;	// by path or by content
+	UINT misses;	// loaded
+	UINT textureCount;	// unique textures in the cache
+	UINT handleCount;
+	UINT64 residentBytes;	// of the uploaded levels
+};
+
+struct TextureCacheEntry
+{
+	unique_ptr<Texture> texture;
+	UINT64 contentHash;
+	UINT refCount;
+	bool loaded;	// the load step has returned
+	bool uploaded;
+	UINT descriptorSlot;
+};
+
+class TextureCache;
+
+// counts a reference to a cached texture, the texture goes when the last handle does
+class TextureHandle
+{
+private:
+	TextureCache* m_cache;
+	TextureCacheEntry* m_entry;
+
+	friend class TextureCache;
+	TextureHandle(TextureCache* cache, TextureCacheEntry* entry);
+
+public:
+	TextureHandle();
+	TextureHandle(const TextureHandle& other);
+	TextureHandle(TextureHandle&& other);
+	~TextureHandle();
+	TextureHandle& operator=(const TextureHandle& other);
+	TextureHandle& operator=(TextureHandle&& other);
+
+	Texture* Get() const;
+	Texture* operator->() const;
+	explicit operator bool() const;
+};
+
+// Shares textures between everything that loads them. A texture is looked up
+// by its path and the way it is filtered first, then by a hash of its source
+// files, so the same data under another name is decoded once as well. Every
+// unique texture gets one resource and one SRV in a CPU side descriptor heap,
+// the renderer copies that SRV into its shader visible table. Load can run on
+// several loader threads at once, a second load of a texture that is still
+// loading waits for it. Upload and the handles of uploaded textures belong to
+// the render thread, which only lets go of them between frames.
+class TextureCache
+{
+private:
+	class Engine* m_engine;
+	std::mutex m_mutex;
+	std::condition_variable m_loadFinished;
+	std::unordered_map<wstring, TextureCacheEntry*> m_keys;	// every path a texture was loaded by
+	std::unordered_map<UINT64, TextureCacheEntry*> m_hashes;
+	vector<unique_ptr<TextureCacheEntry>> m_entries;
+	vector<UINT> m_freeSlots;
+	ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+	UINT m_descriptorSize;
+	UINT m_hits;
+	UINT m_misses;
+
+	static UINT64 HashFiles(const vector<const wchar_t*>& fileNames, UINT64 seed);
+	TextureHandle Acquire(const wstring& key, const vector<const wchar_t*>& fileNames, UINT64 seed,
+		const std::function<void(Texture&)>& load);
+	void AddRef(TextureCacheEntry* entry);
+	void Release(TextureCacheEntry* entry);
+
+	friend class TextureHandle;
+
+public:
+	explicit TextureCache(Engine* const engine);
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	void CreateDescriptorHeap(ID3D12Device* const device);
+
+	// see Texture::LoadFromFile
+	TextureHandle Load(const wchar_t* const fileName, MipContent content);
+	// see Texture::LoadOrmFromFiles, specularFileName can be null
+	TextureHandle LoadOrm(const wchar_t* const occlusionFileName, const wchar_t* const roughnessFileName,
+		const wchar_t* const specularFileName);
+
+	bool IsUploaded(const TextureHandle& texture);
+	// creates the resource and records the copy unless an earlier call did
+	void Upload(const TextureHandle& texture, const wchar_t* const textureName, UINT firstMip,
+		ID3D12GraphicsCommandList* const commandList);
+	D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorHandle(const TextureHandle& texture) const;
+
+	TextureCacheStats GetStats();
+};
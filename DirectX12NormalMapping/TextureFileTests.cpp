@@ -0,0 +1,201 @@
+#include "TextureFileTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "DdsFile.h"
+#include "Ktx2File.h"
+
+using std::function;
+using std::vector;
+
+namespace
+{
+	// an 8x8 texture with 4 mips: 32, 8, 8 and 8 bytes of BC1 blocks, 64, 16, 16 and 16 bytes of BC5 blocks
+	const uint32_t TEST_SIZE = 8;
+	const uint32_t TEST_MIPS = 4;
+
+	void PutU32(vector<uint8_t>& file, size_t offset, uint32_t value)
+	{
+		memcpy(file.data() + offset, &value, sizeof(value));
+	}
+
+	void PutU64(vector<uint8_t>& file, size_t offset, uint64_t value)
+	{
+		memcpy(file.data() + offset, &value, sizeof(value));
+	}
+
+	vector<uint8_t> BuildDds()
+	{
+		const size_t dataOffset = 148;
+		vector<uint8_t> file(dataOffset + static_cast<size_t>(DdsFile::GetMipChainSize(DDS_FORMAT_BC1_UNORM, TEST_SIZE, TEST_SIZE, TEST_MIPS)));
+		PutU32(file, 0, 0x20534444);	// "DDS "
+		PutU32(file, 4, 124);	// header size
+		PutU32(file, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000);
+		PutU32(file, 12, TEST_SIZE);	// height
+		PutU32(file, 16, TEST_SIZE);	// width
+		PutU32(file, 28, TEST_MIPS);
+		PutU32(file, 76, 32);	// pixel format size
+		PutU32(file, 80, 0x4);	// DDPF_FOURCC
+		PutU32(file, 84, 0x30315844);	// "DX10"
+		PutU32(file, 108, 0x1000 | 0x8 | 0x400000);
+		PutU32(file, 128, DDS_FORMAT_BC1_UNORM);
+		PutU32(file, 132, 3);	// 2D
+		PutU32(file, 140, 1);	// array size
+		return file;
+	}
+
+	// the levels are stored from the smallest like the KTX2 tools do, each 8 byte aligned
+	vector<uint8_t> BuildKtx2()
+	{
+		const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		const size_t levelIndexOffset = 80;
+		size_t dataOffset = levelIndexOffset + TEST_MIPS * 24;
+
+		vector<uint8_t> file(dataOffset + static_cast<size_t>(DdsFile::GetMipChainSize(DDS_FORMAT_BC5_UNORM, TEST_SIZE, TEST_SIZE, TEST_MIPS)));
+		memcpy(file.data(), identifier, sizeof(identifier));
+		PutU32(file, 12, 141);	// VK_FORMAT_BC5_UNORM_BLOCK
+		PutU32(file, 16, 1);	// type size
+		PutU32(file, 20, TEST_SIZE);
+		PutU32(file, 24, TEST_SIZE);
+		PutU32(file, 36, 1);	// faces
+		PutU32(file, 40, TEST_MIPS);
+
+		for (int mip = TEST_MIPS - 1; mip >= 0; --mip)
+		{
+			const uint32_t mipSize = TEST_SIZE >> mip > 0 ? TEST_SIZE >> mip : 1;
+			const uint64_t length = DdsFile::GetMipChainSize(DDS_FORMAT_BC5_UNORM, mipSize, mipSize, 1);
+			PutU64(file, levelIndexOffset + mip * 24, dataOffset);
+			PutU64(file, levelIndexOffset + mip * 24 + 8, length);
+			PutU64(file, levelIndexOffset + mip * 24 + 16, length);
+			dataOffset += static_cast<size_t>(length);
+		}
+		return file;
+	}
+
+	struct TestCase
+	{
+		const wchar_t* name;
+		function<void(vector<uint8_t>&)> corrupt;
+		bool valid;
+	};
+
+	int RunCases(const wchar_t* const containerName, const function<vector<uint8_t>()>& build,
+		const function<bool(const uint8_t*, uint64_t, TextureFileInfo&)>& parse, const vector<TestCase>& cases)
+	{
+		int failures = 0;
+		for (const TestCase& test : cases)
+		{
+			vector<uint8_t> file = build();
+			test.corrupt(file);
+
+			TextureFileInfo info = {};
+			const bool parsed = parse(file.empty() ? nullptr : file.data(), file.size(), info);
+
+			// what a parser accepts must stay inside the buffer
+			bool inside = true;
+			for (uint32_t mip = 0; parsed && mip < info.mipCount; ++mip)
+			{
+				inside = inside && info.mipOffsets[mip] <= file.size() && info.mipSizes[mip] <= file.size() - info.mipOffsets[mip];
+			}
+
+			const bool passed = parsed == test.valid && inside;
+			failures += passed ? 0 : 1;
+			wprintf(L"  %s %-40s %s\n", containerName, test.name, passed ? L"ok" : L"FAILED");
+		}
+		return failures;
+	}
+}
+
+int RunTextureFileTests()
+{
+	const uint64_t noOffset = 0;
+	int failures = 0;
+
+	const vector<TestCase> ddsCases =
+	{
+		{ L"valid", [](vector<uint8_t>&) {}, true },
+		{ L"no mip count means one level", [](vector<uint8_t>& file) { PutU32(file, 28, 0); }, true },
+		{ L"empty", [](vector<uint8_t>& file) { file.clear(); }, false },
+		{ L"truncated header", [](vector<uint8_t>& file) { file.resize(100); }, false },
+		{ L"truncated DX10 header", [](vector<uint8_t>& file) { file.resize(140); }, false },
+		{ L"truncated data", [](vector<uint8_t>& file) { file.pop_back(); }, false },
+		{ L"bad magic", [](vector<uint8_t>& file) { PutU32(file, 0, 0x20534443); }, false },
+		{ L"bad header size", [](vector<uint8_t>& file) { PutU32(file, 4, 128); }, false },
+		{ L"bad pixel format size", [](vector<uint8_t>& file) { PutU32(file, 76, 0); }, false },
+		{ L"legacy pixel format", [](vector<uint8_t>& file) { PutU32(file, 80, 0x40); }, false },
+		{ L"not DX10", [](vector<uint8_t>& file) { PutU32(file, 84, 0x31545844); }, false },
+		{ L"3D texture", [](vector<uint8_t>& file) { PutU32(file, 132, 4); }, false },
+		{ L"texture array", [](vector<uint8_t>& file) { PutU32(file, 140, 6); }, false },
+		{ L"zero array size", [](vector<uint8_t>& file) { PutU32(file, 140, 0); }, false },
+		{ L"unsupported format", [](vector<uint8_t>& file) { PutU32(file, 128, 2); }, false },
+		{ L"zero width", [](vector<uint8_t>& file) { PutU32(file, 16, 0); }, false },
+		{ L"too wide", [](vector<uint8_t>& file) { PutU32(file, 16, 16385); }, false },
+		{ L"BC width not whole blocks", [](vector<uint8_t>& file) { PutU32(file, 16, 6); }, false },
+		{ L"huge size, data missing", [](vector<uint8_t>& file) { PutU32(file, 12, 16384); PutU32(file, 16, 16384); }, false },
+		{ L"more mips than levels", [](vector<uint8_t>& file) { PutU32(file, 28, TEST_MIPS + 1); }, false },
+		{ L"mip count overflow", [](vector<uint8_t>& file) { PutU32(file, 28, 0xFFFFFFFF); }, false },
+	};
+	failures += RunCases(L"DDS ", BuildDds, DdsFile::Parse, ddsCases);
+
+	const vector<TestCase> ktx2Cases =
+	{
+		{ L"valid", [](vector<uint8_t>&) {}, true },
+		{ L"no level count means one level", [](vector<uint8_t>& file) { PutU32(file, 40, 0); }, true },
+		{ L"empty", [](vector<uint8_t>& file) { file.clear(); }, false },
+		{ L"truncated header", [](vector<uint8_t>& file) { file.resize(60); }, false },
+		{ L"truncated level index", [](vector<uint8_t>& file) { file.resize(80 + 24 * 2); }, false },
+		{ L"truncated data", [](vector<uint8_t>& file) { file.pop_back(); }, false },
+		{ L"bad identifier", [](vector<uint8_t>& file) { file[5] = '1'; }, false },
+		{ L"3D texture", [](vector<uint8_t>& file) { PutU32(file, 28, 4); }, false },
+		{ L"texture array", [](vector<uint8_t>& file) { PutU32(file, 32, 6); }, false },
+		{ L"cube map", [](vector<uint8_t>& file) { PutU32(file, 36, 6); }, false },
+		{ L"supercompressed", [](vector<uint8_t>& file) { PutU32(file, 44, 2); }, false },
+		{ L"unsupported format", [](vector<uint8_t>& file) { PutU32(file, 12, 37); }, false },
+		{ L"bad type size", [](vector<uint8_t>& file) { PutU32(file, 16, 4); }, false },
+		{ L"zero height", [](vector<uint8_t>& file) { PutU32(file, 24, 0); }, false },
+		{ L"too high", [](vector<uint8_t>& file) { PutU32(file, 24, 16385); }, false },
+		{ L"BC height not whole blocks", [](vector<uint8_t>& file) { PutU32(file, 24, 6); }, false },
+		{ L"more levels than mips", [](vector<uint8_t>& file) { PutU32(file, 40, 5); }, false },
+		{ L"level count overflow", [](vector<uint8_t>& file) { PutU32(file, 40, 0xFFFFFFFF); }, false },
+		{ L"level past the end", [](vector<uint8_t>& file) { PutU64(file, 80, file.size()); }, false },
+		{ L"level offset overflow", [](vector<uint8_t>& file) { PutU64(file, 80, ~noOffset - 8); }, false },
+		{ L"wrong level length", [](vector<uint8_t>& file) { PutU64(file, 80 + 8, 32); }, false },
+		{ L"wrong uncompressed length", [](vector<uint8_t>& file) { PutU64(file, 80 + 16, 128); }, false },
+	};
+	failures += RunCases(L"KTX2", BuildKtx2, Ktx2File::Parse, ktx2Cases);
+
+	// the offsets of the valid files
+	TextureFileInfo info = {};
+	vector<uint8_t> dds = BuildDds();
+	bool offsetsMatch = DdsFile::Parse(dds.data(), dds.size(), info) && info.mipCount == TEST_MIPS &&
+		info.mipOffsets[0] == 148 && info.mipSizes[0] == 32 && info.mipOffsets[3] == 148 + 48 && info.mipSizes[3] == 8;
+
+	vector<uint8_t> ktx2 = BuildKtx2();
+	offsetsMatch = offsetsMatch && Ktx2File::Parse(ktx2.data(), ktx2.size(), info) && info.format == DDS_FORMAT_BC5_UNORM &&
+		info.mipOffsets[3] == 80 + TEST_MIPS * 24 && info.mipSizes[0] == 64 && info.mipOffsets[0] == 80 + TEST_MIPS * 24 + 48;
+
+	failures += offsetsMatch ? 0 : 1;
+	wprintf(L"  level offsets %s\n", offsetsMatch ? L"ok" : L"FAILED");
+
+	// the header the cooker writes reads back as the texture it describes
+	vector<uint8_t> written(dds.size());
+	DdsFile::WriteHeader(DDS_FORMAT_BC1_UNORM, TEST_SIZE, TEST_SIZE, TEST_MIPS, written.data());
+	const bool headerMatches = DdsFile::Parse(written.data(), written.size(), info) && info.format == DDS_FORMAT_BC1_UNORM &&
+		info.width == TEST_SIZE && info.height == TEST_SIZE && info.mipCount == TEST_MIPS && info.mipOffsets[0] == DDS_HEADER_SIZE;
+
+	failures += headerMatches ? 0 : 1;
+	wprintf(L"  written header %s\n", headerMatches ? L"ok" : L"FAILED");
+
+	// a block compressed resource starts at whole blocks, every level of an uncompressed one can
+	const bool firstMipsMatch = DdsFile::GetCoarsestFirstMip(DDS_FORMAT_BC1_UNORM, 1000, 1000, 10) == 1 &&
+		DdsFile::GetCoarsestFirstMip(DDS_FORMAT_BC5_UNORM, 256, 64, 9) == 4 &&
+		DdsFile::GetCoarsestFirstMip(DDS_FORMAT_BC4_UNORM, 6, 6, 3) == 0 &&
+		DdsFile::GetCoarsestFirstMip(DDS_FORMAT_B8G8R8A8_UNORM, 1000, 1000, 10) == 9;
+	failures += firstMipsMatch ? 0 : 1;
+	wprintf(L"  coarsest first mip %s\n", firstMipsMatch ? L"ok" : L"FAILED");
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
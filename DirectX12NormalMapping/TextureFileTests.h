@@ -0,0 +1,6 @@
+#pragma once
+
+// DdsFile and Ktx2File parsers against well formed files and malformed headers
+// built in memory, and DdsFile::WriteHeader read back by the parser, prints
+// every case and returns 0 when all of them pass
+int RunTextureFileTests();
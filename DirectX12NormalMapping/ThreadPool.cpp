@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+			if (m_jobs.empty())
+			{
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+
+		job();
+	}
+}
+
+ThreadPool::ThreadPool(UINT threadCount)
+	: m_stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_jobAvailable.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+UINT ThreadPool::GetThreadCount() const
+{
+	return static_cast<UINT>(m_workers.size());
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push(std::move(job));
+	}
+
+	m_jobAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(UINT count, const std::function<void(UINT)>& job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (count == 1)
+	{
+		job(0);
+		return;
+	}
+
+	struct Batch
+	{
+		std::atomic<UINT> next;
+		std::atomic<UINT> finished;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->next = 0;
+	batch->finished = 0;
+
+	auto runItems = [batch, count, &job]()
+	{
+		for (UINT i = batch->next++; i < count; i = batch->next++)
+		{
+			job(i);
+
+			if (++batch->finished == count)
+			{
+				std::lock_guard<std::mutex> lock(batch->mutex);
+				batch->done.notify_all();
+			}
+		}
+	};
+
+	// the caller is one of the participants
+	UINT helpers = count - 1 < GetThreadCount() ? count - 1 : GetThreadCount();
+	for (UINT i = 0; i < helpers; ++i)
+	{
+		Enqueue(runItems);
+	}
+
+	runItems();
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->done.wait(lock, [&batch, count] { return batch->finished == count; });
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool sharedPool;
+	return sharedPool;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <windows.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	bool m_stopping;
+
+	void WorkerLoop();
+
+public:
+	// threadCount == 0 uses one worker per hardware thread
+	explicit ThreadPool(UINT threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	UINT GetThreadCount() const;
+
+	// runs the job on a worker thread, does not wait
+	void Enqueue(std::function<void()> job);
+
+	// calls job(i) for every i in [0, count) and returns when all have finished,
+	// the calling thread takes part in the work
+	void ParallelFor(UINT count, const std::function<void(UINT)>& job);
+
+	static ThreadPool& GetShared();
+};
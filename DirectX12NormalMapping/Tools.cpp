@@ -0,0 +1,1332 @@
+#include "stdafx.h"
+#include "Tools.h"
+#include <cstdio>
+#include <cwchar>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <WaveFrontReader.h>
+#include "Engine.h"
+#include "MappedFile.h"
+#include "ObjParser.h"
+#include "TangentGenerator.h"
+#include "VertexQuantizer.h"
+#include "MeshletCuller.h"
+#include "BlockCompressor.h"
+#include "DdsFile.h"
+#include "DdsWriter.h"
+#include "MipGenerator.h"
+#include "OrmPacker.h"
+#include "TextureFileTests.h"
+#include "MipStreamerTests.h"
+#include "ResidencyManagerTests.h"
+#include "UploadRingTests.h"
+#include "HeapAllocatorTests.h"
+#include "DescriptorAllocatorTests.h"
+#include "ResourceStateTrackerTests.h"
+#include "DeferredReleaseQueueTests.h"
+#include "MeshletTests.h"
+#include "TextureCache.h"
+#include "PngBenchmark.h"
+
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+
+namespace
+{
+	void AttachToConsole()
+	{
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			AllocConsole();
+		}
+
+		FILE* stream = nullptr;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+	}
+
+	double ElapsedMs(high_resolution_clock::time_point start)
+	{
+		return duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+
+	// the original XMVECTOR implementation, kept as the reference for the kernels
+	void CalculateTangentsReference(vector<Vertex>& vertices, const vector<DWORD>& indices)
+	{
+		for (DWORD indexOfIndex = 0; indexOfIndex < indices.size(); indexOfIndex += 3)
+		{
+			DWORD vertexIndex0 = indices[indexOfIndex];
+			const Vertex& vertex0 = vertices[vertexIndex0];
+			XMVECTOR vertexPos0 = XMLoadFloat3(&vertex0.position);
+			XMVECTOR texCoord0 = XMLoadFloat2(&vertex0.textureCoordinate);
+
+			DWORD vertexIndex1 = indices[indexOfIndex + 1];
+			const Vertex& vertex1 = vertices[vertexIndex1];
+			XMVECTOR vertexPos1 = XMLoadFloat3(&vertex1.position);
+			XMVECTOR texCoord1 = XMLoadFloat2(&vertex1.textureCoordinate);
+
+			DWORD vertexIndex2 = indices[indexOfIndex + 2];
+			const Vertex& vertex2 = vertices[vertexIndex2];
+			XMVECTOR vertexPos2 = XMLoadFloat3(&vertex2.position);
+			XMVECTOR texCoord2 = XMLoadFloat2(&vertex2.textureCoordinate);
+
+			XMVECTOR deltaPos0Vec = vertexPos0 - vertexPos2;
+			deltaPos0Vec = XMVector3Normalize(deltaPos0Vec);
+			XMFLOAT3 deltaPos0;
+			XMStoreFloat3(&deltaPos0, deltaPos0Vec);
+
+			XMVECTOR deltaPos1Vec = vertexPos2 - vertexPos1;
+			deltaPos1Vec = XMVector3Normalize(deltaPos1Vec);
+			XMFLOAT3 deltaPos1;
+			XMStoreFloat3(&deltaPos1, deltaPos1Vec);
+
+			XMVECTOR deltaTexCoordVec0 = texCoord1 - texCoord0;
+			deltaTexCoordVec0 = XMVector2Normalize(deltaTexCoordVec0);
+			XMFLOAT2 deltaTexCoord0;
+			XMStoreFloat2(&deltaTexCoord0, deltaTexCoordVec0);
+
+			XMVECTOR deltaTexCoord1Vec = texCoord2 - texCoord0;
+			deltaTexCoord1Vec = XMVector2Normalize(deltaTexCoord1Vec);
+			XMFLOAT2 deltaTexCoord1;
+			XMStoreFloat2(&deltaTexCoord1, deltaTexCoord1Vec);
+
+			float det = (deltaTexCoord0.x * deltaTexCoord1.y - deltaTexCoord0.y * deltaTexCoord1.x);
+
+			XMVECTOR tangent = (deltaPos0Vec * deltaTexCoord0.y - deltaPos1Vec * deltaTexCoord1.y) / det;
+			tangent = XMVector3Normalize(tangent);
+
+			XMVECTOR tangentSum0 = XMLoadFloat3(&vertices[vertexIndex0].tangent) + tangent;
+			XMVECTOR tangentSum1 = XMLoadFloat3(&vertices[vertexIndex1].tangent) + tangent;
+			XMVECTOR tangentSum2 = XMLoadFloat3(&vertices[vertexIndex2].tangent) + tangent;
+
+			XMStoreFloat3(&vertices[vertexIndex0].tangent, tangentSum0);
+			XMStoreFloat3(&vertices[vertexIndex1].tangent, tangentSum1);
+			XMStoreFloat3(&vertices[vertexIndex2].tangent, tangentSum2);
+		}
+
+		vector<UINT> verticesRepeatings(vertices.size(), 0);
+
+		for (DWORD index : indices)
+		{
+			++verticesRepeatings[index];
+		}
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			XMVECTOR vertexTangentAvg = XMLoadFloat3(&vertices[i].tangent);
+			vertexTangentAvg /= verticesRepeatings[i];
+			XMStoreFloat3(&vertices[i].tangent, vertexTangentAvg);
+		}
+	}
+
+	int CookMesh(int argc, wchar_t** argv)
+	{
+		if (argc < 4)
+		{
+			wprintf(L"usage: -cook <input.obj> <output.mesh>\n");
+			return -1;
+		}
+
+		Actor actor(nullptr);
+
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		actor.LoadObjFromFile(argv[2]);
+		double loadMs = ElapsedMs(start);
+
+		if (!actor.SaveCookedMeshToFile(argv[3]))
+		{
+			wprintf(L"failed to write %s\n", argv[3]);
+			return -1;
+		}
+
+		const VertexWeldStats& weldStats = actor.GetWeldStats();
+		const MeshOptimizerStats& stats = actor.GetOptimizerStats();
+		wprintf(L"cooked %s -> %s: %u vertices, %u indices (OBJ load %.2f ms)\n",
+			argv[2], argv[3], actor.GetVertexCount(), actor.GetIndexCount(), loadMs);
+		wprintf(L"welded vertices: %u -> %u\n", weldStats.verticesBefore, weldStats.verticesAfter);
+		wprintf(L"vertex cache (%u entries): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			MeshOptimizer::VERTEX_CACHE_SIZE, stats.acmrBefore, stats.acmrAfter, stats.atvrBefore, stats.atvrAfter);
+
+		for (UINT i = 0; i < actor.GetLodCount(); ++i)
+		{
+			const MeshLod& lod = actor.GetLod(i);
+			wprintf(L"LOD %u: %u triangles, error %g\n", i, lod.indexCount / 3, lod.error);
+		}
+		return 0;
+	}
+
+	int BenchmarkMesh(int argc, wchar_t** argv)
+	{
+		if (argc < 4)
+		{
+			wprintf(L"usage: -bench-mesh <input.obj> <input.mesh> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 4 ? _wtoi(argv[4]) : 5;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		double objBestMs = DBL_MAX;
+		double cookedBestMs = DBL_MAX;
+		UINT vertexCount = 0;
+		UINT indexCount = 0;
+
+		for (int i = 0; i < iterations; ++i)
+		{
+			Actor objActor(nullptr);
+			high_resolution_clock::time_point start = high_resolution_clock::now();
+			objActor.LoadObjFromFile(argv[2]);
+			double objMs = ElapsedMs(start);
+			objBestMs = objMs < objBestMs ? objMs : objBestMs;
+			vertexCount = objActor.GetVertexCount();
+			indexCount = objActor.GetIndexCount();
+
+			Actor cookedActor(nullptr);
+			start = high_resolution_clock::now();
+			if (!cookedActor.LoadCookedMeshFromFile(argv[3]))
+			{
+				wprintf(L"failed to open %s\n", argv[3]);
+				return -1;
+			}
+
+			// touch every page so the comparison includes the actual reads
+			const BYTE* bytes = reinterpret_cast<const BYTE*>(cookedActor.GetVertices());
+			UINT64 vertexBytes = static_cast<UINT64>(cookedActor.GetVertexCount()) * sizeof(Vertex);
+			volatile BYTE checksum = 0;
+			for (UINT64 offset = 0; offset < vertexBytes; offset += 4096)
+			{
+				checksum ^= bytes[offset];
+			}
+			bytes = reinterpret_cast<const BYTE*>(cookedActor.GetIndices());
+			UINT64 indexBytes = static_cast<UINT64>(cookedActor.GetIndexCount()) * sizeof(DWORD);
+			for (UINT64 offset = 0; offset < indexBytes; offset += 4096)
+			{
+				checksum ^= bytes[offset];
+			}
+
+			double cookedMs = ElapsedMs(start);
+			cookedBestMs = cookedMs < cookedBestMs ? cookedMs : cookedBestMs;
+		}
+
+		wprintf(L"%u vertices, %u indices, best of %d\n", vertexCount, indexCount, iterations);
+		wprintf(L"  OBJ parse:   %10.3f ms\n", objBestMs);
+		wprintf(L"  cooked load: %10.3f ms (%.1fx)\n", cookedBestMs, objBestMs / cookedBestMs);
+		return 0;
+	}
+
+	int BenchmarkObj(int argc, wchar_t** argv)
+	{
+		typedef WaveFrontReader<DWORD>::Vertex ReaderVertex;
+
+		if (argc < 3)
+		{
+			wprintf(L"usage: -bench-obj <input.obj> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 3 ? _wtoi(argv[3]) : 5;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		MappedFile file;
+		if (!file.Open(argv[2]))
+		{
+			wprintf(L"failed to open %s\n", argv[2]);
+			return -1;
+		}
+
+		const char* data = reinterpret_cast<const char*>(file.GetData());
+		const size_t size = static_cast<size_t>(file.GetSize());
+		const double megabytes = size / (1024.0 * 1024.0);
+
+		// reference parser
+		WaveFrontReader<DWORD> waveFrontReader;
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		if (FAILED(waveFrontReader.Load(argv[2])))
+		{
+			wprintf(L"WaveFrontReader failed to load %s\n", argv[2]);
+			return -1;
+		}
+		double readerMs = ElapsedMs(start);
+
+		ThreadPool singleThreadPool(1);
+		ObjParser singleThreadParser(singleThreadPool);
+		ObjParser parallelParser(ThreadPool::GetShared());
+
+		vector<Vertex> vertices;
+		vector<DWORD> indices;
+		double singleBestMs = DBL_MAX;
+		double parallelBestMs = DBL_MAX;
+
+		for (int i = 0; i < iterations; ++i)
+		{
+			start = high_resolution_clock::now();
+			singleThreadParser.Parse(data, size, vertices, indices);
+			double singleMs = ElapsedMs(start);
+			singleBestMs = singleMs < singleBestMs ? singleMs : singleBestMs;
+
+			start = high_resolution_clock::now();
+			if (!parallelParser.Parse(data, size, vertices, indices))
+			{
+				wprintf(L"ObjParser failed to parse %s\n", argv[2]);
+				return -1;
+			}
+			double parallelMs = ElapsedMs(start);
+			parallelBestMs = parallelMs < parallelBestMs ? parallelMs : parallelBestMs;
+		}
+
+		// output has to match the WaveFrontReader path exactly
+		bool identical = vertices.size() == waveFrontReader.vertices.size() &&
+			indices == waveFrontReader.indices;
+		for (size_t i = 0; identical && i < vertices.size(); ++i)
+		{
+			const ReaderVertex& readerVertex = waveFrontReader.vertices[i];
+			identical = memcmp(&vertices[i].position, &readerVertex.position, sizeof(XMFLOAT3)) == 0 &&
+				memcmp(&vertices[i].normal, &readerVertex.normal, sizeof(XMFLOAT3)) == 0 &&
+				memcmp(&vertices[i].textureCoordinate, &readerVertex.textureCoordinate, sizeof(XMFLOAT2)) == 0;
+		}
+
+		wprintf(L"%.2f MB, %zu vertices, %zu triangles, best of %d\n",
+			megabytes, vertices.size(), indices.size() / 3, iterations);
+		wprintf(L"  WaveFrontReader: %10.3f ms %8.1f MB/s\n", readerMs, megabytes / (readerMs / 1000.0));
+		wprintf(L"  ObjParser x1:    %10.3f ms %8.1f MB/s\n", singleBestMs, megabytes / (singleBestMs / 1000.0));
+		wprintf(L"  ObjParser x%-2u:   %10.3f ms %8.1f MB/s\n", ThreadPool::GetShared().GetThreadCount() + 1,
+			parallelBestMs, megabytes / (parallelBestMs / 1000.0));
+		wprintf(L"  output %s\n", identical ? L"identical" : L"DIFFERS from WaveFrontReader");
+		return identical ? 0 : -1;
+	}
+
+	// the largest difference to the reference tangents, NaNs (unused vertices) have to match too
+	bool CompareTangents(const vector<Vertex>& result, const vector<Vertex>& reference, float tolerance, float& maxError)
+	{
+		maxError = 0.0f;
+		bool match = true;
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			const float* actual = &result[i].tangent.x;
+			const float* expected = &reference[i].tangent.x;
+			for (int c = 0; c < 3; ++c)
+			{
+				if (isnan(actual[c]) || isnan(expected[c]))
+				{
+					match = match && isnan(actual[c]) && isnan(expected[c]);
+					continue;
+				}
+
+				float error = fabsf(actual[c] - expected[c]);
+				maxError = error > maxError ? error : maxError;
+			}
+		}
+		return match && maxError <= tolerance;
+	}
+
+	int BenchmarkTangents(int argc, wchar_t** argv)
+	{
+		if (argc < 3)
+		{
+			wprintf(L"usage: -bench-tangents <input.obj> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 3 ? _wtoi(argv[3]) : 10;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		vector<Vertex> vertices;
+		vector<DWORD> indices;
+		ObjParser objParser(ThreadPool::GetShared());
+		if (!objParser.Load(argv[2], vertices, indices))
+		{
+			wprintf(L"failed to load %s\n", argv[2]);
+			return -1;
+		}
+
+		const double triangleCount = static_cast<double>(indices.size() / 3);
+
+		vector<Vertex> reference = vertices;
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		CalculateTangentsReference(reference, indices);
+		double referenceMs = ElapsedMs(start);
+
+		wprintf(L"%.0f triangles, %zu vertices, best of %d\n", triangleCount, vertices.size(), iterations);
+		wprintf(L"  %-10s %10.3f ms %8.2f Mtri/s\n", L"reference", referenceMs, triangleCount / (referenceMs * 1000.0));
+
+		const float tolerance = 1e-5f;
+		bool allMatch = true;
+		const TangentKernel selected = TangentGenerator::SelectKernel();
+		const TangentKernel kernels[] = { TangentKernel::Scalar, TangentKernel::Sse, TangentKernel::Avx };
+
+		for (TangentKernel kernel : kernels)
+		{
+			if (static_cast<int>(kernel) > static_cast<int>(selected))
+			{
+				wprintf(L"  %-10s not supported\n", TangentGenerator::GetKernelName(kernel));
+				continue;
+			}
+
+			vector<Vertex> result;
+			double bestMs = DBL_MAX;
+			for (int i = 0; i < iterations; ++i)
+			{
+				result = vertices;
+				start = high_resolution_clock::now();
+				TangentGenerator::Generate(result, indices, kernel);
+				double ms = ElapsedMs(start);
+				bestMs = ms < bestMs ? ms : bestMs;
+			}
+
+			float maxError;
+			const bool match = CompareTangents(result, reference, tolerance, maxError);
+			allMatch = allMatch && match;
+
+			wprintf(L"  %-10s %10.3f ms %8.2f Mtri/s  max error %g %s\n", TangentGenerator::GetKernelName(kernel),
+				bestMs, triangleCount / (bestMs * 1000.0), maxError, match ? L"ok" : L"MISMATCH");
+		}
+
+		// thread scaling of the parallel accumulation with the selected kernel
+		const UINT hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+		double singleThreadMs = 0.0;
+
+		for (UINT threads = 1; threads <= hardwareThreads; threads *= 2)
+		{
+			// the calling thread takes part, so the pool gets one worker less
+			ThreadPool threadPool(threads > 1 ? threads - 1 : 1);
+			vector<Vertex> result;
+			double bestMs = DBL_MAX;
+
+			for (int i = 0; i < iterations; ++i)
+			{
+				result = vertices;
+				start = high_resolution_clock::now();
+				if (threads > 1)
+				{
+					TangentGenerator::Generate(result, indices, selected, threadPool);
+				}
+				else
+				{
+					TangentGenerator::Generate(result, indices, selected);
+				}
+				double ms = ElapsedMs(start);
+				bestMs = ms < bestMs ? ms : bestMs;
+			}
+
+			// the slices add up in another order than the reference, every thread count has to stay within the tolerance too
+			float maxError;
+			const bool match = CompareTangents(result, reference, tolerance, maxError);
+			allMatch = allMatch && match;
+
+			singleThreadMs = threads == 1 ? bestMs : singleThreadMs;
+			wprintf(L"  %2u threads %10.3f ms %8.2f Mtri/s  speedup %.2fx  max error %g %s\n", threads,
+				bestMs, triangleCount / (bestMs * 1000.0), singleThreadMs / bestMs, maxError, match ? L"ok" : L"MISMATCH");
+		}
+
+		return allMatch ? 0 : -1;
+	}
+
+	int BenchmarkQuantize(int argc, wchar_t** argv)
+	{
+		if (argc < 3)
+		{
+			wprintf(L"usage: -bench-quantize <input.obj> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 3 ? _wtoi(argv[3]) : 10;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		Actor actor(nullptr);
+		actor.LoadObjFromFile(argv[2]);
+
+		const Vertex* vertices = actor.GetVertices();
+		const size_t vertexCount = actor.GetVertexCount();
+		const XMFLOAT3 boundsMin = actor.GetBoundsMin();
+		const XMFLOAT3 boundsMax = actor.GetBoundsMax();
+		const double fullMb = vertexCount * sizeof(Vertex) / (1024.0 * 1024.0);
+
+		wprintf(L"%zu vertices, %.2f MB -> %.2f MB (%.2fx), best of %d\n", vertexCount, fullMb,
+			vertexCount * sizeof(QuantizedVertex) / (1024.0 * 1024.0), sizeof(Vertex) / static_cast<double>(sizeof(QuantizedVertex)),
+			iterations);
+
+		bool allMatch = true;
+		vector<QuantizedVertex> reference(vertexCount);
+		const QuantizeKernel kernels[] = { QuantizeKernel::Scalar, QuantizeKernel::Sse };
+
+		for (QuantizeKernel kernel : kernels)
+		{
+			vector<QuantizedVertex> result(vertexCount);
+			double bestMs = DBL_MAX;
+			for (int i = 0; i < iterations; ++i)
+			{
+				high_resolution_clock::time_point start = high_resolution_clock::now();
+				VertexQuantizer::Encode(kernel, vertices, vertexCount, boundsMin, boundsMax, result.data());
+				double ms = ElapsedMs(start);
+				bestMs = ms < bestMs ? ms : bestMs;
+			}
+
+			bool match = true;
+			if (kernel == QuantizeKernel::Scalar)
+			{
+				reference.swap(result);
+			}
+			else
+			{
+				match = memcmp(reference.data(), result.data(), vertexCount * sizeof(QuantizedVertex)) == 0;
+			}
+			allMatch = allMatch && match;
+
+			wprintf(L"  %-10s %10.3f ms %8.2f MB/s %s\n", VertexQuantizer::GetKernelName(kernel),
+				bestMs, fullMb / (bestMs / 1000.0), match ? L"ok" : L"MISMATCH");
+		}
+
+		// round trip errors, positions in quantization steps, directions in degrees
+		const float* min = &boundsMin.x;
+		const float* max = &boundsMax.x;
+		double maxPositionError = 0.0;
+		double maxNormalError = 0.0;
+		double maxTangentError = 0.0;
+		bool texCoordsOk = true;
+
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			XMFLOAT3 position = VertexQuantizer::DecodePosition(reference[i], boundsMin, boundsMax);
+			const float* decoded = &position.x;
+			const float* expected = &vertices[i].position.x;
+			for (int c = 0; c < 3; ++c)
+			{
+				double step = (max[c] - min[c]) / 65535.0;
+				double error = fabs(static_cast<double>(decoded[c]) - expected[c]);
+				maxPositionError = fmax(maxPositionError, step > 0.0 ? error / step : error);
+			}
+
+			const XMFLOAT3* directions[] = { &vertices[i].normal, &vertices[i].tangent };
+			const UINT32 encoded[] = { reference[i].normal, reference[i].tangent };
+			double* maxErrors[] = { &maxNormalError, &maxTangentError };
+			for (int d = 0; d < 2; ++d)
+			{
+				const XMFLOAT3& a = *directions[d];
+				if (!isfinite(a.x) || !isfinite(a.y) || !isfinite(a.z) || (a.x == 0.0f && a.y == 0.0f && a.z == 0.0f))
+				{
+					continue;
+				}
+
+				XMFLOAT3 b = VertexQuantizer::DecodeDirection(encoded[d]);
+				double crossX = static_cast<double>(a.y) * b.z - static_cast<double>(a.z) * b.y;
+				double crossY = static_cast<double>(a.z) * b.x - static_cast<double>(a.x) * b.z;
+				double crossZ = static_cast<double>(a.x) * b.y - static_cast<double>(a.y) * b.x;
+				double dot = static_cast<double>(a.x) * b.x + static_cast<double>(a.y) * b.y + static_cast<double>(a.z) * b.z;
+				double angle = atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot) * 180.0 / XM_PI;
+				*maxErrors[d] = fmax(*maxErrors[d], angle);
+			}
+
+			// half precision, within half an ulp of the original
+			XMFLOAT2 texCoord = VertexQuantizer::DecodeTextureCoordinate(reference[i]);
+			const float* decodedTexCoord = &texCoord.x;
+			const float* expectedTexCoord = &vertices[i].textureCoordinate.x;
+			for (int c = 0; c < 2; ++c)
+			{
+				double bound = fmax(fabs(expectedTexCoord[c]) / 2048.0, 1.0 / 33554432.0);
+				texCoordsOk = texCoordsOk && fabs(static_cast<double>(decodedTexCoord[c]) - expectedTexCoord[c]) <= bound;
+			}
+		}
+
+		const bool errorsOk = maxPositionError <= 0.51 && maxNormalError <= 0.01 && maxTangentError <= 0.01 && texCoordsOk;
+		wprintf(L"  max position error %.3f steps, normal %.4f deg, tangent %.4f deg, texture coordinates %s\n",
+			maxPositionError, maxNormalError, maxTangentError, texCoordsOk ? L"ok" : L"OUT OF RANGE");
+
+		// every float bit pattern through both half conversions
+		UINT64 halfMismatches = 0;
+		for (UINT64 bits = 0; bits <= 0xffffffffull; bits += 4)
+		{
+			UINT32 patterns[4] = { static_cast<UINT32>(bits), static_cast<UINT32>(bits + 1),
+				static_cast<UINT32>(bits + 2), static_cast<UINT32>(bits + 3) };
+			float values[4];
+			memcpy(values, patterns, sizeof(values));
+
+			UINT16 halves[4];
+			VertexQuantizer::FloatToHalfSse(values, halves);
+			for (int i = 0; i < 4; ++i)
+			{
+				halfMismatches += halves[i] != VertexQuantizer::FloatToHalf(values[i]) ? 1 : 0;
+			}
+		}
+		wprintf(L"  half conversion: %llu mismatches over all floats\n", halfMismatches);
+
+		return allMatch && errorsOk && halfMismatches == 0 ? 0 : -1;
+	}
+
+	int BenchmarkMeshlets(int argc, wchar_t** argv)
+	{
+		if (argc < 3)
+		{
+			wprintf(L"usage: -bench-meshlets <input.obj> [views]\n");
+			return -1;
+		}
+
+		int views = argc > 3 ? _wtoi(argv[3]) : 64;
+		if (views < 1)
+		{
+			views = 1;
+		}
+
+		Actor actor(nullptr);
+		actor.LoadObjFromFile(argv[2]);
+
+		const Vertex* vertices = actor.GetVertices();
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(actor.GetIndices());
+		const MeshLod& lod = actor.GetLod(0);
+
+		vector<Meshlet> meshlets;
+		high_resolution_clock::time_point buildStart = high_resolution_clock::now();
+		MeshletBuilder::Build(vertices, actor.GetVertexCount(), indices, lod.indexOffset, lod.indexCount, meshlets);
+		double buildMs = ElapsedMs(buildStart);
+
+		UINT meshletVertices = 0;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			meshletVertices += meshlet.vertexCount;
+		}
+		wprintf(L"%zu meshlets for %u triangles in %.3f ms, %.1f vertices and %.1f triangles each\n",
+			meshlets.size(), lod.indexCount / 3, buildMs,
+			meshletVertices / static_cast<double>(meshlets.size()), lod.indexCount / 3.0 / meshlets.size());
+
+		// cameras on a sphere around the mesh, alternating between seeing all of it and being close
+		XMFLOAT3 boundsMin = actor.GetBoundsMin();
+		XMFLOAT3 boundsMax = actor.GetBoundsMax();
+		XMVECTOR center = (XMLoadFloat3(&boundsMin) + XMLoadFloat3(&boundsMax)) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&boundsMax) - XMLoadFloat3(&boundsMin))) * 0.5f;
+		XMMATRIX projectionMat = XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 16.0f / 9.0f, radius * 0.01f, radius * 100.0f);
+
+		double rejectedTriangles = 0.0;
+		double frustumCulled = 0.0;
+		double coneCulled = 0.0;
+		double draws = 0.0;
+		double cullMs = 0.0;
+		UINT violations = 0;
+		vector<IndexRange> ranges;
+
+		for (int view = 0; view < views; ++view)
+		{
+			float y = 1.0f - 2.0f * (view + 0.5f) / views;
+			float ring = sqrtf(1.0f - y * y);
+			float angle = view * 2.39996323f;	// golden angle
+			float distance = radius * (view % 2 == 0 ? 3.0f : 1.2f);
+			XMVECTOR direction = XMVectorSet(ring * cosf(angle), y, ring * sinf(angle), 0.0f);
+			XMVECTOR eye = center + direction * distance;
+			XMVECTOR up = fabsf(y) > 0.99f ? X_UNIT_VEC : Y_UNIT_VEC;
+			XMMATRIX objectToClip = XMMatrixLookAtLH(eye, center, up) * projectionMat;
+
+			XMFLOAT3 eyePosition;
+			XMStoreFloat3(&eyePosition, eye);
+
+			high_resolution_clock::time_point cullStart = high_resolution_clock::now();
+			MeshletCuller culler(objectToClip, eyePosition);
+			MeshletCullStats stats;
+			culler.Cull(meshlets, ranges, stats);
+			cullMs += ElapsedMs(cullStart);
+
+			rejectedTriangles += 1.0 - stats.visibleTriangles / static_cast<double>(stats.triangles);
+			frustumCulled += stats.frustumCulled / static_cast<double>(stats.meshlets);
+			coneCulled += stats.coneCulled / static_cast<double>(stats.meshlets);
+			draws += ranges.size();
+
+			for (const Meshlet& meshlet : meshlets)
+			{
+				if (culler.IsInFrustum(meshlet) && !culler.IsBackfacing(meshlet))
+				{
+					continue;
+				}
+
+				for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3)
+				{
+					violations += IsTriangleVisible(vertices, indices + i, objectToClip, eye) ? 1 : 0;
+				}
+			}
+		}
+
+		wprintf(L"%d views: %.1f%% triangles rejected, meshlets %.1f%% frustum and %.1f%% cone culled, %.1f draws\n",
+			views, 100.0 * rejectedTriangles / views, 100.0 * frustumCulled / views, 100.0 * coneCulled / views, draws / views);
+		wprintf(L"  culling %.3f us per view, %u visible triangles culled %s\n",
+			1000.0 * cullMs / views, violations, violations == 0 ? L"ok" : L"WRONG");
+
+		return violations == 0 ? 0 : -1;
+	}
+
+	bool ParseBlockFormat(const wchar_t* const name, BlockFormat& format)
+	{
+		const BlockFormat formats[] = { BlockFormat::Bc1, BlockFormat::Bc4, BlockFormat::Bc5 };
+		for (BlockFormat candidate : formats)
+		{
+			if (_wcsicmp(name, BlockCompressor::GetFormatName(candidate)) == 0)
+			{
+				format = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	UINT32 GetDdsFormat(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::Bc1:
+			return DDS_FORMAT_BC1_UNORM;
+		case BlockFormat::Bc4:
+			return DDS_FORMAT_BC4_UNORM;
+		case BlockFormat::Bc5:
+			return DDS_FORMAT_BC5_UNORM;
+		}
+		return 0;
+	}
+
+	// over the BGRA channels the format stores
+	double ComputePsnr(BlockFormat format, const BYTE* original, const BYTE* decoded, size_t texelCount)
+	{
+		const UINT bc1Channels[] = { 0, 1, 2 };
+		const UINT bc4Channels[] = { 2 };
+		const UINT bc5Channels[] = { 2, 1 };
+		const UINT* channels = format == BlockFormat::Bc1 ? bc1Channels : (format == BlockFormat::Bc4 ? bc4Channels : bc5Channels);
+		const UINT channelCount = format == BlockFormat::Bc1 ? 3 : (format == BlockFormat::Bc4 ? 1 : 2);
+
+		double squaredError = 0.0;
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			for (UINT c = 0; c < channelCount; ++c)
+			{
+				double difference = static_cast<double>(original[i * 4 + channels[c]]) - decoded[i * 4 + channels[c]];
+				squaredError += difference * difference;
+			}
+		}
+
+		double meanSquaredError = squaredError / (static_cast<double>(texelCount) * channelCount);
+		return meanSquaredError > 0.0 ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+	}
+
+	// the content the shaders expect in each format, for filtering the mips
+	MipContent GetMipContent(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::Bc1:
+			return MipContent::Srgb;
+		case BlockFormat::Bc5:
+			return MipContent::Normal;
+		default:
+			return MipContent::Linear;
+		}
+	}
+
+	bool ParseMipFilter(const wchar_t* const name, MipFilter& filter)
+	{
+		const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+		for (MipFilter candidate : filters)
+		{
+			if (_wcsicmp(name, MipGenerator::GetFilterName(candidate)) == 0)
+			{
+				filter = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool ParseMipContent(const wchar_t* const name, MipContent& content)
+	{
+		const wchar_t* names[] = { L"linear", L"srgb", L"normal" };
+		const MipContent contents[] = { MipContent::Linear, MipContent::Srgb, MipContent::Normal };
+		for (int i = 0; i < _countof(names); ++i)
+		{
+			if (_wcsicmp(name, names[i]) == 0)
+			{
+				content = contents[i];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int CookTexture(int argc, wchar_t** argv)
+	{
+		BlockFormat format;
+		MipFilter filter = MipFilter::Kaiser;
+		if (argc < 5 || !ParseBlockFormat(argv[4], format) || (argc > 5 && !ParseMipFilter(argv[5], filter)))
+		{
+			wprintf(L"usage: -cook-texture <input.png> <output.dds> <bc1|bc4|bc5> [box|kaiser]\n");
+			return -1;
+		}
+
+		// the mips are filtered here so the engine only copies them
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		Texture texture(nullptr);
+		texture.LoadFromFile(argv[2], GetMipContent(format), filter);
+		const UINT width = texture.GetWidth();
+		const UINT height = texture.GetHeight();
+		const UINT mipCount = texture.GetMipLevels();
+		double mipMs = ElapsedMs(start);
+
+		// D3D12 only creates a block compressed resource whose top level is whole blocks
+		if (width % 4 != 0 || height % 4 != 0)
+		{
+			wprintf(L"%s is %ux%u, a block compressed texture needs a multiple of 4 in both dimensions\n", argv[2], width, height);
+			return -1;
+		}
+
+		vector<BYTE> blocks(static_cast<size_t>(DdsFile::GetMipChainSize(GetDdsFormat(format), width, height, mipCount)));
+		start = high_resolution_clock::now();
+		const BYTE* mipTexels = texture.GetData();
+		BYTE* mipBlocks = blocks.data();
+		UINT mipWidth = width;
+		UINT mipHeight = height;
+		for (UINT mip = 0; mip < mipCount; ++mip)
+		{
+			BlockCompressor::Compress(format, BlockKernel::Sse, mipTexels, mipWidth, mipHeight, mipBlocks, ThreadPool::GetShared());
+
+			mipTexels += static_cast<size_t>(mipWidth) * mipHeight * 4;
+			mipBlocks += BlockCompressor::GetCompressedSize(format, mipWidth, mipHeight);
+			mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+			mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+		}
+		double compressMs = ElapsedMs(start);
+
+		if (!DdsWriter::Write(argv[3], GetDdsFormat(format), width, height, mipCount, blocks.data(), blocks.size()))
+		{
+			wprintf(L"failed to write %s\n", argv[3]);
+			return -1;
+		}
+
+		vector<BYTE> decoded(static_cast<size_t>(width) * height * 4);
+		BlockCompressor::Decompress(format, blocks.data(), width, height, decoded.data());
+
+		wprintf(L"cooked %s -> %s: %ux%u %s, %u mips (%s) in %.2f ms, %.2f MB -> %.2f MB in %.2f ms, PSNR %.2f dB\n",
+			argv[2], argv[3], width, height, BlockCompressor::GetFormatName(format), mipCount, MipGenerator::GetFilterName(filter), mipMs,
+			MipGenerator::GetChainSize(width, height, mipCount) / (1024.0 * 1024.0), blocks.size() / (1024.0 * 1024.0), compressMs,
+			ComputePsnr(format, texture.GetData(), decoded.data(), static_cast<size_t>(width) * height));
+		return 0;
+	}
+
+	int BenchmarkCompress(int argc, wchar_t** argv)
+	{
+		if (argc < 3)
+		{
+			wprintf(L"usage: -bench-compress <input.png> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 3 ? _wtoi(argv[3]) : 5;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		Texture texture(nullptr);
+		texture.LoadFromFile(argv[2], MipContent::Linear);
+		const UINT width = texture.GetWidth();
+		const UINT height = texture.GetHeight();
+		const BYTE* bgra = texture.GetData();
+		const double megapixels = static_cast<double>(width) * height / 1e6;
+		ThreadPool& threadPool = ThreadPool::GetShared();
+
+		wprintf(L"%ux%u, best of %d, %u threads\n", width, height, iterations, threadPool.GetThreadCount());
+
+		bool allMatch = true;
+		const BlockFormat formats[] = { BlockFormat::Bc1, BlockFormat::Bc4, BlockFormat::Bc5 };
+		const BlockKernel kernels[] = { BlockKernel::Scalar, BlockKernel::Sse };
+
+		for (BlockFormat format : formats)
+		{
+			const size_t compressedSize = static_cast<size_t>(BlockCompressor::GetCompressedSize(format, width, height));
+			vector<BYTE> reference(compressedSize);
+			BlockCompressor::Compress(format, BlockKernel::Scalar, bgra, width, height, reference.data());
+
+			for (BlockKernel kernel : kernels)
+			{
+				for (int threaded = 0; threaded < 2; ++threaded)
+				{
+					vector<BYTE> blocks(compressedSize);
+					double bestMs = DBL_MAX;
+					for (int i = 0; i < iterations; ++i)
+					{
+						high_resolution_clock::time_point start = high_resolution_clock::now();
+						if (threaded)
+						{
+							BlockCompressor::Compress(format, kernel, bgra, width, height, blocks.data(), threadPool);
+						}
+						else
+						{
+							BlockCompressor::Compress(format, kernel, bgra, width, height, blocks.data());
+						}
+						double ms = ElapsedMs(start);
+						bestMs = ms < bestMs ? ms : bestMs;
+					}
+
+					bool match = blocks == reference;
+					allMatch = allMatch && match;
+
+					wprintf(L"  %s %-6s %-8s %10.3f ms %8.2f MPixel/s %s\n", BlockCompressor::GetFormatName(format),
+						BlockCompressor::GetKernelName(kernel), threaded ? L"threaded" : L"single",
+						bestMs, megapixels / (bestMs / 1000.0), match ? L"ok" : L"MISMATCH");
+				}
+			}
+
+			vector<BYTE> decoded(static_cast<size_t>(width) * height * 4);
+			BlockCompressor::Decompress(format, reference.data(), width, height, decoded.data());
+			wprintf(L"  %s %.2f MB -> %.2f MB, PSNR %.2f dB\n", BlockCompressor::GetFormatName(format),
+				decoded.size() / (1024.0 * 1024.0), compressedSize / (1024.0 * 1024.0),
+				ComputePsnr(format, bgra, decoded.data(), static_cast<size_t>(width) * height));
+		}
+
+		return allMatch ? 0 : -1;
+	}
+
+	int BenchmarkMips(int argc, wchar_t** argv)
+	{
+		MipContent content;
+		if (argc < 4 || !ParseMipContent(argv[3], content))
+		{
+			wprintf(L"usage: -bench-mips <input.png> <linear|srgb|normal> [iterations]\n");
+			return -1;
+		}
+
+		int iterations = argc > 4 ? _wtoi(argv[4]) : 5;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		Texture texture(nullptr);
+		texture.LoadFromFile(argv[2], content);
+		const UINT width = texture.GetWidth();
+		const UINT height = texture.GetHeight();
+		const UINT mipCount = texture.GetMipLevels();
+		const BYTE* bgra = texture.GetData();
+		const size_t chainSize = static_cast<size_t>(MipGenerator::GetChainSize(width, height, mipCount));
+		const double megapixels = static_cast<double>(width) * height / 1e6;
+		ThreadPool& threadPool = ThreadPool::GetShared();
+
+		wprintf(L"%ux%u, %u mips, best of %d, %u threads\n", width, height, mipCount, iterations, threadPool.GetThreadCount());
+
+		bool allMatch = true;
+		const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+		const MipKernel kernels[] = { MipKernel::Scalar, MipKernel::Sse };
+
+		for (MipFilter filter : filters)
+		{
+			vector<BYTE> reference(chainSize);
+			MipGenerator::Generate(filter, content, MipKernel::Scalar, bgra, width, height, mipCount, reference.data());
+
+			for (MipKernel kernel : kernels)
+			{
+				for (int threaded = 0; threaded < 2; ++threaded)
+				{
+					vector<BYTE> chain(chainSize);
+					double bestMs = DBL_MAX;
+					for (int i = 0; i < iterations; ++i)
+					{
+						high_resolution_clock::time_point start = high_resolution_clock::now();
+						if (threaded)
+						{
+							MipGenerator::Generate(filter, content, kernel, bgra, width, height, mipCount, chain.data(), threadPool);
+						}
+						else
+						{
+							MipGenerator::Generate(filter, content, kernel, bgra, width, height, mipCount, chain.data());
+						}
+						double ms = ElapsedMs(start);
+						bestMs = ms < bestMs ? ms : bestMs;
+					}
+
+					bool match = chain == reference;
+					allMatch = allMatch && match;
+
+					wprintf(L"  %-6s %-6s %-8s %10.3f ms %8.2f MPixel/s %s\n", MipGenerator::GetFilterName(filter),
+						MipGenerator::GetKernelName(kernel), threaded ? L"threaded" : L"single",
+						bestMs, megapixels / (bestMs / 1000.0), match ? L"ok" : L"MISMATCH");
+				}
+			}
+		}
+
+		return allMatch ? 0 : -1;
+	}
+
+	int PackOrm(int argc, wchar_t** argv)
+	{
+		if (argc < 5)
+		{
+			wprintf(L"usage: -pack-orm <occlusion.png> <roughness.png> <output.dds> [specular.png]\n");
+			return -1;
+		}
+
+		const wchar_t* specularFileName = argc > 5 ? argv[5] : nullptr;
+
+		high_resolution_clock::time_point start = high_resolution_clock::now();
+		Texture texture(nullptr);
+		texture.LoadOrmFromFiles(argv[2], argv[3], specularFileName);
+		const UINT width = texture.GetWidth();
+		const UINT height = texture.GetHeight();
+		const UINT mipCount = texture.GetMipLevels();
+		const UINT64 chainSize = MipGenerator::GetChainSize(width, height, mipCount);
+		double packMs = ElapsedMs(start);
+
+		if (!DdsWriter::Write(argv[4], DDS_FORMAT_B8G8R8A8_UNORM, width, height, mipCount, texture.GetData(), chainSize))
+		{
+			wprintf(L"failed to write %s\n", argv[4]);
+			return -1;
+		}
+
+		wprintf(L"packed %s, %s and %s -> %s: %ux%u, %u mips in %.2f ms, %.2f MB instead of %.2f MB\n",
+			argv[2], argv[3], specularFileName != nullptr ? specularFileName : L"full specular", argv[4], width, height, mipCount, packMs,
+			chainSize / (1024.0 * 1024.0), (specularFileName != nullptr ? 3 : 2) * chainSize / (1024.0 * 1024.0));
+		return 0;
+	}
+
+	int VerifyOrm(int argc, wchar_t** argv)
+	{
+		if (argc < 5)
+		{
+			wprintf(L"usage: -verify-orm <occlusion.png> <roughness.png> <orm.dds> [specular.png]\n");
+			return -1;
+		}
+
+		Texture occlusion(nullptr);
+		occlusion.LoadFromFile(argv[2], MipContent::Linear);
+		Texture roughness(nullptr);
+		roughness.LoadFromFile(argv[3], MipContent::Linear);
+		Texture specular(nullptr);
+		if (argc > 5)
+		{
+			specular.LoadFromFile(argv[5], MipContent::Linear);
+		}
+		Texture orm(nullptr);
+		orm.LoadFromFile(argv[4], MipContent::Linear);
+
+		const UINT width = orm.GetWidth();
+		const UINT height = orm.GetHeight();
+		if (static_cast<UINT32>(orm.GetFormat()) != DDS_FORMAT_B8G8R8A8_UNORM)
+		{
+			wprintf(L"%s is not a BGRA8 texture\n", argv[4]);
+			return -1;
+		}
+		if (occlusion.GetWidth() != width || occlusion.GetHeight() != height ||
+			roughness.GetWidth() != width || roughness.GetHeight() != height ||
+			(argc > 5 && (specular.GetWidth() != width || specular.GetHeight() != height)))
+		{
+			wprintf(L"the sources are not %ux%u\n", width, height);
+			return -1;
+		}
+
+		// the top level holds the packed values, the mips are filtered from it
+		OrmChannelError errors[ORM_CHANNEL_COUNT];
+		OrmPacker::Compare(occlusion.GetData(), roughness.GetData(), argc > 5 ? specular.GetData() : nullptr, orm.GetData(),
+			static_cast<size_t>(width) * height, errors);
+
+		const wchar_t* channelNames[ORM_CHANNEL_COUNT] = { L"occlusion", L"roughness", L"specular" };
+		bool allMatch = true;
+		for (UINT c = 0; c < ORM_CHANNEL_COUNT; ++c)
+		{
+			allMatch = allMatch && errors[c].maxError == 0;
+			wprintf(L"  %-9s max error %3d, mean squared error %.4f %s\n", channelNames[c], errors[c].maxError,
+				errors[c].meanSquaredError, errors[c].maxError == 0 ? L"ok" : L"MISMATCH");
+		}
+
+		const bool fullChain = orm.GetMipLevels() == MipGenerator::GetMipCount(width, height);
+		wprintf(L"  %u of %u mips %s\n", orm.GetMipLevels(), MipGenerator::GetMipCount(width, height), fullChain ? L"ok" : L"MISSING");
+
+		return allMatch && fullChain ? 0 : -1;
+	}
+
+	// loads the textures the engine starts with from the PNGs, one after another and then fanned out on the
+	// thread pool the way the asset loader does it
+	int BenchmarkTextureLoad()
+	{
+		const int textureCount = 3;
+		const wchar_t* textureNames[textureCount] = { L"color", L"normal", L"orm" };
+
+		auto loadTexture = [](Texture& texture, int index)
+		{
+			switch (index)
+			{
+			case 0:
+				texture.LoadFromFile(L"Assets\\color.png", MipContent::Srgb);
+				break;
+			case 1:
+				texture.LoadFromFile(L"Assets\\normal.png", MipContent::Normal);
+				break;
+			default:
+				texture.LoadOrmFromFiles(L"Assets\\oclussion.png", L"Assets\\roughness.png", nullptr);
+				break;
+			}
+		};
+
+		ThreadPool& threadPool = ThreadPool::GetShared();
+		wprintf(L"%u threads\n", threadPool.GetThreadCount());
+
+		for (int parallel = 0; parallel < 2; ++parallel)
+		{
+			vector<Texture> textures;
+			textures.reserve(textureCount);
+			for (int i = 0; i < textureCount; ++i)
+			{
+				textures.emplace_back(nullptr);
+			}
+			double loadMs[textureCount] = {};
+
+			high_resolution_clock::time_point start = high_resolution_clock::now();
+			auto job = [&](UINT i)
+			{
+				high_resolution_clock::time_point loadStart = high_resolution_clock::now();
+				loadTexture(textures[i], i);
+				loadMs[i] = ElapsedMs(loadStart);
+			};
+
+			if (parallel)
+			{
+				threadPool.ParallelFor(textureCount, job);
+			}
+			else
+			{
+				for (UINT i = 0; i < textureCount; ++i)
+				{
+					job(i);
+				}
+			}
+			double totalMs = ElapsedMs(start);
+
+			wprintf(L"%s: %.2f ms\n", parallel ? L"parallel" : L"sequential", totalMs);
+			for (int i = 0; i < textureCount; ++i)
+			{
+				const TextureLoadTimes& times = textures[i].GetLoadTimes();
+				wprintf(L"  %-6s %8.2f ms (decode %.2f, pack %.2f, mips %.2f)\n", textureNames[i], loadMs[i],
+					times.decodeMs, times.packMs, times.mipMs);
+			}
+		}
+
+		return 0;
+	}
+
+	int TestTextureCache()
+	{
+		TextureCache cache(nullptr);
+		int failures = 0;
+		auto check = [&failures](const wchar_t* const name, bool passed)
+		{
+			failures += passed ? 0 : 1;
+			wprintf(L"  %-44s %s\n", name, passed ? L"ok" : L"FAILED");
+		};
+
+		// the same image under another name
+		wchar_t copyFileName[MAX_PATH];
+		GetTempPathW(MAX_PATH, copyFileName);
+		wcscat_s(copyFileName, L"texture_cache_color.png");
+		if (!CopyFileW(L"Assets\\color.png", copyFileName, FALSE))
+		{
+			wprintf(L"Could not copy Assets\\color.png\n");
+			return -1;
+		}
+
+		TextureHandle color = cache.Load(L"Assets\\color.png", MipContent::Srgb);
+		TextureHandle samePath = cache.Load(L"assets/COLOR.png", MipContent::Srgb);
+		TextureHandle sameContent = cache.Load(copyFileName, MipContent::Srgb);
+		TextureHandle otherContent = cache.Load(L"Assets\\color.png", MipContent::Linear);
+		DeleteFileW(copyFileName);
+
+		check(L"same path, another spelling", samePath.Get() == color.Get());
+		check(L"same bytes, another path", sameContent.Get() == color.Get());
+		check(L"same file, filtered differently", otherContent.Get() != color.Get());
+
+		TextureCacheStats stats = cache.GetStats();
+		check(L"2 hits, 2 misses, 2 textures, 4 handles", stats.hits == 2 && stats.misses == 2 && stats.textureCount == 2 &&
+			stats.handleCount == 4);
+
+		otherContent = TextureHandle();
+		TextureHandle copied = color;
+		color = TextureHandle();
+		samePath = TextureHandle();
+		sameContent = TextureHandle();
+		check(L"a copied handle keeps the texture", cache.GetStats().textureCount == 1 && copied->GetWidth() > 0);
+		copied = TextureHandle();
+		check(L"the last handle frees it", cache.GetStats().textureCount == 0);
+
+		// loader threads asking for one texture at once, one of them decodes it
+		const UINT loadCount = 8;
+		vector<TextureHandle> normals(loadCount);
+		ThreadPool::GetShared().ParallelFor(loadCount, [&](UINT i)
+		{
+			normals[i] = cache.Load(L"Assets\\normal.png", MipContent::Normal);
+		});
+
+		bool shared = true;
+		for (const TextureHandle& normal : normals)
+		{
+			shared = shared && normal.Get() == normals[0].Get();
+		}
+		stats = cache.GetStats();
+		check(L"concurrent loads decode once", shared && stats.misses == 3 && stats.hits == 2 + loadCount - 1);
+
+		wprintf(L"%d failures\n", failures);
+		return failures == 0 ? 0 : -1;
+	}
+
+	int BenchmarkPng(int argc, wchar_t** argv)
+	{
+		int iterations = argc > 2 ? _wtoi(argv[2]) : 10;
+		if (iterations < 1)
+		{
+			iterations = 1;
+		}
+
+		// the benchmark is portable and takes narrow paths
+		vector<string> fileNames;
+		for (int i = 3; i < argc; ++i)
+		{
+			char fileName[MAX_PATH] = {};
+			WideCharToMultiByte(CP_ACP, 0, argv[i], -1, fileName, MAX_PATH, nullptr, nullptr);
+			fileNames.push_back(fileName);
+		}
+
+		return RunPngBenchmark(fileNames, iterations);
+	}
+}
+
+bool IsToolCommand(const wchar_t* const command)
+{
+	return wcscmp(command, L"-cook") == 0 ||
+		wcscmp(command, L"-bench-mesh") == 0 ||
+		wcscmp(command, L"-bench-obj") == 0 ||
+		wcscmp(command, L"-bench-tangents") == 0 ||
+		wcscmp(command, L"-bench-quantize") == 0 ||
+		wcscmp(command, L"-bench-meshlets") == 0 ||
+		wcscmp(command, L"-test-meshlets") == 0 ||
+		wcscmp(command, L"-cook-texture") == 0 ||
+		wcscmp(command, L"-bench-compress") == 0 ||
+		wcscmp(command, L"-bench-mips") == 0 ||
+		wcscmp(command, L"-pack-orm") == 0 ||
+		wcscmp(command, L"-verify-orm") == 0 ||
+		wcscmp(command, L"-test-texture-files") == 0 ||
+		wcscmp(command, L"-bench-texture-load") == 0 ||
+		wcscmp(command, L"-test-mip-streaming") == 0 ||
+		wcscmp(command, L"-test-texture-cache") == 0 ||
+		wcscmp(command, L"-bench-png") == 0 ||
+		wcscmp(command, L"-test-residency") == 0 ||
+		wcscmp(command, L"-test-upload-ring") == 0 ||
+		wcscmp(command, L"-test-heap-allocator") == 0 ||
+		wcscmp(command, L"-bench-heap-allocator") == 0 ||
+		wcscmp(command, L"-test-descriptor-allocator") == 0 ||
+		wcscmp(command, L"-test-resource-states") == 0 ||
+		wcscmp(command, L"-test-deferred-release") == 0;
+}
+
+int RunTool(int argc, wchar_t** argv)
+{
+	AttachToConsole();
+
+	if (wcscmp(argv[1], L"-cook") == 0)
+	{
+		return CookMesh(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-mesh") == 0)
+	{
+		return BenchmarkMesh(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-obj") == 0)
+	{
+		return BenchmarkObj(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-tangents") == 0)
+	{
+		return BenchmarkTangents(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-quantize") == 0)
+	{
+		return BenchmarkQuantize(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-meshlets") == 0)
+	{
+		return BenchmarkMeshlets(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-test-meshlets") == 0)
+	{
+		return RunMeshletTests();
+	}
+	else if (wcscmp(argv[1], L"-cook-texture") == 0)
+	{
+		return CookTexture(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-compress") == 0)
+	{
+		return BenchmarkCompress(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-bench-mips") == 0)
+	{
+		return BenchmarkMips(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-pack-orm") == 0)
+	{
+		return PackOrm(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-verify-orm") == 0)
+	{
+		return VerifyOrm(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-test-texture-files") == 0)
+	{
+		return RunTextureFileTests();
+	}
+	else if (wcscmp(argv[1], L"-bench-texture-load") == 0)
+	{
+		return BenchmarkTextureLoad();
+	}
+	else if (wcscmp(argv[1], L"-test-mip-streaming") == 0)
+	{
+		return RunMipStreamerTests();
+	}
+	else if (wcscmp(argv[1], L"-test-texture-cache") == 0)
+	{
+		return TestTextureCache();
+	}
+	else if (wcscmp(argv[1], L"-bench-png") == 0)
+	{
+		return BenchmarkPng(argc, argv);
+	}
+	else if (wcscmp(argv[1], L"-test-residency") == 0)
+	{
+		return RunResidencyManagerTests();
+	}
+	else if (wcscmp(argv[1], L"-test-upload-ring") == 0)
+	{
+		return RunUploadRingTests();
+	}
+	else if (wcscmp(argv[1], L"-test-heap-allocator") == 0)
+	{
+		return RunHeapAllocatorTests();
+	}
+	else if (wcscmp(argv[1], L"-bench-heap-allocator") == 0)
+	{
+		int iterations = argc > 2 ? _wtoi(argv[2]) : 1000000;
+		return RunHeapAllocatorBenchmark(iterations > 0 ? iterations : 1);
+	}
+	else if (wcscmp(argv[1], L"-test-descriptor-allocator") == 0)
+	{
+		return RunDescriptorAllocatorTests();
+	}
+	else if (wcscmp(argv[1], L"-test-resource-states") == 0)
+	{
+		return RunResourceStateTrackerTests();
+	}
+	else if (wcscmp(argv[1], L"-test-deferred-release") == 0)
+	{
+		return RunDeferredReleaseQueueTests();
+	}
+
+	return -1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// offline tools run from the command line instead of opening the window:
+//   -cook <input.obj> <output.mesh>
+//   -bench-mesh <input.obj> <input.mesh> [iterations]
+//   -bench-obj <input.obj> [iterations]
+//   -bench-tangents <input.obj> [iterations]
+//   -bench-quantize <input.obj> [iterations]
+//   -bench-meshlets <input.obj> [views]
+//   -test-meshlets
+//   -cook-texture <input.png> <output.dds> <bc1|bc4|bc5> [box|kaiser]
+//   -bench-compress <input.png> [iterations]
+//   -bench-mips <input.png> <linear|srgb|normal> [iterations]
+//   -pack-orm <occlusion.png> <roughness.png> <output.dds> [specular.png]
+//   -verify-orm <occlusion.png> <roughness.png> <orm.dds> [specular.png]
+//   -test-texture-files
+//   -bench-texture-load
+//   -test-mip-streaming
+//   -test-texture-cache
+//   -bench-png [iterations] [file.png ...]
+//   -test-residency
+//   -test-upload-ring
+//   -test-heap-allocator
+//   -bench-heap-allocator [iterations]
+//   -test-descriptor-allocator
+//   -test-resource-states
+//   -test-deferred-release
+
+bool IsToolCommand(const wchar_t* const command);
+int RunTool(int argc, wchar_t** argv);
@@ -0,0 +1,85 @@
+#include "UploadRing.h"
+
+using namespace std;
+
+UploadRing::UploadRing(uint64_t capacity, function<uint64_t()> completedFenceValue)
+	: m_capacity(capacity), m_completedFenceValue(completedFenceValue), m_head(0), m_tail(0), m_submittedHead(0), m_stats()
+{
+}
+
+bool UploadRing::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	Reclaim();
+
+	uint64_t start = (m_head + alignment - 1) & ~(alignment - 1);
+	if (start % m_capacity + size > m_capacity)
+	{
+		// skip the end, the region starts at the beginning of the ring
+		start = (start / m_capacity + 1) * m_capacity;
+	}
+
+	if (size > m_capacity || start + size - m_tail > m_capacity)
+	{
+		++m_stats.failedAllocations;
+		return false;
+	}
+
+	if (start / m_capacity != m_head / m_capacity)
+	{
+		++m_stats.wraps;
+	}
+	m_stats.paddingBytes += start - m_head;
+	m_stats.allocatedBytes += size;
+	++m_stats.allocations;
+
+	m_head = start + size;
+	if (GetUsedBytes() > m_stats.peakUsedBytes)
+	{
+		m_stats.peakUsedBytes = GetUsedBytes();
+	}
+
+	offset = start % m_capacity;
+	return true;
+}
+
+void UploadRing::Submit(uint64_t fenceValue)
+{
+	if (m_head == m_submittedHead)
+	{
+		return;
+	}
+
+	Submission submission = { fenceValue, m_head };
+	m_submissions.push_back(submission);
+	m_submittedHead = m_head;
+}
+
+void UploadRing::Reclaim()
+{
+	if (m_submissions.empty())
+	{
+		return;
+	}
+
+	const uint64_t completedFenceValue = m_completedFenceValue();
+	while (!m_submissions.empty() && m_submissions.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_submissions.front().end;
+		m_submissions.pop_front();
+	}
+}
+
+uint64_t UploadRing::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint64_t UploadRing::GetUsedBytes() const
+{
+	return m_head - m_tail;
+}
+
+const UploadRingStats& UploadRing::GetStats() const
+{
+	return m_stats;
+}
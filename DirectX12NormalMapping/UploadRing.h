@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// buffer copies have no placement rule, 16 keeps the CPU side copies aligned
+const uint64_t UPLOAD_RING_BUFFER_ALIGNMENT = 16;
+
+struct UploadRingStats
+{
+	uint64_t allocatedBytes;	// handed out, alignment and skipped ends not included
+	uint64_t paddingBytes;	// lost to alignment and to regions that would have run past the end
+	uint64_t peakUsedBytes;	// most bytes in flight at once, padding included
+	uint32_t allocations;
+	uint32_t wraps;
+	uint32_t failedAllocations;	// did not fit, the caller has to upload some other way
+};
+
+// Suballocates upload memory from one fixed size ring. Allocations are taken
+// from the head and recorded copies read them until the GPU gets past the
+// fence value they were submitted with, after which the tail moves past them
+// and the space is reused. A region never wraps, when it would run past the
+// end the rest of the ring is skipped and it starts at the beginning. Offsets
+// only, the memory itself is the caller's, and the completed fence value comes
+// from the injected clock.
+class UploadRing
+{
+private:
+	struct Submission
+	{
+		uint64_t fenceValue;
+		uint64_t end;	// head when it was submitted
+	};
+
+	uint64_t m_capacity;
+	std::function<uint64_t()> m_completedFenceValue;
+	// positions count every byte ever used, the offset in the ring is position % capacity
+	uint64_t m_head;	// the next allocation starts here
+	uint64_t m_tail;	// everything before it has been read by the GPU
+	uint64_t m_submittedHead;
+	std::deque<Submission> m_submissions;
+	UploadRingStats m_stats;
+
+public:
+	UploadRing(uint64_t capacity, std::function<uint64_t()> completedFenceValue);
+
+	// alignment is a power of two dividing the capacity, returns false when
+	// the ring has no room for size bytes until more submissions complete
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	// everything allocated since the last call is read by copies that are done once the fence reaches fenceValue
+	void Submit(uint64_t fenceValue);
+	// moves the tail past the submissions the fence has passed, Allocate does it too
+	void Reclaim();
+
+	uint64_t GetCapacity() const;
+	uint64_t GetUsedBytes() const;	// allocated and not reclaimed yet, padding included
+	const UploadRingStats& GetStats() const;
+};
@@ -0,0 +1,174 @@
+#include "UploadRingTests.h"
+#include <cstdio>
+#include <cwchar>
+#include <random>
+#include <vector>
+#include "UploadRing.h"
+
+using std::mt19937;
+using std::vector;
+
+namespace
+{
+	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, without the Direct3D headers
+	const uint64_t TEXTURE_ALIGNMENT = 512;
+	const uint64_t KB = 1024;
+
+	struct Region
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t fenceValue;	// the GPU reads it until the fence gets here
+	};
+
+	struct FramePlan
+	{
+		const wchar_t* name;
+		uint64_t capacity;
+		uint32_t framesInFlight;	// the fence lags this many frames behind the CPU
+		uint32_t frameCount;
+		uint32_t uploadsPerFrame;
+		uint64_t maxUploadSize;
+		bool mayFail;	// the ring is too small for the busiest frames
+	};
+
+	bool Overlaps(const Region& a, const Region& b)
+	{
+		return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+	}
+
+	bool RunPlan(const FramePlan& plan)
+	{
+		uint64_t completedFenceValue = 0;
+		UploadRing ring(plan.capacity, [&]() { return completedFenceValue; });
+		mt19937 random(1234);
+		vector<Region> inFlight;
+		bool passed = true;
+
+		for (uint32_t frame = 0; frame < plan.frameCount; ++frame)
+		{
+			const uint64_t fenceValue = frame + 1;
+			completedFenceValue = fenceValue > plan.framesInFlight ? fenceValue - plan.framesInFlight : 0;
+			for (size_t i = 0; i < inFlight.size();)
+			{
+				if (inFlight[i].fenceValue <= completedFenceValue)
+				{
+					inFlight[i] = inFlight.back();
+					inFlight.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+
+			for (uint32_t upload = 0; upload < plan.uploadsPerFrame; ++upload)
+			{
+				// textures and buffers mixed, every size from a few bytes up
+				const bool texture = random() % 2 == 0;
+				const uint64_t size = 1 + random() % plan.maxUploadSize;
+				const uint64_t alignment = texture ? TEXTURE_ALIGNMENT : UPLOAD_RING_BUFFER_ALIGNMENT;
+				uint64_t offset;
+				if (!ring.Allocate(size, alignment, offset))
+				{
+					passed = passed && plan.mayFail;
+					continue;
+				}
+
+				Region region = { offset, size, fenceValue };
+				passed = passed && offset % alignment == 0 && offset + size <= plan.capacity;
+				for (const Region& other : inFlight)
+				{
+					passed = passed && !Overlaps(region, other);
+				}
+				inFlight.push_back(region);
+			}
+
+			ring.Submit(fenceValue);
+			passed = passed && ring.GetUsedBytes() <= plan.capacity;
+		}
+
+		const UploadRingStats& stats = ring.GetStats();
+		wprintf(L"  %-40s %s  %u allocations, %u wraps, %u failed, peak %llu KB\n", plan.name, passed ? L"ok" : L"FAILED",
+			stats.allocations, stats.wraps, stats.failedAllocations, static_cast<unsigned long long>(stats.peakUsedBytes / KB));
+		return passed;
+	}
+
+	// a region that would run past the end starts over at the beginning
+	bool TestWrap()
+	{
+		uint64_t completedFenceValue = 0;
+		UploadRing ring(KB, [&]() { return completedFenceValue; });
+		uint64_t offset = ~0ull;
+
+		bool passed = ring.Allocate(600, UPLOAD_RING_BUFFER_ALIGNMENT, offset) && offset == 0;
+		ring.Submit(1);
+		passed = passed && ring.Allocate(300, UPLOAD_RING_BUFFER_ALIGNMENT, offset) && offset == 608;
+		ring.Submit(2);
+
+		// the beginning is still being read
+		passed = passed && !ring.Allocate(200, UPLOAD_RING_BUFFER_ALIGNMENT, offset);
+		completedFenceValue = 1;
+		passed = passed && ring.Allocate(200, UPLOAD_RING_BUFFER_ALIGNMENT, offset) && offset == 0;
+		passed = passed && ring.GetStats().wraps == 1 && ring.GetStats().paddingBytes == 8 + KB - 908;
+
+		wprintf(L"  %-40s %s\n", L"wrap past the end", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+
+	// space comes back only once the fence passes the submission that used it
+	bool TestReclaim()
+	{
+		uint64_t completedFenceValue = 0;
+		UploadRing ring(4 * KB, [&]() { return completedFenceValue; });
+		uint64_t offset;
+
+		bool passed = true;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			passed = passed && ring.Allocate(KB, TEXTURE_ALIGNMENT, offset) && offset == i * KB;
+		}
+		passed = passed && !ring.Allocate(1, UPLOAD_RING_BUFFER_ALIGNMENT, offset);
+
+		// not submitted yet, so not reclaimed whatever the fence says
+		completedFenceValue = 10;
+		passed = passed && !ring.Allocate(1, UPLOAD_RING_BUFFER_ALIGNMENT, offset);
+
+		ring.Submit(11);
+		passed = passed && !ring.Allocate(1, UPLOAD_RING_BUFFER_ALIGNMENT, offset);
+		completedFenceValue = 11;
+		passed = passed && ring.Allocate(4 * KB, TEXTURE_ALIGNMENT, offset) && offset == 0 && ring.GetUsedBytes() == 4 * KB;
+
+		// never more than the ring holds
+		ring.Submit(12);
+		completedFenceValue = 12;
+		passed = passed && !ring.Allocate(4 * KB + 1, UPLOAD_RING_BUFFER_ALIGNMENT, offset) && ring.GetUsedBytes() == 0;
+		passed = passed && ring.GetStats().failedAllocations == 4;
+
+		wprintf(L"  %-40s %s\n", L"reclaim by fence", passed ? L"ok" : L"FAILED");
+		return passed;
+	}
+}
+
+int RunUploadRingTests()
+{
+	int failures = 0;
+
+	const FramePlan plans[] =
+	{
+		{ L"one frame in flight, 64 KB", 64 * KB, 1, 1000, 8, 4 * KB, false },
+		{ L"three frames in flight, 256 KB", 256 * KB, 3, 1000, 8, 8 * KB, false },
+		{ L"three frames in flight, 64 KB", 64 * KB, 3, 1000, 8, 8 * KB, true },
+		{ L"texture sized uploads, 1 MB", 1024 * KB, 2, 200, 2, 300 * KB, true },
+	};
+
+	for (const FramePlan& plan : plans)
+	{
+		failures += RunPlan(plan) ? 0 : 1;
+	}
+	failures += TestWrap() ? 0 : 1;
+	failures += TestReclaim() ? 0 : 1;
+
+	wprintf(L"%d failures\n", failures);
+	return failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// UploadRing driven by a fake fence with uploads of buffer and texture sizes
+// over simulated frames, checks alignment, wrapping and that no region is
+// handed out while the GPU could still be reading it, prints every case and
+// returns 0 when all of them pass
+int RunUploadRingTests();
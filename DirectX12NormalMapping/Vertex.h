@@ -0,0 +1,13 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+struct Vertex
+{
+	XMFLOAT3 position;
+	XMFLOAT3 normal;
+	XMFLOAT3 tangent;
+	XMFLOAT2 textureCoordinate;
+};
@@ -0,0 +1,357 @@
+#include "VertexQuantizer.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	const float POSITION_STEPS = 65535.0f;
+	const float SNORM16_STEPS = 32767.0f;
+
+	// float bit patterns used by the half conversion
+	const UINT32 HALF_MIN_NORMAL = 0x38800000;	// 2^-14
+	const UINT32 HALF_OVERFLOW = 0x477ff000;	// 65520, rounds to infinity
+	const UINT32 FLOAT_INFINITY = 0x7f800000;
+	const UINT32 HALF_EXPONENT_REBIAS = 0x38000000;	// (127 - 15) << 23
+	const UINT32 ONE_HALF = 0x3f000000;	// 0.5f, its ulp is the half subnormal step 2^-24
+
+	// clamps in the same argument order as _mm_max_ps/_mm_min_ps, so NaN gives the bound
+	inline float MaxScalar(float a, float b)
+	{
+		return a > b ? a : b;
+	}
+
+	inline float MinScalar(float a, float b)
+	{
+		return a < b ? a : b;
+	}
+
+	inline UINT32 AsUint(float value)
+	{
+		UINT32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline float AsFloat(UINT32 bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	inline UINT16 QuantizeUnorm16(float value, float min, float scale)
+	{
+		float t = (value - min) * scale;
+		t = MinScalar(MaxScalar(t, 0.0f), POSITION_STEPS);
+		return static_cast<UINT16>(nearbyintf(t));
+	}
+
+	inline UINT32 QuantizeSnorm16(float value)
+	{
+		float t = MinScalar(MaxScalar(value, -1.0f), 1.0f);
+		return static_cast<UINT16>(static_cast<INT16>(nearbyintf(t * SNORM16_STEPS)));
+	}
+
+	UINT32 EncodeOctahedral(const XMFLOAT3& direction)
+	{
+		float sum = (fabsf(direction.x) + fabsf(direction.y)) + fabsf(direction.z);
+		float inverse = 1.0f / sum;
+		float u = direction.x * inverse;
+		float v = direction.y * inverse;
+		float w = direction.z * inverse;
+
+		// fold the lower hemisphere over the diagonals
+		if (w < 0.0f)
+		{
+			float foldedU = (1.0f - fabsf(v)) * copysignf(1.0f, u);
+			float foldedV = (1.0f - fabsf(u)) * copysignf(1.0f, v);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		// zero length or non-finite
+		if (u != u || v != v)
+		{
+			u = 0.0f;
+			v = 0.0f;
+		}
+
+		return QuantizeSnorm16(u) | (QuantizeSnorm16(v) << 16);
+	}
+
+	void EncodeScalar(const Vertex& vertex, const float* boundsMin, const float* scale, QuantizedVertex& quantized)
+	{
+		quantized.position[0] = QuantizeUnorm16(vertex.position.x, boundsMin[0], scale[0]);
+		quantized.position[1] = QuantizeUnorm16(vertex.position.y, boundsMin[1], scale[1]);
+		quantized.position[2] = QuantizeUnorm16(vertex.position.z, boundsMin[2], scale[2]);
+		quantized.position[3] = 0;
+		quantized.normal = EncodeOctahedral(vertex.normal);
+		quantized.tangent = EncodeOctahedral(vertex.tangent);
+		quantized.textureCoordinate[0] = VertexQuantizer::FloatToHalf(vertex.textureCoordinate.x);
+		quantized.textureCoordinate[1] = VertexQuantizer::FloatToHalf(vertex.textureCoordinate.y);
+	}
+
+	// SSE2 versions of the above, one vertex per lane
+
+	inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	__m128i FloatToHalf4(__m128 values)
+	{
+		const __m128i bits = _mm_castps_si128(values);
+		const __m128i absBits = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+		const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+
+		// normal: rebias the exponent and round the mantissa to nearest even
+		__m128i roundBit = _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+		__m128i normal = _mm_sub_epi32(absBits, _mm_set1_epi32(HALF_EXPONENT_REBIAS - 0xfff));
+		normal = _mm_srli_epi32(_mm_add_epi32(normal, roundBit), 13);
+
+		// subnormal: let the float adder round to multiples of 2^-24
+		__m128 subnormalSum = _mm_add_ps(_mm_castsi128_ps(absBits), _mm_set1_ps(0.5f));
+		__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormalSum), _mm_set1_epi32(ONE_HALF));
+
+		__m128i isNormal = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(HALF_MIN_NORMAL - 1));
+		__m128i isOverflow = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(HALF_OVERFLOW - 1));
+		__m128i isNan = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(FLOAT_INFINITY));
+
+		__m128i half = Select(isNormal, normal, subnormal);
+		half = Select(isOverflow, _mm_set1_epi32(0x7c00), half);
+		half = Select(isNan, _mm_set1_epi32(0x7e00), half);
+		return _mm_or_si128(half, sign);
+	}
+
+	inline __m128i QuantizeUnorm16x4(__m128 value, __m128 min, __m128 scale)
+	{
+		__m128 t = _mm_mul_ps(_mm_sub_ps(value, min), scale);
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(POSITION_STEPS));
+		return _mm_cvtps_epi32(t);
+	}
+
+	inline __m128i QuantizeSnorm16x4(__m128 value)
+	{
+		__m128 t = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+		return _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(t, _mm_set1_ps(SNORM16_STEPS))), _mm_set1_epi32(0xffff));
+	}
+
+	__m128i EncodeOctahedral4(__m128 x, __m128 y, __m128 z)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 absX = _mm_andnot_ps(signMask, x);
+		__m128 absY = _mm_andnot_ps(signMask, y);
+		__m128 absZ = _mm_andnot_ps(signMask, z);
+
+		__m128 inverse = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(absX, absY), absZ));
+		__m128 u = _mm_mul_ps(x, inverse);
+		__m128 v = _mm_mul_ps(y, inverse);
+		__m128 w = _mm_mul_ps(z, inverse);
+
+		__m128 signU = _mm_or_ps(_mm_and_ps(u, signMask), one);
+		__m128 signV = _mm_or_ps(_mm_and_ps(v, signMask), one);
+		__m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, v)), signU);
+		__m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, u)), signV);
+
+		__m128 isLower = _mm_cmplt_ps(w, _mm_setzero_ps());
+		u = Select(isLower, foldedU, u);
+		v = Select(isLower, foldedV, v);
+
+		__m128 isValid = _mm_and_ps(_mm_cmpord_ps(u, u), _mm_cmpord_ps(v, v));
+		u = _mm_and_ps(u, isValid);
+		v = _mm_and_ps(v, isValid);
+
+		return _mm_or_si128(QuantizeSnorm16x4(u), _mm_slli_epi32(QuantizeSnorm16x4(v), 16));
+	}
+
+	void EncodeSse(const Vertex* vertices, size_t vertexCount,
+		const float* boundsMin, const float* scale, QuantizedVertex* quantizedVertices)
+	{
+		const __m128 minX = _mm_set1_ps(boundsMin[0]);
+		const __m128 minY = _mm_set1_ps(boundsMin[1]);
+		const __m128 minZ = _mm_set1_ps(boundsMin[2]);
+		const __m128 scaleX = _mm_set1_ps(scale[0]);
+		const __m128 scaleY = _mm_set1_ps(scale[1]);
+		const __m128 scaleZ = _mm_set1_ps(scale[2]);
+
+		alignas(16) UINT32 positionX[4];
+		alignas(16) UINT32 positionY[4];
+		alignas(16) UINT32 positionZ[4];
+		alignas(16) UINT32 normals[4];
+		alignas(16) UINT32 tangents[4];
+		alignas(16) UINT32 texCoordU[4];
+		alignas(16) UINT32 texCoordV[4];
+
+		size_t i = 0;
+		for (; i + 4 <= vertexCount; i += 4)
+		{
+			const Vertex& v0 = vertices[i];
+			const Vertex& v1 = vertices[i + 1];
+			const Vertex& v2 = vertices[i + 2];
+			const Vertex& v3 = vertices[i + 3];
+
+			// gather into structure of arrays form
+			__m128 px = _mm_setr_ps(v0.position.x, v1.position.x, v2.position.x, v3.position.x);
+			__m128 py = _mm_setr_ps(v0.position.y, v1.position.y, v2.position.y, v3.position.y);
+			__m128 pz = _mm_setr_ps(v0.position.z, v1.position.z, v2.position.z, v3.position.z);
+			__m128 nx = _mm_setr_ps(v0.normal.x, v1.normal.x, v2.normal.x, v3.normal.x);
+			__m128 ny = _mm_setr_ps(v0.normal.y, v1.normal.y, v2.normal.y, v3.normal.y);
+			__m128 nz = _mm_setr_ps(v0.normal.z, v1.normal.z, v2.normal.z, v3.normal.z);
+			__m128 tx = _mm_setr_ps(v0.tangent.x, v1.tangent.x, v2.tangent.x, v3.tangent.x);
+			__m128 ty = _mm_setr_ps(v0.tangent.y, v1.tangent.y, v2.tangent.y, v3.tangent.y);
+			__m128 tz = _mm_setr_ps(v0.tangent.z, v1.tangent.z, v2.tangent.z, v3.tangent.z);
+			__m128 tu = _mm_setr_ps(v0.textureCoordinate.x, v1.textureCoordinate.x, v2.textureCoordinate.x, v3.textureCoordinate.x);
+			__m128 tv = _mm_setr_ps(v0.textureCoordinate.y, v1.textureCoordinate.y, v2.textureCoordinate.y, v3.textureCoordinate.y);
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(positionX), QuantizeUnorm16x4(px, minX, scaleX));
+			_mm_store_si128(reinterpret_cast<__m128i*>(positionY), QuantizeUnorm16x4(py, minY, scaleY));
+			_mm_store_si128(reinterpret_cast<__m128i*>(positionZ), QuantizeUnorm16x4(pz, minZ, scaleZ));
+			_mm_store_si128(reinterpret_cast<__m128i*>(normals), EncodeOctahedral4(nx, ny, nz));
+			_mm_store_si128(reinterpret_cast<__m128i*>(tangents), EncodeOctahedral4(tx, ty, tz));
+			_mm_store_si128(reinterpret_cast<__m128i*>(texCoordU), FloatToHalf4(tu));
+			_mm_store_si128(reinterpret_cast<__m128i*>(texCoordV), FloatToHalf4(tv));
+
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				QuantizedVertex& quantized = quantizedVertices[i + lane];
+				quantized.position[0] = static_cast<UINT16>(positionX[lane]);
+				quantized.position[1] = static_cast<UINT16>(positionY[lane]);
+				quantized.position[2] = static_cast<UINT16>(positionZ[lane]);
+				quantized.position[3] = 0;
+				quantized.normal = normals[lane];
+				quantized.tangent = tangents[lane];
+				quantized.textureCoordinate[0] = static_cast<UINT16>(texCoordU[lane]);
+				quantized.textureCoordinate[1] = static_cast<UINT16>(texCoordV[lane]);
+			}
+		}
+
+		for (; i < vertexCount; ++i)
+		{
+			EncodeScalar(vertices[i], boundsMin, scale, quantizedVertices[i]);
+		}
+	}
+}
+
+const wchar_t* VertexQuantizer::GetKernelName(QuantizeKernel kernel)
+{
+	return kernel == QuantizeKernel::Sse ? L"SSE" : L"scalar";
+}
+
+void VertexQuantizer::Encode(QuantizeKernel kernel, const Vertex* vertices, size_t vertexCount,
+	const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, QuantizedVertex* quantizedVertices)
+{
+	const float min[3] = { boundsMin.x, boundsMin.y, boundsMin.z };
+	const float extent[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+
+	float scale[3];
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		scale[axis] = extent[axis] > 0.0f ? POSITION_STEPS / extent[axis] : 0.0f;
+	}
+
+	if (kernel == QuantizeKernel::Sse)
+	{
+		EncodeSse(vertices, vertexCount, min, scale, quantizedVertices);
+		return;
+	}
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		EncodeScalar(vertices[i], min, scale, quantizedVertices[i]);
+	}
+}
+
+UINT16 VertexQuantizer::FloatToHalf(float value)
+{
+	const UINT32 bits = AsUint(value);
+	const UINT32 absBits = bits & 0x7fffffff;
+	const UINT32 sign = (bits >> 16) & 0x8000;
+	UINT32 half;
+
+	if (absBits > FLOAT_INFINITY)
+	{
+		half = 0x7e00;
+	}
+	else if (absBits >= HALF_OVERFLOW)
+	{
+		half = 0x7c00;
+	}
+	else if (absBits >= HALF_MIN_NORMAL)
+	{
+		half = (absBits - HALF_EXPONENT_REBIAS + 0xfff + ((absBits >> 13) & 1)) >> 13;
+	}
+	else
+	{
+		half = AsUint(AsFloat(absBits) + 0.5f) - ONE_HALF;
+	}
+
+	return static_cast<UINT16>(half | sign);
+}
+
+float VertexQuantizer::HalfToFloat(UINT16 value)
+{
+	const UINT32 sign = static_cast<UINT32>(value & 0x8000) << 16;
+	const UINT32 exponent = (value >> 10) & 0x1f;
+	const UINT32 mantissa = value & 0x3ff;
+
+	if (exponent == 0)
+	{
+		return copysignf(mantissa * (1.0f / 16777216.0f), AsFloat(sign | 0x3f800000));
+	}
+
+	if (exponent == 31)
+	{
+		return AsFloat(sign | FLOAT_INFINITY | (mantissa << 13));
+	}
+
+	return AsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+void VertexQuantizer::FloatToHalfSse(const float* values, UINT16* halves)
+{
+	alignas(16) UINT32 result[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(result), FloatToHalf4(_mm_loadu_ps(values)));
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		halves[i] = static_cast<UINT16>(result[i]);
+	}
+}
+
+XMFLOAT3 VertexQuantizer::DecodePosition(const QuantizedVertex& vertex, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	return XMFLOAT3(
+		boundsMin.x + (vertex.position[0] / POSITION_STEPS) * (boundsMax.x - boundsMin.x),
+		boundsMin.y + (vertex.position[1] / POSITION_STEPS) * (boundsMax.y - boundsMin.y),
+		boundsMin.z + (vertex.position[2] / POSITION_STEPS) * (boundsMax.z - boundsMin.z));
+}
+
+XMFLOAT3 VertexQuantizer::DecodeDirection(UINT32 octahedral)
+{
+	// R16G16_SNORM, -32768 and -32767 both map to -1
+	float u = MaxScalar(static_cast<INT16>(octahedral & 0xffff) / SNORM16_STEPS, -1.0f);
+	float v = MaxScalar(static_cast<INT16>(octahedral >> 16) / SNORM16_STEPS, -1.0f);
+	float w = 1.0f - fabsf(u) - fabsf(v);
+
+	float t = MaxScalar(-w, 0.0f);
+	u += u >= 0.0f ? -t : t;
+	v += v >= 0.0f ? -t : t;
+
+	float length = sqrtf(u * u + v * v + w * w);
+	return XMFLOAT3(u / length, v / length, w / length);
+}
+
+XMFLOAT2 VertexQuantizer::DecodeTextureCoordinate(const QuantizedVertex& vertex)
+{
+	return XMFLOAT2(HalfToFloat(vertex.textureCoordinate[0]), HalfToFloat(vertex.textureCoordinate[1]));
+}
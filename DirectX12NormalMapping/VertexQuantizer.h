@@ -0,0 +1,36 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include "Vertex.h"
+#include "QuantizedVertex.h"
+
+enum class QuantizeKernel
+{
+	Scalar,
+	Sse	// 4 vertices per iteration
+};
+
+// Encodes vertices into QuantizedVertex: positions as 16 bit fractions of the
+// bounds, normal and tangent as octahedral 16 bit pairs (zero length and
+// non-finite directions become +Z) and texture coordinates as half floats.
+// Both kernels round to nearest even and give bit identical results.
+// The Decode functions mirror Shaders.hlsl and are used for error checks.
+class VertexQuantizer
+{
+public:
+	static const wchar_t* GetKernelName(QuantizeKernel kernel);
+
+	static void Encode(QuantizeKernel kernel, const Vertex* vertices, size_t vertexCount,
+		const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, QuantizedVertex* quantizedVertices);
+
+	static UINT16 FloatToHalf(float value);
+	static float HalfToFloat(UINT16 value);
+	// converts 4 floats per call with the SSE kernel, for checking it against FloatToHalf
+	static void FloatToHalfSse(const float* values, UINT16* halves);
+
+	static XMFLOAT3 DecodePosition(const QuantizedVertex& vertex, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax);
+	static XMFLOAT3 DecodeDirection(UINT32 octahedral);
+	static XMFLOAT2 DecodeTextureCoordinate(const QuantizedVertex& vertex);
+};
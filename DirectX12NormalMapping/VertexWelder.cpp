@@ -0,0 +1,156 @@
+#include "VertexWelder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+	const DWORD INVALID_VERTEX = 0xffffffff;
+	const double CELL_LIMIT = 4611686018427387904.0;	// 2^62, keeps cell + 1 in range
+
+	struct GridCell
+	{
+		INT64 x;
+		INT64 y;
+		INT64 z;
+
+		bool operator==(const GridCell& other) const
+		{
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	struct GridCellHash
+	{
+		size_t operator()(const GridCell& cell) const
+		{
+			UINT64 hash = static_cast<UINT64>(cell.x) * 0x9E3779B97F4A7C15ull;
+			hash ^= static_cast<UINT64>(cell.y) * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+			hash ^= static_cast<UINT64>(cell.z) * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	INT64 CellCoordinate(float value, float cellSize)
+	{
+		if (cellSize > 0.0f && isfinite(value))
+		{
+			double cell = floor(static_cast<double>(value) / cellSize);
+			return static_cast<INT64>(max(-CELL_LIMIT, min(CELL_LIMIT, cell)));
+		}
+
+		// exact welding, or a value that has no cell
+		UINT32 bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline bool IsWithin(float a, float b, float epsilon)
+	{
+		return fabs(a - b) <= epsilon;
+	}
+
+	inline bool IsWithin(const XMFLOAT3& a, const XMFLOAT3& b, float epsilon)
+	{
+		return IsWithin(a.x, b.x, epsilon) && IsWithin(a.y, b.y, epsilon) && IsWithin(a.z, b.z, epsilon);
+	}
+
+	bool CanWeld(const Vertex& a, const Vertex& b, const VertexWeldEpsilons& epsilons)
+	{
+		return IsWithin(a.position, b.position, epsilons.position) &&
+			IsWithin(a.normal, b.normal, epsilons.normal) &&
+			IsWithin(a.tangent, b.tangent, epsilons.tangent) &&
+			IsWithin(a.textureCoordinate.x, b.textureCoordinate.x, epsilons.textureCoordinate) &&
+			IsWithin(a.textureCoordinate.y, b.textureCoordinate.y, epsilons.textureCoordinate);
+	}
+}
+
+VertexWeldEpsilons VertexWelder::GetDefaultEpsilons()
+{
+	VertexWeldEpsilons epsilons;
+	epsilons.position = 1e-5f;
+	epsilons.normal = 1e-3f;
+	epsilons.tangent = 1e-3f;
+	epsilons.textureCoordinate = 1e-5f;
+	return epsilons;
+}
+
+void VertexWelder::Weld(vector<Vertex>& vertices, vector<DWORD>& indices,
+	const VertexWeldEpsilons& epsilons, VertexWeldStats& stats)
+{
+	stats.verticesBefore = static_cast<UINT>(vertices.size());
+
+	const float cellSize = epsilons.position;
+	const INT64 searchRadius = cellSize > 0.0f ? 1 : 0;
+
+	// every cell links the kept vertices inside it through nextInCell
+	unordered_map<GridCell, DWORD, GridCellHash> cellHeads;
+	cellHeads.reserve(vertices.size());
+	vector<DWORD> nextInCell;
+	nextInCell.reserve(vertices.size());
+
+	vector<Vertex> welded;
+	welded.reserve(vertices.size());
+	vector<DWORD> remap(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const Vertex& vertex = vertices[i];
+		const GridCell cell =
+		{
+			CellCoordinate(vertex.position.x, cellSize),
+			CellCoordinate(vertex.position.y, cellSize),
+			CellCoordinate(vertex.position.z, cellSize)
+		};
+
+		DWORD match = INVALID_VERTEX;
+
+		for (INT64 z = -searchRadius; z <= searchRadius && match == INVALID_VERTEX; ++z)
+		{
+			for (INT64 y = -searchRadius; y <= searchRadius && match == INVALID_VERTEX; ++y)
+			{
+				for (INT64 x = -searchRadius; x <= searchRadius && match == INVALID_VERTEX; ++x)
+				{
+					const GridCell neighbour = { cell.x + x, cell.y + y, cell.z + z };
+					auto head = cellHeads.find(neighbour);
+					if (head == cellHeads.end())
+					{
+						continue;
+					}
+
+					for (DWORD candidate = head->second; candidate != INVALID_VERTEX; candidate = nextInCell[candidate])
+					{
+						if (CanWeld(welded[candidate], vertex, epsilons))
+						{
+							match = candidate;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match == INVALID_VERTEX)
+		{
+			match = static_cast<DWORD>(welded.size());
+			welded.push_back(vertex);
+
+			DWORD& head = cellHeads.emplace(cell, INVALID_VERTEX).first->second;
+			nextInCell.push_back(head);
+			head = match;
+		}
+
+		remap[i] = match;
+	}
+
+	for (DWORD& index : indices)
+	{
+		index = remap[index];
+	}
+
+	vertices.swap(welded);
+	stats.verticesAfter = static_cast<UINT>(vertices.size());
+}
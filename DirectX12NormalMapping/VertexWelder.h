@@ -0,0 +1,36 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <vector>
+#include "Vertex.h"
+
+// largest per component difference for two vertices to be merged, zero
+// only merges bit identical values
+struct VertexWeldEpsilons
+{
+	float position;
+	float normal;
+	float tangent;
+	float textureCoordinate;
+};
+
+struct VertexWeldStats
+{
+	UINT verticesBefore;
+	UINT verticesAfter;
+};
+
+// Merges vertices whose attributes all lie within the epsilons and remaps the
+// index buffer. Positions are hashed into a grid with the position epsilon as
+// cell size, so only the 27 cells around a vertex have to be searched.
+// The first vertex of every group is kept unchanged.
+class VertexWelder
+{
+public:
+	static VertexWeldEpsilons GetDefaultEpsilons();
+
+	static void Weld(std::vector<Vertex>& vertices, std::vector<DWORD>& indices,
+		const VertexWeldEpsilons& epsilons, VertexWeldStats& stats);
+};